@@ -23,6 +23,11 @@ if (CXX_COMPILER_WNOUNUSEDPARAMETER)
 	add_compile_options(-Wno-unused-parameter)
 endif ()
 
+# GCC 10 needs coroutines enabled explicitly
+if (CMAKE_CXX_COMPILER_ID STREQUAL "GNU" AND CMAKE_CXX_COMPILER_VERSION VERSION_LESS 11)
+	add_compile_options(-fcoroutines)
+endif ()
+
 if (FORCE32)
 	check_c_compiler_flag(-m32 C_COMPILER_M32)
 	check_cxx_compiler_flag(-m32 CXX_COMPILER_M32)
@@ -0,0 +1,4 @@
+-- lowercase copy of login, so lookups are an exact match on an index
+ALTER TABLE `users` ADD COLUMN `login_key` varchar(50) CHARACTER SET utf8 COLLATE utf8_bin NOT NULL DEFAULT '' AFTER `login`;
+UPDATE `users` SET `login_key`=LOWER(`login`);
+ALTER TABLE `users` ADD UNIQUE KEY `login_key` (`login_key`);
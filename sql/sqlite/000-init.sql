@@ -0,0 +1,10 @@
+PRAGMA journal_mode = WAL;
+PRAGMA foreign_keys = OFF;
+
+DROP TABLE IF EXISTS `users`;
+CREATE TABLE `users` (
+  `id` INTEGER PRIMARY KEY AUTOINCREMENT,
+  `login` TEXT NOT NULL COLLATE NOCASE,
+  `password` TEXT NOT NULL,
+  `level` INTEGER NOT NULL CHECK (`level`>=0)
+);
@@ -0,0 +1,4 @@
+-- lowercase copy of login, so lookups are an exact match on an index
+ALTER TABLE `users` ADD COLUMN `login_key` TEXT NOT NULL DEFAULT '';
+UPDATE `users` SET `login_key`=LOWER(`login`);
+CREATE UNIQUE INDEX `users_login_key` ON `users` (`login_key`);
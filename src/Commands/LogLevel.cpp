@@ -0,0 +1,44 @@
+#include "LogLevel.h"
+#include "Log/LogSite.h"
+#include <boost/program_options/errors.hpp>
+#include <sstream>
+
+
+using namespace LotosPP::Commands;
+
+
+LogLevel::LogLevel()
+	: Command("loglevel", LotosPP::Common::enums::UserLevel_ADMIN)
+{}
+
+void LogLevel::execute(LotosPP::Common::User* user)
+{
+	using namespace LotosPP::Log;
+
+	if (user->getLevel()<LotosPP::Common::enums::UserLevel_ADMIN) {
+		user->uPrintf("Unknown command.\n");
+		return;
+		}
+	if (user->com.word.size()==3) {
+		try {
+			severity_level level{severity_t::to_severity(user->com.word[2])};
+			Categories::instance()->set(user->com.word[1], level);
+			LOG(LINFO) << user->getName() << " set log category " << user->com.word[1] << " to " << severity_t::to_string(level);
+			}
+		catch (boost::program_options::validation_error&) {
+			user->uPrintf("Unknown level, one of trace, debug, info, warning, error, fatal.\n");
+			return;
+			}
+		}
+	else if (user->com.word.size()!=1) {
+		user->uPrintf("Usage: .loglevel [<category> <level>]\n");
+		return;
+		}
+	std::ostringstream out;
+	out << "Log categories:\n";
+	for (const auto& [name, level] : Categories::instance()->list()) {
+		out << "  " << name << " " << severity_t::to_string(level) << "\n";
+		}
+	out << "Records suppressed by the rate limit: " << LogSite::getSuppressed() << "\n";
+	user->uPrintf("%s", out.str().c_str());
+}
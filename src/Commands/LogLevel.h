@@ -0,0 +1,22 @@
+#ifndef LOTOSPP_COMMANDS_LOGLEVEL_H
+#define	LOTOSPP_COMMANDS_LOGLEVEL_H
+
+#include "Common/Command.h"
+
+
+namespace LotosPP::Commands {
+
+/**
+ * Lists the log categories, or sets the level of one: .loglevel [<category> <level>]
+ */
+class LogLevel
+	: public LotosPP::Common::Command
+{
+public:
+	LogLevel();
+	virtual void execute(LotosPP::Common::User* user);
+};
+
+	}
+
+#endif
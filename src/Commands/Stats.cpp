@@ -0,0 +1,80 @@
+#include "Stats.h"
+#ifdef WITH_DATABASE
+#	include "Common/UserCache.h"
+#	include "Database/Executor.h"
+#	include "Database/GroupCommit.h"
+#	include "Database/QueryStats.h"
+#endif
+#include "Log/Logger.h"
+#include "Log/LogSite.h"
+#include <iomanip>
+#include <sstream>
+
+
+using namespace LotosPP::Commands;
+
+
+Stats::Stats()
+	: Command("stats", LotosPP::Common::enums::UserLevel_ADMIN)
+{}
+
+void Stats::execute(LotosPP::Common::User* user)
+{
+	if (user->getLevel()<LotosPP::Common::enums::UserLevel_ADMIN) {
+		user->uPrintf("Unknown command.\n");
+		return;
+		}
+	std::ostringstream out;
+	out << "Log records dropped: " << LotosPP::Log::Logger::getInstance()->getDropped()
+		<< ", suppressed by the rate limit: " << LotosPP::Log::LogSite::getSuppressed() << "\n";
+#ifdef WITH_DATABASE
+	using namespace LotosPP::Database;
+
+	out << "Database connections:\n";
+	uint32_t i{0};
+	for (const Executor::ConnectionStats& conn : Executor::instance()->getStats()) {
+		out << "  #" << i++ << (conn.writer ? " writer" : "") << (conn.connected ? " up" : " down")
+			<< ", jobs " << conn.jobs << ", failures " << conn.failures << ", reconnects " << conn.reconnects << "\n";
+		}
+
+	CircuitBreaker::Stats breaker=Executor::instance()->getBreakerStats();
+	out << "  breaker " << (breaker.state==CircuitBreaker::STATE_CLOSED ? "closed" : breaker.state==CircuitBreaker::STATE_OPEN ? "open" : "probing")
+		<< ", trips " << breaker.trips << ", probes " << breaker.probes << ", failed fast " << breaker.rejected;
+	if (breaker.state!=CircuitBreaker::STATE_CLOSED) {
+		out << ", retry every " << breaker.retryDelay << " ms";
+		}
+	out << "\n";
+
+	GroupCommit::Stats commit=GroupCommit::instance()->getStats();
+	out << "Group commit:\n"
+		<< "  batches " << commit.batches << ", rows " << commit.rows << " (max " << commit.maxRows << "), failures " << commit.failures
+		<< ", queued " << commit.queued << "\n"
+		<< "  commit avg " << (commit.batches ? commit.commitMicros/commit.batches : 0) << " us, max " << commit.maxCommitMicros << " us\n";
+	out << "User cache: " << LotosPP::Common::UserCache::instance()->size() << " rows\n";
+
+	QueryStats* stats=QueryStats::instance();
+	if (!stats->isEnabled()) {
+		out << "Query statistics are disabled (database.QueryStats).\n";
+		}
+	else {
+		out << "Queries by total time (us):\n"
+			<< "  " << std::setw(8) << "count" << std::setw(8) << "errors" << std::setw(9) << "p50" << std::setw(9) << "p95"
+			<< std::setw(9) << "p99" << std::setw(9) << "max" << "  statement\n";
+		for (const QueryStats::Summary& s : stats->getTop(10)) {
+			out << "  " << std::setw(8) << s.count << std::setw(8) << s.errors << std::setw(9) << s.p50 << std::setw(9) << s.p95
+				<< std::setw(9) << s.p99 << std::setw(9) << s.max << "  " << s.fingerprint.substr(0, 120) << "\n";
+			}
+		std::vector<QueryStats::SlowQuery> slow=stats->getSlow();
+		out << "Slow queries: " << (slow.empty() ? "none" : "") << "\n";
+		for (const QueryStats::SlowQuery& q : slow) {
+			char when[32];
+			strftime(when, sizeof(when), "%H:%M:%S", localtime(&q.when));
+			out << "  " << when << " " << q.micros/1000 << " ms, " << (q.rows<0 ? std::string("?") : std::to_string(q.rows)) << " rows: "
+				<< q.fingerprint.substr(0, 120) << "\n";
+			}
+		}
+#else
+	out << "Built without a database.\n";
+#endif
+	user->uPrintf("%s", out.str().c_str());
+}
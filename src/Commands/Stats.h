@@ -0,0 +1,22 @@
+#ifndef LOTOSPP_COMMANDS_STATS_H
+#define	LOTOSPP_COMMANDS_STATS_H
+
+#include "Common/Command.h"
+
+
+namespace LotosPP::Commands {
+
+/**
+ * Server internals for admins, the database pool, write batching and query latencies
+ */
+class Stats
+	: public LotosPP::Common::Command
+{
+public:
+	Stats();
+	virtual void execute(LotosPP::Common::User* user);
+};
+
+	}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef LOTOSPP_COMMON_CLOCK_H
+#define LOTOSPP_COMMON_CLOCK_H
+
+#include <boost/thread/thread_time.hpp>
+
+
+namespace LotosPP::Common {
+
+/**
+ * Time of the tasks and of the scheduler
+ *
+ * The system time, unless a simulation switched to the virtual clock. That one only moves when the simulation
+ * advances it to the next scheduler event, so hours pass as fast as their tasks run and the same way every time.
+ */
+class Clock
+{
+public:
+	static boost::system_time now()
+	{
+		return s_virtual ? s_now : boost::get_system_time();
+	};
+	static bool isVirtual()
+	{
+		return s_virtual;
+	};
+	/**
+	 * Switches to the virtual clock, before any task is created
+	 */
+	static void setVirtual(const boost::system_time& start)
+	{
+		s_now=start;
+		s_virtual=true;
+	};
+	/**
+	 * Moves the virtual clock forward, never back
+	 */
+	static void advance(const boost::system_time& to)
+	{
+		if (to>s_now) {
+			s_now=to;
+			}
+	};
+
+private:
+	static inline bool s_virtual{false};
+	static inline boost::system_time s_now{};
+};
+
+	}
+
+#endif
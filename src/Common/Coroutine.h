@@ -0,0 +1,158 @@
+#ifndef LOTOSPP_COMMON_COROUTINE_H
+#define LOTOSPP_COMMON_COROUTINE_H
+
+#include "Task.h"
+#include "globals.h"
+#include "Log/Logger.h"
+#include <boost/bind/bind.hpp>
+#include <boost/weak_ptr.hpp>
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+
+namespace LotosPP::Common {
+
+/**
+ * Fire-and-forget coroutine
+ *
+ * Runs eagerly until its first suspension and frees its own frame when it finishes. Awaitables from this header always
+ * resume it on the dispatcher thread, so the body may touch talker state between suspensions without locking.
+ */
+class Coroutine
+{
+public:
+	struct promise_type {
+		Coroutine get_return_object()
+		{
+			return {};
+		};
+		std::suspend_never initial_suspend() noexcept
+		{
+			return {};
+		};
+		std::suspend_never final_suspend() noexcept
+		{
+			return {};
+		};
+		void return_void()
+		{};
+		void unhandled_exception()
+		{
+			try {
+				std::rethrow_exception(std::current_exception());
+				}
+			catch (std::exception& e) {
+				LOG(LERROR) << "Unhandled exception in coroutine: " << e.what();
+				}
+			catch (...) {
+				LOG(LERROR) << "Unhandled exception in coroutine";
+				}
+		};
+		};
+
+	/**
+	 * Continues a suspended coroutine on the dispatcher thread
+	 *
+	 * The frame is destroyed instead when the object owning it has gone away in the meantime
+	 *
+	 * @param handle suspended coroutine
+	 * @param alive life guard of the owning object
+	 */
+	static void resume(std::coroutine_handle<> handle, boost::weak_ptr<void> alive)
+	{
+		if (alive.expired()) {
+			handle.destroy();
+			return;
+			}
+		handle.resume();
+	};
+
+	static void post(std::coroutine_handle<> handle, const boost::weak_ptr<void>& alive)
+	{
+		LotosPP::g_dispatcher.addTask(createTask(boost::bind(&Coroutine::resume, handle, alive), Task::CATEGORY_COROUTINE));
+	};
+};
+
+/**
+ * Awaitable running a blocking callable on a pool of threads
+ *
+ * Use through offload(), Pool is anything with bool addJob(boost::function<void (void)>). A pool refusing the job, shut
+ * down already, resumes the coroutine right away with a default constructed result, which callers take as failure.
+ */
+template<typename R, typename Pool>
+class Offload
+{
+public:
+	template<typename F>
+	Offload(Pool& pool, F&& f, const boost::weak_ptr<void>& alive)
+		: m_pool{pool}, m_f{std::forward<F>(f)}, m_alive{alive}
+	{};
+
+	bool await_ready() const noexcept
+	{
+		return false;
+	};
+	bool await_suspend(std::coroutine_handle<> handle)
+	{
+		return m_pool.addJob([this, handle]() {
+			// the awaitable lives in the suspended frame, so this is valid until the frame is resumed or destroyed
+			try {
+				if constexpr (std::is_void_v<R>) {
+					m_f();
+					}
+				else {
+					m_result=m_f();
+					}
+				}
+			catch (...) {
+				m_error=std::current_exception();
+				}
+			Coroutine::post(handle, m_alive);
+			});
+	};
+	R await_resume()
+	{
+		if (m_error) {
+			std::rethrow_exception(m_error);
+			}
+		if constexpr (!std::is_void_v<R>) {
+			return std::move(m_result);
+			}
+	};
+
+private:
+	struct Empty {};
+
+	Pool& m_pool;
+	boost::function<R (void)> m_f;
+	boost::weak_ptr<void> m_alive;
+	std::conditional_t<std::is_void_v<R>, Empty, R> m_result{};
+	std::exception_ptr m_error{};
+};
+
+/**
+ * Runs f on the worker pool, resumes the awaiting coroutine on the dispatcher with its result
+ *
+ * @param f callable, must not touch talker state
+ * @param alive life guard of the object owning the coroutine
+ */
+template<typename F>
+auto offload(F&& f, const boost::weak_ptr<void>& alive)
+{
+	return Offload<std::invoke_result_t<F>, WorkerPool>(LotosPP::g_workers, std::forward<F>(f), alive);
+}
+
+/**
+ * Runs f on the given pool, e.g. the database executor, resumes the awaiting coroutine on the dispatcher with its result
+ */
+template<typename Pool, typename F>
+auto offload(Pool& pool, F&& f, const boost::weak_ptr<void>& alive)
+{
+	return Offload<std::invoke_result_t<F>, Pool>(pool, std::forward<F>(f), alive);
+}
+
+	}
+
+#endif
@@ -1,26 +1,92 @@
 #include "Dispatcher.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
+#include "Probe.h"
+#include "StatsSegment.h"
 #include "Network/OutputMessage.h"
 #include "Task.h"
+#include "globals.h"
+#include "Log/LogSite.h"
+#include "System/build_config.h"
 #ifdef __EXCEPTION_TRACER__
 #	include "ExceptionHandler.h"
 #endif
 #include <boost/bind/bind.hpp>
-#ifdef __DEBUG_SCHEDULER__
-#	include <iostream>
+#include <boost/core/demangle.hpp>
+#include <array>
+#include <chrono>
+#include <sstream>
+#if defined(OS_POSIX) && !defined(OS_OPENBSD)
+#	define HAVE_STACK_SAMPLE
+#	include <cerrno>
+#	include <csignal>
+#	include <cstdlib>
+#	include <cstring>
+#	include <execinfo.h>
+#	include <pthread.h>
 #endif
 
 
 using namespace LotosPP::Common;
 
 
+namespace {
+
+typedef std::array<Metrics::Histogram*, Task::CATEGORY_COUNT> CategoryHistograms;
+
+CategoryHistograms categoryHistograms(const std::string& name, const std::string& help)
+{
+	CategoryHistograms histograms;
+	for (uint8_t i=0; i<Task::CATEGORY_COUNT; ++i) {
+		histograms[i]=Metrics::instance()->histogram(name, help,
+			std::string("category=\"")+Task::getCategoryName((Task::Category)i)+"\"");
+		}
+	return histograms;
+}
+
+CategoryHistograms queueWait{categoryHistograms("lotospp_dispatcher_queue_wait_seconds", "Time a task waited in the dispatcher queue")};
+CategoryHistograms taskDuration{categoryHistograms("lotospp_dispatcher_task_duration_seconds", "Time the dispatcher spent running a task")};
+Metrics::Counter* tasksTotal{Metrics::instance()->counter("lotospp_dispatcher_tasks_total", "Tasks the dispatcher ran")};
+
+int64_t steadyNanos()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef HAVE_STACK_SAMPLE
+// SIGURG is ignored by default, a stray one does no harm
+const int STACK_SAMPLE_SIGNAL=SIGURG;
+const int STACK_SAMPLE_DEPTH=32;
+void* stackSample[STACK_SAMPLE_DEPTH];
+// frames in stackSample, -1 while a sample is asked for
+std::atomic<int> stackSampleDepth{0};
+
+void stackSampleHandler(int)
+{
+	int savedErrno{errno};
+	stackSampleDepth.store(backtrace(stackSample, STACK_SAMPLE_DEPTH), std::memory_order_release);
+	errno=savedErrno;
+}
+#endif
+
+	}
+
 Dispatcher::Dispatcher()
 {
 	m_taskList.clear();
+	Metrics::instance()->gauge("lotospp_dispatcher_queue_length", "Tasks waiting for the dispatcher", [this] {
+			boost::lock_guard<boost::mutex> lockGuard(m_taskLock);
+			return (int64_t)m_taskList.size();
+		});
 }
 
 void Dispatcher::shutdownAndWait()
 {
 	shutdown();
+	if (m_watchdogThread.joinable()) {
+		m_watchdogThread.interrupt();
+		m_watchdogThread.join();
+		}
 	m_thread.join();
 }
 
@@ -29,6 +95,76 @@ void Dispatcher::start()
 	assert(m_threadState==STATE_TERMINATED);
 	m_threadState=STATE_RUNNING;
 	m_thread=boost::thread(boost::bind(&Dispatcher::dispatcherThread, (void*)this));
+
+	m_watchdogThreshold=LotosPP::options.get<uint32_t>("global.taskWatchdog", 1000);
+	if (m_watchdogThreshold) {
+#ifdef HAVE_STACK_SAMPLE
+		// backtrace() loads its unwinder on the first call, not in the signal handler then
+		backtrace(stackSample, 1);
+		struct sigaction sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler=&stackSampleHandler;
+		sa.sa_flags=SA_RESTART;
+		sigemptyset(&sa.sa_mask);
+		sigaction(STACK_SAMPLE_SIGNAL, &sa, nullptr);
+#endif
+		m_watchdogThread=boost::thread(boost::bind(&Dispatcher::watchdogThread, (void*)this));
+		}
+}
+
+void Dispatcher::watchdogThread(void* p)
+{
+	Dispatcher* dispatcher=(Dispatcher*)p;
+	// a task is caught within a quarter of the threshold after it passed it
+	boost::chrono::milliseconds interval{std::max<uint32_t>(10, dispatcher->m_watchdogThreshold/4)};
+	try {
+		while (dispatcher->m_threadState!=STATE_TERMINATED) {
+			boost::this_thread::sleep_for(interval);
+			dispatcher->checkRunningTask();
+			}
+		}
+	catch (boost::thread_interrupted&) {
+		}
+}
+
+void Dispatcher::checkRunningTask()
+{
+	int64_t started{m_taskStarted.load(std::memory_order_acquire)};
+	uint64_t number{m_taskNumber.load(std::memory_order_relaxed)};
+	if (!started || number==m_taskReported) {
+		return;
+		}
+	int64_t ms{(steadyNanos()-started)/1000000};
+	if (ms<m_watchdogThreshold) {
+		return;
+		}
+	m_taskReported=number;
+
+	std::ostringstream out;
+	const std::type_info* type{m_taskType.load(std::memory_order_relaxed)};
+	out << "Task of category " << Task::getCategoryName((Task::Category)m_taskCategory.load(std::memory_order_relaxed))
+		<< " running for " << ms << " ms: " << (type ? boost::core::demangle(type->name()) : "unknown");
+#ifdef HAVE_STACK_SAMPLE
+	stackSampleDepth.store(-1, std::memory_order_relaxed);
+	if (pthread_kill(m_thread.native_handle(), STACK_SAMPLE_SIGNAL)==0) {
+		int depth{-1};
+		for (uint32_t wait=0; wait<100 && (depth=stackSampleDepth.load(std::memory_order_acquire))<0; ++wait) {
+			boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+			}
+		// the task may have finished meanwhile, then this is the stack of the next one
+		if (m_taskNumber.load(std::memory_order_relaxed)!=number) {
+			out << "\n\tfinished before the stack sample";
+			}
+		else if (char** symbols=depth>0 ? backtrace_symbols(stackSample, depth) : nullptr) {
+			// the first frames are the signal handler
+			for (int i=2; i<depth; ++i) {
+				out << "\n\t" << symbols[i];
+				}
+			free(symbols);
+			}
+		}
+#endif
+	LOGC(LWARNING, "dispatcher") << out.str();
 }
 
 void Dispatcher::dispatcherThread(void* p)
@@ -38,11 +174,12 @@ void Dispatcher::dispatcherThread(void* p)
 	ExceptionHandler dispatcherExceptionHandler;
 	dispatcherExceptionHandler.InstallHandler();
 #endif
-#ifdef __DEBUG_SCHEDULER__
-	std::cout << "Starting Dispatcher" << std::endl;
-#endif
+	LOGC(LTRACE, "scheduler") << "Starting Dispatcher";
 
 	Network::OutputMessagePool* outputPool;
+	FlightRecorder* recorder{FlightRecorder::instance()};
+	recorder->setThreadName("dispatcher");
+	StatsSegment::instance()->registerThread("dispatcher");
 
 	// NOTE: second argument defer_lock is to prevent from immediate locking
 	boost::unique_lock<boost::mutex> taskLockUnique(dispatcher->m_taskLock, boost::defer_lock);
@@ -55,20 +192,17 @@ void Dispatcher::dispatcherThread(void* p)
 
 		if (dispatcher->m_taskList.empty()) {
 			//if the list is empty wait for signal
-#ifdef __DEBUG_SCHEDULER__
-			std::cout << "Dispatcher: Waiting for task" << std::endl;
-#endif
+			LOGC(LTRACE, "scheduler") << "Dispatcher: Waiting for task";
 			dispatcher->m_taskSignal.wait(taskLockUnique);
 			}
 
-#ifdef __DEBUG_SCHEDULER__
-		std::cout << "Dispatcher: Signalled" << std::endl;
-#endif
+		LOGC(LTRACE, "scheduler") << "Dispatcher: Signalled";
 
 		if (!dispatcher->m_taskList.empty() && (dispatcher->m_threadState!=STATE_TERMINATED)) {
 			// take the first task
 			task=dispatcher->m_taskList.front();
 			dispatcher->m_taskList.pop_front();
+			LOTOSPP_PROBE(task__dequeue, dispatcher->m_taskList.size());
 			}
 
 		taskLockUnique.unlock();
@@ -76,6 +210,17 @@ void Dispatcher::dispatcherThread(void* p)
 		// finally execute the task...
 		if (task) {
 			if (!task->hasExpired()) {
+				// the last TASK_BEGIN without its TASK_END is what crashed
+				uint16_t name{recorder->nameOf(task->getType())};
+				recorder->record(FlightRecorder::EVENT_TASK_BEGIN, 0, 0, name);
+				std::chrono::steady_clock::time_point begin{std::chrono::steady_clock::now()};
+				Task::Category category{task->getCategory()};
+				queueWait[category]->record(std::chrono::duration_cast<std::chrono::microseconds>(begin-task->getEnqueued()).count());
+				dispatcher->m_taskCategory.store(category, std::memory_order_relaxed);
+				dispatcher->m_taskType.store(&task->getType(), std::memory_order_relaxed);
+				dispatcher->m_taskNumber.fetch_add(1, std::memory_order_relaxed);
+				dispatcher->m_taskStarted.store(std::chrono::duration_cast<std::chrono::nanoseconds>(begin.time_since_epoch()).count(),
+					std::memory_order_release);
 				Network::OutputMessagePool::getInstance()->startExecutionFrame();
 				(*task)();
 
@@ -83,13 +228,17 @@ void Dispatcher::dispatcherThread(void* p)
 				if (outputPool) {
 					outputPool->sendAll();
 					}
+				dispatcher->m_taskStarted.store(0, std::memory_order_relaxed);
+				uint64_t nanos=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-begin).count();
+				recorder->record(FlightRecorder::EVENT_TASK_END, nanos, 0, name);
+				LOTOSPP_PROBE(task__execute, task->getType().name(), nanos);
+				taskDuration[category]->record(nanos/1000);
+				tasksTotal->add();
 				}
 
 			delete task;
 
-#ifdef __DEBUG_SCHEDULER__
-			std::cout << "Dispatcher: Executing task" << std::endl;
-#endif
+			LOGC(LTRACE, "scheduler") << "Dispatcher: Executing task";
 			}
 		}
 #ifdef __EXCEPTION_TRACER__
@@ -97,11 +246,43 @@ void Dispatcher::dispatcherThread(void* p)
 #endif
 }
 
-void Dispatcher::addTask(Task* task, bool push_front/*=false*/)
+void Dispatcher::startSimulated()
+{
+	assert(m_threadState==STATE_TERMINATED);
+	m_threadState=STATE_RUNNING;
+}
+
+size_t Dispatcher::runPending()
+{
+	size_t count{0};
+	while (true) {
+		m_taskLock.lock();
+		if (m_taskList.empty()) {
+			m_taskLock.unlock();
+			return count;
+			}
+		Task* task=m_taskList.front();
+		m_taskList.pop_front();
+		m_taskLock.unlock();
+
+		if (!task->hasExpired()) {
+			(*task)();
+			if (Network::OutputMessagePool* outputPool=Network::OutputMessagePool::getInstance(); outputPool) {
+				outputPool->sendAll();
+				}
+			++count;
+			}
+		delete task;
+		}
+}
+
+bool Dispatcher::addTask(Task* task, bool push_front/*=false*/)
 {
-	bool do_signal{false};
+	bool do_signal{false},
+		added{false};
 	m_taskLock.lock();
 	if (m_threadState==STATE_RUNNING) {
+		added=true;
 		do_signal=m_taskList.empty();
 		if (push_front) {
 			m_taskList.push_front(task);
@@ -109,23 +290,26 @@ void Dispatcher::addTask(Task* task, bool push_front/*=false*/)
 		else {
 			m_taskList.push_back(task);
 			}
+		task->setEnqueued();
+		LOTOSPP_PROBE(task__enqueue, m_taskList.size());
 
-#ifdef __DEBUG_SCHEDULER__
-		std::cout << "Dispatcher: Added task" << std::endl;
-#endif
+		LOGC(LTRACE, "scheduler") << "Dispatcher: Added task";
 		}
-#ifdef __DEBUG_SCHEDULER__
 	else {
-		std::cout << "Error: [Dispatcher::addTask] Dispatcher thread is terminated." << std::endl;
+		LOGC(LTRACE, "scheduler") << "Error: [Dispatcher::addTask] Dispatcher thread is terminated.";
 		}
-#endif
 
 	m_taskLock.unlock();
 
+	if (!added) {
+		delete task;
+		return false;
+		}
 	// send a signal if the list was empty
 	if (do_signal) {
 		m_taskSignal.notify_one();
 		}
+	return true;
 }
 
 void Dispatcher::flush()
@@ -140,9 +324,7 @@ void Dispatcher::flush()
 			outputPool->sendAll();
 			}
 		}
-#ifdef __DEBUG_SCHEDULER__
-	std::cout << "Flushing Dispatcher" << std::endl;
-#endif
+	LOGC(LTRACE, "scheduler") << "Flushing Dispatcher";
 }
 
 void Dispatcher::stop()
@@ -150,9 +332,7 @@ void Dispatcher::stop()
 	m_taskLock.lock();
 	m_threadState=STATE_CLOSING;
 	m_taskLock.unlock();
-#ifdef __DEBUG_SCHEDULER__
-	std::cout << "Stopping Dispatcher" << std::endl;
-#endif
+	LOGC(LTRACE, "scheduler") << "Stopping Dispatcher";
 }
 
 void Dispatcher::shutdown()
@@ -161,7 +341,5 @@ void Dispatcher::shutdown()
 	m_threadState=STATE_TERMINATED;
 	flush();
 	m_taskLock.unlock();
-#ifdef __DEBUG_SCHEDULER__
-	std::cout << "Shutdown Dispatcher" << std::endl;
-#endif
+	LOGC(LTRACE, "scheduler") << "Shutdown Dispatcher";
 }
@@ -2,7 +2,9 @@
 #define LOTOSPP_COMMON_DISPATCHER_H
 
 #include <boost/thread.hpp>
+#include <atomic>
 #include <list>
+#include <typeinfo>
 
 
 namespace LotosPP::Common {
@@ -10,6 +12,13 @@ namespace LotosPP::Common {
 
 //const int DISPATCHER_TASK_EXPIRATION=2000;
 
+/**
+ * Runs the tasks of the talker one at a time, on a thread of its own
+ *
+ * The queue wait and the execution time of the tasks go to histograms by Task::Category. A watchdog thread logs any
+ * task running for longer than global.taskWatchdog ms (0 for none) with its category, its type and a stack sample
+ * of the dispatcher thread.
+ */
 class Dispatcher
 {
 public:
@@ -17,13 +26,27 @@ public:
 	~Dispatcher()
 	{};
 
-	void addTask(Task* task, bool push_front=false);
+	/**
+	 * @return false when the dispatcher doesn't take tasks anymore, the task is deleted without running then
+	 */
+	bool addTask(Task* task, bool push_front=false);
 
 	void start();
 	void stop();
 	void shutdown();
 	void shutdownAndWait();
 
+	/**
+	 * Simulation: takes tasks without a thread, runPending() runs them
+	 */
+	void startSimulated();
+	/**
+	 * Simulation: runs the queued tasks on the calling thread, the tasks they add too
+	 *
+	 * @return number of tasks run
+	 */
+	size_t runPending();
+
 	enum DispatcherState {
 		STATE_RUNNING,
 		STATE_CLOSING,
@@ -32,10 +55,21 @@ public:
 
 protected:
 	static void dispatcherThread(void* p);
+	static void watchdogThread(void* p);
 
 	void flush();
+	void checkRunningTask();
 
 	boost::thread m_thread;
+	boost::thread m_watchdogThread;
+	uint32_t m_watchdogThreshold{0};
+
+	// the running task for the watchdog, m_taskStarted is 0 between tasks
+	std::atomic<int64_t> m_taskStarted{0};
+	std::atomic<uint64_t> m_taskNumber{0};
+	std::atomic<uint8_t> m_taskCategory{0};
+	std::atomic<const std::type_info*> m_taskType{nullptr};
+	uint64_t m_taskReported{0};
 	boost::mutex m_taskLock;
 	boost::condition_variable m_taskSignal;
 
@@ -2,6 +2,7 @@
 
 #ifdef __EXCEPTION_TRACER__
 
+#include "FlightRecorder.h"
 #include "globals.h"
 #include <cstdlib>
 #include <iostream>
@@ -474,6 +475,8 @@ void _SigHandler(int signum, siginfo_t *info, void* void_context)
 {
 	bool file{false};
 	ucontext_t context=*(ucontext_t*)void_context;
+	// first, the report below may crash again
+	LotosPP::Common::FlightRecorder::instance()->annotate(signum, info->si_addr);
 
 	std::ostream* outdriver;
 	std::cout << "Error: generating report file..." << std::endl;
@@ -492,7 +495,11 @@ void _SigHandler(int signum, siginfo_t *info, void* void_context)
 	*outdriver << "*****************************************************" << std::endl;
 	*outdriver << "Error report - " << std::ctime(&rawtime) << std::endl;
 	*outdriver << "Compiler info - " << COMPILER_STRING << std::endl;
-	*outdriver << "Compilation Date - " << COMPILATION_DATE << std::endl << std::endl;
+	*outdriver << "Compilation Date - " << COMPILATION_DATE << std::endl;
+	if (LotosPP::Common::FlightRecorder::instance()->isEnabled()) {
+		*outdriver << "Flight recorder - " << LotosPP::Common::FlightRecorder::instance()->getFileName() << std::endl;
+		}
+	*outdriver << std::endl;
 
 	if (rusage resources; getrusage(RUSAGE_SELF, &resources)!=-1) {
 		//- global memory information
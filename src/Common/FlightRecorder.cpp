@@ -0,0 +1,153 @@
+#include "FlightRecorder.h"
+#include "Singleton.h"
+#include "globals.h"
+#include "System/build_config.h"
+#include "Log/Logger.h"
+#include <cxxabi.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#ifdef OS_POSIX
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <unistd.h>
+#endif
+
+
+using namespace LotosPP::Common;
+
+
+FlightRecorder* FlightRecorder::instance()
+{
+	static LotosPP::Common::Singleton<FlightRecorder> instance;
+	return instance.get();
+}
+
+bool FlightRecorder::start()
+{
+#ifdef OS_POSIX
+	if (m_events || !options.get<bool>("global.flightRecorder", true)) {
+		return false;
+		}
+	// a power of two, the index wraps with a mask
+	uint64_t capacity{1024};
+	while (capacity<options.get<uint64_t>("global.flightRecorderEvents", 65536) && capacity<(1ull<<24)) {
+		capacity<<=1;
+		}
+	size_t namesOffset{(sizeof(Header)+63)&~(size_t)63};
+	size_t eventsOffset{namesOffset+NAME_SLOTS*NAME_LENGTH};
+	m_mapSize=eventsOffset+capacity*sizeof(Event);
+
+	m_fileName=options.get("global.log.dir", "")+"/flight.rec";
+	// keep what the last run, perhaps a crash, left
+	std::rename(m_fileName.c_str(), (m_fileName+".prev").c_str());
+	int fd=open(m_fileName.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0640);
+	if (fd<0 || ftruncate(fd, m_mapSize)!=0) {
+		LOG(LWARNING) << "Can't create the flight recorder " << m_fileName << ": " << strerror(errno);
+		if (fd>=0) {
+			close(fd);
+			}
+		return false;
+		}
+	void* map=mmap(nullptr, m_mapSize, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map==MAP_FAILED) {
+		LOG(LWARNING) << "Can't map the flight recorder " << m_fileName << ": " << strerror(errno);
+		return false;
+		}
+	m_map=map;
+	m_header=new (map) Header;
+	memcpy(m_header->magic, MAGIC, sizeof(MAGIC));
+	m_header->version=VERSION;
+	m_header->eventSize=sizeof(Event);
+	m_header->capacity=capacity;
+	m_header->pid=getpid();
+	m_header->startTime=time(nullptr);
+	m_header->next=0;
+	m_header->names=0;
+	m_header->signal=0;
+	m_names=(char*)map+namesOffset;
+	m_mask=capacity-1;
+	// the file is zero filled, seq 0 marks the unused events
+	m_events=(Event*)((char*)map+eventsOffset);
+	record(EVENT_START);
+	LOG(LINFO) << "Flight recorder: " << m_fileName << ", " << capacity << " events";
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FlightRecorder::stop()
+{
+#ifdef OS_POSIX
+	if (!m_events) {
+		return;
+		}
+	record(EVENT_STOP);
+	// threads may still record, the mapping stays, only the disk is brought up to date
+	msync(m_map, m_mapSize, MS_ASYNC);
+#endif
+}
+
+void FlightRecorder::setThreadName(const std::string& name)
+{
+	if (m_events && threadIndex()<THREAD_SLOTS) {
+		m_header->threads[threadIndex()]=intern(name);
+		}
+}
+
+uint16_t FlightRecorder::nameOf(const std::type_info& type)
+{
+	if (!m_events) {
+		return 0;
+		}
+	// demangling is slow, each thread knows the types it met
+	static thread_local std::unordered_map<const std::type_info*, uint16_t> typeNames;
+	if (auto it=typeNames.find(&type); it!=typeNames.end()) {
+		return it->second;
+		}
+	int status;
+	char* demangled=abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+	uint16_t id=intern(demangled ? demangled : type.name());
+	free(demangled);
+	typeNames.emplace(&type, id);
+	return id;
+}
+
+uint16_t FlightRecorder::intern(const std::string& name)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_nameLock);
+	if (auto it=m_nameIds.find(name); it!=m_nameIds.end()) {
+		return it->second;
+		}
+	uint32_t id=m_header->names.load();
+	if (id>=NAME_SLOTS) {
+		// full, 0 stays unnamed
+		return 0;
+		}
+	// id 0 is the empty name
+	if (id==0) {
+		id=1;
+		}
+	char* slot=m_names+id*NAME_LENGTH;
+	size_t length=std::min<size_t>(name.length(), NAME_LENGTH-1);
+	memcpy(slot, name.data(), length);
+	slot[length]='\0';
+	m_header->names.store(id+1, std::memory_order_release);
+	m_nameIds.emplace(name, id);
+	return id;
+}
+
+void FlightRecorder::annotate(int signal, const void* address)
+{
+	if (!m_events) {
+		return;
+		}
+	m_header->signal=signal;
+	record(EVENT_SIGNAL, signal, (uint64_t)address);
+}
@@ -0,0 +1,149 @@
+#ifndef LOTOSPP_COMMON_FLIGHTRECORDER_H
+#define LOTOSPP_COMMON_FLIGHTRECORDER_H
+
+#include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <cstdint>
+
+
+namespace LotosPP::Common {
+
+/**
+ * Flight recorder, the last events of the server for post-mortem analysis
+ *
+ * A ring of global.flightRecorderEvents fixed-size events in <log dir>/flight.rec, mapped shared into memory so
+ * what was written survives a crash of the process. Recording is a fetch_add on the ring index and a few plain
+ * stores, no locks and no system calls. The crash handler adds the signal, lotospp-flightdecode prints the
+ * timeline. A start moves the file of the previous run to flight.rec.prev.
+ *
+ * File layout: Header, NAME_SLOTS names of NAME_LENGTH bytes, the ring of Events.
+ */
+class FlightRecorder
+{
+public:
+	static constexpr char MAGIC[8]={'L', 'P', 'P', 'F', 'L', 'I', 'T', '1'};
+	static const uint32_t VERSION=1;
+	static constexpr uint32_t NAME_SLOTS=1024;
+	static constexpr uint32_t NAME_LENGTH=128;
+	static constexpr uint32_t THREAD_SLOTS=256;
+
+	enum EventType : uint16_t {
+		EVENT_START=1,
+		EVENT_STOP,
+		// aux the name of the callable
+		EVENT_TASK_BEGIN,
+		// a duration in ns, aux the name of the callable
+		EVENT_TASK_END,
+		// a event id, aux the name of the callable
+		EVENT_SCHEDULER_FIRE,
+		// a connection, b IPv4 address (0 for IPv6), aux remote port
+		EVENT_CONNECTION_OPEN,
+		// a connection
+		EVENT_CONNECTION_CLOSE,
+		// a signal, b fault address
+		EVENT_SIGNAL
+		};
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t eventSize;
+		uint64_t capacity;
+		uint64_t pid;
+		// unix time of the start, event times are ns since the epoch
+		uint64_t startTime;
+		std::atomic<uint64_t> next;
+		std::atomic<uint32_t> names;
+		int32_t signal;
+		// name ids of the threads by index, they outlive the events of the ring
+		uint16_t threads[THREAD_SLOTS];
+		};
+
+	struct Event {
+		// index+1 once the event is complete, 0 while it is written
+		std::atomic<uint64_t> seq;
+		uint64_t time;
+		uint64_t a;
+		uint64_t b;
+		uint32_t thread;
+		uint16_t type;
+		uint16_t aux;
+		};
+
+	static FlightRecorder* instance();
+
+	FlightRecorder()
+	{};
+
+	/**
+	 * Maps the file, if global.flightRecorder isn't off
+	 */
+	bool start();
+	void stop();
+	bool isEnabled() const
+	{
+		return m_events!=nullptr;
+	};
+	const std::string& getFileName() const
+	{
+		return m_fileName;
+	};
+
+	void record(EventType type, uint64_t a=0, uint64_t b=0, uint16_t aux=0)
+	{
+		if (!m_events) {
+			return;
+			}
+		uint64_t i=m_header->next.fetch_add(1, std::memory_order_relaxed);
+		Event& event=m_events[i&m_mask];
+		event.seq.store(0, std::memory_order_relaxed);
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+		event.time=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		event.a=a;
+		event.b=b;
+		event.thread=threadIndex();
+		event.type=type;
+		event.aux=aux;
+		event.seq.store(i+1, std::memory_order_release);
+	};
+	/**
+	 * Names the calling thread in the timeline, the first THREAD_SLOTS threads
+	 */
+	void setThreadName(const std::string& name);
+	/**
+	 * @return id of the demangled name of a callable type, stored once in the file
+	 */
+	uint16_t nameOf(const std::type_info& type);
+	/**
+	 * From the crash handler, async-signal-safe
+	 */
+	void annotate(int signal, const void* address);
+
+private:
+	static uint32_t threadIndex()
+	{
+		static std::atomic<uint32_t> threads{0};
+		static thread_local uint32_t index{++threads};
+		return index;
+	};
+	uint16_t intern(const std::string& name);
+
+	std::string m_fileName{};
+	void* m_map{nullptr};
+	size_t m_mapSize{0};
+	Header* m_header{nullptr};
+	char* m_names{nullptr};
+	Event* m_events{nullptr};
+	uint64_t m_mask{0};
+
+	boost::mutex m_nameLock;
+	std::unordered_map<std::string, uint16_t> m_nameIds{};
+};
+
+	}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef LOTOSPP_COMMON_HISTOGRAM_H
+#define LOTOSPP_COMMON_HISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <cstdint>
+
+
+namespace LotosPP::Common {
+
+/**
+ * Log-linear histogram, HDR style
+ *
+ * Every power of two is split into 16 linear sub-buckets, so any recorded value is known to within about 6%, with a
+ * fixed 5 KiB footprint and O(1) recording. Values are unitless, latencies are recorded in microseconds by convention.
+ * Not thread safe, the owner locks.
+ */
+class Histogram
+{
+public:
+	static const uint32_t SUB_BITS=4;
+	static const uint32_t SUB_BUCKETS=1<<SUB_BITS;
+	// up to 2^40, above that everything lands in the last bucket
+	static const uint32_t MAX_BITS=40;
+	static const uint32_t BUCKETS=(MAX_BITS-SUB_BITS+1)*SUB_BUCKETS;
+
+	void record(uint64_t value)
+	{
+		++m_buckets[index(value)];
+		++m_count;
+		m_sum+=value;
+		m_min=std::min(m_min, value);
+		m_max=std::max(m_max, value);
+	};
+	void merge(const Histogram& other)
+	{
+		for (uint32_t i=0; i<BUCKETS; ++i) {
+			m_buckets[i]+=other.m_buckets[i];
+			}
+		m_count+=other.m_count;
+		m_sum+=other.m_sum;
+		m_min=std::min(m_min, other.m_min);
+		m_max=std::max(m_max, other.m_max);
+	};
+	void reset()
+	{
+		*this=Histogram();
+	};
+
+	uint64_t getCount() const
+	{
+		return m_count;
+	};
+	uint64_t getSum() const
+	{
+		return m_sum;
+	};
+	uint64_t getMin() const
+	{
+		return m_count ? m_min : 0;
+	};
+	uint64_t getMax() const
+	{
+		return m_max;
+	};
+	uint64_t getMean() const
+	{
+		return m_count ? m_sum/m_count : 0;
+	};
+	/**
+	 * @param percentile 0-100
+	 * @return highest value of the bucket the percentile falls in, never above the maximum recorded
+	 */
+	uint64_t getPercentile(double percentile) const
+	{
+		if (!m_count) {
+			return 0;
+			}
+		uint64_t rank=std::max<uint64_t>(1, (uint64_t)(percentile/100.0*m_count+0.5));
+		uint64_t seen{0};
+		for (uint32_t i=0; i<BUCKETS; ++i) {
+			if ((seen+=m_buckets[i])>=rank) {
+				return std::min(upperBound(i), m_max);
+				}
+			}
+		return m_max;
+	};
+
+	/**
+	 * Bucket of a value, exposed for exporters
+	 */
+	static uint32_t index(uint64_t value)
+	{
+		if (value<SUB_BUCKETS) {
+			return value;
+			}
+		uint32_t exponent=std::bit_width(value)-1;
+		if (exponent>=MAX_BITS) {
+			return BUCKETS-1;
+			}
+		return (exponent-SUB_BITS+1)*SUB_BUCKETS+((value>>(exponent-SUB_BITS))&(SUB_BUCKETS-1));
+	};
+	static uint64_t upperBound(uint32_t bucket)
+	{
+		if (bucket<SUB_BUCKETS) {
+			return bucket;
+			}
+		uint32_t shift=bucket/SUB_BUCKETS-1;
+		return ((uint64_t)(SUB_BUCKETS+bucket%SUB_BUCKETS+1)<<shift)-1;
+	};
+	uint64_t getBucket(uint32_t bucket) const
+	{
+		return m_buckets[bucket];
+	};
+
+private:
+	std::array<uint64_t, BUCKETS> m_buckets{};
+	uint64_t m_count{0};
+	uint64_t m_sum{0};
+	uint64_t m_min{std::numeric_limits<uint64_t>::max()};
+	uint64_t m_max{0};
+};
+
+	}
+
+#endif
@@ -1,10 +1,13 @@
 #include "IOUser.h"
 #include "Singleton.h"
 #include "User.h"
+#include "UserCache.h"
+#include "Database/GroupCommit.h"
 #include "Database/Query.h"
 #include "Database/Transaction.h"
-#include "Database/Insert.h"
 #include "Database/Result.h"
+#include "Database/Statement.h"
+#include <boost/algorithm/string/case_conv.hpp>
 
 
 using namespace LotosPP::Common;
@@ -18,23 +21,16 @@ IOUser* IOUser::instance()
 
 bool IOUser::load(User* user, const std::string& userName, bool preload/*=false*/)
 {
-	Database::Driver* db=Database::Driver::instance();
-	Database::Query query;
-	Database::Result_ptr result;
-
-	query << "SELECT id, level, password \
-		FROM `users` \
-		WHERE login=LOWER(" << db->escapeString(userName) << ")";
-
-	if (!(result=db->storeQuery(query))) {
+	UserRecord record;
+	if (load(record, userName)!=LOAD_FOUND) {
 		return false;
 		}
-	user->setGUID(result->getDataInt("id"));
+	user->setGUID(record.guid);
 	if (user->password) {
-		user->password->assign(result->getDataString("password"));
+		user->password->assign(record.password);
 		}
 	else {
-		user->password=new std::string(result->getDataString("password"));
+		user->password=new std::string(record.password);
 		}
 
 	if (preload) {
@@ -42,47 +38,92 @@ bool IOUser::load(User* user, const std::string& userName, bool preload/*=false*
 		return true;
 		}
 
-	user->level=UserLevel::fromInteger(result->getDataUInt("level"));
+	user->level=record.level;
 
 	return true;
 }
 
-bool IOUser::save(const User* user, [[maybe_unused]]bool shallow/*=false*/)
+IOUser::LoadResult IOUser::load(UserRecord& record, const std::string& userName)
 {
+	std::string key{boost::algorithm::to_lower_copy(userName)};
+	if (UserCache::instance()->get(key, record)) {
+		return LOAD_FOUND;
+		}
+
 	Database::Driver* db=Database::Driver::instance();
-	Database::Query query;
+	Database::Query lock;
+	Database::Statement_ptr stmt;
 	Database::Result_ptr result;
 
-	query << "UPDATE users SET "
-		<< " login=" << db->escapeString(user->name)
-		<< ", level=" << user->level.value()
-		<< " WHERE id=" << user->getGUID();
-	Database::Transaction transaction(db);
-	if (!transaction.begin()) {
-		return false;
+	// login_key is the lowercase login, an exact match uses its unique index
+	if (!(stmt=db->prepare("SELECT id, level, password, login FROM `users` WHERE login_key=?"))) {
+		return LOAD_ERROR;
+		}
+	if (!(result=stmt->bind(key).query())) {
+		return stmt->failed() ? LOAD_ERROR : LOAD_MISSING;
 		}
-	if (!db->executeQuery(query)) {
+	// columns in the order of the SELECT list
+	record.guid=result->get<uint32_t>(0);
+	record.level=UserLevel::fromInteger(result->get<int32_t>(1));
+	record.password=result->get<std::string>(2);
+	record.name=result->get<std::string>(3);
+
+	UserCache::instance()->put(key, record);
+	return LOAD_FOUND;
+}
+
+bool IOUser::save(const User* user, [[maybe_unused]]bool shallow/*=false*/)
+{
+	UserRecord record;
+	// fills the cache on a miss, the password isn't kept by a logged in User
+	if (load(record, user->name)!=LOAD_FOUND) {
 		return false;
 		}
-	return transaction.commit();
+	record.guid=user->getGUID();
+	record.name=user->name;
+	record.level=user->level;
+	if (user->password) {
+		record.password=*user->password;
+		}
+	UserCache::instance()->update(boost::algorithm::to_lower_copy(user->name), record);
+	return true;
+}
+
+void IOUser::queueSave(const UserRecord& record, const boost::function<void (bool)>& callback)
+{
+	Database::GroupCommit::instance()->upsert("users", {"id", "login", "login_key", "password", "level"}, "id", {
+			(uint64_t)record.guid,
+			record.name,
+			boost::algorithm::to_lower_copy(record.name),
+			record.password,
+			(int64_t)record.level.value()
+		}, callback);
 }
 
 uint64_t IOUser::create(const User* user)
+{
+	return create(user->name, *user->password, user->level);
+}
+
+uint64_t IOUser::create(const std::string& userName, const std::string& password, UserLevel level)
 {
 	Database::Driver* db=Database::Driver::instance();
-	Database::Query query;
+	Database::Query lock;
+	Database::Statement_ptr stmt;
+	std::string key{boost::algorithm::to_lower_copy(userName)};
+
+	if (!(stmt=db->prepare("INSERT INTO users (login, login_key, password, level) VALUES (?, ?, ?, ?)"))) {
+		return false;
+		}
 	Database::Transaction transaction(db);
 	transaction.begin();
-	Database::Insert insert(db);
-
-	insert.setQuery("INSERT INTO users (login, password, level) VALUES ");
-	query.reset();
-	query << db->escapeString(user->name) << "," << db->escapeString(*user->password) << "," << user->level.value();
-	if (!insert.addRow(query.str()) || !insert.execute()) {
+	if (!stmt->bind(userName).bind(key).bind(password).bind((int32_t)level.value()).execute()) {
 		return false;
 		}
-	uint64_t id=db->getLastInsertedRowID();
-	return transaction.commit()
-		? id
-		: 0;
+	uint64_t id=stmt->getLastInsertedRowID();
+	if (!transaction.commit()) {
+		return 0;
+		}
+	UserCache::instance()->put(key, UserRecord{(uint32_t)id, userName, password, level});
+	return id;
 }
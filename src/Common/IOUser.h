@@ -1,6 +1,8 @@
 #ifndef LOTOSPP_COMMON_IOUSER_H
 #define LOTOSPP_COMMON_IOUSER_H
 
+#include "Common/Enums/UserLevel.h"
+#include <boost/function.hpp>
 #include <string>
 #include <cstdint>
 
@@ -8,9 +10,25 @@
 namespace LotosPP::Common {
 	class User;
 
+/**
+ * Account data as stored in the database, detached from any User so it can be loaded off the dispatcher thread
+ */
+struct UserRecord {
+	uint32_t guid{0};
+	std::string name{};
+	std::string password{};
+	UserLevel level{enums::UserLevel_LOGIN};
+};
+
 class IOUser
 {
 public:
+	enum LoadResult {
+		LOAD_FOUND,
+		LOAD_MISSING,
+		LOAD_ERROR
+		};
+
 	static IOUser* instance();
 
 	/**
@@ -22,14 +40,43 @@ public:
 	 * @return true if the user was successfully loaded
 	 */
 	bool load(User* user, const std::string& userName, bool preLoad=false);
+	/**
+	 * Load an account record
+	 *
+	 * @param record record to load to
+	 * @param userName Name of the user
+	 * @return LOAD_MISSING only when the database said there is no such user, LOAD_ERROR when it could not be asked
+	 */
+	LoadResult load(UserRecord& record, const std::string& userName);
 	/**
 	 * Save a user
+	 *
+	 * Only updates the UserCache, the row reaches the database with its next flush.
+	 *
 	 * @param user the user to save
 	 * @param shallow
 	 * @return true if the user was successfully saved
 	 */
 	bool save(const User* user, bool shallow=false);
+	/**
+	 * Queue an account record for writing
+	 *
+	 * It is written with others in a single transaction by Database::GroupCommit, inserted or updated by guid.
+	 *
+	 * @param record record to write, guid set
+	 * @param callback called with the outcome on a database thread once the batch is done
+	 */
+	void queueSave(const UserRecord& record, const boost::function<void (bool)>& callback);
 	uint64_t create(const User* user);
+	/**
+	 * Create an account
+	 *
+	 * @param userName Name of the user
+	 * @param password hashed password
+	 * @param level initial level
+	 * @return guid of the new account, 0 on failure
+	 */
+	uint64_t create(const std::string& userName, const std::string& password, UserLevel level);
 //	bool getPassword(const std::string& userName, std::string& password);
 };
 
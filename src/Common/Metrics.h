@@ -0,0 +1,282 @@
+#ifndef LOTOSPP_COMMON_METRICS_H
+#define LOTOSPP_COMMON_METRICS_H
+
+#include <boost/function.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+namespace LotosPP::Common {
+
+/**
+ * Registry of runtime metrics: counters, gauges and latency histograms by name
+ *
+ * A metric is registered once, usually into a static at its call site, and lives as long as the process; registering
+ * a name again returns the same metric, registering it as another type throws. Updates are lock free. Counters and
+ * histograms are split into shards on their own cache lines, each thread updates one, a scrape sums them. The admin
+ * port serves the registry in the Prometheus text format, names follow its conventions. Counters and histograms of
+ * one name may be split by labels, e.g. category="input", each label set is a metric of its own.
+ */
+class Metrics
+{
+public:
+	static const uint32_t SHARDS=16;
+
+	static Metrics* instance()
+	{
+		static Metrics instance;
+		return &instance;
+	};
+
+	class Metric
+	{
+	public:
+		enum Type {
+			TYPE_COUNTER,
+			TYPE_GAUGE,
+			TYPE_HISTOGRAM
+			};
+
+		Metric(const std::string& name, const std::string& help, Type type, const std::string& labels=std::string())
+			: m_name{name}, m_help{help}, m_type{type}, m_labels{labels}
+		{};
+		virtual ~Metric()
+		{};
+
+		const std::string& getName() const
+		{
+			return m_name;
+		};
+		const std::string& getHelp() const
+		{
+			return m_help;
+		};
+		Type getType() const
+		{
+			return m_type;
+		};
+		/**
+		 * @return labels in the exposition syntax, name="value",..., empty for none
+		 */
+		const std::string& getLabels() const
+		{
+			return m_labels;
+		};
+
+	private:
+		std::string m_name;
+		std::string m_help;
+		Type m_type;
+		std::string m_labels;
+	};
+
+	class Counter
+		: public Metric
+	{
+	public:
+		static constexpr Type TYPE=TYPE_COUNTER;
+
+		Counter(const std::string& name, const std::string& help, const std::string& labels)
+			: Metric(name, help, TYPE, labels)
+		{};
+
+		void add(uint64_t n=1)
+		{
+			m_shards[shard()].value.fetch_add(n, std::memory_order_relaxed);
+		};
+		uint64_t get() const
+		{
+			uint64_t value{0};
+			for (const Shard& shard : m_shards) {
+				value+=shard.value.load(std::memory_order_relaxed);
+				}
+			return value;
+		};
+
+	private:
+		struct alignas(64) Shard {
+			std::atomic<uint64_t> value{0};
+		};
+		std::array<Shard, SHARDS> m_shards{};
+	};
+
+	/**
+	 * A value going up and down, or read from its owner at the scrape
+	 */
+	class Gauge
+		: public Metric
+	{
+	public:
+		static constexpr Type TYPE=TYPE_GAUGE;
+
+		Gauge(const std::string& name, const std::string& help, const boost::function<int64_t (void)>& read)
+			: Metric(name, help, TYPE), m_read{read}
+		{};
+
+		void set(int64_t value)
+		{
+			m_value.store(value, std::memory_order_relaxed);
+		};
+		void add(int64_t n=1)
+		{
+			m_value.fetch_add(n, std::memory_order_relaxed);
+		};
+		void sub(int64_t n=1)
+		{
+			m_value.fetch_sub(n, std::memory_order_relaxed);
+		};
+		int64_t get() const
+		{
+			return m_read ? m_read() : m_value.load(std::memory_order_relaxed);
+		};
+
+	private:
+		boost::function<int64_t (void)> m_read;
+		std::atomic<int64_t> m_value{0};
+	};
+
+	/**
+	 * Latencies in microseconds, counted into the fixed buckets of UPPER_BOUNDS
+	 */
+	class Histogram
+		: public Metric
+	{
+	public:
+		static constexpr std::array<uint64_t, 16> UPPER_BOUNDS{
+			100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+			1000000, 2500000, 5000000, 10000000
+			};
+		// the last one is +Inf
+		static const uint32_t BUCKETS=UPPER_BOUNDS.size()+1;
+		static constexpr Type TYPE=TYPE_HISTOGRAM;
+
+		Histogram(const std::string& name, const std::string& help, const std::string& labels)
+			: Metric(name, help, TYPE, labels)
+		{};
+
+		void record(uint64_t micros)
+		{
+			uint32_t bucket{0};
+			while (bucket<UPPER_BOUNDS.size() && micros>UPPER_BOUNDS[bucket]) {
+				++bucket;
+				}
+			Shard& s=m_shards[shard()];
+			s.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+			s.sum.fetch_add(micros, std::memory_order_relaxed);
+		};
+
+		struct Snapshot {
+			std::array<uint64_t, BUCKETS> buckets{};
+			uint64_t count{0};
+			uint64_t sum{0};
+		};
+		/**
+		 * @return counts per bucket, not cumulative, summed over the shards
+		 */
+		Snapshot get() const
+		{
+			Snapshot snapshot;
+			for (const Shard& s : m_shards) {
+				for (uint32_t i=0; i<BUCKETS; ++i) {
+					uint64_t n{s.buckets[i].load(std::memory_order_relaxed)};
+					snapshot.buckets[i]+=n;
+					snapshot.count+=n;
+					}
+				snapshot.sum+=s.sum.load(std::memory_order_relaxed);
+				}
+			return snapshot;
+		};
+
+	private:
+		struct alignas(64) Shard {
+			std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+			std::atomic<uint64_t> sum{0};
+		};
+		std::array<Shard, SHARDS> m_shards{};
+	};
+
+	Counter* counter(const std::string& name, const std::string& help, const std::string& labels=std::string())
+	{
+		return add<Counter>(key(name, labels), name, help, labels);
+	};
+	Gauge* gauge(const std::string& name, const std::string& help, const boost::function<int64_t (void)>& read=boost::function<int64_t (void)>())
+	{
+		return add<Gauge>(name, name, help, read);
+	};
+	Histogram* histogram(const std::string& name, const std::string& help, const std::string& labels=std::string())
+	{
+		return add<Histogram>(key(name, labels), name, help, labels);
+	};
+
+	/**
+	 * @return the metric of that name without labels, nullptr when there is none
+	 */
+	const Metric* find(const std::string& name)
+	{
+		boost::lock_guard<boost::mutex> lockGuard(m_lock);
+		std::map<std::string, std::unique_ptr<Metric>>::const_iterator it=m_metrics.find(name);
+		return it==m_metrics.end() ? nullptr : it->second.get();
+	};
+	/**
+	 * @return all metrics by name, those of a name next to each other
+	 */
+	std::vector<const Metric*> getAll()
+	{
+		boost::lock_guard<boost::mutex> lockGuard(m_lock);
+		std::vector<const Metric*> metrics;
+		metrics.reserve(m_metrics.size());
+		for (const auto& [name, metric] : m_metrics) {
+			metrics.push_back(metric.get());
+			}
+		return metrics;
+	};
+
+private:
+	/**
+	 * Shard of the calling thread, threads take them in turn
+	 */
+	static uint32_t shard()
+	{
+		static std::atomic<uint32_t> next{0};
+		thread_local uint32_t shard{next.fetch_add(1, std::memory_order_relaxed)%SHARDS};
+		return shard;
+	};
+
+	/**
+	 * Registry key, '\x01' sorts before any character of a name so the label sets of a name follow it directly
+	 */
+	static std::string key(const std::string& name, const std::string& labels)
+	{
+		return labels.empty() ? name : name+'\x01'+labels;
+	};
+
+	template <typename T, typename... Args>
+	T* add(const std::string& key, const std::string& name, const std::string& help, Args&&... args)
+	{
+		boost::lock_guard<boost::mutex> lockGuard(m_lock);
+		std::unique_ptr<Metric>& metric=m_metrics[key];
+		if (!metric) {
+			metric.reset(new T(name, help, std::forward<Args>(args)...));
+			}
+		else if (metric->getType()!=T::TYPE) {
+			// two call sites disagree on what the name is, one of them would update the other through the wrong type
+			throw std::runtime_error("metric "+name+" is already registered with another type");
+			}
+		return static_cast<T*>(metric.get());
+	};
+
+	boost::mutex m_lock;
+	std::map<std::string, std::unique_ptr<Metric>> m_metrics{};
+};
+
+	}
+
+#endif
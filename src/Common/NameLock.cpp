@@ -0,0 +1,71 @@
+#include "NameLock.h"
+#include "Singleton.h"
+#include "Task.h"
+#include "globals.h"
+#include <boost/bind/bind.hpp>
+
+
+using namespace LotosPP::Common;
+
+
+NameLock* NameLock::instance()
+{
+	static Singleton<NameLock> instance;
+	return instance.get();
+}
+
+void NameLock::Guard::release()
+{
+	if (!m_held) {
+		return;
+		}
+	m_held=false;
+	NameLock::instance()->release(m_name);
+}
+
+bool NameLock::Acquire::await_ready()
+{
+	if (m_lock->isLocked(m_name)) {
+		return false;
+		}
+	m_lock->m_names[m_name];
+	return true;
+}
+
+void NameLock::Acquire::await_suspend(std::coroutine_handle<> handle)
+{
+	m_lock->m_names[m_name].push_back(Waiter(handle, m_alive));
+}
+
+void NameLock::release(const std::string& name)
+{
+	auto it=m_names.find(name);
+	if (it==m_names.end()) {
+		return;
+		}
+	if (it->second.empty()) {
+		m_names.erase(it);
+		return;
+		}
+	// the name stays locked until the next waiter runs, do not resume it from inside the releasing code
+	LotosPP::g_dispatcher.addTask(createTask(boost::bind(&NameLock::wakeNext, name), Task::CATEGORY_USER));
+}
+
+void NameLock::wakeNext(const std::string& name)
+{
+	NameLock* lock=NameLock::instance();
+	auto it=lock->m_names.find(name);
+	if (it==lock->m_names.end()) {
+		return;
+		}
+	while (!it->second.empty()) {
+		Waiter waiter=it->second.front();
+		it->second.pop_front();
+		if (!waiter.second.expired()) {
+			waiter.first.resume();
+			return;
+			}
+		waiter.first.destroy();
+		}
+	lock->m_names.erase(it);
+}
@@ -0,0 +1,119 @@
+#ifndef LOTOSPP_COMMON_NAMELOCK_H
+#define LOTOSPP_COMMON_NAMELOCK_H
+
+#include <boost/weak_ptr.hpp>
+#include <coroutine>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+
+
+namespace LotosPP::Common {
+
+/**
+ * Per user name lock for the login coroutines
+ *
+ * Makes sure only one session at a time loads, creates or logs into a given account. Dispatcher thread only.
+ */
+class NameLock
+{
+public:
+	static NameLock* instance();
+
+	/**
+	 * Ownership of a locked name, releases it when destroyed
+	 */
+	class Guard
+	{
+	public:
+		Guard()
+		{};
+		explicit Guard(const std::string& name)
+			: m_name{name}, m_held{true}
+		{};
+		Guard(Guard&& other) noexcept
+			: m_name{std::move(other.m_name)}, m_held{std::exchange(other.m_held, false)}
+		{};
+		Guard& operator=(Guard&& other) noexcept
+		{
+			if (this!=&other) {
+				release();
+				m_name=std::move(other.m_name);
+				m_held=std::exchange(other.m_held, false);
+				}
+			return *this;
+		};
+		Guard(const Guard&)=delete;
+		Guard& operator=(const Guard&)=delete;
+		~Guard()
+		{
+			release();
+		};
+
+		void release();
+		bool held() const
+		{
+			return m_held;
+		};
+		const std::string& name() const
+		{
+			return m_name;
+		};
+
+	private:
+		std::string m_name{};
+		bool m_held{false};
+	};
+
+	/**
+	 * Awaitable returned by acquire()
+	 */
+	class Acquire
+	{
+	public:
+		Acquire(NameLock* lock, const std::string& name, const boost::weak_ptr<void>& alive)
+			: m_lock{lock}, m_name{name}, m_alive{alive}
+		{};
+
+		bool await_ready();
+		void await_suspend(std::coroutine_handle<> handle);
+		Guard await_resume()
+		{
+			return Guard(m_name);
+		};
+
+	private:
+		NameLock* m_lock;
+		std::string m_name;
+		boost::weak_ptr<void> m_alive;
+	};
+
+	/**
+	 * Waits until nobody else holds the name
+	 *
+	 * @param name lowercase user name
+	 * @param alive life guard of the object owning the coroutine, dead waiters are skipped
+	 */
+	Acquire acquire(const std::string& name, const boost::weak_ptr<void>& alive)
+	{
+		return Acquire(this, name, alive);
+	};
+
+	bool isLocked(const std::string& name) const
+	{
+		return m_names.find(name)!=m_names.end();
+	};
+
+protected:
+	typedef std::pair<std::coroutine_handle<>, boost::weak_ptr<void>> Waiter;
+
+	void release(const std::string& name);
+	static void wakeNext(const std::string& name);
+
+	std::map<std::string, std::deque<Waiter>> m_names{};
+};
+
+	}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef LOTOSPP_COMMON_PROBE_H
+#define LOTOSPP_COMMON_PROBE_H
+
+/**
+ * USDT static tracepoints of the provider lotospp
+ *
+ * A probe is a nop in the code and a note in the ELF file, bpftrace, perf or systemtap patch it into a trap while
+ * they are attached and only then it costs anything. Built in when sys/sdt.h is found (WITH_USDT), empty otherwise.
+ * Arguments are integers or C strings, keep them cheap to compute: they are evaluated even with nothing attached.
+ *
+ *	bpftrace -l 'usdt:bin/lotospp:lotospp:*'
+ *	bpftrace -e 'usdt:bin/lotospp:lotospp:task__execute { @[str(arg0)]=hist(arg1); }'
+ *
+ * Probes and arguments:
+ *	connection__accept(connection, IPv4 address or 0, remote port)
+ *	connection__close(connection)
+ *	packet__received(connection, bytes)
+ *	message__send(connection, bytes)
+ *	task__enqueue(queue length)
+ *	task__dequeue(queue length)
+ *	task__execute(mangled type of the callable, ns)
+ *	scheduler__fire(event id, mangled type of the callable)
+ *	query__start(sql)
+ *	query__end(sql, us, 1 if it succeeded)
+ */
+#ifdef WITH_USDT
+#	include <sys/sdt.h>
+#	define LOTOSPP_PROBE(...) STAP_PROBEV(lotospp, __VA_ARGS__)
+#else
+#	define LOTOSPP_PROBE(...) do {} while (false)
+#endif
+
+#endif
@@ -1,12 +1,13 @@
 #include "Scheduler.h"
+#include "FlightRecorder.h"
+#include "Probe.h"
+#include "StatsSegment.h"
 #ifdef __EXCEPTION_TRACER__
 #	include "ExceptionHandler.h"
 #endif
 #include "globals.h"
+#include "Log/LogSite.h"
 #include <boost/bind/bind.hpp>
-#ifdef __DEBUG_SCHEDULER__
-#	include <iostream>
-#endif
 
 
 using namespace LotosPP::Common;
@@ -36,9 +37,11 @@ void Scheduler::schedulerThread(void* p)
 	ExceptionHandler schedulerExceptionHandler;
 	schedulerExceptionHandler.InstallHandler();
 #endif
-#ifdef __DEBUG_SCHEDULER__
-	std::cout << "Starting Scheduler" << std::endl;
-#endif
+	LOGC(LTRACE, "scheduler") << "Starting Scheduler";
+
+	FlightRecorder* recorder{FlightRecorder::instance()};
+	recorder->setThreadName("scheduler");
+	StatsSegment::instance()->registerThread("scheduler");
 
 	// NOTE: second argument defer_lock is to prevent from immediate locking
 	boost::unique_lock<boost::mutex> eventLockUnique(scheduler->m_eventLock, boost::defer_lock);
@@ -50,21 +53,15 @@ void Scheduler::schedulerThread(void* p)
 		eventLockUnique.lock();
 
 		if (scheduler->m_eventList.empty()) {
-#ifdef __DEBUG_SCHEDULER__
-			std::cout << "Scheduler: No events" << std::endl;
-#endif
+			LOGC(LTRACE, "scheduler") << "Scheduler: No events";
 			scheduler->m_eventSignal.wait(eventLockUnique);
 			}
 		else {
-#ifdef __DEBUG_SCHEDULER__
-			std::cout << "Scheduler: Waiting for event" << std::endl;
-#endif
+			LOGC(LTRACE, "scheduler") << "Scheduler: Waiting for event";
 			ret=scheduler->m_eventSignal.timed_wait(eventLockUnique, scheduler->m_eventList.top()->getCycle());
 			}
 
-#ifdef __DEBUG_SCHEDULER__
-		std::cout << "Scheduler: Signaled" << std::endl;
-#endif
+		LOGC(LTRACE, "scheduler") << "Scheduler: Signaled";
 		SchedulerTask* task{nullptr};
 		bool runTask{false};
 
@@ -90,9 +87,9 @@ void Scheduler::schedulerThread(void* p)
 			if (runTask) {
 				// Expiration has another meaning for dispatcher tasks, reset it
 				task->setDontExpire();
-#ifdef __DEBUG_SCHEDULER__
-				std::cout << "Scheduler: Executing event " << task->getEventId() << std::endl;
-#endif
+				recorder->record(FlightRecorder::EVENT_SCHEDULER_FIRE, task->getEventId(), 0, recorder->nameOf(task->getType()));
+				LOTOSPP_PROBE(scheduler__fire, task->getEventId(), task->getType().name());
+				LOGC(LTRACE, "scheduler") << "Scheduler: Executing event " << task->getEventId();
 				LotosPP::g_dispatcher.addTask(task);
 				}
 			else {
@@ -106,6 +103,41 @@ void Scheduler::schedulerThread(void* p)
 #endif
 }
 
+void Scheduler::startSimulated()
+{
+	assert(m_threadState==STATE_TERMINATED);
+	m_threadState=STATE_RUNNING;
+}
+
+bool Scheduler::runNext(const boost::system_time& until)
+{
+	while (true) {
+		m_eventLock.lock();
+		if (m_eventList.empty() || m_eventList.top()->getCycle()>until) {
+			m_eventLock.unlock();
+			return false;
+			}
+		SchedulerTask* task=m_eventList.top();
+		m_eventList.pop();
+		bool runTask{false};
+		if (EventIdSet::iterator it=m_eventIds.find(task->getEventId()); it!=m_eventIds.end()) {
+			runTask=true;
+			m_eventIds.erase(it);
+			}
+		m_eventLock.unlock();
+
+		if (!runTask) {
+			// was stopped
+			delete task;
+			continue;
+			}
+		Clock::advance(task->getCycle());
+		task->setDontExpire();
+		LotosPP::g_dispatcher.addTask(task);
+		return true;
+		}
+}
+
 uint32_t Scheduler::addEvent(SchedulerTask* task)
 {
 	bool do_signal{false};
@@ -130,15 +162,11 @@ uint32_t Scheduler::addEvent(SchedulerTask* task)
 		// we have to signal it
 		do_signal=(task==m_eventList.top());
 
-#ifdef __DEBUG_SCHEDULER__
-		std::cout << "Scheduler: Added event " << task->getEventId() << std::endl;
-#endif
+		LOGC(LTRACE, "scheduler") << "Scheduler: Added event " << task->getEventId();
 		}
-#ifdef __DEBUG_SCHEDULER__
 	else {
-		std::cout << "Error: [Scheduler::addTask] Scheduler thread is terminated." << std::endl;
+		LOGC(LTRACE, "scheduler") << "Error: [Scheduler::addTask] Scheduler thread is terminated.";
 		}
-#endif
 
 	m_eventLock.unlock();
 
@@ -155,9 +183,7 @@ bool Scheduler::stopEvent(uint32_t eventid)
 		return false;
 		}
 
-#ifdef __DEBUG_SCHEDULER__
-	std::cout << "Scheduler: Stopping event " << eventid << std::endl;
-#endif
+	LOGC(LTRACE, "scheduler") << "Scheduler: Stopping event " << eventid;
 
 	m_eventLock.lock();
 
@@ -175,9 +201,7 @@ bool Scheduler::stopEvent(uint32_t eventid)
 
 void Scheduler::stop()
 {
-#ifdef __DEBUG_SCHEDULER__
-	std::cout << "Stopping Scheduler" << std::endl;
-#endif
+	LOGC(LTRACE, "scheduler") << "Stopping Scheduler";
 	m_eventLock.lock();
 	m_threadState=Scheduler::STATE_CLOSING;
 	m_eventLock.unlock();
@@ -185,9 +209,7 @@ void Scheduler::stop()
 
 void Scheduler::shutdown()
 {
-#ifdef __DEBUG_SCHEDULER__
-	std::cout << "Shutdown Scheduler" << std::endl;
-#endif
+	LOGC(LTRACE, "scheduler") << "Shutdown Scheduler";
 	m_eventLock.lock();
 	m_threadState=Scheduler::STATE_TERMINATED;
 
@@ -31,6 +31,10 @@ public:
 
 	bool operator<(const SchedulerTask& other) const
 	{
+		// events due together fire in the order they were added
+		if (getCycle()==other.getCycle()) {
+			return m_eventid>other.m_eventid;
+			}
 		return getCycle()>other.getCycle();
 	};
 
@@ -38,7 +42,7 @@ public:
 
 protected:
 	SchedulerTask(uint32_t delay, const boost::function<void (void)>& f)
-		: Task(delay, f)
+		: Task(delay, f, CATEGORY_SCHEDULER)
 	{};
 
 	uint32_t m_eventid{0};
@@ -81,6 +85,17 @@ public:
 	void shutdown();
 	void shutdownAndWait();
 
+	/**
+	 * Simulation: takes events without a thread, runNext() fires them on the virtual clock
+	 */
+	void startSimulated();
+	/**
+	 * Simulation: advances the virtual clock to the next event due by until and hands it to the dispatcher
+	 *
+	 * @return false when there is none
+	 */
+	bool runNext(const boost::system_time& until);
+
 	enum SchedulerState {
 		STATE_RUNNING,
 		STATE_CLOSING,
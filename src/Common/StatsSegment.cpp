@@ -0,0 +1,174 @@
+#include "StatsSegment.h"
+#include "Metrics.h"
+#include "Scheduler.h"
+#include "Singleton.h"
+#include "globals.h"
+#include "System/build_config.h"
+#include "Log/Logger.h"
+#include <boost/thread/lock_guard.hpp>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+#ifdef OS_POSIX
+#	include <fcntl.h>
+#	include <pthread.h>
+#	include <sys/mman.h>
+#	include <unistd.h>
+#endif
+
+
+using namespace LotosPP::Common;
+
+
+namespace {
+
+/**
+ * @return value of a counter or gauge, count of a histogram, 0 when it isn't registered
+ */
+uint64_t metricValue(const char* name)
+{
+	const Metrics::Metric* metric=Metrics::instance()->find(name);
+	if (!metric) {
+		return 0;
+		}
+	switch (metric->getType()) {
+		case Metrics::Metric::TYPE_COUNTER:
+			return static_cast<const Metrics::Counter*>(metric)->get();
+		case Metrics::Metric::TYPE_GAUGE:
+			return std::max<int64_t>(0, static_cast<const Metrics::Gauge*>(metric)->get());
+		case Metrics::Metric::TYPE_HISTOGRAM:
+			return static_cast<const Metrics::Histogram*>(metric)->get().count;
+		}
+	return 0;
+}
+
+	}
+
+StatsSegment* StatsSegment::instance()
+{
+	static LotosPP::Common::Singleton<StatsSegment> instance;
+	return instance.get();
+}
+
+bool StatsSegment::start()
+{
+#ifdef OS_POSIX
+	m_name=options.get("global.statsSegment", "/lotospp-"+options.get("global.userPort", std::string()));
+	if (m_segment || m_name.empty()) {
+		return false;
+		}
+	m_interval=std::max<uint32_t>(options.get<uint32_t>("global.statsInterval", 1000), SchedulerTask::SCHEDULER_MINTICKS);
+
+	// a segment left by a crashed run is replaced
+	shm_unlink(m_name.c_str());
+	int fd=shm_open(m_name.c_str(), O_RDWR|O_CREAT|O_EXCL, 0640);
+	if (fd<0 || ftruncate(fd, sizeof(Segment))!=0) {
+		LOG(LWARNING) << "Can't create the stats segment " << m_name << ": " << strerror(errno);
+		if (fd>=0) {
+			close(fd);
+			shm_unlink(m_name.c_str());
+			}
+		return false;
+		}
+	void* map=mmap(nullptr, sizeof(Segment), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map==MAP_FAILED) {
+		LOG(LWARNING) << "Can't map the stats segment " << m_name << ": " << strerror(errno);
+		shm_unlink(m_name.c_str());
+		return false;
+		}
+	// zero filled, the atomics start at 0
+	m_segment=new (map) Segment;
+	m_segment->version=VERSION;
+	m_segment->size=sizeof(Segment);
+	m_segment->pid=getpid();
+	m_segment->startTime=time(nullptr);
+	update();
+	// readers check the magic last, it marks a segment ready
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(m_segment->magic, MAGIC, sizeof(MAGIC));
+	g_scheduler.addEvent(createSchedulerTask(m_interval, &StatsSegment::updateEvent));
+	LOG(LINFO) << "Stats segment: " << m_name << ", every " << m_interval << " ms";
+	return true;
+#else
+	return false;
+#endif
+}
+
+void StatsSegment::stop()
+{
+#ifdef OS_POSIX
+	if (!m_segment) {
+		return;
+		}
+	// mapped readers keep what they have, new ones find nothing
+	shm_unlink(m_name.c_str());
+#endif
+}
+
+void StatsSegment::registerThread(const std::string& name)
+{
+#ifdef OS_POSIX
+	clockid_t clock;
+	if (pthread_getcpuclockid(pthread_self(), &clock)!=0) {
+		return;
+		}
+	boost::lock_guard<boost::mutex> lockGuard(m_threadLock);
+	if (m_threads.size()<THREAD_SLOTS) {
+		m_threads.push_back(Thread{name, (int64_t)clock});
+		}
+#endif
+}
+
+void StatsSegment::updateEvent()
+{
+	StatsSegment* segment=instance();
+	segment->update();
+	g_scheduler.addEvent(createSchedulerTask(segment->m_interval, &StatsSegment::updateEvent));
+}
+
+void StatsSegment::update()
+{
+#ifdef OS_POSIX
+	// read before the sequence goes odd, readers retry for as short as possible
+	uint64_t connections{metricValue("lotospp_connections")},
+		connectionsTotal{metricValue("lotospp_connections_total")},
+		users{metricValue("lotospp_users")},
+		dispatcherQueue{metricValue("lotospp_dispatcher_queue_length")},
+		tasks{metricValue("lotospp_dispatcher_tasks_total")},
+		poolMessages{metricValue("lotospp_output_messages")},
+		poolAvailable{metricValue("lotospp_output_messages_available")},
+		receivedBytes{metricValue("lotospp_network_receive_bytes_total")},
+		sentBytes{metricValue("lotospp_network_transmit_bytes_total")};
+	boost::lock_guard<boost::mutex> lockGuard(m_threadLock);
+	std::vector<uint64_t> cpu(m_threads.size(), 0);
+	for (size_t i=0; i<m_threads.size(); ++i) {
+		struct timespec ts;
+		if (clock_gettime((clockid_t)m_threads[i].clock, &ts)==0) {
+			cpu[i]=(uint64_t)ts.tv_sec*1000000000+ts.tv_nsec;
+			}
+		}
+
+	uint32_t sequence=m_segment->sequence.load(std::memory_order_relaxed);
+	m_segment->sequence.store(sequence+1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_segment->time.store(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count(),
+		std::memory_order_relaxed);
+	m_segment->connections.store(connections, std::memory_order_relaxed);
+	m_segment->connectionsTotal.store(connectionsTotal, std::memory_order_relaxed);
+	m_segment->users.store(users, std::memory_order_relaxed);
+	m_segment->dispatcherQueue.store(dispatcherQueue, std::memory_order_relaxed);
+	m_segment->tasks.store(tasks, std::memory_order_relaxed);
+	m_segment->poolMessages.store(poolMessages, std::memory_order_relaxed);
+	m_segment->poolAvailable.store(poolAvailable, std::memory_order_relaxed);
+	m_segment->receivedBytes.store(receivedBytes, std::memory_order_relaxed);
+	m_segment->sentBytes.store(sentBytes, std::memory_order_relaxed);
+	for (size_t i=0; i<m_threads.size(); ++i) {
+		strncpy(m_segment->thread[i].name, m_threads[i].name.c_str(), THREAD_NAME_LENGTH-1);
+		m_segment->thread[i].cpuNanos.store(cpu[i], std::memory_order_relaxed);
+		}
+	m_segment->threads.store(m_threads.size(), std::memory_order_relaxed);
+	m_segment->sequence.store(sequence+2, std::memory_order_release);
+#endif
+}
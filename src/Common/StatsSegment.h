@@ -0,0 +1,168 @@
+#ifndef LOTOSPP_COMMON_STATSSEGMENT_H
+#define LOTOSPP_COMMON_STATSSEGMENT_H
+
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+
+namespace LotosPP::Common {
+
+/**
+ * Stats segment, the core counters of the server in POSIX shared memory
+ *
+ * Once every global.statsInterval ms the dispatcher copies the counters of the metrics registry and the CPU time of
+ * the named threads into the segment global.statsSegment (/lotospp-<userPort> by default, empty for none). The
+ * segment is a fixed Segment, versioned by a seqlock: the sequence is odd while the server writes, a reader copies
+ * the fields and keeps the copy if the sequence didn't change meanwhile. Readers such as lotospp-top only map it,
+ * the server neither waits for them nor knows about them.
+ */
+class StatsSegment
+{
+public:
+	static constexpr char MAGIC[8]={'L', 'P', 'P', 'S', 'T', 'A', 'T', '1'};
+	static const uint32_t VERSION=1;
+	static constexpr uint32_t THREAD_SLOTS=64;
+	static constexpr uint32_t THREAD_NAME_LENGTH=16;
+
+	struct ThreadSlot {
+		char name[THREAD_NAME_LENGTH];
+		std::atomic<uint64_t> cpuNanos;
+		};
+
+	struct Segment {
+		char magic[8];
+		uint32_t version;
+		uint32_t size;
+		uint64_t pid;
+		// unix time of the start
+		uint64_t startTime;
+		std::atomic<uint32_t> sequence;
+		std::atomic<uint32_t> threads;
+		// unix time of the update in ms
+		std::atomic<uint64_t> time;
+		std::atomic<uint64_t> connections;
+		std::atomic<uint64_t> connectionsTotal;
+		std::atomic<uint64_t> users;
+		std::atomic<uint64_t> dispatcherQueue;
+		std::atomic<uint64_t> tasks;
+		std::atomic<uint64_t> poolMessages;
+		std::atomic<uint64_t> poolAvailable;
+		std::atomic<uint64_t> receivedBytes;
+		std::atomic<uint64_t> sentBytes;
+		ThreadSlot thread[THREAD_SLOTS];
+		};
+
+	/**
+	 * A consistent copy of a Segment
+	 */
+	struct Snapshot {
+		uint64_t pid;
+		uint64_t startTime;
+		uint64_t time;
+		uint64_t connections;
+		uint64_t connectionsTotal;
+		uint64_t users;
+		uint64_t dispatcherQueue;
+		uint64_t tasks;
+		uint64_t poolMessages;
+		uint64_t poolAvailable;
+		uint64_t receivedBytes;
+		uint64_t sentBytes;
+		struct Thread {
+			std::string name;
+			uint64_t cpuNanos;
+			};
+		std::vector<Thread> threads;
+		};
+
+	static StatsSegment* instance();
+
+	StatsSegment()
+	{};
+
+	/**
+	 * Creates the segment and schedules its updates, unless global.statsSegment is empty
+	 */
+	bool start();
+	void stop();
+	bool isEnabled() const
+	{
+		return m_segment!=nullptr;
+	};
+	const std::string& getName() const
+	{
+		return m_name;
+	};
+
+	/**
+	 * Publishes the CPU time of the calling thread under name, from the thread itself
+	 */
+	void registerThread(const std::string& name);
+
+	/**
+	 * Reader side, copies segment once no update is in progress
+	 *
+	 * @return false when the server kept writing for all the attempts
+	 */
+	static bool read(const Segment* segment, Snapshot& snapshot)
+	{
+		for (uint32_t attempt=0; attempt<1000; ++attempt) {
+			uint32_t before=segment->sequence.load(std::memory_order_acquire);
+			if (before&1) {
+				continue;
+				}
+			snapshot.pid=segment->pid;
+			snapshot.startTime=segment->startTime;
+			snapshot.time=segment->time.load(std::memory_order_relaxed);
+			snapshot.connections=segment->connections.load(std::memory_order_relaxed);
+			snapshot.connectionsTotal=segment->connectionsTotal.load(std::memory_order_relaxed);
+			snapshot.users=segment->users.load(std::memory_order_relaxed);
+			snapshot.dispatcherQueue=segment->dispatcherQueue.load(std::memory_order_relaxed);
+			snapshot.tasks=segment->tasks.load(std::memory_order_relaxed);
+			snapshot.poolMessages=segment->poolMessages.load(std::memory_order_relaxed);
+			snapshot.poolAvailable=segment->poolAvailable.load(std::memory_order_relaxed);
+			snapshot.receivedBytes=segment->receivedBytes.load(std::memory_order_relaxed);
+			snapshot.sentBytes=segment->sentBytes.load(std::memory_order_relaxed);
+			uint32_t threads=std::min(segment->threads.load(std::memory_order_relaxed), THREAD_SLOTS);
+			snapshot.threads.resize(threads);
+			for (uint32_t i=0; i<threads; ++i) {
+				char name[THREAD_NAME_LENGTH];
+				memcpy(name, segment->thread[i].name, sizeof(name));
+				name[THREAD_NAME_LENGTH-1]='\0';
+				snapshot.threads[i].name=name;
+				snapshot.threads[i].cpuNanos=segment->thread[i].cpuNanos.load(std::memory_order_relaxed);
+				}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (segment->sequence.load(std::memory_order_relaxed)==before) {
+				return true;
+				}
+			}
+		return false;
+	};
+
+private:
+	static void updateEvent();
+	void update();
+
+	std::string m_name{};
+	uint32_t m_interval{1000};
+	Segment* m_segment{nullptr};
+
+	struct Thread {
+		std::string name;
+		// clockid_t of the thread CPU clock
+		int64_t clock;
+		};
+	boost::mutex m_threadLock;
+	std::vector<Thread> m_threads{};
+};
+
+	}
+
+#endif
@@ -74,6 +74,7 @@ void Talker::shutdown()
 
 	LotosPP::g_scheduler.shutdown();
 	LotosPP::g_dispatcher.shutdown();
+	LotosPP::g_workers.shutdown();
 
 	cleanup();
 
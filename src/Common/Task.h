@@ -1,8 +1,11 @@
 #ifndef LOTOSPP_COMMON_TASK_H
 #define LOTOSPP_COMMON_TASK_H
 
+#include "Clock.h"
 #include <boost/function.hpp>
 #include <boost/thread/thread_time.hpp>
+#include <chrono>
+#include <typeinfo>
 
 
 namespace LotosPP::Common {
@@ -11,12 +14,38 @@ namespace LotosPP::Common {
 class Task
 {
 public:
+	/**
+	 * What a task does, the dispatcher keeps its queue wait and execution times by category
+	 */
+	enum Category : uint8_t {
+		CATEGORY_OTHER,
+		// a line or a command of a user
+		CATEGORY_INPUT,
+		// closing and releasing connections, protocols and output messages
+		CATEGORY_NETWORK,
+		// an event the scheduler fired
+		CATEGORY_SCHEDULER,
+		// a result of the database executor
+		CATEGORY_DATABASE,
+		// a coroutine resumed once its blocking work is done
+		CATEGORY_COROUTINE,
+		// session ends and name lock hand-overs
+		CATEGORY_USER,
+		CATEGORY_COUNT
+		};
+
+	static const char* getCategoryName(Category category)
+	{
+		static const char* names[CATEGORY_COUNT]={"other", "input", "network", "scheduler", "database", "coroutine", "user"};
+		return category<CATEGORY_COUNT ? names[category] : "other";
+	};
+
 	// DO NOT allocate this class on the stack
-	Task(uint32_t ms, const boost::function<void (void)>& f)
-		: m_expiration{boost::get_system_time()+boost::posix_time::milliseconds(ms)}, m_f{f}
+	Task(uint32_t ms, const boost::function<void (void)>& f, Category category=CATEGORY_OTHER)
+		: m_expiration{Clock::now()+boost::posix_time::milliseconds(ms)}, m_f{f}, m_category{category}
 	{};
-	Task(const boost::function<void (void)>& f)
-		: m_expiration{boost::date_time::not_a_date_time}, m_f{f}
+	Task(const boost::function<void (void)>& f, Category category=CATEGORY_OTHER)
+		: m_expiration{boost::date_time::not_a_date_time}, m_f{f}, m_category{category}
 	{};
 
 	~Task()
@@ -27,6 +56,31 @@ public:
 		m_f();
 	};
 
+	/**
+	 * @return type of the callable, for the flight recorder
+	 */
+	const std::type_info& getType() const
+	{
+		return m_f.target_type();
+	};
+
+	Category getCategory() const
+	{
+		return m_category;
+	};
+
+	/**
+	 * Marks the task queued, the dispatcher measures the wait from here
+	 */
+	void setEnqueued()
+	{
+		m_enqueued=std::chrono::steady_clock::now();
+	};
+	std::chrono::steady_clock::time_point getEnqueued() const
+	{
+		return m_enqueued;
+	};
+
 	void setDontExpire()
 	{
 		m_expiration=boost::date_time::not_a_date_time;
@@ -37,23 +91,25 @@ public:
 		if (m_expiration==boost::date_time::not_a_date_time) {
 			return false;
 			}
-		return m_expiration<boost::get_system_time();
+		return m_expiration<Clock::now();
 	};
 protected:
 	// Expiration has another meaning for scheduler tasks,
 	// then it is the time the task should be added to the dispatcher
 	boost::system_time m_expiration;
 	boost::function<void (void)> m_f;
+	Category m_category;
+	std::chrono::steady_clock::time_point m_enqueued{};
 };
 
-inline Task* createTask(boost::function<void (void)> f)
+inline Task* createTask(boost::function<void (void)> f, Task::Category category=Task::CATEGORY_OTHER)
 {
-	return new Task(f);
+	return new Task(f, category);
 }
 
-inline Task* createTask(uint32_t expiration, boost::function<void (void)> f)
+inline Task* createTask(uint32_t expiration, boost::function<void (void)> f, Task::Category category=Task::CATEGORY_OTHER)
 {
-	return new Task(expiration, f);
+	return new Task(expiration, f, category);
 }
 
 	}
@@ -1,19 +1,28 @@
 #include "User.h"
 #include "Lotospp/buildinfo.h"
 #include "IOUser.h"
+#include "Metrics.h"
+#include "UserCache.h"
 #include "Common/Enums/TelnetCmd.h"
 #include "Common/Enums/AsciiChar.h"
 #include "Common/Enums/LoginCom.h"
 #include "Common/Enums/TelnetOpt.h"
 #include "Common/Enums/TelnetSub.h"
+#include "Strings/stringFormat.h"
 #include "Strings/stringSplit.h"
 #include "Strings/misc.h"
 #include "globals.h"
+#include "Commands/LogLevel.h"
 #include "Commands/Say.h"
 #include "Commands/Quit.h"
+#include "Commands/Stats.h"
 #include "Security/Blowfish.h"
+#include "Security/DesCrypt.h"
+#include "Database/Executor.h"
+#include "Network/LatencyTrace.h"
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/case_conv.hpp>
+#include <boost/bind/bind.hpp>
 #include <memory>
 #include <stdexcept>
 
@@ -23,6 +32,12 @@ using namespace LotosPP;
 using namespace std;
 
 
+namespace {
+
+Common::Metrics::Gauge* users{Common::Metrics::instance()->gauge("lotospp_users", "Users connected, logging in or logged in")};
+
+	}
+
 User::User(const std::string& n/*=""*/, Network::Protocol* p/*=nullptr*/)
 	: Creature(),
 		client{p}, name{n}
@@ -30,6 +45,7 @@ User::User(const std::string& n/*=""*/, Network::Protocol* p/*=nullptr*/)
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
 	userCount++;
 #endif
+	users->add();
 
 	if (client) {
 		client->setUser(this);
@@ -46,6 +62,7 @@ User::~User()
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
 	userCount--;
 #endif
+	users->sub();
 }
 
 void User::addList()
@@ -68,13 +85,17 @@ boost::asio::ip::address User::getAddress() const
 
 void User::parseLine()
 {
+	const Network::LatencyTrace_ptr& trace=Network::LatencyTracer::current();
+	int64_t traceBegin{trace ? Network::LatencyTrace::now() : 0};
 	Strings::cleanString(textBuffer[buffnum]);
 	com.parse(textBuffer[buffnum]);
 
+	// only the name of a known command goes to the trace, never what was typed
+	const char* command{nullptr};
 	bool skipPrompt{false};
 	switch (stage.value()) {
 		case enums::UserStage_CMD_LINE:
-			runCmdLine();
+			command=runCmdLine();
 			skipPrompt=true;
 			break;
 		default:
@@ -85,6 +106,9 @@ void User::parseLine()
 	if (!skipPrompt) {
 		prompt();
 		}
+	if (trace) {
+		trace->addSpan("command", traceBegin, Network::LatencyTrace::now(), 0, command ? command : "");
+		}
 // SWAP_BUFF
 	buffnum=!buffnum;
 }
@@ -125,11 +149,11 @@ void User::prompt()
 		}
 }
 
-void User::uRead(Network::NetworkMessage msg)
+void User::uRead(const std::string& data)
 {
 	size_t remain,
-		len{msg.getMessageLength()};
-	string input{msg.GetRaw()};
+		len{data.length()};
+	string input{data};
 
 	for (size_t i=0; i<len; ++i) { // Loop through input
 		if (((unsigned char)input[i])==enums::TELCMD_IAC || bpos) {
@@ -160,10 +184,7 @@ void User::uRead(Network::NetworkMessage msg)
 					uWrite("\r\n");
 					}
 				if (level==enums::UserLevel_LOGIN) {
-					login(textBuffer[buffnum]);
-					if (level==enums::UserLevel_LOGIN) {
-						prompt();
-						}
+					queueLogin(textBuffer[buffnum]);
 					}
 				else {
 					parseLine();
@@ -209,38 +230,11 @@ void User::uWrite(const std::string& message) const
 		}
 }
 
-/**
- * Convert all std::strings to const char* using constexpr if (C++17)
- */
-template<typename T>
-auto convert(T&& t)
-{
-	if constexpr (is_same<remove_cv_t<remove_reference_t<T>>, string>::value) {
-		return forward<T>(t).c_str();
-		}
-	return forward<T>(t);
-}
-/**
- * printf like formatting for C++ with std::string
- * Original source: https://stackoverflow.com/a/26221725/11722
- */
-template<typename ... Args>
-std::string stringFormat(const std::string& format, Args&& ... args)
-{
-	size_t size=snprintf(nullptr, 0, format.c_str(), forward<Args>(args) ...)+1;
-	if (size<=0) {
-		throw runtime_error("Error during formatting.");
-		}
-	unique_ptr<char[]> buf(new char[size]);
-	snprintf(buf.get(), size, format.c_str(), args ...);
-	return string(buf.get(), buf.get()+size-1);
-}
-
 // @note https://gist.github.com/Zitrax/a2e0040d301bf4b8ef8101c0b1e3f1d5
 template<typename ... Args>
 void User::uPrintf(const std::string& fmtstr, Args ... args) const
 {
-	string str=stringFormat(fmtstr, convert(std::forward<Args>(args))...);
+	string str=Strings::stringFormat(fmtstr, Strings::convert(std::forward<Args>(args))...);
 
 	string str2;
 	size_t str2max{str2.max_size()};
@@ -272,128 +266,318 @@ void User::uPrintf(const std::string& fmtstr, Args ... args) const
 	uWrite(str2);
 }
 
-void User::login(const std::string& inpstr)
+/**
+ * Queue a line entered at the login prompt, a login step waiting for the database gets it when done
+ */
+void User::queueLogin(const std::string& inpstr)
 {
-	LoginCom loginCom;
-	auto it=loginCom.begin();
-	size_t len{inpstr.length()};
+	if (stage==enums::UserStage_DISCONNECT || stage==enums::UserStage_SWAPPED) {
+		return;
+		}
+	loginInput.push_back(inpstr);
+	runLogin();
+}
 
+void User::runLogin()
+{
+	while (!loginPending && !loginInput.empty()) {
+		string inpstr{loginInput.front()};
+		loginInput.pop_front();
+		if (level==enums::UserLevel_LOGIN) {
+			login(inpstr);
+			}
+		else {
+			// typed ahead while the last login step was running
+			textBuffer[buffnum]=inpstr;
+			parseLine();
+			}
+		}
+}
+
+void User::login(const std::string& inpstr)
+{
+	loginPending=true;
 	switch (stage.value()) {
 		case enums::UserStage_NEW:
 		case enums::UserStage_LOGIN_ID:
 		case enums::UserStage_LOGIN_NAME:
-			for ( ; it!=loginCom.end(); it++) {
-				if (boost::iequals((*it).toString(), inpstr)) {
-					break;
-					}
-				}
-			switch ((*it).value()) {
-				case enums::LoginCom_QUIT:
-					uPrintf("\n\n*** Login abandoned ***\n\n");
-					throw enums::UserStage_DISCONNECT;
-				case enums::LoginCom_WHO:
-					{
-					uint32_t i=0;
-					for (const auto& [id, u] : User::listUser.list) {
-						if (u==this || u->level==enums::UserLevel_LOGIN) {
-							continue;
-							}
-						++i;
-						if (!(i%4)) {
-							uPrintf("\n");
-							}
-						uPrintf("%-*s", 19, u->name.c_str());
-						}
-					if (!i) {
-						uPrintf("no1 :(\n");
-						}
+			loginName(inpstr);
+			return;
+		case enums::UserStage_LOGIN_PWD:
+			loginPassword(inpstr);
+			return;
+		case enums::UserStage_LOGIN_REENTER_PWD:
+			loginConfirm(inpstr);
+			return;
+		}
+	loginDone(stage);
+}
+
+/**
+ * Finish a login step
+ *
+ * @param result stage reached, UserStage_DISCONNECT or UserStage_SWAPPED end this session
+ */
+void User::loginDone(UserStage result)
+{
+	if (result==enums::UserStage_DISCONNECT || result==enums::UserStage_SWAPPED) {
+		stage=result;
+		loginInput.clear();
+		// the session may still be referenced by the caller, delete it from a task of its own
+		g_dispatcher.addTask(Common::createTask(boost::bind(&User::endSession, boost::weak_ptr<void>(lifeGuard), this, result), Common::Task::CATEGORY_USER));
+		return;
+		}
+	loginPending=false;
+	if (level==enums::UserLevel_LOGIN) {
+		prompt();
+		}
+	runLogin();
+}
+
+void User::endSession(boost::weak_ptr<void> alive, User* user, UserStage result)
+{
+	if (alive.expired()) {
+		return;
+		}
+	if (result==enums::UserStage_DISCONNECT) {
+		user->disconnect();
+		}
+	delete user;
+}
+
+Common::Coroutine User::loginName(std::string inpstr)
+{
+	LoginCom loginCom;
+	auto it=loginCom.begin();
+	size_t len{inpstr.length()};
+
+	for ( ; it!=loginCom.end(); it++) {
+		if (boost::iequals((*it).toString(), inpstr)) {
+			break;
+			}
+		}
+	switch ((*it).value()) {
+		case enums::LoginCom_QUIT:
+			uPrintf("\n\n*** Login abandoned ***\n\n");
+			loginDone(enums::UserStage_DISCONNECT);
+			co_return;
+		case enums::LoginCom_WHO:
+			{
+			uint32_t i=0;
+			for (const auto& [id, u] : User::listUser.list) {
+				if (u==this || u->level==enums::UserLevel_LOGIN) {
+					continue;
 					}
-					return;
-				case enums::LoginCom_VERSION:
-					uPrintf("\nLotos++ ");
-					uPrintf(Lotospp_get_buildinfo()->project_version);
+				++i;
+				if (!(i%4)) {
 					uPrintf("\n");
-					return;
-				}
-			if (inpstr.length()<MIN_USERNAME_LEN) {
-				uPrintf("\ntoo short\n\n");
-				attempt();
-				return;
-				}
-			if (inpstr.length()>MAX_USERNAME_LEN) {
-				uPrintf("\ntoo long\n\n");
-				attempt();
-				return;
-				}
-			for (size_t i=0; i<len; ++i) {
-				if (!::isalpha(inpstr[i])) {
-					uPrintf("\nletters only\n\n");
-					attempt();
-					}
-				}
-			name=boost::algorithm::to_lower_copy(inpstr);
-			name[0]=::toupper(name[0]);
-			// If user has hung on another login clear that session
-			for (const auto& [f, u] : listUser.list) {
-				if (u->level==enums::UserLevel_LOGIN && u!=this && boost::iequals(u->name, name)) {
-					u->kick();
 					}
+				uPrintf("%-*s", 19, u->name.c_str());
 				}
-			if (!IOUser::instance()->load(this, inpstr, true)) {
-				uPrintf("creating new account\n");
+			if (!i) {
+				uPrintf("no1 :(\n");
 				}
-//			client->sendEchoOff();
-			level=enums::UserLevel_LOGIN;
-			stage=enums::UserStage_LOGIN_PWD;
-			return;
-		case enums::UserStage_LOGIN_PWD:
-			if (len<MIN_PASSWORD_LEN) {
-				uPrintf("\n\ntoo short\n\n");
-				attempt();
-				return;
-				}
-			if (!password || !password->length()) { // new user
-				password=new string(Security::Blowfish::crypt(inpstr));
-				uPrintf("\n\nconfirm: ");
-				stage=enums::UserStage_LOGIN_REENTER_PWD;
-				}
-			else {
-				if (!password->compare(Security::Blowfish::crypt(inpstr, password->c_str()))) {
-					IOUser::instance()->load(this, name);
-					delete password;
-					password=nullptr;
-//					client->sendEchoOn();
-//					cls();
-					stage=enums::UserStage_CMD_LINE;
-					uConnect();
-					return;
-					}
-				uPrintf("\n\nwrong password\n\n");
-				attempt();
+			}
+			loginDone(stage);
+			co_return;
+		case enums::LoginCom_VERSION:
+			uPrintf("\nLotos++ ");
+			uPrintf(Lotospp_get_buildinfo()->project_version);
+			uPrintf("\n");
+			loginDone(stage);
+			co_return;
+		}
+	if (inpstr.length()<MIN_USERNAME_LEN) {
+		uPrintf("\ntoo short\n\n");
+		if (attempt()) {
+			loginDone(stage);
+			}
+		co_return;
+		}
+	if (inpstr.length()>MAX_USERNAME_LEN) {
+		uPrintf("\ntoo long\n\n");
+		if (attempt()) {
+			loginDone(stage);
+			}
+		co_return;
+		}
+	for (size_t i=0; i<len; ++i) {
+		if (!::isalpha(inpstr[i])) {
+			uPrintf("\nletters only\n\n");
+			if (attempt()) {
+				loginDone(stage);
 				}
-			return;
-		case enums::UserStage_LOGIN_REENTER_PWD:
-			if (password->compare(Security::Blowfish::crypt(inpstr, password->c_str()))) {
-				uPrintf("\n\npassword nomatch\n\n");
-				attempt();
-				return;
+			co_return;
+			}
+		}
+	string key{boost::algorithm::to_lower_copy(inpstr)};
+	name=key;
+	name[0]=::toupper(name[0]);
+	// If user has hung on another login clear that session
+	for (const auto& [f, u] : listUser.list) {
+		if (u->level==enums::UserLevel_LOGIN && u!=this && boost::iequals(u->name, name)) {
+			u->nameLock.release();
+			u->kick();
+			}
+		}
+
+	boost::weak_ptr<void> alive{lifeGuard};
+	nameLock=co_await NameLock::instance()->acquire(key, alive);
+	UserRecord record;
+	// reconnecting users are usually still cached, no need for a database round trip then. That is also all
+	// that can log in while the database is down.
+	bool found=UserCache::instance()->get(key, record),
+		failed{false};
+	if (!found && !Database::Executor::instance()->isAvailable()) {
+		failed=true;
+		}
+	else if (!found) {
+		// stays set if the executor refuses the job
+		failed=true;
+		found=co_await Common::offload(*Database::Executor::instance(), [&record, &failed, key]() {
+				IOUser::LoadResult loaded=IOUser::instance()->load(record, key);
+				// a name that could not be looked up must not be offered as a new account
+				failed= loaded==IOUser::LOAD_ERROR;
+				return loaded==IOUser::LOAD_FOUND;
+			}, alive);
+		}
+	if (!nameLock.held()) {
+		// superseded by a newer login with the same name, the kick tears this session down
+		co_return;
+		}
+	if (failed) {
+		uPrintf("\ndatabase unavailable, try again later\n\n");
+		nameLock.release();
+		stage=enums::UserStage_LOGIN_NAME;
+		loginDone(stage);
+		co_return;
+		}
+	if (found) {
+		guid=record.guid;
+		delete password;
+		password=new string(record.password);
+		accountLevel=record.level;
+		}
+	else {
+		uPrintf("creating new account\n");
+		}
+//	client->sendEchoOff();
+	level=enums::UserLevel_LOGIN;
+	stage=enums::UserStage_LOGIN_PWD;
+	loginDone(stage);
+}
+
+Common::Coroutine User::loginPassword(std::string inpstr)
+{
+	if (inpstr.length()<MIN_PASSWORD_LEN) {
+		uPrintf("\n\ntoo short\n\n");
+		if (attempt()) {
+			loginDone(stage);
+			}
+		co_return;
+		}
+
+	boost::weak_ptr<void> alive{lifeGuard};
+	if (!password || !password->length()) { // new user
+		string hash=co_await Common::offload([inpstr]() {
+				return Security::Blowfish::crypt(inpstr);
+			}, alive);
+		if (!nameLock.held()) {
+			co_return;
+			}
+		delete password;
+		password=new string(hash);
+		uPrintf("\n\nconfirm: ");
+		stage=enums::UserStage_LOGIN_REENTER_PWD;
+		loginDone(stage);
+		co_return;
+		}
+
+	string setting{*password};
+	// imported NUTS accounts keep their crypt() hash until the first login
+	bool legacy{Security::DesCrypt::isHash(setting)};
+	string hash=co_await Common::offload([inpstr, setting, legacy]() {
+			if (legacy) {
+				return Security::DesCrypt::verify(inpstr, setting) ? Security::Blowfish::crypt(inpstr) : string();
 				}
-			client->sendEchoOn();
-			level=enums::UserLevel_NOVICE;
-			guid=IOUser::instance()->create(this);
-			delete password;
-			password=nullptr;
-//			cls();
-			uWrite("press [ENTER] to login");
-			stage=enums::UserStage_LOGIN_PROMPT;
-			return;
+			return Security::Blowfish::crypt(inpstr, setting);
+		}, alive);
+	if (!nameLock.held()) {
+		co_return;
+		}
+	if (legacy ? !hash.empty() : !password->compare(hash)) {
+		if (legacy) {
+			// the bcrypt hash replaces it with the next flush
+			UserCache::instance()->update(boost::algorithm::to_lower_copy(name), UserRecord{guid, name, hash, accountLevel});
+			}
+		level=accountLevel;
+		delete password;
+		password=nullptr;
+		nameLock.release();
+//		client->sendEchoOn();
+//		cls();
+		stage=enums::UserStage_CMD_LINE;
+		loginDone(uConnect());
+		co_return;
+		}
+	uPrintf("\n\nwrong password\n\n");
+	if (attempt()) {
+		loginDone(stage);
 		}
 }
 
-void User::uConnect()
+Common::Coroutine User::loginConfirm(std::string inpstr)
+{
+	boost::weak_ptr<void> alive{lifeGuard};
+	string setting{*password};
+	string hash=co_await Common::offload([inpstr, setting]() {
+			return Security::Blowfish::crypt(inpstr, setting);
+		}, alive);
+	if (!nameLock.held()) {
+		co_return;
+		}
+	if (password->compare(hash)) {
+		uPrintf("\n\npassword nomatch\n\n");
+		if (attempt()) {
+			loginDone(stage);
+			}
+		co_return;
+		}
+	if (client) {
+		client->sendEchoOn();
+		}
+	level=enums::UserLevel_NOVICE;
+	string account{name}, hashed{*password};
+	UserLevel newLevel{level};
+	uint64_t id=co_await Common::offload(Database::Executor::instance()->writer(), [account, hashed, newLevel]() {
+			return IOUser::instance()->create(account, hashed, newLevel);
+		}, alive);
+	if (!nameLock.held()) {
+		// superseded meanwhile, the newer session owns the name now
+		co_return;
+		}
+	if (!id) {
+		uPrintf("\n\naccount not created, try again later\n\n");
+		level=enums::UserLevel_LOGIN;
+		if (attempt()) {
+			loginDone(stage);
+			}
+		co_return;
+		}
+	guid=id;
+	delete password;
+	password=nullptr;
+	nameLock.release();
+//	cls();
+	uWrite("press [ENTER] to login");
+	stage=enums::UserStage_LOGIN_PROMPT;
+	loginDone(stage);
+}
+
+Common::UserStage User::uConnect()
 {
 	for (const auto& [f, u] : listUser.list) {
-		if (this!=u && !name.compare(u->name)) {
+		if (this!=u && client && !name.compare(u->name)) {
 			uPrintf("\n\nalready logged in - switching to old session ...\n");
 			uPrintf("old addr: %s", u->getAddress().to_string().c_str());
 			u->uPrintf("\nswapping this session to addr %s\n\n", getAddress().to_string().c_str());
@@ -403,26 +587,37 @@ void User::uConnect()
 			client=nullptr;
 			removeList();
 			u->prompt();
-			throw enums::UserStage_SWAPPED;
+			return enums::UserStage_SWAPPED;
 			}
 		}
 	prompt();
+	return enums::UserStage_CMD_LINE;
 }
 
-void User::attempt()
+bool User::attempt()
 {
+	nameLock.release();
 	attempts++;
 	if (attempts==MAX_LOGIN_ATTEMPTS) {
 		uPrintf("\nmax attempts\n");
 		kick();
 		removeList();
-		return;
+		return false;
 		}
 	stage=enums::UserStage_LOGIN_NAME;
 	if (password) {
 		delete password;
 		password=nullptr;
 		}
+	return true;
+}
+
+void User::enterAs(const std::string& n, UserLevel l)
+{
+	name=n;
+	level=l;
+	stage=enums::UserStage_CMD_LINE;
+	prompt();
 }
 
 void User::kick() const
@@ -689,19 +884,19 @@ int User::getTermtype()
 	return sh;
 }
 
-void User::runCmdLine()
+const char* User::runCmdLine()
 {
 	bool dot{false};
 
 	// If nothing entered just return. Word[0] could be zero length if user entered "" on the command line
 	if (com.word.empty() || !com.word[0].length()) {
-		return;
+		return nullptr;
 		}
 	if (com.word[0][0]=='.') { // Check for dot command
 		if (com.word[0].length()==1) {
 			uPrintf("Missing command.\n");
 			prompt();
-			return;
+			return nullptr;
 			}
 		dot=true;
 		}
@@ -711,12 +906,27 @@ void User::runCmdLine()
 		Command* cmd=new Commands::Say;
 		cmd->execute(this);
 		prompt();
+		return "say";
 		}
 	else if (boost::iequals(w, "quit")) {
 		Command* cmd=new Commands::Quit;
 		cmd->execute(this);
+		return "quit";
+		}
+	else if (boost::iequals(w, "stats")) {
+		Command* cmd=new Commands::Stats;
+		cmd->execute(this);
+		prompt();
+		return "stats";
+		}
+	else if (boost::iequals(w, "loglevel")) {
+		Command* cmd=new Commands::LogLevel;
+		cmd->execute(this);
+		prompt();
+		return "loglevel";
 		}
 	else {
 		uPrintf("Unknown command.\n");
 		}
+	return nullptr;
 }
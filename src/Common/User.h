@@ -3,11 +3,15 @@
 
 #include "Creature.h"
 #include "AutoList.h"
+#include "Coroutine.h"
+#include "NameLock.h"
 #include "Network/Protocol.h"
 #include "Common/Enums/UserStage.h"
 #include "Common/Enums/TelnetFlag.h"
 #include "Common/Enums/UserLevel.h"
 #include "Strings/Splitline.h"
+#include <boost/shared_ptr.hpp>
+#include <deque>
 
 
 namespace LotosPP {
@@ -64,6 +68,10 @@ public:
 	{
 		return getID()!=0;
 	};
+	UserLevel getLevel() const
+	{
+		return level;
+	};
 	void disconnect()
 	{
 		if (client) {
@@ -72,8 +80,12 @@ public:
 	};
 	boost::asio::ip::address getAddress() const;
 	void kick() const;
+	/**
+	 * Straight to the command line as name, for simulated clients which have no account
+	 */
+	void enterAs(const std::string& n, UserLevel l);
 
-	virtual void uRead(LotosPP::Network::NetworkMessage msg);
+	virtual void uRead(const std::string& data);
 	virtual void uWrite(const std::string& message) const;
 	template<typename ... Args>
 	void uPrintf(const std::string& fmtstr, Args ... args) const;
@@ -88,9 +100,21 @@ protected:
 
 	virtual void parseLine();
 	virtual void prompt();
+	void queueLogin(const std::string& inpstr);
+	void runLogin();
 	void login(const std::string& inpstr);
-	void attempt();
-	void uConnect();
+	Coroutine loginName(std::string inpstr);
+	Coroutine loginPassword(std::string inpstr);
+	Coroutine loginConfirm(std::string inpstr);
+	void loginDone(UserStage result);
+	static void endSession(boost::weak_ptr<void> alive, User* user, UserStage result);
+	/**
+	 * Counts a failed login step
+	 *
+	 * @return false when that was the last attempt, the session is kicked then and must not prompt again
+	 */
+	bool attempt();
+	UserStage uConnect();
 	bool parseTelopt();
 	int getTermsize();
 	int getTermtype();
@@ -99,6 +123,13 @@ protected:
 	UserLevel level{enums::UserLevel_LOGIN};
 
 	uint8_t attempts{0};
+	// expires with the user, suspended login coroutines check it before resuming
+	boost::shared_ptr<void> lifeGuard{new bool{true}};
+	// lines entered while a login step is still waiting for the database
+	std::deque<std::string> loginInput{};
+	bool loginPending{false};
+	NameLock::Guard nameLock{};
+	UserLevel accountLevel{enums::UserLevel_LOGIN};
 	uint32_t bpos{0};
 	uint8_t buffnum{0};
 	std::string buff{};
@@ -117,7 +148,10 @@ protected:
 	friend class LotosPP::Network::Protocols::Telnet;
 	friend class IOUser;
 
-	virtual void runCmdLine();
+	/**
+	 * @return name of the command run, nullptr if the line named none
+	 */
+	virtual const char* runCmdLine();
 };
 
 typedef std::vector<User*> UserVector;
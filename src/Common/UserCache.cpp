@@ -0,0 +1,165 @@
+#include "UserCache.h"
+#include "Singleton.h"
+#include "Scheduler.h"
+#include "globals.h"
+#include "Database/GroupCommit.h"
+#include "Log/Logger.h"
+#include <boost/bind/bind.hpp>
+#include <algorithm>
+#include <vector>
+
+
+using namespace LotosPP::Common;
+
+
+UserCache* UserCache::instance()
+{
+	static Singleton<UserCache> instance;
+	return instance.get();
+}
+
+UserCache::UserCache()
+	: m_capacity{std::max<size_t>(1, LotosPP::options.get<size_t>("database.CacheSize", 4096))},
+		m_flushInterval{LotosPP::options.get<uint32_t>("database.FlushInterval", 5000)}
+{}
+
+bool UserCache::get(const std::string& key, UserRecord& record)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	auto it=m_entries.find(key);
+	if (it==m_entries.end()) {
+		return false;
+		}
+	m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+	record=it->second.record;
+	return true;
+}
+
+void UserCache::put(const std::string& key, const UserRecord& record)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	// a load racing with a save of the same account keeps the pending write, see store()
+	store(key, record);
+	evict();
+}
+
+void UserCache::update(const std::string& key, const UserRecord& record)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	Entry& entry=store(key, record);
+	entry.record=record;
+	entry.dirty=true;
+	entry.version=++m_version;
+	evict();
+}
+
+void UserCache::remove(const std::string& key)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	auto it=m_entries.find(key);
+	if (it==m_entries.end()) {
+		return;
+		}
+	m_lru.erase(it->second.lru);
+	m_entries.erase(it);
+}
+
+UserCache::Entry& UserCache::store(const std::string& key, const UserRecord& record)
+{
+	auto [it, inserted]=m_entries.try_emplace(key);
+	Entry& entry=it->second;
+	if (inserted) {
+		m_lru.push_front(key);
+		entry.lru=m_lru.begin();
+		entry.record=record;
+		}
+	else {
+		m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+		if (!entry.dirty) {
+			entry.record=record;
+			}
+		}
+	return entry;
+}
+
+void UserCache::evict()
+{
+	// oldest first, skipping rows that still have to be written
+	auto it=m_lru.end();
+	while (m_entries.size()>m_capacity && it!=m_lru.begin()) {
+		--it;
+		auto entry=m_entries.find(*it);
+		if (entry->second.dirty) {
+			continue;
+			}
+		m_entries.erase(entry);
+		it=m_lru.erase(it);
+		}
+}
+
+void UserCache::start()
+{
+	g_scheduler.addEvent(createSchedulerTask(m_flushInterval, &UserCache::flushEvent));
+}
+
+void UserCache::flushEvent()
+{
+	UserCache* cache=instance();
+	cache->flush();
+	g_scheduler.addEvent(createSchedulerTask(cache->m_flushInterval, &UserCache::flushEvent));
+}
+
+size_t UserCache::flush()
+{
+	struct Save {
+		std::string key;
+		UserRecord record;
+		uint64_t version;
+		};
+	std::vector<Save> saves;
+	{
+		boost::lock_guard<boost::mutex> lockGuard(m_lock);
+		for (auto& [key, entry] : m_entries) {
+			// a write of an older version may still be on its way, group commit keeps them in order
+			if (!entry.dirty || entry.queued==entry.version) {
+				continue;
+				}
+			entry.queued=entry.version;
+			saves.push_back(Save{key, entry.record, entry.version});
+			}
+	}
+	// queued without the lock, a save group commit refuses calls saved() right away
+	for (const Save& save : saves) {
+		IOUser::instance()->queueSave(save.record, boost::bind(&UserCache::saved, this, save.key, save.version, boost::placeholders::_1));
+		}
+	return saves.size();
+}
+
+void UserCache::flushAndWait()
+{
+	if (size_t rows=flush()) {
+		LOG(LINFO) << "UserCache: flushing " << rows << " rows";
+		}
+	Database::GroupCommit::instance()->flushAndWait();
+}
+
+void UserCache::saved(const std::string& key, uint64_t version, bool committed)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	auto it=m_entries.find(key);
+	if (it==m_entries.end()) {
+		return;
+		}
+	Entry& entry=it->second;
+	if (!committed) {
+		if (entry.queued==version) {
+			// retried with the next flush
+			entry.queued=0;
+			}
+		return;
+		}
+	if (entry.version==version) {
+		entry.dirty=false;
+		evict();
+		}
+}
@@ -0,0 +1,93 @@
+#ifndef LOTOSPP_COMMON_USERCACHE_H
+#define LOTOSPP_COMMON_USERCACHE_H
+
+#include "IOUser.h"
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+
+namespace LotosPP::Common {
+
+/**
+ * User record cache in front of IOUser
+ *
+ * LRU of account rows keyed by lowercase login. A save only marks its row dirty, flush() queues all dirty rows to
+ * Database::GroupCommit, which writes them with multi-row statements. A scheduler event flushes every
+ * database.FlushInterval ms, which bounds how stale the database can get. Dirty rows are never evicted. Thread safe.
+ */
+class UserCache
+{
+public:
+	static UserCache* instance();
+
+	UserCache();
+
+	/**
+	 * @param key lowercase login
+	 * @param record filled on hit
+	 * @return true on hit
+	 */
+	bool get(const std::string& key, UserRecord& record);
+	/**
+	 * Stores a row as read from or written to the database
+	 */
+	void put(const std::string& key, const UserRecord& record);
+	/**
+	 * Stores a changed row, written by the next flush
+	 */
+	void update(const std::string& key, const UserRecord& record);
+	void remove(const std::string& key);
+
+	/**
+	 * Starts the periodic write-behind
+	 */
+	void start();
+	/**
+	 * Queues the dirty rows not queued yet
+	 *
+	 * @return number of rows queued
+	 */
+	size_t flush();
+	/**
+	 * Writes all dirty rows and waits for it, for shutdown, before the GroupCommit stops
+	 */
+	void flushAndWait();
+
+	size_t size()
+	{
+		boost::lock_guard<boost::mutex> lockGuard(m_lock);
+		return m_entries.size();
+	};
+
+protected:
+	struct Entry {
+		UserRecord record{};
+		std::list<std::string>::iterator lru{};
+		bool dirty{false};
+		// bumped by every update, a write only cleans the row if it was of the latest version
+		uint64_t version{0};
+		uint64_t queued{0};
+	};
+
+	/**
+	 * Inserts or refreshes a row and makes it the most recent, a dirty row keeps its data
+	 */
+	Entry& store(const std::string& key, const UserRecord& record);
+	void evict();
+	void saved(const std::string& key, uint64_t version, bool committed);
+	static void flushEvent();
+
+	boost::mutex m_lock;
+	std::unordered_map<std::string, Entry> m_entries{};
+	std::list<std::string> m_lru{};
+	size_t m_capacity;
+	uint32_t m_flushInterval;
+	uint64_t m_version{0};
+};
+
+	}
+
+#endif
@@ -0,0 +1,100 @@
+#include "WorkerPool.h"
+#include "FlightRecorder.h"
+#include "StatsSegment.h"
+#ifdef __EXCEPTION_TRACER__
+#	include "ExceptionHandler.h"
+#endif
+#include "Log/Logger.h"
+#include <boost/bind/bind.hpp>
+#include <cassert>
+
+
+using namespace LotosPP::Common;
+
+
+WorkerPool::WorkerPool()
+{
+	m_jobList.clear();
+}
+
+void WorkerPool::start(uint32_t threads/*=0*/)
+{
+	assert(m_threadState==STATE_TERMINATED);
+	if (!threads) {
+		threads=std::max(2u, boost::thread::hardware_concurrency());
+		}
+	m_threadState=STATE_RUNNING;
+	for (uint32_t i=0; i<threads; ++i) {
+		m_threads.create_thread(boost::bind(&WorkerPool::workerThread, (void*)this));
+		}
+}
+
+void WorkerPool::workerThread(void* p)
+{
+	WorkerPool* pool=(WorkerPool*)p;
+#ifdef __EXCEPTION_TRACER__
+	ExceptionHandler workerExceptionHandler;
+	workerExceptionHandler.InstallHandler();
+#endif
+
+	FlightRecorder::instance()->setThreadName("worker");
+	StatsSegment::instance()->registerThread("worker");
+
+	boost::unique_lock<boost::mutex> jobLockUnique(pool->m_jobLock, boost::defer_lock);
+
+	while (pool->m_threadState!=STATE_TERMINATED) {
+		boost::function<void (void)> job;
+
+		jobLockUnique.lock();
+		while (pool->m_jobList.empty() && pool->m_threadState!=STATE_TERMINATED) {
+			pool->m_jobSignal.wait(jobLockUnique);
+			}
+		if (!pool->m_jobList.empty()) {
+			job.swap(pool->m_jobList.front());
+			pool->m_jobList.pop_front();
+			}
+		jobLockUnique.unlock();
+
+		if (job) {
+			try {
+				job();
+				}
+			catch (std::exception& e) {
+				LOG(LERROR) << "WorkerPool: job failed: " << e.what();
+				}
+			}
+		}
+#ifdef __EXCEPTION_TRACER__
+	workerExceptionHandler.RemoveHandler();
+#endif
+}
+
+bool WorkerPool::addJob(const boost::function<void (void)>& job)
+{
+	m_jobLock.lock();
+	if (m_threadState!=STATE_RUNNING) {
+		m_jobLock.unlock();
+		LOG(LERROR) << "[WorkerPool::addJob] Worker pool is terminated.";
+		return false;
+		}
+	m_jobList.push_back(job);
+	m_jobLock.unlock();
+
+	m_jobSignal.notify_one();
+	return true;
+}
+
+void WorkerPool::shutdown()
+{
+	m_jobLock.lock();
+	m_threadState=STATE_TERMINATED;
+	m_jobList.clear();
+	m_jobLock.unlock();
+	m_jobSignal.notify_all();
+}
+
+void WorkerPool::shutdownAndWait()
+{
+	shutdown();
+	m_threads.join_all();
+}
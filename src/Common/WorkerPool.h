@@ -0,0 +1,56 @@
+#ifndef LOTOSPP_COMMON_WORKERPOOL_H
+#define LOTOSPP_COMMON_WORKERPOOL_H
+
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <list>
+#include <vector>
+
+
+namespace LotosPP::Common {
+
+/**
+ * Pool of threads for blocking work (database round trips, password hashing)
+ *
+ * Jobs must not touch talker state, they hand their result back to the dispatcher thread instead
+ */
+class WorkerPool
+{
+public:
+	WorkerPool();
+	~WorkerPool()
+	{};
+
+	/**
+	 * @return false when the pool is terminated and the job was dropped
+	 */
+	bool addJob(const boost::function<void (void)>& job);
+
+	void start(uint32_t threads=0);
+	void shutdown();
+	void shutdownAndWait();
+
+	size_t getThreadCount() const
+	{
+		return m_threads.size();
+	};
+
+	enum WorkerPoolState {
+		STATE_RUNNING,
+		STATE_TERMINATED
+		};
+
+protected:
+	static void workerThread(void* p);
+
+	boost::thread_group m_threads;
+	boost::mutex m_jobLock;
+	boost::condition_variable m_jobSignal;
+
+	std::list<boost::function<void (void)>> m_jobList{};
+	WorkerPoolState m_threadState{STATE_TERMINATED};
+};
+
+	}
+
+#endif
@@ -191,7 +191,7 @@ public:
 	static std::string toValue(const Enum<E, size_>& _e)
 	{
 		init();
-		if (typename EnumToValue::const_iterator i=enum_to_value.find(_e); i==enum_to_value.end()) {
+		if (typename EnumToValue::const_iterator i=enum_to_value.find(_e); i!=enum_to_value.end()) {
 			return i->second;
 			}
 		std::ostringstream os;
@@ -208,7 +208,7 @@ public:
 	static std::vector<std::string> toStrings(const Enum<E, size_>& _e)
 	{
 		init();
-		if (typename EnumToString::const_iterator i=enum_to_string.find(_e); i==enum_to_string.end()) {
+		if (typename EnumToString::const_iterator i=enum_to_string.find(_e); i!=enum_to_string.end()) {
 			return i->second;
 			}
 		return {};
@@ -223,7 +223,7 @@ public:
 	static Enum<E, size_> fromString(const std::string& str)
 	{
 		init();
-		if (typename StringToEnum::const_iterator i=string_to_enum.find(str); i==string_to_enum.end()) {
+		if (typename StringToEnum::const_iterator i=string_to_enum.find(str); i!=string_to_enum.end()) {
 			return i->second;
 			}
 		std::ostringstream os;
@@ -240,7 +240,7 @@ public:
 	static Enum<E, size_> fromInteger(int id)
 	{
 		init();
-		if (typename EnumToString::const_iterator i=enum_to_string.find(Enum<E, size_>(id)); i==enum_to_string.end()) {
+		if (typename EnumToString::const_iterator i=enum_to_string.find(Enum<E, size_>(id)); i!=enum_to_string.end()) {
 			return i->first;
 			}
 		std::ostringstream os;
@@ -259,7 +259,7 @@ public:
 	static Enum<E, size_> fromStringI(const std::string& str)
 	{
 		init();
-		if (typename StringToEnum::const_iterator i=lstring_to_enum.find(str); i==lstring_to_enum.end()) {
+		if (typename StringToEnum::const_iterator i=lstring_to_enum.find(str); i!=lstring_to_enum.end()) {
 			return i->second;
 			}
 		std::ostringstream os;
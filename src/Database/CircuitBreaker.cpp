@@ -0,0 +1,98 @@
+#include "CircuitBreaker.h"
+#include "Log/Logger.h"
+#include <boost/thread/locks.hpp>
+#include <algorithm>
+
+
+using namespace LotosPP::Database;
+
+
+void CircuitBreaker::configure(uint32_t threshold, uint32_t minDelay, uint32_t maxDelay)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	m_threshold=std::max(1u, threshold);
+	m_minDelay=std::max(1u, minDelay);
+	m_maxDelay=std::max(m_minDelay, maxDelay);
+}
+
+bool CircuitBreaker::allow()
+{
+	if (m_state==STATE_CLOSED) {
+		return true;
+		}
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	if (m_state==STATE_OPEN && Clock::now()>=m_retryAt) {
+		// this caller probes, everyone else keeps failing fast until it reports back
+		m_state=STATE_HALF_OPEN;
+		++m_probes;
+		return true;
+		}
+	if (m_state==STATE_CLOSED) {
+		return true;
+		}
+	++m_rejected;
+	return false;
+}
+
+void CircuitBreaker::success()
+{
+	if (m_state==STATE_CLOSED && !m_failures) {
+		return;
+		}
+	boost::unique_lock<boost::mutex> lockUnique(m_lock);
+	m_failures=0;
+	if (m_state==STATE_CLOSED) {
+		return;
+		}
+	m_state=STATE_CLOSED;
+	m_retryDelay=0;
+	auto down=std::chrono::duration_cast<std::chrono::seconds>(Clock::now()-m_openedAt).count();
+	lockUnique.unlock();
+
+	LOG(LINFO) << "Database: available again after " << down << " s";
+}
+
+void CircuitBreaker::failure()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	switch (m_state) {
+		case STATE_CLOSED:
+			if (++m_failures>=m_threshold) {
+				++m_trips;
+				m_openedAt=Clock::now();
+				open(m_minDelay);
+				}
+			break;
+		case STATE_HALF_OPEN:
+			open(std::min(m_maxDelay, m_retryDelay*2));
+			break;
+		case STATE_OPEN:
+			// queries failing fast, they tell nothing new
+			break;
+		}
+}
+
+void CircuitBreaker::open(uint32_t delay)
+{
+	// under m_lock
+	m_state=STATE_OPEN;
+	m_retryDelay=delay;
+	m_retryAt=Clock::now()+std::chrono::milliseconds(delay);
+	LOG(LWARNING) << "Database: unavailable, failing fast, next attempt in " << delay << " ms";
+}
+
+uint32_t CircuitBreaker::untilRetry()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	if (m_state!=STATE_OPEN) {
+		return m_minDelay;
+		}
+	auto left=std::chrono::duration_cast<std::chrono::milliseconds>(m_retryAt-Clock::now()).count();
+	return left>0 ? left : 0;
+}
+
+CircuitBreaker::Stats CircuitBreaker::getStats()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	return Stats{m_state, m_failures, m_retryDelay, m_trips, m_probes, m_rejected};
+}
@@ -0,0 +1,96 @@
+#ifndef LOTOSPP_DATABASE_CIRCUITBREAKER_H
+#define LOTOSPP_DATABASE_CIRCUITBREAKER_H
+
+#include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+namespace LotosPP::Database {
+
+/**
+ * Circuit breaker over the database connections
+ *
+ * After threshold consecutive connection failures the breaker opens: reconnects are refused and queries fail fast
+ * instead of each waiting for its own connect timeout. Once the retry delay passes a single probe may reconnect,
+ * its success closes the breaker, its failure doubles the delay up to maxDelay. Thread safe.
+ */
+class CircuitBreaker
+{
+public:
+	enum State {
+		STATE_CLOSED,
+		STATE_OPEN,
+		STATE_HALF_OPEN
+		};
+
+	/**
+	 * @param threshold consecutive failures opening the breaker
+	 * @param minDelay ms before the first probe
+	 * @param maxDelay ms between probes at most
+	 */
+	void configure(uint32_t threshold, uint32_t minDelay, uint32_t maxDelay);
+
+	/**
+	 * Asks for a connection attempt
+	 *
+	 * @return true when closed, or for the one probe once the retry delay passed
+	 */
+	bool allow();
+	/**
+	 * Reports the outcome of a connection attempt or of a query
+	 */
+	void success();
+	void failure();
+
+	/**
+	 * @return ms until the next probe is allowed, minDelay when none is pending
+	 */
+	uint32_t untilRetry();
+
+	State getState() const
+	{
+		return m_state;
+	};
+	/**
+	 * @return false while failing fast or probing
+	 */
+	bool isClosed() const
+	{
+		return m_state==STATE_CLOSED;
+	};
+
+	struct Stats {
+		State state{STATE_CLOSED};
+		uint32_t failures{0};
+		uint32_t retryDelay{0};
+		uint64_t trips{0};
+		uint64_t probes{0};
+		uint64_t rejected{0};
+	};
+	Stats getStats();
+
+protected:
+	typedef std::chrono::steady_clock Clock;
+
+	void open(uint32_t delay);
+
+	boost::mutex m_lock;
+	std::atomic<State> m_state{STATE_CLOSED};
+	// fast path of success(), nothing to reset while zero
+	std::atomic<uint32_t> m_failures{0};
+	uint32_t m_threshold{3};
+	uint32_t m_minDelay{500};
+	uint32_t m_maxDelay{30000};
+	uint32_t m_retryDelay{0};
+	Clock::time_point m_retryAt{};
+	Clock::time_point m_openedAt{};
+	uint64_t m_trips{0};
+	uint64_t m_probes{0};
+	uint64_t m_rejected{0};
+};
+
+	}
+
+#endif
@@ -1,8 +1,16 @@
 #include "Driver.h"
+#include "CircuitBreaker.h"
+#include "Common/Probe.h"
 #include "Query.h"
+#include "QueryStats.h"
+#include "Result.h"
+#include "Statement.h"
 #ifdef WITH_MYSQL
 #	include "Drivers/MySQL.h"
 #endif
+#ifdef WITH_SQLITE
+#	include "Drivers/SQLite.h"
+#endif
 #include "globals.h"
 #include <boost/algorithm/string/predicate.hpp>
 #include <stdexcept>
@@ -13,30 +21,79 @@ using namespace LotosPP::Database;
 
 Driver* Driver::instance()
 {
+	if (t_instance) {
+		return t_instance;
+		}
 	if (!_instance) {
-		std::string type=LotosPP::options.get("database.Type", "");
+		_instance=create();
+		}
+	return _instance;
+}
+
+Driver* Driver::create()
+{
+	std::string type=LotosPP::options.get("database.Type", "");
 #ifdef WITH_MYSQL
-		if (boost::iequals("mysql", type)) {
-			_instance=new Drivers::MySQL;
-			}
+	if (boost::iequals("mysql", type)) {
+		return new Drivers::MySQL;
+		}
 #endif
+#ifdef WITH_SQLITE
+	if (boost::iequals("sqlite", type)) {
+		return new Drivers::SQLite;
 		}
-	return _instance;
+#endif
+	return nullptr;
+}
+
+bool Driver::reconnect()
+{
+	if (m_connected) {
+		return true;
+		}
+	if (m_breaker && !m_breaker->allow()) {
+		return false;
+		}
+	bool connected{ping()};
+	if (m_breaker) {
+		if (connected) {
+			m_breaker->success();
+			}
+		else {
+			m_breaker->failure();
+			}
+		}
+	return connected;
 }
 
 bool Driver::executeQuery(Query& query)
 {
-	return internalQuery(query.str());
+	return executeQuery(query.str());
 }
 
 bool Driver::executeQuery(const std::string& query)
 {
-	return internalQuery(query);
+	LOTOSPP_PROBE(query__start, query.c_str());
+	QueryStats::Timer timer;
+	bool ok=internalQuery(query);
+	uint64_t micros{timer.micros()};
+	LOTOSPP_PROBE(query__end, query.c_str(), micros, ok);
+	QueryStats::instance()->record(query, micros, -1, ok);
+	return ok;
 }
 
 Result_ptr Driver::storeQuery(const std::string& query)
 {
-	return internalSelectQuery(query);
+	LOTOSPP_PROBE(query__start, query.c_str());
+	QueryStats::Timer timer;
+	// drivers return no result for an empty one as well, only verifyResult() tells it from an error
+	m_queryFailed=true;
+	Result_ptr result=internalSelectQuery(query);
+	uint64_t micros{timer.micros()};
+	bool ok{!m_queryFailed};
+	LOTOSPP_PROBE(query__end, query.c_str(), micros, ok);
+	QueryStats::instance()->record(query, micros, result ? result->getRowCount() : 0, ok);
+	return result;
 }
 
 Result_ptr Driver::storeQuery(Query& query)
@@ -44,6 +101,35 @@ Result_ptr Driver::storeQuery(Query& query)
 	return storeQuery(query.str());
 }
 
+Result_ptr Driver::streamQuery(const std::string& query)
+{
+	// until the first row only, the rest is up to the reader
+	LOTOSPP_PROBE(query__start, query.c_str());
+	QueryStats::Timer timer;
+	m_queryFailed=true;
+	Result_ptr result=internalStreamQuery(query);
+	uint64_t micros{timer.micros()};
+	bool ok{!m_queryFailed};
+	LOTOSPP_PROBE(query__end, query.c_str(), micros, ok);
+	QueryStats::instance()->record(query, micros, -1, ok);
+	return result;
+}
+
+Result_ptr Driver::streamQuery(Query& query)
+{
+	return streamQuery(query.str());
+}
+
+Statement_ptr Driver::prepare(const std::string& sql)
+{
+	return Statement_ptr(new TextStatement(this, sql));
+}
+
+bool Driver::tableExists(const std::string& table)
+{
+	return (bool)storeQuery("SELECT 1 FROM information_schema.tables WHERE table_name="+escapeString(table));
+}
+
 void Driver::freeResult([[maybe_unused]]Result* res)
 {
 	throw std::runtime_error("No database driver loaded, yet a Result was freed.");
@@ -52,7 +138,9 @@ void Driver::freeResult([[maybe_unused]]Result* res)
 Result_ptr Driver::verifyResult(Result_ptr result)
 {
 	if (!result->advance()) {
+		m_queryFailed=result->failed();
 		return Result_ptr();
 		}
+	m_queryFailed=false;
 	return result;
 }
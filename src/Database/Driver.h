@@ -3,16 +3,21 @@
 
 #include <boost/shared_ptr.hpp>
 #include <string>
+#include <vector>
 #include <cstdint>
 
 
 namespace LotosPP::Database {
+	class CircuitBreaker;
 	class Query;
 	class Result;
 	typedef boost::shared_ptr<Result> Result_ptr;
+	class Statement;
+	typedef boost::shared_ptr<Statement> Statement_ptr;
 
 enum DBParam_t {
-	DBPARAM_MULTIINSERT=1
+	DBPARAM_MULTIINSERT=1,
+	DBPARAM_SINGLE_WRITER=2 // only one connection should write at a time, see Executor::addWriteJob()
 	};
 
 class Driver
@@ -26,6 +31,22 @@ public:
 	 * @return database connection handler singleton
 	 */
 	static Driver* instance();
+	/**
+	 * Creates a new connection of the configured type
+	 *
+	 * Used by the Executor, every thread of it owns one. On those threads instance() returns that connection.
+	 *
+	 * @return new connection, nullptr when no driver matches database.Type
+	 */
+	static Driver* create();
+	static void setThreadInstance(Driver* driver)
+	{
+		t_instance=driver;
+	};
+	static bool hasThreadInstance()
+	{
+		return t_instance!=nullptr;
+	};
 
 	/**
 	 * Database information
@@ -52,6 +73,29 @@ public:
 		return m_connected;
 	};
 
+	/**
+	 * Checks the connection, reconnecting if the driver supports it
+	 *
+	 * @return whether or not the database is connected afterwards
+	 */
+	virtual bool ping()
+	{
+		return m_connected;
+	};
+	/**
+	 * Reconnects a lost connection, unless the circuit breaker says to fail fast
+	 *
+	 * @return whether or not the database is connected afterwards
+	 */
+	bool reconnect();
+	/**
+	 * @param breaker shared by the connections of an Executor, nullptr to always try
+	 */
+	void setCircuitBreaker(CircuitBreaker* breaker)
+	{
+		m_breaker=breaker;
+	};
+
 protected:
 	/**
 	 * Transaction related methods
@@ -95,6 +139,28 @@ public:
 	 */
 	Result_ptr storeQuery(const std::string& query);
 	Result_ptr storeQuery(Query& query);
+	/**
+	 * Queries database without buffering the result set
+	 *
+	 * Rows are fetched from the server as advance() is called, so big results are never held in memory at once.
+	 * No other query may run on this connection until the result is released.
+	 *
+	 * @param query
+	 * @return results object positioned on the first row (null on error or when empty)
+	 */
+	Result_ptr streamQuery(const std::string& query);
+	Result_ptr streamQuery(Query& query);
+
+	/**
+	 * Prepares statement
+	 *
+	 * Drivers with native prepared statements cache them per connection, keyed by the SQL text, so preparing the same
+	 * text again is cheap. Others fall back to substituting escaped parameters into the text.
+	 *
+	 * @param sql statement with '?' placeholders
+	 * @return statement to bind parameters to (null on error)
+	 */
+	virtual Statement_ptr prepare(const std::string& sql);
 
 	/**
 	 * Escapes string for query
@@ -116,6 +182,26 @@ public:
 	 */
 	virtual std::string escapeBlob(const char* s, uint32_t length) =0;
 
+	/**
+	 * Checks whether a table exists in the current database
+	 *
+	 * @param table table name
+	 * @return true if it exists, false if not or on error
+	 */
+	virtual bool tableExists(const std::string& table);
+
+	/**
+	 * Clause turning an INSERT into an upsert
+	 *
+	 * @param key unique column the rows collide on
+	 * @param columns columns to overwrite with the inserted values on collision
+	 * @return clause to append after the VALUES list, empty when the database has none
+	 */
+	virtual std::string getUpsertClause([[maybe_unused]]const std::string& key, [[maybe_unused]]const std::vector<std::string>& columns) const
+	{
+		return std::string();
+	};
+
 	/**
 	 * Resource freeing
 	 * Used as argument to shared_ptr, you need not call this directly
@@ -129,19 +215,34 @@ protected:
 	{};
 	virtual ~Driver()
 	{};
+	friend class Executor;
+	friend class TextStatement;
 
 	/**
 	 * Executes a query directly
 	 */
 	virtual bool internalQuery(const std::string& query) =0;
 	virtual Result_ptr internalSelectQuery(const std::string& query) =0;
+	virtual Result_ptr internalStreamQuery(const std::string& query)
+	{
+		return internalSelectQuery(query);
+	};
 
+	/**
+	 * Positions result on its first row
+	 *
+	 * Drivers return their results through it, so reaching it means the query ran; storeQuery() and streamQuery()
+	 * count a query that did not as failed, one without rows as done.
+	 */
 	Result_ptr verifyResult(Result_ptr result);
 
 	bool m_connected{false};
+	bool m_queryFailed{false};
+	CircuitBreaker* m_breaker{nullptr};
 
 private:
 	static inline Driver* _instance{nullptr};
+	static inline thread_local Driver* t_instance{nullptr};
 };
 
 	}
@@ -2,9 +2,11 @@
 
 #include "../Query.h"
 #include "globals.h"
+#include "Log/LogSite.h"
 //#include <boost/bind/bind.hpp>
-#include <iostream>
+#include <cstring>
 #include <errmsg.h> // mysql
+#include <mysqld_error.h> // mysql
 
 
 using namespace LotosPP::Database::Drivers;
@@ -14,17 +16,42 @@ using namespace std;
 
 MySQL::MySQL()
 {
-	// connection handle initialization
-	if (!mysql_init(&m_handle)) {
-		cout << endl << "Failed to initialize MySQL connection handle." << endl;
+	if (!connect()) {
 		return;
 		}
 
-	// automatic reconnect
-	my_bool reconnect{true};
-	mysql_options(&m_handle, MYSQL_OPT_RECONNECT, &reconnect);
+	using LotosPP::options;
+	if (options.get<string>("global.mapStorageType", "")=="binary") {
+		LotosPP::Database::Query query;
+		query << "SHOW variables LIKE 'max_allowed_packet';";
+
+		if (LotosPP::Database::Result_ptr result=storeQuery(query.str()); result && result->getDataInt("Value")<16777216) {
+			LOGC(LWARNING, "sql") << "max_allowed_packet might be set too low for binary map storage, raise it with: "
+				"SET GLOBAL max_allowed_packet = 16777216;";
+			}
+		}
+}
 
+bool MySQL::connect()
+{
 	using LotosPP::options;
+	// a fresh handle every time, no MYSQL_OPT_RECONNECT: that would reconnect inside any call, blocking it and
+	// silently losing the session state
+	if (m_initialized) {
+		clearStatements();
+		mysql_close(&m_handle);
+		m_initialized=false;
+		}
+	// connection handle initialization
+	if (!mysql_init(&m_handle)) {
+		LOGC(LERROR, "sql") << "Failed to initialize MySQL connection handle.";
+		return false;
+		}
+	m_initialized=true;
+	// bounds how long a reconnect may hold a database thread
+	unsigned int timeout{options.get<unsigned int>("database.ConnectTimeout", 5)};
+	mysql_options(&m_handle, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+
 	// connects to database
 	if (!mysql_real_connect(&m_handle,
 			options.get("database.Host", "localhost").c_str(),
@@ -36,34 +63,24 @@ MySQL::MySQL()
 			0
 			)
 		) {
-		cout << "Failed to connect to database. MYSQL ERROR: " << mysql_error(&m_handle) << endl;
-		return;
+		LOGC(LERROR, "sql") << "Failed to connect to database. MYSQL ERROR: " << mysql_error(&m_handle);
+		return false;
 		}
 
 	if (MYSQL_VERSION_ID<50019) {
-		//mySQL servers < 5.0.19 has a bug where MYSQL_OPT_RECONNECT is (incorrectly) reset by mysql_real_connect calls
-		//See http://dev.mysql.com/doc/refman/5.0/en/mysql-options.html for more information.
-		mysql_options(&m_handle, MYSQL_OPT_RECONNECT, &reconnect);
-		cout << endl << "[Warning] Outdated MySQL server detected (" << MYSQL_SERVER_VERSION << "). Consider upgrading to a newer version." << endl;
+		LOGC(LWARNING, "sql") << "Outdated MySQL server detected (" << MYSQL_SERVER_VERSION << "). Consider upgrading to a newer version.";
 		}
 
 	m_connected=true;
-
-	if (options.get<string>("global.mapStorageType", "")=="binary") {
-		LotosPP::Database::Query query;
-		query << "SHOW variables LIKE 'max_allowed_packet';";
-
-		if (LotosPP::Database::Result_ptr result=storeQuery(query.str()); result && result->getDataInt("Value")<16777216) {
-			cout << endl << "[Warning] max_allowed_packet might be set too low for binary map storage." << endl;
-			cout << "Use the following query to raise max_allow_packet: " << endl;
-			cout << "\tSET GLOBAL max_allowed_packet = 16777216;" << endl;
-			}
-		}
+	return true;
 }
 
 MySQL::~MySQL()
 {
-	mysql_close(&m_handle);
+	clearStatements();
+	if (m_initialized) {
+		mysql_close(&m_handle);
+		}
 }
 
 bool MySQL::getParam(const LotosPP::Database::DBParam_t& param) const
@@ -76,6 +93,15 @@ bool MySQL::getParam(const LotosPP::Database::DBParam_t& param) const
 		}
 }
 
+bool MySQL::ping()
+{
+	if (m_connected && !mysql_ping(&m_handle)) {
+		return true;
+		}
+	m_connected=false;
+	return connect();
+}
+
 bool MySQL::beginTransaction()
 {
 	return executeQuery("BEGIN");
@@ -87,12 +113,10 @@ bool MySQL::rollback()
 		return false;
 		}
 
-#ifdef __DEBUG_SQL__
-	cout << "ROLLBACK" << endl;
-#endif
+	LOGC(LTRACE, "sql") << "ROLLBACK";
 
 	if (mysql_rollback(&m_handle)) {
-		cout << "mysql_rollback(): MYSQL ERROR: " << mysql_error(&m_handle) << endl;
+		LOGC(LERROR, "sql") << "mysql_rollback(): MYSQL ERROR: " << mysql_error(&m_handle);
 		return false;
 		}
 
@@ -105,11 +129,9 @@ bool MySQL::commit()
 		return false;
 		}
 
-#ifdef __DEBUG_SQL__
-	cout << "COMMIT" << endl;
-#endif
+	LOGC(LTRACE, "sql") << "COMMIT";
 	if (mysql_commit(&m_handle)) {
-		cout << "mysql_commit(): MYSQL ERROR: " << mysql_error(&m_handle) << endl;
+		LOGC(LERROR, "sql") << "mysql_commit(): MYSQL ERROR: " << mysql_error(&m_handle);
 		return false;
 		}
 
@@ -122,15 +144,13 @@ bool MySQL::internalQuery(const string& query)
 		return false;
 		}
 
-#ifdef __DEBUG_SQL__
-	cout << "MYSQL QUERY: " << query << endl;
-#endif
+	LOGC(LTRACE, "sql") << "MYSQL QUERY: " << query;
 
 	bool state{true};
 
 	// executes the query
 	if (mysql_real_query(&m_handle, query.c_str(), query.length())) {
-		cout << "mysql_real_query(): " << query.substr(0, 256) << ": MYSQL ERROR: " << mysql_error(&m_handle) << endl;
+		LOGC(LERROR, "sql") << "mysql_real_query(): " << query.substr(0, 256) << ": MYSQL ERROR: " << mysql_error(&m_handle);
 		if (int error=mysql_errno(&m_handle); error==CR_SERVER_LOST || error==CR_SERVER_GONE_ERROR) {
 			m_connected=false;
 			}
@@ -148,18 +168,26 @@ bool MySQL::internalQuery(const string& query)
 }
 
 LotosPP::Database::Result_ptr MySQL::internalSelectQuery(const std::string& query)
+{
+	return selectQuery(query, false);
+}
+
+LotosPP::Database::Result_ptr MySQL::internalStreamQuery(const std::string& query)
+{
+	return selectQuery(query, true);
+}
+
+LotosPP::Database::Result_ptr MySQL::selectQuery(const std::string& query, bool stream)
 {
 	if (!m_connected) {
 		return LotosPP::Database::Result_ptr();
 		}
 
-#ifdef __DEBUG_SQL__
-	cout << "MYSQL QUERY: " << query << endl;
-#endif
+	LOGC(LTRACE, "sql") << "MYSQL QUERY: " << query;
 
 	// executes the query
 	if (mysql_real_query(&m_handle, query.c_str(), query.length())) {
-		cout << "mysql_real_query(): " << query << ": MYSQL ERROR: " << mysql_error(&m_handle) << endl;
+		LOGC(LERROR, "sql") << "mysql_real_query(): " << query << ": MYSQL ERROR: " << mysql_error(&m_handle);
 		if (int error=mysql_errno(&m_handle); error==CR_SERVER_LOST || error==CR_SERVER_GONE_ERROR) {
 			m_connected=false;
 			}
@@ -167,10 +195,13 @@ LotosPP::Database::Result_ptr MySQL::internalSelectQuery(const std::string& quer
 
 	// we should call that every time as someone would call executeQuery('SELECT...')
 	// as it is described in MySQL manual: "it doesn't hurt" :P
-	MYSQL_RES* m_res=mysql_store_result(&m_handle);
+	// streamed rows stay on the server until fetched, the connection is busy until the result is freed
+	MYSQL_RES* m_res=stream
+		? mysql_use_result(&m_handle)
+		: mysql_store_result(&m_handle);
 	// error occured
 	if (!m_res) {
-		cout << "mysql_store_result(): " << query.substr(0, 256) << ": MYSQL ERROR: " << mysql_error(&m_handle) << endl;
+		LOGC(LERROR, "sql") << (stream ? "mysql_use_result(): " : "mysql_store_result(): ") << query.substr(0, 256) << ": MYSQL ERROR: " << mysql_error(&m_handle);
 		if (int error=mysql_errno(&m_handle); error==CR_SERVER_LOST || error==CR_SERVER_GONE_ERROR) {
 			m_connected=false;
 			}
@@ -179,7 +210,7 @@ LotosPP::Database::Result_ptr MySQL::internalSelectQuery(const std::string& quer
 		}
 
 	// retriving results of query
-	LotosPP::Database::Result_ptr res(new MySQLResult(m_res), boost::bind(&LotosPP::Database::Driver::freeResult, this, boost::placeholders::_1));
+	LotosPP::Database::Result_ptr res(new MySQLResult(m_res, !stream), boost::bind(&LotosPP::Database::Driver::freeResult, this, boost::placeholders::_1));
 	return verifyResult(res);
 }
 
@@ -211,14 +242,188 @@ std::string MySQL::escapeBlob(const char* s, uint32_t length)
 	return r;
 }
 
+bool MySQL::tableExists(const std::string& table)
+{
+	return (bool)storeQuery("SELECT 1 FROM information_schema.tables WHERE table_schema=DATABASE() AND table_name="+escapeString(table));
+}
+
+std::string MySQL::getUpsertClause([[maybe_unused]]const std::string& key, const std::vector<std::string>& columns) const
+{
+	// collides on any unique key, there is no way to name one
+	string r{" ON DUPLICATE KEY UPDATE "};
+	for (size_t i=0; i<columns.size(); ++i) {
+		if (i) {
+			r+=", ";
+			}
+		r+=columns[i]+"=VALUES("+columns[i]+")";
+		}
+	return r;
+}
+
 void MySQL::freeResult(LotosPP::Database::Result* res)
 {
+	if (MySQLStatementResult* stmtRes=dynamic_cast<MySQLStatementResult*>(res)) {
+		delete stmtRes;
+		return;
+		}
 	delete (MySQLResult*)res;
 }
 
+LotosPP::Database::Statement_ptr MySQL::prepare(const std::string& sql)
+{
+	if (!m_connected) {
+		return LotosPP::Database::Statement_ptr();
+		}
+	return LotosPP::Database::Statement_ptr(new MySQLStatement(this, sql));
+}
+
+MySQL::CachedStatement* MySQL::getStatement(const std::string& sql)
+{
+	if (unsigned long threadId=mysql_thread_id(&m_handle); threadId!=m_threadId) {
+		clearStatements();
+		m_threadId=threadId;
+		}
+	if (auto it=m_statements.find(sql); it!=m_statements.end()) {
+		return &it->second;
+		}
+
+	LOGC(LTRACE, "sql") << "MYSQL PREPARE: " << sql;
+	MYSQL_STMT* stmt=mysql_stmt_init(&m_handle);
+	if (!stmt) {
+		LOGC(LERROR, "sql") << "mysql_stmt_init(): MYSQL ERROR: " << mysql_error(&m_handle);
+		return nullptr;
+		}
+	if (mysql_stmt_prepare(stmt, sql.c_str(), sql.length())) {
+		LOGC(LERROR, "sql") << "mysql_stmt_prepare(): " << sql.substr(0, 256) << ": MYSQL ERROR: " << mysql_stmt_error(stmt);
+		if (unsigned int error=mysql_stmt_errno(stmt); error==CR_SERVER_LOST || error==CR_SERVER_GONE_ERROR) {
+			m_connected=false;
+			}
+		mysql_stmt_close(stmt);
+		return nullptr;
+		}
+	CachedStatement& cached=m_statements[sql];
+	cached.stmt=MySQLStmt_ptr(stmt, mysql_stmt_close);
+	return &cached;
+}
+
+void MySQL::dropStatement(const std::string& sql)
+{
+	if (auto it=m_statements.find(sql); it!=m_statements.end()) {
+		m_statements.erase(it);
+		}
+}
+
+void MySQL::clearStatements()
+{
+	m_statements.clear();
+}
+
+/** MySQLStatement definitions */
+
+MySQL::CachedStatement* MySQLStatement::run()
+{
+	for (int attempt=0; attempt<2; ++attempt) {
+		MySQL::CachedStatement* cached=m_db->getStatement(m_sql);
+		if (!cached) {
+			// a reconnect may bring the server back
+			if (!attempt && !m_db->isConnected() && m_db->reconnect()) {
+				continue;
+				}
+			return nullptr;
+			}
+		MYSQL_STMT* stmt=cached->stmt.get();
+		if (mysql_stmt_param_count(stmt)!=m_params.size()) {
+			LOGC(LERROR, "sql") << "MySQLStatement: " << m_sql.substr(0, 256) << ": expected " << mysql_stmt_param_count(stmt) << " parameters, got " << m_params.size();
+			return nullptr;
+			}
+
+		std::vector<MYSQL_BIND> binds(m_params.size());
+		std::vector<unsigned long> lengths(m_params.size());
+		if (!binds.empty()) {
+			memset(binds.data(), 0, sizeof(MYSQL_BIND)*binds.size());
+			}
+		for (size_t i=0; i<m_params.size(); ++i) {
+			if (int64_t* v=std::get_if<int64_t>(&m_params[i])) {
+				binds[i].buffer_type=MYSQL_TYPE_LONGLONG;
+				binds[i].buffer=v;
+				}
+			else if (uint64_t* v=std::get_if<uint64_t>(&m_params[i])) {
+				binds[i].buffer_type=MYSQL_TYPE_LONGLONG;
+				binds[i].buffer=v;
+				binds[i].is_unsigned=true;
+				}
+			else if (std::string* v=std::get_if<std::string>(&m_params[i])) {
+				lengths[i]=v->length();
+				binds[i].buffer_type=MYSQL_TYPE_STRING;
+				binds[i].buffer=v->data();
+				binds[i].buffer_length=lengths[i];
+				binds[i].length=&lengths[i];
+				}
+			else {
+				binds[i].buffer_type=MYSQL_TYPE_NULL;
+				}
+			}
+
+		LOGC(LTRACE, "sql") << "MYSQL EXECUTE: " << m_sql;
+		if ((binds.empty() || !mysql_stmt_bind_param(stmt, binds.data())) && !mysql_stmt_execute(stmt)) {
+			return cached;
+			}
+
+		unsigned int error=mysql_stmt_errno(stmt);
+		LOGC(LERROR, "sql") << "mysql_stmt_execute(): " << m_sql.substr(0, 256) << ": MYSQL ERROR: " << mysql_stmt_error(stmt);
+		switch (error) {
+			case CR_SERVER_LOST:
+			case CR_SERVER_GONE_ERROR:
+				m_db->m_connected=false;
+				[[fallthrough]];
+			case CR_NO_PREPARE_STMT:
+			case ER_UNKNOWN_STMT_HANDLER:
+			case ER_NEED_REPREPARE:
+				// statement is gone on the server side, prepare it again and retry once
+				m_db->dropStatement(m_sql);
+				if (!m_db->isConnected() && !m_db->reconnect()) {
+					return nullptr;
+					}
+				continue;
+			default:
+				mysql_stmt_reset(stmt);
+				return nullptr;
+			}
+		}
+	return nullptr;
+}
+
+bool MySQLStatement::internalExecute()
+{
+	MySQL::CachedStatement* cached=run();
+	if (!cached) {
+		return false;
+		}
+	m_insertId=mysql_stmt_insert_id(cached->stmt.get());
+	// same as internalQuery, drop a result nobody asked for
+	mysql_stmt_free_result(cached->stmt.get());
+	return true;
+}
+
+LotosPP::Database::Result_ptr MySQLStatement::internalQuery()
+{
+	MySQL::CachedStatement* cached=run();
+	if (!cached) {
+		return LotosPP::Database::Result_ptr();
+		}
+	if (!mysql_stmt_field_count(cached->stmt.get())) {
+		// ran, but returns no columns
+		m_failed=false;
+		return LotosPP::Database::Result_ptr();
+		}
+	LotosPP::Database::Result_ptr res(new MySQLStatementResult(cached->stmt, cached->names), boost::bind(&LotosPP::Database::Driver::freeResult, m_db, boost::placeholders::_1));
+	return verifyResult(res);
+}
+
 /** MySQLResult definitions */
 
-MySQLResult::MySQLResult(MYSQL_RES* res)
+MySQLResult::MySQLResult(MYSQL_RES* res, bool buffered)
+	: m_buffered{buffered}
 {
 	m_handle=res;
 	m_listNames.clear();
@@ -229,6 +434,7 @@ MySQLResult::MySQLResult(MYSQL_RES* res)
 		m_listNames[field->name]=i;
 		i++;
 		}
+	m_fieldCount=i;
 }
 
 MySQLResult::~MySQLResult()
@@ -236,79 +442,81 @@ MySQLResult::~MySQLResult()
 	mysql_free_result(m_handle);
 }
 
-int32_t MySQLResult::getDataInt(const std::string& s)
+int32_t MySQLResult::column(const std::string& s, const char* caller)
 {
-	if (listNames_t::iterator it=m_listNames.find(s); it!=m_listNames.end()) {
-		if (m_row[it->second]==NULL) {
-			return 0;
-			}
-		return atoi(m_row[it->second]);
+	if (MySQLColumnNames::const_iterator it=m_listNames.find(s); it!=m_listNames.end()) {
+		return it->second;
 		}
 
-	cout << "Error during getDataInt(" << s << ")." << endl;
-	return 0; // Failed
+	LOGC(LERROR, "sql") << "Error during " << caller << "(" << s << ").";
+	return -1;
 }
 
-uint32_t MySQLResult::getDataUInt(const std::string& s)
+int32_t MySQLResult::getColumnIndex(const std::string& s)
 {
-	if (listNames_t::iterator it=m_listNames.find(s); it!=m_listNames.end()) {
-		if (m_row[it->second]==NULL) {
-			return 0;
-			}
-		istringstream os(m_row[it->second]);
-		uint32_t res;
-		os >> res;
-		return res;
+	if (MySQLColumnNames::const_iterator it=m_listNames.find(s); it!=m_listNames.end()) {
+		return it->second;
 		}
-
-	cout << "Error during getDataInt(" << s << ")." << endl;
-	return 0; // Failed
+	return -1;
 }
 
-int64_t MySQLResult::getDataLong(const std::string& s)
+std::string_view MySQLResult::getView(uint32_t column)
 {
-	if (listNames_t::iterator it=m_listNames.find(s); it!=m_listNames.end()) {
-		if (m_row[it->second]==NULL) {
-			return 0;
-			}
-		return atoll(m_row[it->second]);
+	if (isNull(column)) {
+		return std::string_view();
 		}
+	return std::string_view(m_row[column], m_lengths[column]);
+}
 
-	cout << "Error during getDataLong(" << s << ")." << endl;
-	return 0; // Failed
+int32_t MySQLResult::getDataInt(const std::string& s)
+{
+	int32_t i=column(s, "getDataInt");
+	return i<0
+		? 0 // Failed
+		: get<int32_t>(i);
 }
 
-std::string MySQLResult::getDataString(const std::string& s)
+uint32_t MySQLResult::getDataUInt(const std::string& s)
 {
-	if (listNames_t::iterator it=m_listNames.find(s); it!=m_listNames.end()) {
-		return m_row[it->second]==NULL
-			? ""
-			: m_row[it->second];
-		}
+	int32_t i=column(s, "getDataUInt");
+	return i<0
+		? 0 // Failed
+		: get<uint32_t>(i);
+}
+
+int64_t MySQLResult::getDataLong(const std::string& s)
+{
+	int32_t i=column(s, "getDataLong");
+	return i<0
+		? 0 // Failed
+		: get<int64_t>(i);
+}
 
-	cout << "Error during getDataString(" << s << ")." << endl;
-	return ""; // Failed
+std::string MySQLResult::getDataString(const std::string& s)
+{
+	int32_t i=column(s, "getDataString");
+	return i<0
+		? "" // Failed
+		: get<std::string>(i);
 }
 
 const char* MySQLResult::getDataStream(const std::string& s, unsigned long& size)
 {
-	if (listNames_t::iterator it=m_listNames.find(s); it!=m_listNames.end()) {
-		if (m_row[it->second]==NULL) {
-			size=0;
-			return NULL;
-			}
-		size=mysql_fetch_lengths(m_handle)[it->second];
-		return m_row[it->second];
+	int32_t i=column(s, "getDataStream");
+	if (i<0 || isNull(i)) {
+		size=0;
+		return NULL;
 		}
-
-	cout << "Error during getDataStream(" << s << ")." << endl;
-	size=0;
-	return NULL;
+	size=m_lengths[i];
+	return m_row[i];
 }
 
 LotosPP::Database::Result_ptr MySQLResult::advance()
 {
 	m_row=mysql_fetch_row(m_handle);
+	m_lengths=m_row!=NULL
+		? mysql_fetch_lengths(m_handle)
+		: nullptr;
 	return m_row!=NULL
 		? shared_from_this()
 		: LotosPP::Database::Result_ptr();
@@ -318,3 +526,197 @@ bool MySQLResult::empty()
 {
 	return m_row==NULL;
 }
+
+/** MySQLStatementResult definitions */
+
+MySQLStatementResult::MySQLStatementResult(const MySQLStmt_ptr& stmt, MySQLColumnNames_ptr& names)
+	: m_stmtHolder{stmt}, m_stmt{stmt.get()}
+{
+	// lets the client size the column buffers from the stored rows
+	mysql_bind_bool updateMaxLength{true};
+	mysql_stmt_attr_set(m_stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &updateMaxLength);
+	if (mysql_stmt_store_result(m_stmt)) {
+		LOGC(LERROR, "sql") << "mysql_stmt_store_result(): MYSQL ERROR: " << mysql_stmt_error(m_stmt);
+		m_failed=true;
+		return;
+		}
+
+	MYSQL_RES* meta=mysql_stmt_result_metadata(m_stmt);
+	if (!meta) {
+		m_failed=true;
+		return;
+		}
+	unsigned int count=mysql_num_fields(meta);
+	MYSQL_FIELD* fields=mysql_fetch_fields(meta);
+	m_buffers.resize(count);
+	m_lengths.resize(count);
+	m_nulls.reset(new mysql_bind_bool[count]());
+	m_binds.resize(count);
+	memset(m_binds.data(), 0, sizeof(MYSQL_BIND)*count);
+	if (!names) {
+		boost::shared_ptr<MySQLColumnNames> resolved(new MySQLColumnNames);
+		for (unsigned int i=0; i<count; ++i) {
+			(*resolved)[fields[i].name]=i;
+			}
+		names=resolved;
+		}
+	m_listNames=names;
+	for (unsigned int i=0; i<count; ++i) {
+		// numbers are converted to text, their display width is enough. The width of TEXT and BLOB columns is
+		// up to 4 GB, they get the longest value stored instead, see fetchTruncated() for the rest.
+		unsigned long length{fields[i].max_length};
+		switch (fields[i].type) {
+			case MYSQL_TYPE_TINY_BLOB:
+			case MYSQL_TYPE_MEDIUM_BLOB:
+			case MYSQL_TYPE_LONG_BLOB:
+			case MYSQL_TYPE_BLOB:
+			case MYSQL_TYPE_STRING:
+			case MYSQL_TYPE_VAR_STRING:
+			case MYSQL_TYPE_VARCHAR:
+			case MYSQL_TYPE_JSON:
+			case MYSQL_TYPE_GEOMETRY:
+				break;
+			default:
+				length=std::max(length, fields[i].length);
+				break;
+			}
+		m_buffers[i].resize(length+1);
+		m_binds[i].buffer_type=MYSQL_TYPE_STRING;
+		m_binds[i].buffer=m_buffers[i].data();
+		m_binds[i].buffer_length=m_buffers[i].size();
+		m_binds[i].length=&m_lengths[i];
+		m_binds[i].is_null=&m_nulls[i];
+		}
+	mysql_free_result(meta);
+	if (count && mysql_stmt_bind_result(m_stmt, m_binds.data())) {
+		LOGC(LERROR, "sql") << "mysql_stmt_bind_result(): MYSQL ERROR: " << mysql_stmt_error(m_stmt);
+		m_binds.clear();
+		m_failed=true;
+		}
+}
+
+MySQLStatementResult::~MySQLStatementResult()
+{
+	mysql_stmt_free_result(m_stmt);
+}
+
+int32_t MySQLStatementResult::column(const std::string& s, const char* caller)
+{
+	// no metadata, the statement returned no columns
+	if (m_listNames) {
+		if (MySQLColumnNames::const_iterator it=m_listNames->find(s); it!=m_listNames->end()) {
+			return it->second;
+			}
+		}
+
+	LOGC(LERROR, "sql") << "Error during " << caller << "(" << s << ").";
+	return -1;
+}
+
+int32_t MySQLStatementResult::getColumnIndex(const std::string& s)
+{
+	if (!m_listNames) {
+		return -1;
+		}
+	if (MySQLColumnNames::const_iterator it=m_listNames->find(s); it!=m_listNames->end()) {
+		return it->second;
+		}
+	return -1;
+}
+
+std::string_view MySQLStatementResult::getView(uint32_t column)
+{
+	if (isNull(column)) {
+		return std::string_view();
+		}
+	return std::string_view(m_buffers[column].data(), std::min(m_lengths[column], (unsigned long)m_buffers[column].size()-1));
+}
+
+int32_t MySQLStatementResult::getDataInt(const std::string& s)
+{
+	int32_t i=column(s, "getDataInt");
+	return i<0
+		? 0
+		: get<int32_t>(i);
+}
+
+uint32_t MySQLStatementResult::getDataUInt(const std::string& s)
+{
+	int32_t i=column(s, "getDataUInt");
+	return i<0
+		? 0
+		: get<uint32_t>(i);
+}
+
+int64_t MySQLStatementResult::getDataLong(const std::string& s)
+{
+	int32_t i=column(s, "getDataLong");
+	return i<0
+		? 0
+		: get<int64_t>(i);
+}
+
+std::string MySQLStatementResult::getDataString(const std::string& s)
+{
+	int32_t i=column(s, "getDataString");
+	return i<0
+		? ""
+		: get<std::string>(i);
+}
+
+const char* MySQLStatementResult::getDataStream(const std::string& s, unsigned long& size)
+{
+	int32_t i=column(s, "getDataStream");
+	if (i<0 || isNull(i)) {
+		size=0;
+		return NULL;
+		}
+	std::string_view v=getView(i);
+	size=v.size();
+	return v.data();
+}
+
+LotosPP::Database::Result_ptr MySQLStatementResult::advance()
+{
+	if (m_binds.empty()) {
+		m_hasRow=false;
+		return LotosPP::Database::Result_ptr();
+		}
+	int rc=mysql_stmt_fetch(m_stmt);
+	m_hasRow=(!rc || (rc==MYSQL_DATA_TRUNCATED && fetchTruncated()));
+	// MYSQL_NO_DATA is the end of the rows, anything else that gave no row an error
+	m_failed=(!m_hasRow && rc!=MYSQL_NO_DATA);
+	return m_hasRow
+		? shared_from_this()
+		: LotosPP::Database::Result_ptr();
+}
+
+bool MySQLStatementResult::fetchTruncated()
+{
+	// a value longer than max_length said, grow its buffer and fetch the column again
+	bool grown{false};
+	for (size_t i=0; i<m_binds.size(); ++i) {
+		if (m_nulls[i] || m_lengths[i]<m_buffers[i].size()) {
+			continue;
+			}
+		m_buffers[i].resize(m_lengths[i]+1);
+		m_binds[i].buffer=m_buffers[i].data();
+		m_binds[i].buffer_length=m_buffers[i].size();
+		if (mysql_stmt_fetch_column(m_stmt, &m_binds[i], i, 0)) {
+			LOGC(LERROR, "sql") << "mysql_stmt_fetch_column(): MYSQL ERROR: " << mysql_stmt_error(m_stmt);
+			return false;
+			}
+		grown=true;
+		}
+	// the next rows go to the grown buffers
+	if (grown && mysql_stmt_bind_result(m_stmt, m_binds.data())) {
+		LOGC(LERROR, "sql") << "mysql_stmt_bind_result(): MYSQL ERROR: " << mysql_stmt_error(m_stmt);
+		return false;
+		}
+	return true;
+}
+
+bool MySQLStatementResult::empty()
+{
+	return !m_hasRow;
+}
@@ -4,8 +4,13 @@
 
 #include "../Driver.h"
 #include "../Result.h"
+#include "../Statement.h"
 #include "System/build_config.h"
 #include <map>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 #ifdef OS_WIN
 #	include <winsock.h>
 #endif
@@ -14,6 +19,11 @@
 
 namespace LotosPP::Database::Drivers {
 
+typedef std::map<std::string, uint32_t, std::less<>> MySQLColumnNames;
+typedef boost::shared_ptr<const MySQLColumnNames> MySQLColumnNames_ptr;
+// closed with mysql_stmt_close() by its last holder, the cache or a result still reading it
+typedef boost::shared_ptr<MYSQL_STMT> MySQLStmt_ptr;
+
 class MySQL
 	: public LotosPP::Database::Driver
 {
@@ -22,6 +32,7 @@ public:
 	virtual ~MySQL();
 
 	virtual bool getParam(const LotosPP::Database::DBParam_t& param) const;
+	virtual bool ping();
 
 	virtual bool beginTransaction();
 	virtual bool rollback();
@@ -31,13 +42,64 @@ public:
 
 	virtual std::string escapeString(const std::string& s);
 	virtual std::string escapeBlob(const char* s, uint32_t length);
+	virtual bool tableExists(const std::string& table);
+	virtual std::string getUpsertClause(const std::string& key, const std::vector<std::string>& columns) const;
+
+	virtual LotosPP::Database::Statement_ptr prepare(const std::string& sql);
 
 protected:
 	virtual bool internalQuery(const std::string& query);
 	virtual LotosPP::Database::Result_ptr internalSelectQuery(const std::string& query);
+	virtual LotosPP::Database::Result_ptr internalStreamQuery(const std::string& query);
+	LotosPP::Database::Result_ptr selectQuery(const std::string& query, bool stream);
 	virtual void freeResult(LotosPP::Database::Result* res);
+	bool connect();
+
+	/**
+	 * Statement cache of this connection
+	 *
+	 * Server side statements die with the connection, a reconnect or a changed thread id clears it and the whole
+	 * cache is prepared again on demand. A result still alive then keeps its statement, mysql_close() detached it.
+	 */
+	struct CachedStatement {
+		MySQLStmt_ptr stmt{};
+		MySQLColumnNames_ptr names{};
+	};
+	CachedStatement* getStatement(const std::string& sql);
+	void dropStatement(const std::string& sql);
+	void clearStatements();
 
 	MYSQL m_handle;
+	bool m_initialized{false};
+	std::map<std::string, CachedStatement> m_statements{};
+	unsigned long m_threadId{0};
+
+	friend class MySQLStatement;
+};
+
+// my_bool in older client libraries, bool since MySQL 8
+typedef std::remove_pointer_t<decltype(MYSQL_BIND::is_null)> mysql_bind_bool;
+
+class MySQLStatement
+	: public LotosPP::Database::Statement
+{
+public:
+	MySQLStatement(MySQL* db, const std::string& sql)
+		: Statement(sql), m_db{db}
+	{};
+
+	virtual uint64_t getLastInsertedRowID()
+	{
+		return m_insertId;
+	};
+
+protected:
+	virtual bool internalExecute();
+	virtual LotosPP::Database::Result_ptr internalQuery();
+	MySQL::CachedStatement* run();
+
+	MySQL* m_db;
+	uint64_t m_insertId{0};
 };
 
 class MySQLResult
@@ -52,18 +114,102 @@ public:
 	virtual std::string getDataString(const std::string& s);
 	virtual const char* getDataStream(const std::string& s, unsigned long& size);
 
+	virtual int32_t getColumnIndex(const std::string& s);
+	virtual uint32_t getColumnCount()
+	{
+		return m_fieldCount;
+	};
+	virtual std::string_view getView(uint32_t column);
+	virtual bool isNull(uint32_t column)
+	{
+		return !m_row || column>=m_fieldCount || !m_row[column];
+	};
+
 	virtual LotosPP::Database::Result_ptr advance();
 	virtual bool empty();
+	virtual int64_t getRowCount()
+	{
+		return m_buffered ? (int64_t)mysql_num_rows(m_handle) : -1;
+	};
 
 protected:
-	MySQLResult(MYSQL_RES* res);
+	/**
+	 * @param buffered false for mysql_use_result(), the row count isn't known then
+	 */
+	MySQLResult(MYSQL_RES* res, bool buffered);
 	virtual ~MySQLResult();
 
-	typedef std::map<const std::string, uint32_t> listNames_t;
-	listNames_t m_listNames{};
+	int32_t column(const std::string& s, const char* caller);
+
+	MySQLColumnNames m_listNames{};
 
 	MYSQL_RES* m_handle{nullptr};
-	MYSQL_ROW m_row;
+	MYSQL_ROW m_row{nullptr};
+	unsigned long* m_lengths{nullptr};
+	uint32_t m_fieldCount{0};
+	bool m_buffered;
+};
+
+/**
+ * Rows of a prepared statement, buffered on the client and read as text
+ */
+class MySQLStatementResult
+	: public LotosPP::Database::Result
+{
+	friend class MySQL;
+	friend class MySQLStatement;
+
+public:
+	virtual int32_t getDataInt(const std::string& s);
+	virtual uint32_t getDataUInt(const std::string& s);
+	virtual int64_t getDataLong(const std::string& s);
+	virtual std::string getDataString(const std::string& s);
+	virtual const char* getDataStream(const std::string& s, unsigned long& size);
+
+	virtual int32_t getColumnIndex(const std::string& s);
+	virtual uint32_t getColumnCount()
+	{
+		return m_binds.size();
+	};
+	virtual std::string_view getView(uint32_t column);
+	virtual bool isNull(uint32_t column)
+	{
+		return !m_hasRow || column>=m_binds.size() || m_nulls[column];
+	};
+
+	virtual LotosPP::Database::Result_ptr advance();
+	virtual bool empty();
+	virtual bool failed()
+	{
+		return m_failed;
+	};
+	virtual int64_t getRowCount()
+	{
+		return mysql_stmt_num_rows(m_stmt);
+	};
+
+protected:
+	/**
+	 * @param stmt executed statement, held until the result is freed
+	 * @param names column ordinals of the statement, filled on its first execution and reused afterwards
+	 */
+	MySQLStatementResult(const MySQLStmt_ptr& stmt, MySQLColumnNames_ptr& names);
+	virtual ~MySQLStatementResult();
+
+	int32_t column(const std::string& s, const char* caller);
+	bool fetchTruncated();
+
+	MySQLColumnNames_ptr m_listNames{};
+
+	MySQLStmt_ptr m_stmtHolder{};
+	MYSQL_STMT* m_stmt{nullptr};
+	std::vector<std::vector<char>> m_buffers{};
+	std::vector<unsigned long> m_lengths{};
+	// not a vector, that would be vector<bool> with MySQL 8
+	std::unique_ptr<mysql_bind_bool[]> m_nulls{};
+	std::vector<MYSQL_BIND> m_binds{};
+	bool m_hasRow{false};
+	bool m_failed{false};
 };
 
 	}
@@ -0,0 +1,374 @@
+#include "SQLite.h"
+
+#include "globals.h"
+#include "Log/LogSite.h"
+#include <boost/bind/bind.hpp>
+
+
+using namespace LotosPP::Database::Drivers;
+using namespace std;
+
+/** SQLite definitions */
+
+SQLite::SQLite()
+{
+	using LotosPP::options;
+	string file{options.get("database.File", "lotos.sqlite3")};
+
+	// every connection is used by a single thread, SQLite's own locking is not needed
+	if (sqlite3_open_v2(file.c_str(), &m_handle, SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE|SQLITE_OPEN_NOMUTEX, nullptr)!=SQLITE_OK) {
+		LOGC(LERROR, "sql") << "Failed to open database " << file << ". SQLITE ERROR: " << sqlite3_errmsg(m_handle);
+		sqlite3_close(m_handle);
+		m_handle=nullptr;
+		return;
+		}
+	sqlite3_busy_timeout(m_handle, options.get<int>("database.BusyTimeout", 5000));
+
+	m_connected=true;
+	// readers don't block the writer and the other way around, commits don't wait for fsync of the database file
+	if (!internalQuery("PRAGMA journal_mode=WAL")
+		|| !internalQuery("PRAGMA synchronous=NORMAL")
+		|| !internalQuery("PRAGMA foreign_keys=ON")
+		) {
+		LOGC(LWARNING, "sql") << "Could not set up SQLite database " << file;
+		}
+}
+
+SQLite::~SQLite()
+{
+	for (auto& [sql, stmt] : m_statements) {
+		sqlite3_finalize(stmt);
+		}
+	m_statements.clear();
+	if (m_handle) {
+		sqlite3_close(m_handle);
+		}
+}
+
+bool SQLite::getParam(const LotosPP::Database::DBParam_t& param) const
+{
+	switch (param) {
+		case DBPARAM_MULTIINSERT:
+		case DBPARAM_SINGLE_WRITER:
+			return true;
+		default:
+			return false;
+		}
+}
+
+bool SQLite::beginTransaction()
+{
+	// take the write lock right away, a deferred transaction may fail to upgrade later
+	return executeQuery("BEGIN IMMEDIATE");
+}
+
+bool SQLite::rollback()
+{
+	return executeQuery("ROLLBACK");
+}
+
+bool SQLite::commit()
+{
+	return executeQuery("COMMIT");
+}
+
+uint64_t SQLite::getLastInsertedRowID()
+{
+	return m_handle
+		? (uint64_t)sqlite3_last_insert_rowid(m_handle)
+		: 0;
+}
+
+std::string SQLite::escapeString(const std::string& s)
+{
+	string r{"'"};
+	r.reserve(s.length()+2);
+	for (char c : s) {
+		if (c=='\'') {
+			r+='\'';
+			}
+		r+=c;
+		}
+	r+='\'';
+	return r;
+}
+
+std::string SQLite::escapeBlob(const char* s, uint32_t length)
+{
+	static const char hex[]="0123456789ABCDEF";
+	string r{"X'"};
+	r.reserve(length*2+3);
+	for (uint32_t i=0; i<length; ++i) {
+		r+=hex[((unsigned char)s[i])>>4];
+		r+=hex[((unsigned char)s[i])&0x0f];
+		}
+	r+='\'';
+	return r;
+}
+
+bool SQLite::tableExists(const std::string& table)
+{
+	return (bool)storeQuery("SELECT 1 FROM sqlite_master WHERE type='table' AND name="+escapeString(table));
+}
+
+std::string SQLite::getUpsertClause(const std::string& key, const std::vector<std::string>& columns) const
+{
+	string r{" ON CONFLICT("+key+") DO UPDATE SET "};
+	for (size_t i=0; i<columns.size(); ++i) {
+		if (i) {
+			r+=", ";
+			}
+		r+=columns[i]+"=excluded."+columns[i];
+		}
+	return r;
+}
+
+bool SQLite::internalQuery(const std::string& query)
+{
+	if (!m_connected) {
+		return false;
+		}
+
+	LOGC(LTRACE, "sql") << "SQLITE QUERY: " << query;
+
+	char* error{nullptr};
+	if (sqlite3_exec(m_handle, query.c_str(), nullptr, nullptr, &error)!=SQLITE_OK) {
+		LOGC(LERROR, "sql") << "sqlite3_exec(): " << query.substr(0, 256) << ": SQLITE ERROR: " << (error ? error : "");
+		sqlite3_free(error);
+		return false;
+		}
+	return true;
+}
+
+LotosPP::Database::Result_ptr SQLite::internalSelectQuery(const std::string& query)
+{
+	if (!m_connected) {
+		return LotosPP::Database::Result_ptr();
+		}
+
+	LOGC(LTRACE, "sql") << "SQLITE QUERY: " << query;
+
+	sqlite3_stmt* stmt{nullptr};
+	if (sqlite3_prepare_v2(m_handle, query.c_str(), query.length(), &stmt, nullptr)!=SQLITE_OK) {
+		LOGC(LERROR, "sql") << "sqlite3_prepare_v2(): " << query.substr(0, 256) << ": SQLITE ERROR: " << sqlite3_errmsg(m_handle);
+		return LotosPP::Database::Result_ptr();
+		}
+
+	// rows are stepped through as they are read, so this is streaming already
+	LotosPP::Database::Result_ptr res(new SQLiteResult(stmt, true), boost::bind(&LotosPP::Database::Driver::freeResult, this, boost::placeholders::_1));
+	return verifyResult(res);
+}
+
+void SQLite::freeResult(LotosPP::Database::Result* res)
+{
+	delete (SQLiteResult*)res;
+}
+
+LotosPP::Database::Statement_ptr SQLite::prepare(const std::string& sql)
+{
+	if (!m_connected) {
+		return LotosPP::Database::Statement_ptr();
+		}
+	return LotosPP::Database::Statement_ptr(new SQLiteStatement(this, sql));
+}
+
+sqlite3_stmt* SQLite::getStatement(const std::string& sql)
+{
+	if (auto it=m_statements.find(sql); it!=m_statements.end()) {
+		return it->second;
+		}
+
+	sqlite3_stmt* stmt{nullptr};
+	if (sqlite3_prepare_v3(m_handle, sql.c_str(), sql.length(), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr)!=SQLITE_OK) {
+		LOGC(LERROR, "sql") << "sqlite3_prepare_v3(): " << sql.substr(0, 256) << ": SQLITE ERROR: " << sqlite3_errmsg(m_handle);
+		return nullptr;
+		}
+	m_statements[sql]=stmt;
+	return stmt;
+}
+
+/** SQLiteStatement definitions */
+
+sqlite3_stmt* SQLiteStatement::bindAll()
+{
+	sqlite3_stmt* stmt=m_db->getStatement(m_sql);
+	if (!stmt) {
+		return nullptr;
+		}
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	if ((size_t)sqlite3_bind_parameter_count(stmt)!=m_params.size()) {
+		LOGC(LERROR, "sql") << "SQLiteStatement: " << m_sql.substr(0, 256) << ": expected " << sqlite3_bind_parameter_count(stmt) << " parameters, got " << m_params.size();
+		return nullptr;
+		}
+
+	for (size_t i=0; i<m_params.size(); ++i) {
+		int rc, pos=i+1;
+		if (const int64_t* v=std::get_if<int64_t>(&m_params[i])) {
+			rc=sqlite3_bind_int64(stmt, pos, *v);
+			}
+		else if (const uint64_t* v=std::get_if<uint64_t>(&m_params[i])) {
+			rc=sqlite3_bind_int64(stmt, pos, (sqlite3_int64)*v);
+			}
+		else if (const std::string* v=std::get_if<std::string>(&m_params[i])) {
+			rc=sqlite3_bind_text(stmt, pos, v->data(), v->length(), SQLITE_TRANSIENT);
+			}
+		else {
+			rc=sqlite3_bind_null(stmt, pos);
+			}
+		if (rc!=SQLITE_OK) {
+			LOGC(LERROR, "sql") << "sqlite3_bind(): " << m_sql.substr(0, 256) << ": SQLITE ERROR: " << sqlite3_errmsg(m_db->m_handle);
+			return nullptr;
+			}
+		}
+	return stmt;
+}
+
+bool SQLiteStatement::internalExecute()
+{
+	sqlite3_stmt* stmt=bindAll();
+	if (!stmt) {
+		return false;
+		}
+
+	LOGC(LTRACE, "sql") << "SQLITE EXECUTE: " << m_sql;
+	int rc;
+	while ((rc=sqlite3_step(stmt))==SQLITE_ROW) {
+		}
+	sqlite3_reset(stmt);
+	if (rc!=SQLITE_DONE) {
+		LOGC(LERROR, "sql") << "sqlite3_step(): " << m_sql.substr(0, 256) << ": SQLITE ERROR: " << sqlite3_errmsg(m_db->m_handle);
+		return false;
+		}
+	m_insertId=sqlite3_last_insert_rowid(m_db->m_handle);
+	return true;
+}
+
+LotosPP::Database::Result_ptr SQLiteStatement::internalQuery()
+{
+	sqlite3_stmt* stmt=bindAll();
+	if (!stmt) {
+		return LotosPP::Database::Result_ptr();
+		}
+
+	LOGC(LTRACE, "sql") << "SQLITE EXECUTE: " << m_sql;
+	LotosPP::Database::Result_ptr res(new SQLiteResult(stmt, false), boost::bind(&LotosPP::Database::Driver::freeResult, m_db, boost::placeholders::_1));
+	return verifyResult(res);
+}
+
+/** SQLiteResult definitions */
+
+SQLiteResult::SQLiteResult(sqlite3_stmt* stmt, bool owned)
+	: m_stmt{stmt}, m_owned{owned}
+{
+	m_columnCount=sqlite3_column_count(m_stmt);
+	for (uint32_t i=0; i<m_columnCount; ++i) {
+		m_listNames[sqlite3_column_name(m_stmt, i)]=i;
+		}
+}
+
+SQLiteResult::~SQLiteResult()
+{
+	if (m_owned) {
+		sqlite3_finalize(m_stmt);
+		}
+	else {
+		// ends the read transaction of a cached statement
+		sqlite3_reset(m_stmt);
+		}
+}
+
+int32_t SQLiteResult::column(const std::string& s, const char* caller)
+{
+	if (listNames_t::const_iterator it=m_listNames.find(s); it!=m_listNames.end() && m_hasRow) {
+		return it->second;
+		}
+
+	LOGC(LERROR, "sql") << "Error during " << caller << "(" << s << ").";
+	return -1;
+}
+
+int32_t SQLiteResult::getColumnIndex(const std::string& s)
+{
+	if (listNames_t::const_iterator it=m_listNames.find(s); it!=m_listNames.end()) {
+		return it->second;
+		}
+	return -1;
+}
+
+std::string_view SQLiteResult::getView(uint32_t column)
+{
+	if (isNull(column)) {
+		return std::string_view();
+		}
+	// text first, then its length, as SQLite documents
+	const char* text=(const char*)sqlite3_column_text(m_stmt, column);
+	return std::string_view(text, sqlite3_column_bytes(m_stmt, column));
+}
+
+bool SQLiteResult::isNull(uint32_t column)
+{
+	return !m_hasRow || column>=m_columnCount || sqlite3_column_type(m_stmt, column)==SQLITE_NULL;
+}
+
+int32_t SQLiteResult::getDataInt(const std::string& s)
+{
+	int32_t i=column(s, "getDataInt");
+	return i<0
+		? 0 // Failed
+		: sqlite3_column_int(m_stmt, i);
+}
+
+uint32_t SQLiteResult::getDataUInt(const std::string& s)
+{
+	int32_t i=column(s, "getDataUInt");
+	return i<0
+		? 0 // Failed
+		: (uint32_t)sqlite3_column_int64(m_stmt, i);
+}
+
+int64_t SQLiteResult::getDataLong(const std::string& s)
+{
+	int32_t i=column(s, "getDataLong");
+	return i<0
+		? 0 // Failed
+		: sqlite3_column_int64(m_stmt, i);
+}
+
+std::string SQLiteResult::getDataString(const std::string& s)
+{
+	int32_t i=column(s, "getDataString");
+	return i<0
+		? "" // Failed
+		: get<std::string>(i);
+}
+
+const char* SQLiteResult::getDataStream(const std::string& s, unsigned long& size)
+{
+	int32_t i=column(s, "getDataStream");
+	if (i<0 || isNull(i)) {
+		size=0;
+		return NULL;
+		}
+	const char* blob=(const char*)sqlite3_column_blob(m_stmt, i);
+	size=sqlite3_column_bytes(m_stmt, i);
+	return blob;
+}
+
+LotosPP::Database::Result_ptr SQLiteResult::advance()
+{
+	int rc=sqlite3_step(m_stmt);
+	if (rc!=SQLITE_ROW && rc!=SQLITE_DONE) {
+		LOGC(LERROR, "sql") << "sqlite3_step(): SQLITE ERROR: " << sqlite3_errmsg(sqlite3_db_handle(m_stmt));
+		m_failed=true;
+		}
+	m_hasRow=(rc==SQLITE_ROW);
+	return m_hasRow
+		? shared_from_this()
+		: LotosPP::Database::Result_ptr();
+}
+
+bool SQLiteResult::empty()
+{
+	return !m_hasRow;
+}
@@ -0,0 +1,132 @@
+#ifndef LOTOSPP_DATABASE_DRIVERS_SQLITE_H
+#define LOTOSPP_DATABASE_DRIVERS_SQLITE_H
+#ifdef WITH_SQLITE
+
+#include "../Driver.h"
+#include "../Result.h"
+#include "../Statement.h"
+#include <map>
+#include <string_view>
+#include <sqlite3.h>
+
+
+namespace LotosPP::Database::Drivers {
+
+/**
+ * Embedded SQLite database
+ *
+ * Every instance is its own connection to database.File, opened in WAL mode so readers on other connections never
+ * block on the writer. Only one connection writes at a time, the Executor routes writes to a dedicated thread.
+ */
+class SQLite
+	: public LotosPP::Database::Driver
+{
+public:
+	SQLite();
+	virtual ~SQLite();
+
+	virtual bool getParam(const LotosPP::Database::DBParam_t& param) const;
+
+	virtual bool beginTransaction();
+	virtual bool rollback();
+	virtual bool commit();
+
+	virtual uint64_t getLastInsertedRowID();
+
+	virtual std::string escapeString(const std::string& s);
+	virtual std::string escapeBlob(const char* s, uint32_t length);
+	virtual bool tableExists(const std::string& table);
+	virtual std::string getUpsertClause(const std::string& key, const std::vector<std::string>& columns) const;
+
+	virtual LotosPP::Database::Statement_ptr prepare(const std::string& sql);
+
+protected:
+	virtual bool internalQuery(const std::string& query);
+	virtual LotosPP::Database::Result_ptr internalSelectQuery(const std::string& query);
+	virtual void freeResult(LotosPP::Database::Result* res);
+
+	/**
+	 * Statement cache of this connection, keyed by the SQL text
+	 */
+	sqlite3_stmt* getStatement(const std::string& sql);
+
+	sqlite3* m_handle{nullptr};
+	std::map<std::string, sqlite3_stmt*> m_statements{};
+
+	friend class SQLiteStatement;
+};
+
+class SQLiteStatement
+	: public LotosPP::Database::Statement
+{
+public:
+	SQLiteStatement(SQLite* db, const std::string& sql)
+		: Statement(sql), m_db{db}
+	{};
+
+	virtual uint64_t getLastInsertedRowID()
+	{
+		return m_insertId;
+	};
+
+protected:
+	virtual bool internalExecute();
+	virtual LotosPP::Database::Result_ptr internalQuery();
+	sqlite3_stmt* bindAll();
+
+	SQLite* m_db;
+	uint64_t m_insertId{0};
+};
+
+class SQLiteResult
+	: public LotosPP::Database::Result
+{
+	friend class SQLite;
+	friend class SQLiteStatement;
+
+public:
+	virtual int32_t getDataInt(const std::string& s);
+	virtual uint32_t getDataUInt(const std::string& s);
+	virtual int64_t getDataLong(const std::string& s);
+	virtual std::string getDataString(const std::string& s);
+	virtual const char* getDataStream(const std::string& s, unsigned long& size);
+
+	virtual int32_t getColumnIndex(const std::string& s);
+	virtual uint32_t getColumnCount()
+	{
+		return m_columnCount;
+	};
+	virtual std::string_view getView(uint32_t column);
+	virtual bool isNull(uint32_t column);
+
+	virtual LotosPP::Database::Result_ptr advance();
+	virtual bool empty();
+	virtual bool failed()
+	{
+		return m_failed;
+	};
+
+protected:
+	/**
+	 * @param stmt statement to step through
+	 * @param owned finalize the statement when done, otherwise it is a cached one and only gets reset
+	 */
+	SQLiteResult(sqlite3_stmt* stmt, bool owned);
+	virtual ~SQLiteResult();
+
+	int32_t column(const std::string& s, const char* caller);
+
+	typedef std::map<std::string, uint32_t, std::less<>> listNames_t;
+	listNames_t m_listNames{};
+
+	sqlite3_stmt* m_stmt{nullptr};
+	bool m_owned{false};
+	bool m_hasRow{false};
+	bool m_failed{false};
+	uint32_t m_columnCount{0};
+};
+
+	}
+
+#endif // WITH_SQLITE
+#endif
@@ -0,0 +1,302 @@
+#include "Executor.h"
+#include "Driver.h"
+#include "Common/Singleton.h"
+#include "Common/Task.h"
+#ifdef __EXCEPTION_TRACER__
+#	include "Common/ExceptionHandler.h"
+#endif
+#include "Log/Logger.h"
+#include "globals.h"
+#include <algorithm>
+#include <cassert>
+
+
+using namespace LotosPP::Database;
+
+
+Executor* Executor::instance()
+{
+	static LotosPP::Common::Singleton<Executor> instance;
+	return instance.get();
+}
+
+uint32_t Executor::start(uint32_t connections/*=0*/)
+{
+	assert(m_state==STATE_TERMINATED);
+	if (!connections) {
+		connections=std::max(1u, LotosPP::options.get<uint32_t>("database.Connections", 4));
+		}
+
+	m_breaker.configure(LotosPP::options.get<uint32_t>("database.FailureThreshold", 3),
+		LotosPP::options.get<uint32_t>("database.RetryMin", 500),
+		LotosPP::options.get<uint32_t>("database.RetryMax", 30000));
+
+	boost::unique_lock<boost::mutex> jobLockUnique(m_jobLock);
+	m_connections.assign(connections, Connection());
+	m_singleWriter=false;
+	m_started=0;
+	m_state=STATE_RUNNING;
+	for (size_t i=0; i<connections; ++i) {
+		m_threads.create_thread(boost::bind(&Executor::connectionThread, (void*)this, i));
+		}
+	// pre-connect, so the first logins don't pay for the handshakes
+	while (m_started<connections) {
+		m_startSignal.wait(jobLockUnique);
+		}
+	uint32_t connected=std::count_if(m_connections.begin(), m_connections.end(), [](const Connection& c) {
+			return c.stats.connected;
+		});
+	jobLockUnique.unlock();
+
+	LOG(LINFO) << "Database: " << connected << "/" << connections << " connections up";
+	return connected;
+}
+
+void Executor::connectionThread(void* p, size_t index)
+{
+	Executor* executor=(Executor*)p;
+#ifdef __EXCEPTION_TRACER__
+	LotosPP::Common::ExceptionHandler executorExceptionHandler;
+	executorExceptionHandler.InstallHandler();
+#endif
+
+	Driver* driver=Driver::create();
+	if (driver) {
+		driver->setCircuitBreaker(&executor->m_breaker);
+		}
+	Driver::setThreadInstance(driver);
+	const boost::posix_time::seconds pingInterval(LotosPP::options.get<long>("database.PingInterval", 30));
+
+	boost::unique_lock<boost::mutex> jobLockUnique(executor->m_jobLock);
+	Connection& connection=executor->m_connections[index];
+	connection.driver=driver;
+	connection.stats.connected=driver && driver->isConnected();
+	if (!index && driver && driver->getParam(DBPARAM_SINGLE_WRITER)) {
+		// the first connection takes all writes, the rest only reads. Alone it does both.
+		connection.writer= connection.stats.writer= true;
+		executor->m_singleWriter=true;
+		}
+	// writes only get their own queue in single writer mode
+	const bool takeWrites{connection.writer},
+		takeReads{!connection.writer || executor->m_connections.size()==1};
+	++executor->m_started;
+	jobLockUnique.unlock();
+	executor->m_startSignal.notify_all();
+
+	// queued jobs still run after shutdown(), they may be writes
+	for (;;) {
+		Job job;
+		bool idle{false};
+
+		jobLockUnique.lock();
+		std::list<Job>* list{nullptr};
+		for (;;) {
+			if (takeWrites && !executor->m_writeList.empty()) {
+				list=&executor->m_writeList;
+				}
+			else if (takeReads && !executor->m_jobList.empty()) {
+				list=&executor->m_jobList;
+				}
+			if (list || executor->m_state==STATE_TERMINATED) {
+				break;
+				}
+			// a lost connection is retried as soon as the breaker lets it, not at the next ping
+			boost::posix_time::time_duration wait{pingInterval};
+			if (driver && !driver->isConnected()) {
+				wait=std::min(wait, boost::posix_time::time_duration(boost::posix_time::milliseconds(std::max(10u, executor->m_breaker.untilRetry()))));
+				}
+			if (!executor->m_jobSignal.timed_wait(jobLockUnique, wait)) {
+				idle=true;
+				break;
+				}
+			}
+		if (!list && executor->m_state==STATE_TERMINATED) {
+			jobLockUnique.unlock();
+			break;
+			}
+		if (list) {
+			job=std::move(list->front());
+			list->pop_front();
+			}
+		jobLockUnique.unlock();
+
+		if (!driver) {
+			if (job.run) {
+				LOG(LERROR) << "Database: no driver for database.Type, failing job";
+				if (job.fail) {
+					job.fail();
+					}
+				}
+			continue;
+			}
+		if (!job.run) {
+			if (idle) {
+				executor->checkConnection(connection);
+				}
+			continue;
+			}
+
+		if (!driver->isConnected()) {
+			executor->checkConnection(connection);
+			}
+		// while disconnected the job still runs, its queries fail fast and it reports that as usual
+		bool connected{driver->isConnected()},
+			failed{false};
+		try {
+			job.run();
+			}
+		catch (std::exception& e) {
+			LOG(LERROR) << "Database: job failed: " << e.what();
+			failed=true;
+			}
+		catch (...) {
+			// anything else would end this thread, and with it the connection
+			LOG(LERROR) << "Database: job failed with an unknown exception";
+			failed=true;
+			}
+		if (connected && !driver->isConnected()) {
+			executor->m_breaker.failure();
+			}
+		else if (driver->isConnected()) {
+			executor->m_breaker.success();
+			}
+
+		jobLockUnique.lock();
+		++connection.stats.jobs;
+		if (failed || !driver->isConnected()) {
+			++connection.stats.failures;
+			}
+		connection.stats.connected=driver->isConnected();
+		connection.stats.lastUsed=boost::get_system_time();
+		jobLockUnique.unlock();
+		}
+
+	jobLockUnique.lock();
+	connection.driver=nullptr;
+	connection.stats.connected=false;
+	jobLockUnique.unlock();
+	Driver::setThreadInstance(nullptr);
+	delete driver;
+#ifdef __EXCEPTION_TRACER__
+	executorExceptionHandler.RemoveHandler();
+#endif
+}
+
+bool Executor::checkConnection(Connection& connection)
+{
+	// connection thread only, a lost connection is only retried when the breaker allows it
+	bool was{connection.driver->isConnected()},
+		now{was ? connection.driver->ping() : connection.driver->reconnect()};
+	if (was && !now) {
+		LOG(LWARNING) << "Database: connection lost";
+		m_breaker.failure();
+		}
+	else if (!was && now) {
+		LOG(LINFO) << "Database: connection reestablished";
+		}
+
+	boost::lock_guard<boost::mutex> jobLockGuard(m_jobLock);
+	connection.stats.connected=now;
+	if (!was && now) {
+		++connection.stats.reconnects;
+		}
+	return now;
+}
+
+std::vector<Executor::ConnectionStats> Executor::getStats()
+{
+	std::vector<ConnectionStats> stats;
+	boost::lock_guard<boost::mutex> jobLockGuard(m_jobLock);
+	for (const Connection& connection : m_connections) {
+		stats.push_back(connection.stats);
+		}
+	return stats;
+}
+
+bool Executor::addJob(const boost::function<void (void)>& job, const boost::function<void (void)>& fail/*=boost::function<void (void)>()*/)
+{
+	m_jobLock.lock();
+	if (m_state!=STATE_RUNNING) {
+		m_jobLock.unlock();
+		LOG(LERROR) << "[Executor::addJob] Database executor is terminated.";
+		return false;
+		}
+	m_jobList.push_back(Job{job, fail});
+	bool wakeAll{m_singleWriter};
+	m_jobLock.unlock();
+
+	// the writer thread doesn't take reads, make sure a reader wakes up
+	if (wakeAll) {
+		m_jobSignal.notify_all();
+		}
+	else {
+		m_jobSignal.notify_one();
+		}
+	return true;
+}
+
+bool Executor::addWriteJob(const boost::function<void (void)>& job, const boost::function<void (void)>& fail/*=boost::function<void (void)>()*/)
+{
+	m_jobLock.lock();
+	if (m_state!=STATE_RUNNING) {
+		m_jobLock.unlock();
+		LOG(LERROR) << "[Executor::addWriteJob] Database executor is terminated.";
+		return false;
+		}
+	if (!m_singleWriter) {
+		m_jobList.push_back(Job{job, fail});
+		m_jobLock.unlock();
+		m_jobSignal.notify_one();
+		return true;
+		}
+	m_writeList.push_back(Job{job, fail});
+	m_jobLock.unlock();
+	m_jobSignal.notify_all();
+	return true;
+}
+
+void Executor::dispatchResult(const boost::function<void (void)>& f)
+{
+	if (LotosPP::g_dispatcher.addTask(LotosPP::Common::createTask(f, LotosPP::Common::Task::CATEGORY_DATABASE))) {
+		return;
+		}
+	// the dispatcher shut down first, don't lose the result
+	Executor* executor=instance();
+	boost::lock_guard<boost::mutex> lateLockGuard(executor->m_lateLock);
+	executor->m_lateResults.push_back(f);
+}
+
+void Executor::logFailure(const char* what)
+{
+	LOG(LERROR) << "Database: job failed: " << what;
+}
+
+void Executor::shutdown()
+{
+	m_jobLock.lock();
+	m_state=STATE_TERMINATED;
+	m_jobLock.unlock();
+	m_jobSignal.notify_all();
+}
+
+void Executor::shutdownAndWait()
+{
+	shutdown();
+	m_threads.join_all();
+
+	// the dispatcher thread is gone, this is the only thread left that may run them
+	for (;;) {
+		std::list<boost::function<void (void)>> results;
+		{
+			boost::lock_guard<boost::mutex> lateLockGuard(m_lateLock);
+			results.swap(m_lateResults);
+		}
+		if (results.empty()) {
+			break;
+			}
+		LOG(LINFO) << "Database: running " << results.size() << " results after the dispatcher";
+		for (const boost::function<void (void)>& f : results) {
+			f();
+			}
+		}
+}
@@ -0,0 +1,243 @@
+#ifndef LOTOSPP_DATABASE_EXECUTOR_H
+#define LOTOSPP_DATABASE_EXECUTOR_H
+
+#include "CircuitBreaker.h"
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <list>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+
+namespace LotosPP::Database {
+	class Driver;
+
+/**
+ * Asynchronous query executor
+ *
+ * Owns a fixed pool of database connections, each of them bound to its own thread. Jobs run on one of those threads,
+ * Driver::instance() returns that thread's connection there, so the existing query code needs no locking.
+ * Results are handed back through a callback run on the dispatcher thread, or through a future. A job that throws or
+ * can't run hands back a default constructed result, callbacks reaching a dispatcher shut down already run from
+ * shutdownAndWait().
+ * Lost connections are reopened by their own threads, in the background, paced by a CircuitBreaker. While it is
+ * open jobs still run but their queries fail fast.
+ */
+class Executor
+{
+public:
+	static Executor* instance();
+
+	Executor()
+	{};
+	~Executor()
+	{};
+
+	/**
+	 * Connection health as seen by its thread
+	 */
+	struct ConnectionStats {
+		bool connected{false};
+		bool writer{false};
+		uint64_t jobs{0};
+		uint64_t failures{0};
+		uint64_t reconnects{0};
+		boost::system_time lastUsed{};
+	};
+
+	/**
+	 * Opens the connections and waits until all of them tried to connect
+	 *
+	 * @param connections pool size, taken from database.Connections when 0
+	 * @return number of connected connections
+	 */
+	uint32_t start(uint32_t connections=0);
+	void shutdown();
+	void shutdownAndWait();
+
+	bool isRunning() const
+	{
+		return m_state==STATE_RUNNING;
+	};
+	/**
+	 * @return false while the database is down, callers may degrade instead of queueing work bound to fail
+	 */
+	bool isAvailable() const
+	{
+		return isRunning() && m_breaker.isClosed();
+	};
+	CircuitBreaker::Stats getBreakerStats()
+	{
+		return m_breaker.getStats();
+	};
+	size_t getConnectionCount() const
+	{
+		return m_connections.size();
+	};
+	std::vector<ConnectionStats> getStats();
+
+	/**
+	 * Runs job on one of the database threads
+	 *
+	 * @param fail run instead of job when it can't run, the thread has no connection
+	 * @return false when the executor is terminated and the job was dropped, fail isn't run then
+	 */
+	bool addJob(const boost::function<void (void)>& job, const boost::function<void (void)>& fail=boost::function<void (void)>());
+	/**
+	 * Runs a job that writes
+	 *
+	 * With drivers allowing a single writer only (SQLite) all of these run on one dedicated connection, in order,
+	 * so writers never wait on each other's locks. Otherwise the same as addJob().
+	 */
+	bool addWriteJob(const boost::function<void (void)>& job, const boost::function<void (void)>& fail=boost::function<void (void)>());
+
+	/**
+	 * addJob() facade over addWriteJob(), for code taking any pool, e.g. Common::offload()
+	 */
+	class Writer
+	{
+	public:
+		Writer(Executor* executor)
+			: m_executor{executor}
+		{};
+		bool addJob(const boost::function<void (void)>& job)
+		{
+			return m_executor->addWriteJob(job);
+		};
+	private:
+		Executor* m_executor;
+	};
+	Writer& writer()
+	{
+		return m_writer;
+	};
+
+	/**
+	 * Runs job on one of the database threads, then callback with its result on the dispatcher thread
+	 */
+	template<typename R>
+	void submit(const boost::function<R (void)>& job, const boost::function<void (R)>& callback)
+	{
+		if (!addJob(boost::bind(&Executor::runSubmitted<R>, job, callback), boost::bind(&Executor::failSubmitted<R>, callback))) {
+			failSubmitted<R>(callback);
+			}
+	};
+
+	/**
+	 * Runs job on one of the database threads, the result is delivered through the future
+	 *
+	 * @note never wait for the future on the dispatcher thread, that is what this class is meant to avoid
+	 */
+	template<typename R>
+	std::future<R> submit(const boost::function<R (void)>& job)
+	{
+		boost::shared_ptr<std::promise<R>> promise=boost::make_shared<std::promise<R>>();
+		std::future<R> future{promise->get_future()};
+		if (!addJob(boost::bind(&Executor::runPromised<R>, job, promise), boost::bind(&Executor::failPromised<R>, promise))) {
+			failPromised<R>(promise);
+			}
+		return future;
+	};
+
+	enum ExecutorState {
+		STATE_RUNNING,
+		STATE_TERMINATED
+		};
+
+protected:
+	struct Job {
+		boost::function<void (void)> run;
+		boost::function<void (void)> fail;
+	};
+
+	struct Connection {
+		Driver* driver{nullptr};
+		bool writer{false};
+		ConnectionStats stats{};
+	};
+
+	static void connectionThread(void* p, size_t index);
+	bool checkConnection(Connection& connection);
+
+	template<typename R>
+	static void runSubmitted(const boost::function<R (void)>& job, const boost::function<void (R)>& callback)
+	{
+		try {
+			if constexpr (std::is_void_v<R>) {
+				job();
+				dispatchResult(callback);
+				}
+			else {
+				dispatchResult(boost::bind(callback, job()));
+				}
+			}
+		catch (const std::exception& e) {
+			logFailure(e.what());
+			failSubmitted<R>(callback);
+			}
+		catch (...) {
+			logFailure("unknown exception");
+			failSubmitted<R>(callback);
+			}
+	};
+	template<typename R>
+	static void failSubmitted(const boost::function<void (R)>& callback)
+	{
+		if constexpr (std::is_void_v<R>) {
+			dispatchResult(callback);
+			}
+		else {
+			dispatchResult(boost::bind(callback, R{}));
+			}
+	};
+	template<typename R>
+	static void runPromised(const boost::function<R (void)>& job, boost::shared_ptr<std::promise<R>> promise)
+	{
+		try {
+			if constexpr (std::is_void_v<R>) {
+				job();
+				promise->set_value();
+				}
+			else {
+				promise->set_value(job());
+				}
+			}
+		catch (...) {
+			promise->set_exception(std::current_exception());
+			}
+	};
+	template<typename R>
+	static void failPromised(boost::shared_ptr<std::promise<R>> promise)
+	{
+		promise->set_exception(std::make_exception_ptr(std::runtime_error("database job could not run")));
+	};
+	static void dispatchResult(const boost::function<void (void)>& f);
+	static void logFailure(const char* what);
+
+	boost::thread_group m_threads;
+	boost::mutex m_jobLock;
+	boost::condition_variable m_jobSignal;
+	boost::condition_variable m_startSignal;
+
+	std::list<Job> m_jobList{};
+	std::list<Job> m_writeList{};
+	// results the dispatcher no longer took, shutdownAndWait() runs them
+	boost::mutex m_lateLock;
+	std::list<boost::function<void (void)>> m_lateResults{};
+	std::vector<Connection> m_connections{};
+	CircuitBreaker m_breaker{};
+	bool m_singleWriter{false};
+	Writer m_writer{this};
+	uint32_t m_started{0};
+	ExecutorState m_state{STATE_TERMINATED};
+};
+
+	}
+
+#endif
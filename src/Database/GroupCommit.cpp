@@ -0,0 +1,257 @@
+#include "GroupCommit.h"
+#include "Driver.h"
+#include "Executor.h"
+#include "Insert.h"
+#include "Transaction.h"
+#include "Common/Singleton.h"
+#include "Log/Logger.h"
+#include "globals.h"
+#include <boost/algorithm/string/join.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <algorithm>
+#include <chrono>
+
+
+using namespace LotosPP::Database;
+
+
+GroupCommit* GroupCommit::instance()
+{
+	static LotosPP::Common::Singleton<GroupCommit> instance;
+	return instance.get();
+}
+
+void GroupCommit::start()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	if (m_running) {
+		return;
+		}
+	m_window=boost::posix_time::milliseconds(LotosPP::options.get<long>("database.GroupCommitWindow", 5));
+	m_maxRows=std::max(1u, LotosPP::options.get<uint32_t>("database.GroupCommitRows", 256));
+	m_stats=Stats();
+	m_running=true;
+	m_thread=boost::thread(boost::bind(&GroupCommit::collectorThread, (void*)this));
+}
+
+void GroupCommit::shutdownAndWait()
+{
+	m_lock.lock();
+	if (!m_running) {
+		m_lock.unlock();
+		return;
+		}
+	m_running=false;
+	m_lock.unlock();
+	m_signal.notify_all();
+	m_thread.join();
+
+	Stats stats=getStats();
+	if (stats.batches) {
+		LOG(LINFO) << "GroupCommit: " << stats.rows << " rows in " << stats.batches << " batches, "
+			<< stats.commitMicros/stats.batches << " us per commit on average, " << stats.failures << " failed";
+		}
+}
+
+void GroupCommit::insert(const std::string& table, const std::vector<std::string>& columns, Row row, const Callback& callback/*=Callback()*/)
+{
+	add(table, columns, std::string(), std::move(row), callback);
+}
+
+void GroupCommit::upsert(const std::string& table, const std::vector<std::string>& columns, const std::string& key, Row row, const Callback& callback/*=Callback()*/)
+{
+	add(table, columns, key, std::move(row), callback);
+}
+
+void GroupCommit::add(const std::string& table, const std::vector<std::string>& columns, const std::string& key, Row&& row, const Callback& callback)
+{
+	if (row.size()!=columns.size()) {
+		LOG(LERROR) << "GroupCommit: " << row.size() << " values for " << columns.size() << " columns of " << table;
+		if (callback) {
+			callback(false);
+			}
+		return;
+		}
+
+	m_lock.lock();
+	if (!m_running) {
+		m_lock.unlock();
+		LOG(LERROR) << "[GroupCommit::add] Group commit is not running.";
+		if (callback) {
+			callback(false);
+			}
+		return;
+		}
+	if (!m_batch) {
+		m_batch=boost::make_shared<Batch>();
+		}
+	std::string name{table+'\n'+boost::algorithm::join(columns, ",")+'\n'+key};
+	auto [it, inserted]=m_batch->try_emplace(name, Group{table, columns, key});
+	it->second.rows.push_back(Pending{std::move(row), callback});
+	if (!m_rows++) {
+		m_firstQueued=boost::get_system_time();
+		}
+	bool wake{m_rows==1 || m_rows>=m_maxRows};
+	m_lock.unlock();
+
+	if (wake) {
+		m_signal.notify_all();
+		}
+}
+
+void GroupCommit::flushAndWait()
+{
+	boost::unique_lock<boost::mutex> lockUnique(m_lock);
+	while (m_running && (m_rows || m_inFlight)) {
+		m_signal.wait(lockUnique);
+		}
+}
+
+GroupCommit::Stats GroupCommit::getStats()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	Stats stats{m_stats};
+	stats.queued=m_rows;
+	return stats;
+}
+
+void GroupCommit::collectorThread(void* p)
+{
+	GroupCommit* groupCommit=(GroupCommit*)p;
+	boost::unique_lock<boost::mutex> lockUnique(groupCommit->m_lock);
+	for (;;) {
+		while (!groupCommit->m_rows && groupCommit->m_running) {
+			groupCommit->m_signal.wait(lockUnique);
+			}
+		if (!groupCommit->m_rows) {
+			break;
+			}
+		// give the others the rest of the window to join in, unless the batch is full or we are stopping
+		boost::system_time deadline=groupCommit->m_firstQueued+groupCommit->m_window;
+		while (groupCommit->m_running && groupCommit->m_rows<groupCommit->m_maxRows
+			&& groupCommit->m_signal.timed_wait(lockUnique, deadline)
+			) {
+			}
+		// one batch commits at a time, keeps the order and meanwhile the next one grows
+		while (groupCommit->m_inFlight) {
+			groupCommit->m_signal.wait(lockUnique);
+			}
+
+		Batch_ptr batch;
+		batch.swap(groupCommit->m_batch);
+		uint32_t rows=groupCommit->m_rows;
+		groupCommit->m_rows=0;
+		groupCommit->m_inFlight=true;
+		lockUnique.unlock();
+
+		// a batch the executor refuses or drops still has to finish, or the next one would wait for it forever
+		if (!Executor::instance()->addWriteJob(boost::bind(&GroupCommit::commitBatch, groupCommit, batch, rows),
+			boost::bind(&GroupCommit::dropBatch, groupCommit, batch, rows))
+			) {
+			groupCommit->dropBatch(batch, rows);
+			}
+		lockUnique.lock();
+		}
+	// the last batch
+	while (groupCommit->m_inFlight) {
+		groupCommit->m_signal.wait(lockUnique);
+		}
+}
+
+void GroupCommit::commitBatch(Batch_ptr batch, uint32_t rows)
+{
+	auto started=std::chrono::steady_clock::now();
+	bool committed{write(Driver::instance(), *batch)};
+	uint64_t micros=std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-started).count();
+	if (!committed) {
+		LOG(LERROR) << "GroupCommit: batch of " << rows << " rows rolled back";
+		}
+	finishBatch(*batch, rows, committed, micros);
+}
+
+void GroupCommit::dropBatch(Batch_ptr batch, uint32_t rows)
+{
+	LOG(LERROR) << "GroupCommit: database executor did not take the batch, dropping " << rows << " rows";
+	finishBatch(*batch, rows, false, 0);
+}
+
+void GroupCommit::finishBatch(const Batch& batch, uint32_t rows, bool committed, uint64_t micros)
+{
+	for (const auto& [name, group] : batch) {
+		for (const Pending& pending : group.rows) {
+			if (pending.callback) {
+				pending.callback(committed);
+				}
+			}
+		}
+
+	m_lock.lock();
+	++m_stats.batches;
+	m_stats.rows+=rows;
+	m_stats.maxRows=std::max(m_stats.maxRows, rows);
+	m_stats.commitMicros+=micros;
+	m_stats.maxCommitMicros=std::max(m_stats.maxCommitMicros, micros);
+	if (!committed) {
+		++m_stats.failures;
+		}
+	m_inFlight=false;
+	m_lock.unlock();
+	m_signal.notify_all();
+}
+
+bool GroupCommit::write(Driver* db, const Batch& batch)
+{
+	Transaction transaction(db);
+	if (!transaction.begin()) {
+		return false;
+		}
+
+	for (const auto& [name, group] : batch) {
+		std::string suffix;
+		std::vector<std::string> update;
+		if (!group.key.empty()) {
+			std::copy_if(group.columns.begin(), group.columns.end(), std::back_inserter(update), [&group](const std::string& column) {
+					return column!=group.key;
+				});
+			suffix=db->getUpsertClause(group.key, update);
+			}
+
+		if (!group.key.empty() && suffix.empty()) {
+			// no upsert in this database, the rows are expected to exist
+			for (const Pending& pending : group.rows) {
+				std::string set, where;
+				for (size_t i=0; i<group.columns.size(); ++i) {
+					std::string column{group.columns[i]+"="+Statement::toSQL(db, pending.row[i])};
+					if (group.columns[i]==group.key) {
+						where=column;
+						}
+					else {
+						set+=(set.empty() ? "" : ", ")+column;
+						}
+					}
+				if (!db->executeQuery("UPDATE "+group.table+" SET "+set+" WHERE "+where)) {
+					return false;
+					}
+				}
+			continue;
+			}
+
+		Insert insert(db);
+		insert.setQuery("INSERT INTO "+group.table+" ("+boost::algorithm::join(group.columns, ", ")+") VALUES ", suffix);
+		for (const Pending& pending : group.rows) {
+			std::string row;
+			for (const Statement::Param& value : pending.row) {
+				row+=(row.empty() ? "" : ", ")+Statement::toSQL(db, value);
+				}
+			if (!insert.addRow(row)) {
+				return false;
+				}
+			}
+		// a row not in any statement the database took is not committed, whatever the transaction says
+		if (!insert.execute() || insert.getRowsWritten()!=group.rows.size()) {
+			return false;
+			}
+		}
+	return transaction.commit();
+}
@@ -0,0 +1,123 @@
+#ifndef LOTOSPP_DATABASE_GROUPCOMMIT_H
+#define LOTOSPP_DATABASE_GROUPCOMMIT_H
+
+#include "Statement.h"
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+namespace LotosPP::Database {
+	class Driver;
+
+/**
+ * Group commit of row writes
+ *
+ * Rows queued by any thread within database.GroupCommitWindow ms, or until database.GroupCommitRows of them, are
+ * written by the Executor's writer in one transaction, as one multi-row INSERT per table and column list.
+ * Batches commit one after another in the order they were queued. While one commits the next keeps collecting, so
+ * batches grow with the load instead of the number of commits.
+ */
+class GroupCommit
+{
+public:
+	static GroupCommit* instance();
+
+	GroupCommit()
+	{};
+	~GroupCommit()
+	{};
+
+	typedef std::vector<Statement::Param> Row;
+	/**
+	 * Completion of a queued row, true once its batch committed, false when it was rolled back
+	 *
+	 * Runs on the database thread, post to the dispatcher for anything more than bookkeeping.
+	 */
+	typedef boost::function<void (bool)> Callback;
+
+	/**
+	 * Batch size and commit latency since start()
+	 */
+	struct Stats {
+		uint64_t batches{0};
+		uint64_t rows{0};
+		uint64_t failures{0};
+		uint32_t maxRows{0};
+		uint64_t commitMicros{0};
+		uint64_t maxCommitMicros{0};
+		uint32_t queued{0};
+	};
+
+	void start();
+	/**
+	 * Commits what is queued and stops, before the Executor stops
+	 */
+	void shutdownAndWait();
+
+	/**
+	 * Queues an INSERT of a row
+	 *
+	 * @param table table name
+	 * @param columns columns the values of row are for
+	 * @param row values
+	 * @param callback completion, optional
+	 */
+	void insert(const std::string& table, const std::vector<std::string>& columns, Row row, const Callback& callback=Callback());
+	/**
+	 * Queues a row to insert, or to update when key collides
+	 *
+	 * @param key unique column, it has to be one of columns
+	 * @see insert()
+	 */
+	void upsert(const std::string& table, const std::vector<std::string>& columns, const std::string& key, Row row, const Callback& callback=Callback());
+
+	/**
+	 * Waits until everything queued so far is committed
+	 */
+	void flushAndWait();
+
+	Stats getStats();
+
+protected:
+	struct Pending {
+		Row row;
+		Callback callback;
+	};
+	struct Group {
+		std::string table;
+		std::vector<std::string> columns;
+		std::string key;
+		std::vector<Pending> rows{};
+	};
+	// by table, columns and key, so each becomes one statement
+	typedef std::map<std::string, Group> Batch;
+	typedef boost::shared_ptr<Batch> Batch_ptr;
+
+	void add(const std::string& table, const std::vector<std::string>& columns, const std::string& key, Row&& row, const Callback& callback);
+	static void collectorThread(void* p);
+	void commitBatch(Batch_ptr batch, uint32_t rows);
+	void dropBatch(Batch_ptr batch, uint32_t rows);
+	void finishBatch(const Batch& batch, uint32_t rows, bool committed, uint64_t micros);
+	static bool write(Driver* db, const Batch& batch);
+
+	boost::thread m_thread;
+	boost::mutex m_lock;
+	boost::condition_variable m_signal;
+	Batch_ptr m_batch{};
+	uint32_t m_rows{0};
+	boost::system_time m_firstQueued{};
+	bool m_running{false};
+	bool m_inFlight{false};
+	boost::posix_time::milliseconds m_window{5};
+	uint32_t m_maxRows{256};
+	Stats m_stats{};
+};
+
+	}
+
+#endif
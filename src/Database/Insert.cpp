@@ -10,37 +10,43 @@ Insert::Insert(Driver* db)
 		m_multiLine{m_db->getParam(DBPARAM_MULTIINSERT)!=0} // checks if current database engine supports multi line INSERTs
 {}
 
-void Insert::setQuery(const std::string& query)
+void Insert::setQuery(const std::string& query, const std::string& suffix/*=""*/)
 {
 	m_query=query;
+	m_suffix=suffix;
 	m_buf.str("");
 	m_rows=0;
+	m_written=0;
 }
 
 bool Insert::addRow(const std::string& row)
 {
 	if (m_multiLine) {
-		m_rows++;
 		size_t size=m_buf.tellp();
-		// adds new row to buffer
-		if (!size) {
-			m_buf << "(" << row << ")";
-			}
-		else if (size>8192) {
+		if (size>8192) {
+			// executes the full buffer, the row starts the next one
 			if (!execute()) {
 				return false;
 				}
-
+			size=0;
+			}
+		// adds new row to buffer
+		if (!size) {
 			m_buf << "(" << row << ")";
 			}
 		else {
 			m_buf << ",(" + row + ")";
 			}
+		m_rows++;
 
 		return true;
 		}
 	// executes INSERT for current row
-	return m_db->executeQuery(m_query+"("+row+")");
+	if (!m_db->executeQuery(m_query+"("+row+")"+m_suffix)) {
+		return false;
+		}
+	m_written++;
+	return true;
 }
 
 bool Insert::addRowAndReset(std::ostringstream& row)
@@ -58,7 +64,10 @@ bool Insert::execute()
 			return true;
 			}
 		// executes buffer
-		bool res=m_db->executeQuery(m_query+m_buf.str());
+		bool res=m_db->executeQuery(m_query+m_buf.str()+m_suffix);
+		if (res) {
+			m_written+=m_rows;
+			}
 
 		// Reset counters
 		m_rows=0;
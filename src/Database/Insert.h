@@ -30,8 +30,9 @@ public:
 	 * Sets query prototype
 	 *
 	 * @param query INSERT query
+	 * @param suffix appended after the rows, e.g. Driver::getUpsertClause()
 	 */
-	void setQuery(const std::string& query);
+	void setQuery(const std::string& query, const std::string& suffix="");
 
 	/**
 	 * Adds new row to INSERT statement
@@ -52,6 +53,14 @@ public:
 	 */
 	bool execute();
 
+	/**
+	 * @return rows the database took since setQuery(), all of those added once execute() succeeded
+	 */
+	uint64_t getRowsWritten() const
+	{
+		return m_written;
+	};
+
 	/**
 	 * Returns ID of the inserted column if it had a AUTO_INCREMENT key
 	 */
@@ -61,7 +70,9 @@ protected:
 	Driver* m_db{nullptr};
 	bool m_multiLine{false};
 	uint32_t m_rows{0};
+	uint64_t m_written{0};
 	std::string m_query{};
+	std::string m_suffix{};
 	std::ostringstream m_buf;
 };
 
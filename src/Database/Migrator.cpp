@@ -0,0 +1,190 @@
+#include "Migrator.h"
+#include "Driver.h"
+#include "Result.h"
+#include "Transaction.h"
+#include "globals.h"
+#include "Log/Logger.h"
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+
+
+using namespace LotosPP::Database;
+namespace fs=std::filesystem;
+
+
+Migrator::Migrator(Driver* db, const std::filesystem::path& dir)
+	: m_db{db}, m_dir{dir}
+{}
+
+fs::path Migrator::getDefaultDir()
+{
+	using LotosPP::options;
+	fs::path dir{options.get("database.SchemaDir", "")};
+	if (dir.empty()) {
+		dir=fs::path(options.get("global.workingDir", "."))/"sql";
+		}
+	return dir/boost::algorithm::to_lower_copy(options.get("database.Type", ""));
+}
+
+bool Migrator::run()
+{
+	if (!readVersion()) {
+		LOG(LERROR) << "Migrator: can't read the schema version";
+		return false;
+		}
+
+	std::vector<Migration> migrations=scan();
+	if (migrations.empty() && m_version<0) {
+		LOG(LERROR) << "Migrator: no scripts in " << m_dir << " for an empty database";
+		return false;
+		}
+	for (const Migration& migration : migrations) {
+		if (migration.version>m_version && !apply(migration)) {
+			return false;
+			}
+		}
+	LOG(LINFO) << "Database: schema version " << m_version;
+	return true;
+}
+
+std::vector<Migrator::Migration> Migrator::scan()
+{
+	std::vector<Migration> migrations;
+	std::error_code ec;
+	for (fs::directory_iterator it(m_dir, ec), end; !ec && it!=end; it.increment(ec)) {
+		std::string name=it->path().filename().string();
+		if (!it->is_regular_file() || it->path().extension()!=".sql") {
+			continue;
+			}
+		// NNN-description.sql
+		int32_t version;
+		auto [next, error]=std::from_chars(name.data(), name.data()+name.length(), version);
+		if (error!=std::errc() || *next!='-') {
+			LOG(LWARNING) << "Migrator: skipping " << it->path() << ", not named NNN-description.sql";
+			continue;
+			}
+		migrations.push_back({version, it->path()});
+		}
+	if (ec) {
+		LOG(LERROR) << "Migrator: can't read " << m_dir << ": " << ec.message();
+		}
+
+	std::sort(migrations.begin(), migrations.end(), [](const Migration& a, const Migration& b) {
+			return a.version<b.version;
+		});
+	auto duplicate=std::adjacent_find(migrations.begin(), migrations.end(), [](const Migration& a, const Migration& b) {
+			return a.version==b.version;
+		});
+	if (duplicate!=migrations.end()) {
+		LOG(LERROR) << "Migrator: " << duplicate->file << " and " << (duplicate+1)->file << " have the same number, ignoring both and above";
+		migrations.erase(duplicate, migrations.end());
+		}
+	return migrations;
+}
+
+bool Migrator::readVersion()
+{
+	if (!m_db->tableExists("schema_version")) {
+		if (!m_db->executeQuery("CREATE TABLE schema_version (version INTEGER NOT NULL)")) {
+			return false;
+			}
+		// created by hand from 000-init.sql before migrations were tracked
+		m_version=m_db->tableExists("users")
+			? 0
+			: -1;
+		return m_db->executeQuery("INSERT INTO schema_version (version) VALUES ("+std::to_string(m_version)+")");
+		}
+
+	Result_ptr result=m_db->storeQuery("SELECT version FROM schema_version");
+	if (!result) {
+		return false;
+		}
+	m_version=result->get<int32_t>(0);
+	return true;
+}
+
+bool Migrator::apply(const Migration& migration)
+{
+	std::ifstream file(migration.file, std::ios::in|std::ios::binary);
+	if (!file) {
+		LOG(LERROR) << "Migrator: can't open " << migration.file;
+		return false;
+		}
+	std::ostringstream script;
+	script << file.rdbuf();
+
+	// MySQL commits DDL implicitly, a failing script may stay half applied there
+	Transaction transaction(m_db);
+	if (!transaction.begin()) {
+		return false;
+		}
+	for (const std::string& statement : split(script.str())) {
+		if (!m_db->executeQuery(statement)) {
+			LOG(LERROR) << "Migrator: " << migration.file << " failed, schema stays at version " << m_version;
+			return false;
+			}
+		}
+	if (!m_db->executeQuery("UPDATE schema_version SET version="+std::to_string(migration.version))
+		|| !transaction.commit()
+		) {
+		return false;
+		}
+	m_version=migration.version;
+	LOG(LINFO) << "Database: applied " << migration.file.filename();
+	return true;
+}
+
+std::vector<std::string> Migrator::split(const std::string& script)
+{
+	std::vector<std::string> statements;
+	std::string statement;
+	char quote{0};
+
+	auto add=[&statements, &statement]() {
+			boost::algorithm::trim(statement);
+			if (!statement.empty()) {
+				statements.push_back(statement);
+				}
+			statement.clear();
+		};
+	for (size_t i=0; i<script.length(); ++i) {
+		char c=script[i];
+		if (quote) {
+			// a doubled quote closes and opens again
+			if (c==quote) {
+				quote=0;
+				}
+			statement+=c;
+			continue;
+			}
+		if (script.compare(i, 2, "--")==0) {
+			if ((i=script.find('\n', i))==std::string::npos) {
+				break;
+				}
+			statement+='\n';
+			continue;
+			}
+		if (script.compare(i, 2, "/*")==0) {
+			if ((i=script.find("*/", i+2))==std::string::npos) {
+				break;
+				}
+			++i;
+			statement+=' ';
+			continue;
+			}
+		if (c==';') {
+			add();
+			continue;
+			}
+		if (c=='\'' || c=='"' || c=='`') {
+			quote=c;
+			}
+		statement+=c;
+		}
+	add();
+	return statements;
+}
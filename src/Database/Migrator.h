@@ -0,0 +1,73 @@
+#ifndef LOTOSPP_DATABASE_MIGRATOR_H
+#define	LOTOSPP_DATABASE_MIGRATOR_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+namespace LotosPP::Database {
+	class Driver;
+
+/**
+ * Schema migrations
+ *
+ * Applies the numbered scripts NNN-description.sql of database.SchemaDir/<database.Type> in order, each of them once.
+ * The last applied number is kept in the schema_version table. A database created before that table existed has its
+ * users table already and counts as being at version 0.
+ */
+class Migrator
+{
+public:
+	/**
+	 * @param db connection to migrate, the writer one
+	 * @param dir directory with the scripts of the driver in use
+	 */
+	Migrator(Driver* db, const std::filesystem::path& dir);
+
+	/**
+	 * Migrates to the newest version found
+	 *
+	 * @return true when the schema is up to date
+	 */
+	bool run();
+
+	/**
+	 * Default script directory, from the configuration
+	 */
+	static std::filesystem::path getDefaultDir();
+
+	/**
+	 * @return applied version, -1 for an empty database
+	 */
+	int32_t getVersion() const
+	{
+		return m_version;
+	};
+
+	/**
+	 * Splits a script into statements
+	 *
+	 * Statements end with ';', quoted strings and comments are skipped.
+	 */
+	static std::vector<std::string> split(const std::string& script);
+
+protected:
+	struct Migration {
+		int32_t version;
+		std::filesystem::path file;
+	};
+
+	std::vector<Migration> scan();
+	bool readVersion();
+	bool apply(const Migration& migration);
+
+	Driver* m_db;
+	std::filesystem::path m_dir;
+	int32_t m_version{-1};
+};
+
+	}
+
+#endif
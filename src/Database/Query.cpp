@@ -1,14 +1,20 @@
 #include "Query.h"
+#include "Driver.h"
 
 using namespace LotosPP::Database;
 
 
 Query::Query()
 {
-	database_lock.lock();
+	if (!Driver::hasThreadInstance()) {
+		database_lock.lock();
+		m_locked=true;
+		}
 }
 
 Query::~Query()
 {
-	database_lock.unlock();
+	if (m_locked) {
+		database_lock.unlock();
+		}
 }
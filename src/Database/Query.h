@@ -10,7 +10,8 @@ namespace LotosPP::Database {
 /**
  * Thread locking hack
  *
- * By using this class for your queries you lock and unlock database for threads
+ * By using this class for your queries you lock and unlock database for threads.
+ * Executor threads own their connection, queries made there skip the lock.
  */
 class Query
 	: public std::ostringstream
@@ -26,6 +27,7 @@ public:
 
 protected:
 	static inline boost::recursive_mutex database_lock;
+	bool m_locked{false};
 };
 
 	}
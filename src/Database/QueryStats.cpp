@@ -0,0 +1,175 @@
+#include "QueryStats.h"
+#include "Common/Metrics.h"
+#include "Common/Singleton.h"
+#include "Log/Logger.h"
+#include "globals.h"
+#include <algorithm>
+#include <cctype>
+
+
+using namespace LotosPP::Database;
+
+
+namespace {
+
+LotosPP::Common::Metrics::Histogram* queryDuration{LotosPP::Common::Metrics::instance()->histogram("lotospp_database_query_duration_seconds", "Latency of database queries")};
+LotosPP::Common::Metrics::Counter* queryErrors{LotosPP::Common::Metrics::instance()->counter("lotospp_database_query_errors_total", "Database queries that failed")};
+
+	}
+
+QueryStats* QueryStats::instance()
+{
+	static LotosPP::Common::Singleton<QueryStats> instance;
+	return instance.get();
+}
+
+QueryStats::QueryStats()
+	: m_enabled{LotosPP::options.get<bool>("database.QueryStats", true)},
+		m_slowMicros{LotosPP::options.get<uint64_t>("database.SlowQueryMs", 100)*1000}
+{}
+
+void QueryStats::record(std::string_view sql, uint64_t micros, int64_t rows, bool ok, const std::string& binds/*=std::string()*/)
+{
+	queryDuration->record(micros);
+	if (!ok) {
+		queryErrors->add();
+		}
+	if (!m_enabled) {
+		return;
+		}
+	// outside of the lock, it is the expensive part
+	std::string print{fingerprint(sql)};
+	bool slow{m_slowMicros && micros>=m_slowMicros};
+
+	boost::unique_lock<boost::mutex> lockUnique(m_lock);
+	// a runaway of distinct statements doesn't eat the memory, 5 KiB each
+	auto it=m_entries.find(print);
+	if (it==m_entries.end()) {
+		it=m_entries.size()<1024
+			? m_entries.try_emplace(print).first
+			: m_entries.try_emplace("(other)").first;
+		}
+	it->second.latency.record(micros);
+	if (!ok) {
+		++it->second.errors;
+		}
+	if (slow) {
+		m_slow.push_front(SlowQuery{time(nullptr), print, binds, micros, rows});
+		if (m_slow.size()>32) {
+			m_slow.pop_back();
+			}
+		}
+	lockUnique.unlock();
+
+	if (slow) {
+		LOG(LWARNING) << "Slow query: " << micros/1000 << " ms, " << (rows<0 ? std::string("?") : std::to_string(rows)) << " rows"
+			<< (binds.empty() ? std::string() : ", binds ("+binds+")") << ": " << print;
+		}
+}
+
+std::string QueryStats::fingerprint(std::string_view sql)
+{
+	std::string print;
+	print.reserve(std::min<size_t>(sql.length(), 1024));
+
+	auto isWord=[](char c) {
+			return isalnum((unsigned char)c) || c=='_' || c=='$' || c=='`';
+		};
+	for (size_t i=0; i<sql.length() && print.length()<1024; ++i) {
+		char c=sql[i];
+		if (isspace((unsigned char)c)) {
+			if (!print.empty() && print.back()!=' ') {
+				print+=' ';
+				}
+			continue;
+			}
+		if (c=='\'' || c=='"') {
+			// string literal, quotes are doubled or escaped with a backslash inside
+			for (++i; i<sql.length(); ++i) {
+				if (sql[i]=='\\') {
+					++i;
+					}
+				else if (sql[i]==c) {
+					if (i+1<sql.length() && sql[i+1]==c) {
+						++i;
+						continue;
+						}
+					break;
+					}
+				}
+			print+='?';
+			continue;
+			}
+		if (isdigit((unsigned char)c) && (print.empty() || !isWord(print.back()))) {
+			while (i+1<sql.length() && (isalnum((unsigned char)sql[i+1]) || sql[i+1]=='.')) {
+				++i;
+				}
+			print+='?';
+			continue;
+			}
+		print+=c;
+		}
+	while (!print.empty() && (print.back()==' ' || print.back()==';')) {
+		print.pop_back();
+		}
+
+	// IN (?, ?, ?) and VALUES (?, ?), (?, ?) don't depend on how many
+	std::string collapsed;
+	collapsed.reserve(print.length());
+	for (size_t i=0; i<print.length(); ++i) {
+		if (print[i]=='?') {
+			size_t end=i+1;
+			for (size_t next; (next=print.find_first_not_of(' ', end))!=std::string::npos && print[next]==','
+				&& (next=print.find_first_not_of(' ', next+1))!=std::string::npos && print[next]=='?'; end=next+1) {
+				}
+			collapsed+=end>i+1 ? "?+" : "?";
+			i=end-1;
+			continue;
+			}
+		collapsed+=print[i];
+		if (print[i]!=')') {
+			continue;
+			}
+		// a row of placeholders, skip the rows following it
+		if (size_t open=collapsed.rfind('('); open==std::string::npos || collapsed.compare(open, 2, "(?")!=0) {
+			continue;
+			}
+		for (;;) {
+			size_t next=print.find_first_not_of(' ', i+1);
+			if (next==std::string::npos || print[next]!=',') {
+				break;
+				}
+			next=print.find_first_not_of(' ', next+1);
+			size_t close;
+			if (next==std::string::npos || print.compare(next, 2, "(?")!=0 || (close=print.find(')', next))==std::string::npos) {
+				break;
+				}
+			i=close;
+			}
+		}
+	return collapsed;
+}
+
+std::vector<QueryStats::Summary> QueryStats::getTop(size_t limit)
+{
+	std::vector<Summary> top;
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	top.reserve(m_entries.size());
+	for (const auto& [print, entry] : m_entries) {
+		const Common::Histogram& h=entry.latency;
+		top.push_back(Summary{print, h.getCount(), entry.errors, h.getSum(), h.getPercentile(50), h.getPercentile(95), h.getPercentile(99), h.getMax()});
+		}
+	std::sort(top.begin(), top.end(), [](const Summary& a, const Summary& b) {
+			return a.totalMicros>b.totalMicros;
+		});
+	if (top.size()>limit) {
+		top.resize(limit);
+		}
+	return top;
+}
+
+std::vector<QueryStats::SlowQuery> QueryStats::getSlow()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	return std::vector<SlowQuery>(m_slow.begin(), m_slow.end());
+}
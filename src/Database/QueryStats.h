@@ -0,0 +1,111 @@
+#ifndef LOTOSPP_DATABASE_QUERYSTATS_H
+#define LOTOSPP_DATABASE_QUERYSTATS_H
+
+#include "Common/Histogram.h"
+#include <boost/thread/mutex.hpp>
+#include <chrono>
+#include <ctime>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+
+namespace LotosPP::Database {
+
+/**
+ * Query latency by statement fingerprint, and the slow query log
+ *
+ * Driver and Statement report every query here. Queries are grouped by their fingerprint, the SQL with literals
+ * replaced by '?', each with a latency histogram. Queries taking database.SlowQueryMs or longer are logged with
+ * their fingerprint, bind types and row count; values never appear, they may be passwords. Thread safe.
+ */
+class QueryStats
+{
+public:
+	static QueryStats* instance();
+
+	QueryStats();
+
+	/**
+	 * Measures one query
+	 */
+	class Timer
+	{
+	public:
+		Timer()
+			: m_started{std::chrono::steady_clock::now()}
+		{};
+		uint64_t micros() const
+		{
+			return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-m_started).count();
+		};
+	private:
+		std::chrono::steady_clock::time_point m_started;
+	};
+
+	/**
+	 * @param sql query text
+	 * @param micros latency
+	 * @param rows rows returned, -1 when not known
+	 * @param ok false when the query failed
+	 * @param binds types of the bound parameters, empty for plain queries
+	 */
+	void record(std::string_view sql, uint64_t micros, int64_t rows, bool ok, const std::string& binds=std::string());
+
+	/**
+	 * SQL normalized to identify the statement, literals become '?' and multi-row VALUES lists one row
+	 */
+	static std::string fingerprint(std::string_view sql);
+
+	struct Summary {
+		std::string fingerprint;
+		uint64_t count;
+		uint64_t errors;
+		uint64_t totalMicros;
+		uint64_t p50;
+		uint64_t p95;
+		uint64_t p99;
+		uint64_t max;
+	};
+	/**
+	 * @param limit number of statements to return
+	 * @return statements taking the most time in total, that first
+	 */
+	std::vector<Summary> getTop(size_t limit);
+
+	struct SlowQuery {
+		time_t when;
+		std::string fingerprint;
+		std::string binds;
+		uint64_t micros;
+		int64_t rows;
+	};
+	/**
+	 * @return latest slow queries, the newest first
+	 */
+	std::vector<SlowQuery> getSlow();
+
+	bool isEnabled() const
+	{
+		return m_enabled;
+	};
+
+protected:
+	struct Entry {
+		Common::Histogram latency{};
+		uint64_t errors{0};
+	};
+
+	boost::mutex m_lock;
+	std::unordered_map<std::string, Entry> m_entries{};
+	std::deque<SlowQuery> m_slow{};
+	bool m_enabled;
+	uint64_t m_slowMicros;
+};
+
+	}
+
+#endif
@@ -2,7 +2,10 @@
 #define	LOTOSPP_DATABASE_RESULT_H
 
 #include <boost/enable_shared_from_this.hpp>
+#include <charconv>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <cstdint>
 
 
@@ -66,6 +69,79 @@ public:
 		return 0;
 	};
 
+	/**
+	 * Column ordinal
+	 *
+	 * Resolve names once before the row loop, then read rows with the ordinal accessors
+	 *
+	 * @param s The name of the field
+	 * @return ordinal of the column, -1 if there is no such column
+	 */
+	virtual int32_t getColumnIndex([[maybe_unused]]const std::string& s)
+	{
+		return -1;
+	};
+	/**
+	 * @return number of columns in the result
+	 */
+	virtual uint32_t getColumnCount()
+	{
+		return 0;
+	};
+	/**
+	 * Raw value of a column in the current row
+	 *
+	 * @param column ordinal of the column
+	 * @return view of the row data, valid until the next advance(); empty for NULL
+	 */
+	virtual std::string_view getView([[maybe_unused]]uint32_t column)
+	{
+		return std::string_view();
+	};
+	/**
+	 * @param column ordinal of the column
+	 * @return true if the column of the current row is NULL
+	 */
+	virtual bool isNull([[maybe_unused]]uint32_t column)
+	{
+		return true;
+	};
+	/**
+	 * Typed value of a column in the current row
+	 *
+	 * Integers are parsed straight from the row data, NULL and unparsable values give T()
+	 *
+	 * @param column ordinal of the column
+	 */
+	template<typename T>
+	T get(uint32_t column)
+	{
+		std::string_view v=getView(column);
+		if constexpr (std::is_same_v<T, std::string_view>) {
+			return v;
+			}
+		else if constexpr (std::is_same_v<T, std::string>) {
+			return std::string(v);
+			}
+		else if constexpr (std::is_same_v<T, bool>) {
+			return get<int64_t>(column)!=0;
+			}
+		else {
+			static_assert(std::is_integral_v<T>, "Result::get supports integers and strings");
+			T value{};
+			std::from_chars(v.data(), v.data()+v.size(), value);
+			return value;
+			}
+	};
+
+	/**
+	 * @return number of rows in the result, -1 when it isn't known before reading them all
+	 */
+	virtual int64_t getRowCount()
+	{
+		return -1;
+	};
+
 	/**
 	 * Moves to next result in set
 	 *
@@ -85,6 +161,13 @@ public:
 	{
 		return true;
 	};
+	/**
+	 * @return true if reading the rows failed, rather than there being no more
+	 */
+	virtual bool failed()
+	{
+		return false;
+	};
 
 protected:
 	Result()
@@ -0,0 +1,121 @@
+#include "Statement.h"
+#include "Driver.h"
+#include "QueryStats.h"
+#include "Result.h"
+#include "Common/Probe.h"
+#include "Log/Logger.h"
+
+
+using namespace LotosPP::Database;
+
+
+bool Statement::execute()
+{
+	LOTOSPP_PROBE(query__start, m_sql.c_str());
+	QueryStats::Timer timer;
+	bool ok=internalExecute();
+	uint64_t micros{timer.micros()};
+	LOTOSPP_PROBE(query__end, m_sql.c_str(), micros, ok);
+	QueryStats::instance()->record(m_sql, micros, -1, ok, getBindShape());
+	return ok;
+}
+
+Result_ptr Statement::query()
+{
+	LOTOSPP_PROBE(query__start, m_sql.c_str());
+	QueryStats::Timer timer;
+	m_failed=true;
+	Result_ptr result=internalQuery();
+	uint64_t micros{timer.micros()};
+	bool ok{!m_failed};
+	LOTOSPP_PROBE(query__end, m_sql.c_str(), micros, ok);
+	QueryStats::instance()->record(m_sql, micros, result ? result->getRowCount() : 0, ok, getBindShape());
+	return result;
+}
+
+Result_ptr Statement::verifyResult(Result_ptr result)
+{
+	if (!result->advance()) {
+		m_failed=result->failed();
+		return Result_ptr();
+		}
+	m_failed=false;
+	return result;
+}
+
+std::string Statement::getBindShape() const
+{
+	std::string shape;
+	for (const Param& param : m_params) {
+		if (!shape.empty()) {
+			shape+=", ";
+			}
+		if (std::holds_alternative<std::string>(param)) {
+			shape+="string";
+			}
+		else if (std::holds_alternative<std::monostate>(param)) {
+			shape+="null";
+			}
+		else {
+			shape+="int";
+			}
+		}
+	return shape;
+}
+
+std::string Statement::toSQL(Driver* db, const Param& param)
+{
+	if (const int64_t* i=std::get_if<int64_t>(&param)) {
+		return std::to_string(*i);
+		}
+	if (const uint64_t* u=std::get_if<uint64_t>(&param)) {
+		return std::to_string(*u);
+		}
+	if (const std::string* s=std::get_if<std::string>(&param)) {
+		return db->escapeString(*s);
+		}
+	return "NULL";
+}
+
+std::string TextStatement::build()
+{
+	std::string sql;
+	sql.reserve(m_sql.length()+32*m_params.size());
+	size_t param{0};
+	bool quoted{false};
+	for (char c : m_sql) {
+		if (c=='\'') {
+			quoted=!quoted;
+			}
+		if (c!='?' || quoted) {
+			sql+=c;
+			continue;
+			}
+		if (param>=m_params.size()) {
+			LOG(LERROR) << "Statement: missing parameter " << param << " for " << m_sql;
+			sql+="NULL";
+			continue;
+			}
+		sql+=toSQL(m_db, m_params[param++]);
+		}
+	return sql;
+}
+
+bool TextStatement::internalExecute()
+{
+	// not through executeQuery(), execute() records it already
+	return m_db->internalQuery(build());
+}
+
+Result_ptr TextStatement::internalQuery()
+{
+	m_db->m_queryFailed=true;
+	Result_ptr result=m_db->internalSelectQuery(build());
+	m_failed=m_db->m_queryFailed;
+	return result;
+}
+
+uint64_t TextStatement::getLastInsertedRowID()
+{
+	return m_db->getLastInsertedRowID();
+}
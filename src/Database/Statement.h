@@ -0,0 +1,161 @@
+#ifndef LOTOSPP_DATABASE_STATEMENT_H
+#define LOTOSPP_DATABASE_STATEMENT_H
+
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <variant>
+#include <vector>
+#include <cstdint>
+
+
+namespace LotosPP::Database {
+	class Driver;
+	class Result;
+	typedef boost::shared_ptr<Result> Result_ptr;
+
+/**
+ * Prepared statement
+ *
+ * Get one from Driver::prepare(), bind a value for every '?' placeholder in order, then execute() or query().
+ * Statements belong to the connection that prepared them, don't pass them between threads.
+ */
+class Statement
+{
+public:
+	typedef std::variant<std::monostate, int64_t, uint64_t, std::string> Param;
+
+	virtual ~Statement()
+	{};
+
+	Statement& bind(int32_t value)
+	{
+		m_params.emplace_back((int64_t)value);
+		return *this;
+	};
+	Statement& bind(uint32_t value)
+	{
+		m_params.emplace_back((uint64_t)value);
+		return *this;
+	};
+	Statement& bind(int64_t value)
+	{
+		m_params.emplace_back(value);
+		return *this;
+	};
+	Statement& bind(uint64_t value)
+	{
+		m_params.emplace_back(value);
+		return *this;
+	};
+	Statement& bind(const std::string& value)
+	{
+		m_params.emplace_back(value);
+		return *this;
+	};
+	Statement& bind(const char* value)
+	{
+		m_params.emplace_back(std::string(value));
+		return *this;
+	};
+	Statement& bindNull()
+	{
+		m_params.emplace_back(std::monostate());
+		return *this;
+	};
+
+	/**
+	 * Forget bound parameters, so the statement can be executed again
+	 */
+	void reset()
+	{
+		m_params.clear();
+	};
+
+	/**
+	 * Executes statement which doesn't generate results (INSERT, UPDATE, DELETE...)
+	 *
+	 * @return true on success, false on error
+	 */
+	bool execute();
+	/**
+	 * Executes statement which generates results (SELECT)
+	 *
+	 * @return results positioned on the first row, null on error or when empty
+	 */
+	Result_ptr query();
+	/**
+	 * @return true if the last query() failed, one without rows did not
+	 */
+	bool failed() const
+	{
+		return m_failed;
+	};
+
+	/**
+	 * @return id generated by the last execute(), 0 if none
+	 */
+	virtual uint64_t getLastInsertedRowID() =0;
+
+	const std::string& getSQL() const
+	{
+		return m_sql;
+	};
+
+	/**
+	 * Parameter as an SQL literal, strings escaped and quoted for db
+	 */
+	static std::string toSQL(Driver* db, const Param& param);
+	/**
+	 * Types of the bound parameters, for the slow query log
+	 */
+	std::string getBindShape() const;
+
+protected:
+	Statement(const std::string& sql)
+		: m_sql{sql}
+	{};
+
+	/**
+	 * Executes the statement with the driver, execute() and query() add the bookkeeping
+	 */
+	virtual bool internalExecute() =0;
+	virtual Result_ptr internalQuery() =0;
+	/**
+	 * Positions result on its first row, internalQuery() returns through it or clears m_failed itself
+	 */
+	Result_ptr verifyResult(Result_ptr result);
+
+	std::string m_sql;
+	std::vector<Param> m_params{};
+	// set by query() until internalQuery() knows better, no rows is not a failure
+	bool m_failed{false};
+};
+
+typedef boost::shared_ptr<Statement> Statement_ptr;
+
+/**
+ * Fallback for drivers without native prepared statements
+ *
+ * Substitutes escaped parameters into the SQL text and runs it as an ordinary query
+ */
+class TextStatement
+	: public Statement
+{
+public:
+	TextStatement(Driver* db, const std::string& sql)
+		: Statement(sql), m_db{db}
+	{};
+
+	virtual uint64_t getLastInsertedRowID();
+
+protected:
+	virtual bool internalExecute();
+	virtual Result_ptr internalQuery();
+	std::string build();
+
+	Driver* m_db;
+};
+
+	}
+
+#endif
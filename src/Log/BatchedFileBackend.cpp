@@ -0,0 +1,49 @@
+#include "BatchedFileBackend.h"
+#include <boost/log/attributes/value_extraction.hpp>
+
+
+using namespace LotosPP::Log;
+
+
+void BatchedFileBackend::configure(size_t batchSize, uint32_t flushInterval, severity_level flushLevel)
+{
+	m_batchSize=batchSize;
+	m_flushInterval=std::chrono::milliseconds(flushInterval);
+	m_flushLevel=flushLevel;
+	m_batch.reserve(m_batchSize+1024);
+}
+
+void BatchedFileBackend::consume(const boost::log::record_view& rec, const string_type& message)
+{
+	if (m_batch.empty()) {
+		m_first=std::chrono::steady_clock::now();
+		}
+	m_batch.append(message);
+	if (m_batch.empty() || m_batch.back()!='\n') {
+		m_batch.push_back('\n');
+		}
+	m_last=rec;
+
+	boost::log::value_ref<severity_level> severity=boost::log::extract<severity_level>("Severity", rec);
+	if ((severity && *severity>=m_flushLevel) || m_batch.size()>=m_batchSize
+		|| std::chrono::steady_clock::now()-m_first>=m_flushInterval) {
+		write();
+		}
+}
+
+void BatchedFileBackend::flush()
+{
+	if (!m_batch.empty()) {
+		write();
+		}
+}
+
+void BatchedFileBackend::write()
+{
+	// the batch ends with a newline, the base adds none then
+	boost::log::sinks::text_file_backend::consume(m_last, m_batch);
+	boost::log::sinks::text_file_backend::flush();
+	m_batch.clear();
+	m_last=boost::log::record_view();
+	++m_writes;
+}
@@ -0,0 +1,60 @@
+#ifndef LOTOSPP_LOG_BATCHEDFILEBACKEND_H
+#define LOTOSPP_LOG_BATCHEDFILEBACKEND_H
+
+#include "severity_t.h"
+#include <boost/log/sinks/text_file_backend.hpp>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+
+namespace LotosPP::Log {
+
+/**
+ * Rotating file backend writing in batches
+ *
+ * Formatted records collect in memory and reach the file as one write, once the batch reaches its size, its
+ * oldest record is flushInterval ms old, or a record of flushLevel or above arrives. Meant for the writer thread
+ * of an asynchronous sink, the frontend serializes the calls.
+ */
+class BatchedFileBackend
+	: public boost::log::sinks::text_file_backend
+{
+public:
+	template<typename ... ArgsT>
+	explicit BatchedFileBackend(const ArgsT& ... args)
+		: boost::log::sinks::text_file_backend(args ...)
+	{};
+
+	/**
+	 * @param batchSize bytes collected at most
+	 * @param flushInterval ms a record may wait at most
+	 * @param flushLevel records written at once, with all before them
+	 */
+	void configure(size_t batchSize, uint32_t flushInterval, severity_level flushLevel);
+
+	// hide those of text_file_backend, the frontend calls them on this type
+	void consume(const boost::log::record_view& rec, const string_type& message);
+	void flush();
+
+	uint64_t getWrites() const
+	{
+		return m_writes;
+	};
+
+protected:
+	void write();
+
+	string_type m_batch{};
+	// rotation goes by the records, the last one stands for the batch
+	boost::log::record_view m_last{};
+	std::chrono::steady_clock::time_point m_first{};
+	size_t m_batchSize{65536};
+	std::chrono::milliseconds m_flushInterval{1000};
+	severity_level m_flushLevel{LWARNING};
+	uint64_t m_writes{0};
+};
+
+	}
+
+#endif
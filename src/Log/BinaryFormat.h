@@ -0,0 +1,116 @@
+#ifndef LOTOSPP_LOG_BINARYFORMAT_H
+#define LOTOSPP_LOG_BINARYFORMAT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+
+/**
+ * Binary log file layout, shared by BinaryLog and lotospp-logdecode
+ *
+ * header:  MAGIC, varint version, varint pid, varint start time (unix seconds)
+ * chunk:   u8 type, varint payload length, payload
+ * FORMAT:  varint id, u8 severity, varint line, string file, string format
+ * THREAD:  varint index, varint native thread id
+ * RECORDS: varint thread index, varint base time (ns since the epoch), then records up to the end of the payload
+ * record:  varint format id, varint ns after the base time, varint argument count, arguments
+ * argument: u8 tag, value; integers are varints (signed ones zigzag), doubles 8 bytes of the host, strings
+ *          a varint length and the bytes
+ */
+namespace LotosPP::Log::Binary {
+
+static const char MAGIC[8]={'L', 'P', 'P', 'B', 'L', 'O', 'G', '1'};
+static const uint32_t VERSION=1;
+
+enum ChunkType : uint8_t {
+	CHUNK_FORMAT=1,
+	CHUNK_THREAD=2,
+	CHUNK_RECORDS=3
+	};
+
+enum ArgTag : uint8_t {
+	ARG_BOOL='b',
+	ARG_INT='i',
+	ARG_UINT='u',
+	ARG_DOUBLE='d',
+	ARG_STRING='s'
+	};
+
+inline void putVarint(std::string& out, uint64_t value)
+{
+	while (value>=0x80) {
+		out+=(char)(value|0x80);
+		value>>=7;
+		}
+	out+=(char)value;
+}
+
+inline bool getVarint(const char*& p, const char* end, uint64_t& value)
+{
+	value=0;
+	for (uint32_t shift=0; p<end && shift<64; shift+=7) {
+		uint8_t byte=*p++;
+		value|=(uint64_t)(byte&0x7f)<<shift;
+		if (!(byte&0x80)) {
+			return true;
+			}
+		}
+	return false;
+}
+
+inline void putString(std::string& out, std::string_view s)
+{
+	putVarint(out, s.length());
+	out.append(s.data(), s.length());
+}
+
+inline bool getString(const char*& p, const char* end, std::string& s)
+{
+	uint64_t length;
+	if (!getVarint(p, end, length) || (uint64_t)(end-p)<length) {
+		return false;
+		}
+	s.assign(p, length);
+	p+=length;
+	return true;
+}
+
+inline uint64_t zigzag(int64_t value)
+{
+	return ((uint64_t)value<<1)^(uint64_t)(value>>63);
+}
+
+inline int64_t unzigzag(uint64_t value)
+{
+	return (int64_t)(value>>1)^-(int64_t)(value&1);
+}
+
+/**
+ * Substitutes the arguments for the {} of format in order, surplus arguments are appended
+ */
+inline std::string render(std::string_view format, const std::vector<std::string>& args)
+{
+	std::string text;
+	text.reserve(format.length()+args.size()*8);
+	size_t next{0};
+	for (size_t i=0; i<format.length(); ++i) {
+		if (format[i]=='{' && i+1<format.length() && format[i+1]=='}' && next<args.size()) {
+			text+=args[next++];
+			++i;
+			continue;
+			}
+		text+=format[i];
+		}
+	for (; next<args.size(); ++next) {
+		text+=' ';
+		text+=args[next];
+		}
+	return text;
+}
+
+	}
+
+#endif
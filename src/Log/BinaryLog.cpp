@@ -0,0 +1,191 @@
+#include "BinaryLog.h"
+#include "Common/Singleton.h"
+#include "globals.h"
+#include <boost/log/detail/process_id.hpp>
+#include <boost/log/detail/thread_id.hpp>
+#include <boost/make_shared.hpp>
+#include <ctime>
+#include <iostream>
+
+
+using namespace LotosPP::Log;
+
+
+BinaryLog* BinaryLog::instance()
+{
+	static LotosPP::Common::Singleton<BinaryLog> instance;
+	return instance.get();
+}
+
+void BinaryLog::start()
+{
+	if (!options.get<bool>("global.logBinary", false) || m_enabled) {
+		return;
+		}
+	m_fileLevel=severity_t::to_severity(options.get("global.log.file.level", ""));
+	m_consoleLevel=severity_t::to_severity(options.get("global.log.console.level", ""));
+	m_batchSize=std::max<size_t>(4096, options.get<size_t>("global.logBatchSize", 65536));
+	m_flushInterval=std::max(1u, options.get<uint32_t>("global.logFlushInterval", 1000));
+	m_overflow=RecordQueue::toOverflow(options.get("global.logOverflow", "drop-debug"));
+	m_stop=false;
+	m_writer=boost::thread(boost::bind(&BinaryLog::writerThread, this));
+	m_enabled=true;
+}
+
+void BinaryLog::shutdown()
+{
+	if (!m_enabled) {
+		return;
+		}
+	m_enabled=false;
+	{
+		boost::lock_guard<boost::mutex> signalLockGuard(m_signalLock);
+		m_stop=true;
+	}
+	m_signal.notify_one();
+	m_writer.join();
+}
+
+uint32_t BinaryLog::registerFormat(severity_level level, const char* file, uint32_t line, const char* format)
+{
+	BinaryLog* binaryLog=instance();
+	boost::lock_guard<boost::mutex> lockGuard(binaryLog->m_lock);
+	uint32_t id=binaryLog->m_formats.size();
+	std::string payload;
+	Binary::putVarint(payload, id);
+	payload+=(char)level;
+	Binary::putVarint(payload, line);
+	Binary::putString(payload, file);
+	Binary::putString(payload, format);
+	binaryLog->m_formats.push_back(payload);
+	return id;
+}
+
+BinaryLog::ThreadBuffer& BinaryLog::threadBuffer()
+{
+	if (t_buffer) {
+		return *t_buffer;
+		}
+	// threads live as long as the server, their buffers as long as the log
+	boost::shared_ptr<ThreadBuffer> buffer=boost::make_shared<ThreadBuffer>();
+	buffer->data.reserve(m_batchSize+4096);
+	std::string payload;
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	buffer->index=m_buffers.size();
+	Binary::putVarint(payload, buffer->index);
+	Binary::putVarint(payload, (uint64_t)boost::log::aux::this_thread::get_id().native_id());
+	m_threads.push_back(payload);
+	m_buffers.push_back(buffer);
+	t_buffer=buffer.get();
+	return *t_buffer;
+}
+
+void BinaryLog::writerThread()
+{
+	std::vector<boost::shared_ptr<ThreadBuffer>> buffers;
+	std::vector<std::pair<uint32_t, std::string>> collected;
+	std::string spare;
+	for (;;) {
+		bool stop;
+		{
+			boost::unique_lock<boost::mutex> signalLockUnique(m_signalLock);
+			if (!m_stop && !m_wakeup) {
+				m_signal.timed_wait(signalLockUnique, boost::posix_time::milliseconds(m_flushInterval));
+				}
+			m_wakeup=false;
+			stop=m_stop;
+		}
+
+		// buffers first: a record found in them had its format registered before, so the formats taken after
+		// cover all of them
+		{
+			boost::lock_guard<boost::mutex> lockGuard(m_lock);
+			buffers=m_buffers;
+		}
+		collected.clear();
+		for (const boost::shared_ptr<ThreadBuffer>& buffer : buffers) {
+			std::string payload;
+			{
+				boost::lock_guard<boost::mutex> bufferLockGuard(buffer->lock);
+				if (buffer->data.empty()) {
+					continue;
+					}
+				Binary::putVarint(payload, buffer->index);
+				Binary::putVarint(payload, buffer->base);
+				spare.reserve(buffer->data.capacity());
+				buffer->data.swap(spare);
+			}
+			payload+=spare;
+			spare.clear();
+			collected.emplace_back(buffer->index, std::move(payload));
+			}
+
+		char date[16];
+		time_t now=time(nullptr);
+		struct tm local;
+		strftime(date, sizeof(date), "%Y-%m-%d", localtime_r(&now, &local));
+		std::vector<std::string> formats, threads;
+		{
+			boost::lock_guard<boost::mutex> lockGuard(m_lock);
+			if (m_date!=date || !m_file.is_open()) {
+				// a new file starts with all of them
+				m_formatsWritten= m_threadsWritten= 0;
+				}
+			formats.assign(m_formats.begin()+m_formatsWritten, m_formats.end());
+			threads.assign(m_threads.begin()+m_threadsWritten, m_threads.end());
+			m_formatsWritten=m_formats.size();
+			m_threadsWritten=m_threads.size();
+		}
+		if ((m_date!=date || !m_file.is_open()) && !open(date)) {
+			if (stop) {
+				break;
+				}
+			continue;
+			}
+		for (const std::string& payload : formats) {
+			writeChunk(Binary::CHUNK_FORMAT, payload);
+			}
+		for (const std::string& payload : threads) {
+			writeChunk(Binary::CHUNK_THREAD, payload);
+			}
+		for (const auto& [index, payload] : collected) {
+			writeChunk(Binary::CHUNK_RECORDS, payload);
+			}
+		m_file.flush();
+
+		if (stop) {
+			break;
+			}
+		}
+	m_file.close();
+}
+
+bool BinaryLog::open(const std::string& date)
+{
+	if (m_file.is_open()) {
+		m_file.close();
+		}
+	m_date=date;
+	std::string name{options.get("global.log.dir", "")+"/"+date+".blog"};
+	m_file.open(name, std::ios::binary|std::ios::app|std::ios::out);
+	if (!m_file) {
+		std::cerr << "Can't open binary log " << name << std::endl;
+		return false;
+		}
+	// appending to the file of an earlier run starts a new section, the decoder resets at every header
+	std::string header(Binary::MAGIC, sizeof(Binary::MAGIC));
+	Binary::putVarint(header, Binary::VERSION);
+	Binary::putVarint(header, (uint64_t)boost::log::aux::this_process::get_id().native_id());
+	Binary::putVarint(header, (uint64_t)time(nullptr));
+	m_file.write(header.data(), header.length());
+	return true;
+}
+
+void BinaryLog::writeChunk(Binary::ChunkType type, const std::string& payload)
+{
+	std::string head;
+	head+=(char)type;
+	Binary::putVarint(head, payload.length());
+	m_file.write(head.data(), head.length());
+	m_file.write(payload.data(), payload.length());
+}
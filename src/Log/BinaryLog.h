@@ -0,0 +1,221 @@
+#ifndef LOTOSPP_LOG_BINARYLOG_H
+#define LOTOSPP_LOG_BINARYLOG_H
+
+#include "BinaryFormat.h"
+#include "Logger.h"
+#include "RecordQueue.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <cstdint>
+
+
+namespace LotosPP::Log {
+
+/**
+ * Binary structured log
+ *
+ * With global.logBinary set LOGF() call sites append a compact record, their format id, a time stamp and the raw
+ * arguments, to a buffer of the calling thread. A writer thread collects the buffers every global.logFlushInterval
+ * ms, or sooner once one holds global.logBatchSize bytes, and appends them to <log dir>/<date>.blog. A thread
+ * whose buffer the writer doesn't keep up with is handled by global.logOverflow. Nothing is
+ * formatted on the server, lotospp-logdecode renders the files as text. Records of the console level and above
+ * are logged as text as well, so they still show. Without global.logBinary LOGF() is LOG() with a format.
+ */
+class BinaryLog
+{
+public:
+	static BinaryLog* instance();
+
+	BinaryLog()
+	{};
+
+	void start();
+	/**
+	 * Writes what is buffered and stops the writer
+	 */
+	void shutdown();
+	bool isEnabled() const
+	{
+		return m_enabled;
+	};
+	uint64_t getDropped() const
+	{
+		return m_dropped;
+	};
+
+	/**
+	 * Called once per call site, by LOGF()
+	 *
+	 * @return format id of the call site
+	 */
+	static uint32_t registerFormat(severity_level level, const char* file, uint32_t line, const char* format);
+
+	template<typename ... Args>
+	static void log(uint32_t format, severity_level level, const char* text, const Args& ... args)
+	{
+		BinaryLog* binaryLog=instance();
+		if (binaryLog->m_enabled && level>=binaryLog->m_fileLevel) {
+			binaryLog->write(format, level, [&args ...](std::string& out) {
+					(encode(out, args), ...);
+				}, sizeof...(args));
+			}
+		if (!binaryLog->m_enabled || level>=binaryLog->m_consoleLevel) {
+			BOOST_LOG_SEV(Logger::getInstance()->get(), level) << Binary::render(text, std::vector<std::string>{toText(args) ...});
+			}
+	};
+
+protected:
+	struct ThreadBuffer {
+		boost::mutex lock;
+		std::string data{};
+		// records store their time relative to the first one of the buffer
+		uint64_t base{0};
+		uint32_t index{0};
+	};
+
+	template<typename F>
+	void write(uint32_t format, severity_level level, F&& encodeArgs, size_t count)
+	{
+		ThreadBuffer& buffer=threadBuffer();
+		boost::unique_lock<boost::mutex> bufferLockUnique(buffer.lock);
+		// the writer is far behind, don't let the buffer grow without bound, global.logOverflow as for the text log
+		while (buffer.data.size()>=m_batchSize*16) {
+			if (m_overflow==RecordQueue::OVERFLOW_COUNT_DROPPED || (m_overflow==RecordQueue::OVERFLOW_DROP_DEBUG && level<LINFO)) {
+				++m_dropped;
+				return;
+				}
+			bufferLockUnique.unlock();
+			wakeup();
+			boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+			bufferLockUnique.lock();
+			}
+		uint64_t now=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		if (buffer.data.empty()) {
+			buffer.base=now;
+			}
+		Binary::putVarint(buffer.data, format);
+		Binary::putVarint(buffer.data, now>buffer.base ? now-buffer.base : 0);
+		Binary::putVarint(buffer.data, count);
+		encodeArgs(buffer.data);
+		if (buffer.data.size()>=m_batchSize) {
+			bufferLockUnique.unlock();
+			wakeup();
+			}
+	};
+	void wakeup()
+	{
+		if (!m_wakeup.exchange(true)) {
+			boost::lock_guard<boost::mutex> signalLockGuard(m_signalLock);
+			m_signal.notify_one();
+			}
+	};
+
+	template<typename T>
+	static void encode(std::string& out, const T& value)
+	{
+		if constexpr (std::is_same_v<T, bool>) {
+			out+=(char)Binary::ARG_BOOL;
+			out+=(char)value;
+			}
+		else if constexpr (std::is_same_v<T, char>) {
+			encode(out, std::string_view(&value, 1));
+			}
+		else if constexpr (std::is_enum_v<T>) {
+			encode(out, (std::underlying_type_t<T>)value);
+			}
+		else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+			out+=(char)Binary::ARG_INT;
+			Binary::putVarint(out, Binary::zigzag(value));
+			}
+		else if constexpr (std::is_integral_v<T>) {
+			out+=(char)Binary::ARG_UINT;
+			Binary::putVarint(out, value);
+			}
+		else if constexpr (std::is_floating_point_v<T>) {
+			double d=value;
+			out+=(char)Binary::ARG_DOUBLE;
+			out.append((const char*)&d, sizeof(d));
+			}
+		else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+			out+=(char)Binary::ARG_STRING;
+			Binary::putString(out, std::string_view(value));
+			}
+		else {
+			// anything else only streams, e.g. addresses, formatted here after all
+			encode(out, toText(value));
+			}
+	};
+	template<typename T>
+	static std::string toText(const T& value)
+	{
+		if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+			return std::string(std::string_view(value));
+			}
+		else if constexpr (std::is_same_v<T, char>) {
+			return std::string(1, value);
+			}
+		else if constexpr (std::is_enum_v<T>) {
+			return std::to_string((std::underlying_type_t<T>)value);
+			}
+		else {
+			std::ostringstream os;
+			os << std::boolalpha << value;
+			return os.str();
+			}
+	};
+
+	ThreadBuffer& threadBuffer();
+	void writerThread();
+	/**
+	 * Opens the file of today, with all formats and threads known so far
+	 */
+	bool open(const std::string& date);
+	void writeChunk(Binary::ChunkType type, const std::string& payload);
+
+	std::atomic<bool> m_enabled{false};
+	severity_level m_fileLevel{LINFO};
+	severity_level m_consoleLevel{LWARNING};
+	size_t m_batchSize{65536};
+	uint32_t m_flushInterval{1000};
+	RecordQueue::Overflow m_overflow{RecordQueue::OVERFLOW_DROP_DEBUG};
+	std::atomic<uint64_t> m_dropped{0};
+
+	boost::mutex m_lock;
+	std::vector<boost::shared_ptr<ThreadBuffer>> m_buffers{};
+	// payloads of the FORMAT and THREAD chunks, repeated at the start of every file
+	std::vector<std::string> m_formats{};
+	std::vector<std::string> m_threads{};
+	size_t m_formatsWritten{0};
+	size_t m_threadsWritten{0};
+
+	boost::thread m_writer;
+	boost::mutex m_signalLock;
+	boost::condition_variable m_signal;
+	std::atomic<bool> m_wakeup{false};
+	bool m_stop{false};
+	std::ofstream m_file;
+	std::string m_date{};
+
+	static inline thread_local ThreadBuffer* t_buffer{nullptr};
+};
+
+	}
+
+/**
+ * LOG() with a format, binary when enabled, {} stands for an argument: LOGF(LINFO, "User connection from {}", adr)
+ */
+#define LOGF(lvl, format, ...) \
+	do { \
+		static const uint32_t lotosppLogFormat=LotosPP::Log::BinaryLog::registerFormat(LotosPP::Log::lvl, __FILE__, __LINE__, format); \
+		LotosPP::Log::BinaryLog::log(lotosppLogFormat, LotosPP::Log::lvl, format __VA_OPT__(,) __VA_ARGS__); \
+	} while (false)
+
+#endif
@@ -0,0 +1,122 @@
+#include "LogSite.h"
+#include "Common/Singleton.h"
+#include <chrono>
+#include <cstring>
+
+
+using namespace LotosPP::Log;
+
+
+Categories* Categories::instance()
+{
+	static LotosPP::Common::Singleton<Categories> instance;
+	return instance.get();
+}
+
+std::atomic<severity_level>* Categories::get(const std::string& name)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	std::unique_ptr<std::atomic<severity_level>>& level=m_levels[name];
+	if (!level) {
+		level=std::make_unique<std::atomic<severity_level>>(LDEBUG);
+		}
+	return level.get();
+}
+
+void Categories::set(const std::string& name, severity_level level)
+{
+	get(name)->store(level);
+}
+
+std::vector<std::pair<std::string, severity_level>> Categories::list()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	std::vector<std::pair<std::string, severity_level>> levels;
+	for (const auto& [name, level] : m_levels) {
+		levels.emplace_back(name, level->load());
+		}
+	return levels;
+}
+
+
+LogSite::LogSite(const char* category, const char* file, uint32_t line)
+	: m_level{Categories::instance()->get(category)}, m_file{file}, m_line{line}
+{
+	// the path of the build tree says nothing
+	if (const char* slash=strrchr(m_file, '/')) {
+		m_file=slash+1;
+		}
+	boost::lock_guard<boost::mutex> lockGuard(s_lock);
+	s_sites.push_back(this);
+}
+
+void LogSite::configure(uint32_t limit, uint32_t sample)
+{
+	s_limit=limit;
+	s_sample=sample;
+}
+
+static uint64_t currentSecond()
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool LogSite::allow(severity_level level)
+{
+	if (level<m_level->load(std::memory_order_relaxed)) {
+		return false;
+		}
+	uint32_t limit{s_limit.load(std::memory_order_relaxed)};
+	if (!limit) {
+		return true;
+		}
+
+	uint64_t second{currentSecond()};
+	uint64_t current{m_second.load(std::memory_order_relaxed)};
+	if (current!=second && m_second.compare_exchange_strong(current, second)) {
+		m_count=0;
+		m_over=0;
+		if (uint64_t suppressed=m_suppressed.exchange(0)) {
+			summary(suppressed);
+			}
+		}
+	if (++m_count<=limit) {
+		return true;
+		}
+	uint32_t sample{s_sample.load(std::memory_order_relaxed)};
+	if (sample && ++m_over%sample==0) {
+		return true;
+		}
+	if (level>m_suppressedLevel.load(std::memory_order_relaxed)) {
+		m_suppressedLevel=level;
+		}
+	++m_suppressed;
+	++s_suppressedTotal;
+	return false;
+}
+
+void LogSite::report()
+{
+	uint64_t second{currentSecond()};
+	std::vector<std::pair<LogSite*, uint64_t>> quiet;
+	{
+		boost::lock_guard<boost::mutex> lockGuard(s_lock);
+		for (LogSite* site : s_sites) {
+			if (site->m_second.load()!=second && site->m_suppressed.load()) {
+				if (uint64_t suppressed=site->m_suppressed.exchange(0)) {
+					quiet.emplace_back(site, suppressed);
+					}
+				}
+			}
+	}
+	// logged outside the lock, a LOGC() site met the first time registers under it
+	for (const auto& [site, suppressed] : quiet) {
+		site->summary(suppressed);
+		}
+}
+
+void LogSite::summary(uint64_t suppressed)
+{
+	severity_level level{m_suppressedLevel.exchange(LTRACE)};
+	BOOST_LOG_SEV(Logger::getInstance()->get(), level) << m_file << ":" << m_line << " suppressed " << suppressed << " similar messages";
+}
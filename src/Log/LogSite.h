@@ -0,0 +1,105 @@
+#ifndef LOTOSPP_LOG_LOGSITE_H
+#define LOTOSPP_LOG_LOGSITE_H
+
+#include "Logger.h"
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+
+namespace LotosPP::Log {
+
+/**
+ * Log categories, a threshold on top of the levels of the sinks
+ *
+ * LOGC() call sites name a category, e.g. "net". Its level comes from the [logCategory] section of the config,
+ * debug when not set there, and .loglevel changes it while the server runs.
+ *
+ * The categories of TRACE_CATEGORIES log step by step what the network, the dispatcher, the scheduler and the
+ * database do at the trace level. It stays off, at the cost of a relaxed load per call site, until the category is
+ * set to trace; the file log then takes it whatever its own level.
+ */
+class Categories
+{
+public:
+	static constexpr const char* TRACE_CATEGORIES[]={"net", "net.detail", "scheduler", "sql"};
+
+	static Categories* instance();
+
+	Categories()
+	{};
+
+	/**
+	 * @return the level of the category, created on first use and valid as long as the server runs
+	 */
+	std::atomic<severity_level>* get(const std::string& name);
+	void set(const std::string& name, severity_level level);
+	std::vector<std::pair<std::string, severity_level>> list();
+
+private:
+	boost::mutex m_lock;
+	std::map<std::string, std::unique_ptr<std::atomic<severity_level>>> m_levels{};
+};
+
+/**
+ * Rate limit of one LOGC() call site
+ *
+ * A site logs at most global.logSiteLimit records a second, 0 doesn't limit. Of the records over the limit every
+ * global.logSiteSample th still passes, 0 lets none pass. The others are counted and reported as "suppressed K
+ * similar messages", by the next record of the site in a later second or by report(), whichever comes first.
+ */
+class LogSite
+{
+public:
+	LogSite(const char* category, const char* file, uint32_t line);
+
+	static void configure(uint32_t limit, uint32_t sample);
+	bool allow(severity_level level);
+	/**
+	 * Reports the sites which suppressed records before the current second and stayed quiet since,
+	 * called every second
+	 */
+	static void report();
+	/**
+	 * @return records suppressed by all sites since the start
+	 */
+	static uint64_t getSuppressed()
+	{
+		return s_suppressedTotal;
+	};
+
+private:
+	void summary(uint64_t suppressed);
+
+	std::atomic<severity_level>* m_level;
+	const char* m_file;
+	uint32_t m_line;
+	std::atomic<uint64_t> m_second{0};
+	std::atomic<uint32_t> m_count{0};
+	std::atomic<uint32_t> m_over{0};
+	std::atomic<uint64_t> m_suppressed{0};
+	std::atomic<severity_level> m_suppressedLevel{LTRACE};
+
+	static inline std::atomic<uint32_t> s_limit{20};
+	static inline std::atomic<uint32_t> s_sample{0};
+	static inline std::atomic<uint64_t> s_suppressedTotal{0};
+	static inline boost::mutex s_lock{};
+	static inline std::vector<LogSite*> s_sites{};
+};
+
+	}
+
+/**
+ * LOG() of a category, rate limited per call site: LOGC(LERROR, "net") << e.what();
+ */
+#define LOGC(lvl, category) \
+	if (static LotosPP::Log::LogSite lotosppLogSite(category, __FILE__, __LINE__); !lotosppLogSite.allow(LotosPP::Log::lvl)) {} \
+	else LOG(lvl)
+
+#endif
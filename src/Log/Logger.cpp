@@ -1,4 +1,8 @@
 #include "Logger.h"
+#include "BatchedFileBackend.h"
+#include "BinaryLog.h"
+#include "LogSite.h"
+#include "RecordQueue.h"
 #include "Common/Singleton.h"
 #include "globals.h"
 #include <boost/core/null_deleter.hpp>
@@ -10,6 +14,7 @@
 #include <boost/log/sinks.hpp>
 #include <boost/log/support/date_time.hpp>
 #include <boost/log/utility/setup/common_attributes.hpp>
+#include <boost/program_options/errors.hpp>
 #include <iostream>
 
 
@@ -23,6 +28,14 @@ BOOST_LOG_ATTRIBUTE_KEYWORD(timestamp, "TimeStamp", boost::posix_time::ptime)
 BOOST_LOG_ATTRIBUTE_KEYWORD(processid, "ProcessID", logging::attributes::current_process_id::value_type)
 BOOST_LOG_ATTRIBUTE_KEYWORD(threadid, "ThreadID", logging::attributes::current_thread_id::value_type)
 
+namespace {
+	// records are formatted, timestamps included, on the writer threads of these
+	typedef logging::sinks::asynchronous_sink<logging::sinks::text_ostream_backend, RecordQueue> consoleSink_t;
+	typedef logging::sinks::asynchronous_sink<BatchedFileBackend, RecordQueue> fileSink_t;
+	boost::shared_ptr<consoleSink_t> consoleSink;
+	boost::shared_ptr<fileSink_t> fileSink;
+	}
+
 
 Logger* Logger::getInstance()
 {
@@ -44,27 +57,76 @@ bool Logger::init()
 			<< " <" << processid << "/" << threadid << "> : [" << severity << "] "
 			<< expr::smessage;
 
-	typedef sinks::synchronous_sink<sinks::text_ostream_backend> textSink;
-	typedef sinks::synchronous_sink<sinks::text_file_backend> fileSink;
+	size_t queueSize{options.get<size_t>("global.logQueueSize", 8192)};
+	RecordQueue::Overflow overflow{RecordQueue::toOverflow(options.get("global.logOverflow", "drop-debug"))};
+	uint32_t flushInterval{options.get<uint32_t>("global.logFlushInterval", 1000)};
 
-	boost::shared_ptr<textSink> cSink=boost::make_shared<textSink>();
-	cSink->set_formatter(fmt);
-	cSink->set_filter(severity>=LotosPP::Log::severity_t::to_severity(options.get("global.log.console.level", "")));
+	consoleSink=boost::make_shared<consoleSink_t>();
+	consoleSink->configure(queueSize, overflow, flushInterval, boost::function<void (void)>());
+	consoleSink->set_formatter(fmt);
+	consoleSink->set_filter(severity>=LotosPP::Log::severity_t::to_severity(options.get("global.log.console.level", "")));
 	boost::shared_ptr<ostream> cStream(&clog, boost::null_deleter());
-	cSink->locked_backend()->add_stream(cStream);
-	core->add_sink(cSink);
+	consoleSink->locked_backend()->add_stream(cStream);
+	consoleSink->locked_backend()->auto_flush(true);
+	core->add_sink(consoleSink);
 
-	boost::shared_ptr<sinks::text_file_backend> fBck=boost::make_shared<sinks::text_file_backend>(
+	boost::shared_ptr<BatchedFileBackend> fBck=boost::make_shared<BatchedFileBackend>(
 		kwd::file_name=options.get("global.log.dir", "")+"/%Y-%m-%d.log",
 		kwd::time_based_rotation=sinks::file::rotation_at_time_point(0, 0, 0),
-		kwd::auto_flush=true,
+		kwd::auto_flush=false,
 		kwd::open_mode=ios_base::app|ios_base::out|ios_base::ate // append, don't overwrite
 		);
-	boost::shared_ptr<fileSink> fSink{new fileSink(fBck)};
-	fSink->set_formatter(fmt);
-	fSink->set_filter(severity>=LotosPP::Log::severity_t::to_severity(options.get("global.log.file.level", "")));
-	core->add_sink(fSink);
+	fBck->configure(options.get<size_t>("global.logBatchSize", 65536), flushInterval,
+		LotosPP::Log::severity_t::to_severity(options.get("global.logFlushLevel", "warning")));
+	fileSink=boost::make_shared<fileSink_t>(fBck);
+	// a quiet log still reaches the disk within the interval
+	fileSink_t* file{fileSink.get()};
+	fileSink->configure(queueSize, overflow, flushInterval, [file]() {
+			file->locked_backend()->flush();
+		});
+	fileSink->set_formatter(fmt);
+	// trace records only pass a category switched to trace
+	fileSink->set_filter(severity>=LotosPP::Log::severity_t::to_severity(options.get("global.log.file.level", "")) || severity==LTRACE);
+	core->add_sink(fileSink);
+
+	LogSite::configure(options.get<uint32_t>("global.logSiteLimit", 20), options.get<uint32_t>("global.logSiteSample", 0));
+	// listed by .loglevel before their first record
+	for (const char* name : Categories::TRACE_CATEGORIES) {
+		Categories::instance()->get(name);
+		}
+	if (boost::optional<boost::property_tree::ptree&> categories=options.get_child_optional("logCategory")) {
+		for (const auto& [name, level] : *categories) {
+			try {
+				Categories::instance()->set(name, severity_t::to_severity(level.data()));
+				}
+			catch (boost::program_options::validation_error&) {
+				cerr << "Unknown level " << level.data() << " of log category " << name << endl;
+				}
+			}
+		}
 
 	logging::add_common_attributes();
+	BinaryLog::instance()->start();
 	return true;
 }
+
+void Logger::shutdown()
+{
+	BinaryLog::instance()->shutdown();
+	boost::shared_ptr<logging::core> core=logging::core::get();
+	if (consoleSink) {
+		core->remove_sink(consoleSink);
+		consoleSink->stop();
+		consoleSink->flush();
+		}
+	if (fileSink) {
+		core->remove_sink(fileSink);
+		fileSink->stop();
+		fileSink->flush();
+		}
+}
+
+uint64_t Logger::getDropped()
+{
+	return (consoleSink ? consoleSink->getDropped() : 0)+(fileSink ? fileSink->getDropped() : 0)+BinaryLog::instance()->getDropped();
+}
@@ -6,6 +6,7 @@
 #include <boost/log/sources/severity_logger.hpp>
 #include <boost/log/sources/record_ostream.hpp>
 #include <string>
+#include <cstdint>
 
 
 namespace LotosPP::Log {
@@ -15,6 +16,14 @@ class Logger
 public:
 	static Logger* getInstance();
 	bool init();
+	/**
+	 * Writes what the asynchronous sinks still hold and stops their threads, before exit
+	 */
+	void shutdown();
+	/**
+	 * @return records dropped by the overflow policy of the sinks
+	 */
+	uint64_t getDropped();
 	boost::log::sources::severity_logger_mt<LotosPP::Log::severity_level>& get()
 	{
 		return _logger;
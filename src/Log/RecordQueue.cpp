@@ -0,0 +1,154 @@
+#include "RecordQueue.h"
+#include "severity_t.h"
+#include <boost/log/attributes/value_extraction.hpp>
+#include <boost/thread/locks.hpp>
+
+
+using namespace LotosPP::Log;
+
+
+RecordQueue::Overflow RecordQueue::toOverflow(const std::string& name)
+{
+	if (name=="block") {
+		return OVERFLOW_BLOCK;
+		}
+	if (name=="count-dropped") {
+		return OVERFLOW_COUNT_DROPPED;
+		}
+	return OVERFLOW_DROP_DEBUG;
+}
+
+RecordQueue::RecordQueue()
+{}
+
+RecordQueue::~RecordQueue()
+{
+	boost::log::record_view* rec;
+	while (m_queue.pop(rec)) {
+		delete rec;
+		}
+}
+
+void RecordQueue::configure(size_t capacity, Overflow overflow, uint32_t idle, const boost::function<void (void)>& onIdle)
+{
+	m_capacity=std::max<size_t>(1, capacity);
+	m_overflow=overflow;
+	m_queue.reserve(m_capacity);
+	boost::lock_guard<boost::mutex> readyLockGuard(m_readyLock);
+	m_idle=std::max(1u, idle);
+	m_onIdle=onIdle;
+}
+
+bool RecordQueue::push(const boost::log::record_view& rec)
+{
+	if (m_size.fetch_add(1)>=m_capacity) {
+		m_size.fetch_sub(1);
+		return false;
+		}
+	// nodes are reserved up to the capacity, this allocates the record handle only
+	m_queue.push(new boost::log::record_view(rec));
+	// pairs with the one in dequeue_ready(), either the writer sees the record or this sees the writer waiting
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_waiting.load(std::memory_order_relaxed)) {
+		boost::lock_guard<boost::mutex> readyLockGuard(m_readyLock);
+		m_ready.notify_one();
+		}
+	return true;
+}
+
+bool RecordQueue::pop(boost::log::record_view& rec)
+{
+	boost::log::record_view* queued;
+	if (!m_queue.pop(queued)) {
+		return false;
+		}
+	rec.swap(*queued);
+	delete queued;
+	m_size.fetch_sub(1);
+	if (m_blocked) {
+		boost::lock_guard<boost::mutex> spaceLockGuard(m_spaceLock);
+		m_space.notify_all();
+		}
+	return true;
+}
+
+void RecordQueue::enqueue(const boost::log::record_view& rec)
+{
+	if (push(rec)) {
+		return;
+		}
+	bool drop{m_overflow==OVERFLOW_COUNT_DROPPED || std::this_thread::get_id()==m_writer.load()};
+	if (!drop && m_overflow==OVERFLOW_DROP_DEBUG) {
+		boost::log::value_ref<severity_level> severity=boost::log::extract<severity_level>("Severity", rec);
+		drop=!severity || *severity<LINFO;
+		}
+	if (drop) {
+		++m_dropped;
+		return;
+		}
+
+	++m_blocked;
+	while (!push(rec)) {
+		// the timeout covers a wakeup missed between the failed push and the wait
+		boost::unique_lock<boost::mutex> spaceLockUnique(m_spaceLock);
+		m_space.timed_wait(spaceLockUnique, boost::posix_time::milliseconds(10));
+		}
+	--m_blocked;
+}
+
+bool RecordQueue::try_enqueue(const boost::log::record_view& rec)
+{
+	return push(rec);
+}
+
+bool RecordQueue::try_dequeue_ready(boost::log::record_view& rec)
+{
+	return pop(rec);
+}
+
+bool RecordQueue::try_dequeue(boost::log::record_view& rec)
+{
+	return pop(rec);
+}
+
+bool RecordQueue::dequeue_ready(boost::log::record_view& rec)
+{
+	m_writer=std::this_thread::get_id();
+	if (pop(rec)) {
+		return true;
+		}
+
+	boost::unique_lock<boost::mutex> readyLockUnique(m_readyLock);
+	for (;;) {
+		if (m_interrupted) {
+			m_interrupted=false;
+			return false;
+			}
+		m_waiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (pop(rec)) {
+			m_waiting=false;
+			return true;
+			}
+		bool woken{m_ready.timed_wait(readyLockUnique, boost::posix_time::milliseconds(m_idle))};
+		m_waiting=false;
+		if (!woken) {
+			boost::function<void (void)> onIdle{m_onIdle};
+			readyLockUnique.unlock();
+			if (onIdle) {
+				onIdle();
+				}
+			return false;
+			}
+		if (pop(rec)) {
+			return true;
+			}
+		}
+}
+
+void RecordQueue::interrupt_dequeue()
+{
+	boost::lock_guard<boost::mutex> readyLockGuard(m_readyLock);
+	m_interrupted=true;
+	m_ready.notify_all();
+}
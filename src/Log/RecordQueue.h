@@ -0,0 +1,96 @@
+#ifndef LOTOSPP_LOG_RECORDQUEUE_H
+#define LOTOSPP_LOG_RECORDQUEUE_H
+
+#include <boost/function.hpp>
+#include <boost/lockfree/queue.hpp>
+#include <boost/log/core/record_view.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <cstdint>
+
+
+namespace LotosPP::Log {
+
+/**
+ * Queueing strategy of the asynchronous sinks
+ *
+ * Logging threads push records onto a bounded lock-free queue and only touch a mutex when the writer sleeps or
+ * the queue is full. What happens then is the overflow policy: block waits for space, drop-debug drops trace and
+ * debug records and blocks for the rest, count-dropped drops anything. Dropped records are counted.
+ * When there is nothing to write for the idle interval the idle handler runs on the writer thread.
+ */
+class RecordQueue
+{
+public:
+	enum Overflow {
+		OVERFLOW_BLOCK,
+		OVERFLOW_DROP_DEBUG,
+		OVERFLOW_COUNT_DROPPED
+		};
+	/**
+	 * @param name block, drop-debug or count-dropped, drop-debug if not known
+	 */
+	static Overflow toOverflow(const std::string& name);
+
+	/**
+	 * Call before the sink is added to the core
+	 *
+	 * @param capacity records queued at most
+	 * @param idle ms the writer sleeps before running onIdle
+	 */
+	void configure(size_t capacity, Overflow overflow, uint32_t idle, const boost::function<void (void)>& onIdle);
+
+	uint64_t getDropped() const
+	{
+		return m_dropped;
+	};
+	size_t size() const
+	{
+		return m_size;
+	};
+
+protected:
+	RecordQueue();
+	template<typename ArgsT>
+	explicit RecordQueue(const ArgsT&)
+		: RecordQueue()
+	{};
+	~RecordQueue();
+
+	// interface of boost::log::sinks::asynchronous_sink
+	void enqueue(const boost::log::record_view& rec);
+	bool try_enqueue(const boost::log::record_view& rec);
+	bool try_dequeue_ready(boost::log::record_view& rec);
+	bool try_dequeue(boost::log::record_view& rec);
+	bool dequeue_ready(boost::log::record_view& rec);
+	void interrupt_dequeue();
+
+	bool push(const boost::log::record_view& rec);
+	bool pop(boost::log::record_view& rec);
+
+	boost::lockfree::queue<boost::log::record_view*> m_queue{0};
+	std::atomic<size_t> m_size{0};
+	size_t m_capacity{8192};
+	Overflow m_overflow{OVERFLOW_DROP_DEBUG};
+	std::atomic<uint64_t> m_dropped{0};
+	// the writer never waits for space, any record it logs itself is dropped instead
+	std::atomic<std::thread::id> m_writer{};
+
+	boost::mutex m_readyLock;
+	boost::condition_variable m_ready;
+	std::atomic<bool> m_waiting{false};
+	bool m_interrupted{false};
+	uint32_t m_idle{1000};
+	boost::function<void (void)> m_onIdle{};
+
+	boost::mutex m_spaceLock;
+	boost::condition_variable m_space;
+	std::atomic<uint32_t> m_blocked{0};
+};
+
+	}
+
+#endif
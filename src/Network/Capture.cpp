@@ -0,0 +1,116 @@
+#include "Capture.h"
+#include "globals.h"
+#include "Common/Singleton.h"
+#include "Log/Logger.h"
+#include <boost/thread/lock_guard.hpp>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+using namespace LotosPP::Network;
+
+
+Capture* Capture::instance()
+{
+	static LotosPP::Common::Singleton<Capture> instance;
+	return instance.get();
+}
+
+bool Capture::start()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	if (m_file || !options.get<bool>("global.capture", false)) {
+		return false;
+		}
+	time_t now=time(nullptr);
+	struct tm local;
+	char stamp[32];
+	strftime(stamp, sizeof(stamp), "%Y-%m-%d-%H%M%S", localtime_r(&now, &local));
+	m_fileName=options.get("global.log.dir", "")+"/"+stamp+".lcap";
+	// passwords are in there as typed, only the owner may read it, and an existing file or link is never followed
+	int fd=::open(m_fileName.c_str(), O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC, 0600);
+	if (fd<0 || !(m_file=fdopen(fd, "wb"))) {
+		LOG(LWARNING) << "Can't create the capture " << m_fileName << ": " << strerror(errno);
+		if (fd>=0) {
+			close(fd);
+			}
+		return false;
+		}
+	setvbuf(m_file, nullptr, _IOFBF, 1<<20);
+
+	FileHeader header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version=VERSION;
+	header.reserved=0;
+	header.startTime=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	fwrite(&header, sizeof(header), 1, m_file);
+	m_last=std::chrono::steady_clock::now();
+	m_bytes=0;
+	m_enabled=true;
+	g_scheduler.addEvent(Common::createSchedulerTask(1000, &Capture::flushEvent));
+	LOG(LINFO) << "Capturing the traffic to " << m_fileName;
+	return true;
+}
+
+void Capture::stop()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	if (!m_file) {
+		return;
+		}
+	m_enabled=false;
+	fclose(m_file);
+	m_file=nullptr;
+	LOG(LINFO) << "Capture " << m_fileName << ": " << m_connections << " connections, " << m_bytes << " bytes";
+}
+
+void Capture::flushEvent()
+{
+	Capture* capture=instance();
+	boost::lock_guard<boost::mutex> lockGuard(capture->m_lock);
+	if (capture->m_file) {
+		fflush(capture->m_file);
+		g_scheduler.addEvent(Common::createSchedulerTask(1000, &Capture::flushEvent));
+		}
+}
+
+uint32_t Capture::open(const std::string& address)
+{
+	if (!isEnabled()) {
+		return 0;
+		}
+	uint32_t connection{++m_connections};
+	record(RECORD_OPEN, connection, address.data(), address.length());
+	return connection;
+}
+
+void Capture::record(RecordType type, uint32_t connection, const void* data/*=nullptr*/, size_t length/*=0*/)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	if (!m_file) {
+		return;
+		}
+	// the order of the file is the order of the lock, the deltas never go negative
+	std::chrono::steady_clock::time_point now{std::chrono::steady_clock::now()};
+	putVarint(std::chrono::duration_cast<std::chrono::nanoseconds>(now-m_last).count());
+	m_last=now;
+	putVarint(connection);
+	fputc(type, m_file);
+	putVarint(length);
+	if (length) {
+		fwrite(data, 1, length, m_file);
+		m_bytes+=length;
+		}
+}
+
+void Capture::putVarint(uint64_t v)
+{
+	while (v>=0x80) {
+		fputc((v&0x7f)|0x80, m_file);
+		v>>=7;
+		}
+	fputc(v, m_file);
+}
@@ -0,0 +1,87 @@
+#ifndef LOTOSPP_NETWORK_CAPTURE_H
+#define LOTOSPP_NETWORK_CAPTURE_H
+
+#include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+
+
+namespace LotosPP::Network {
+
+/**
+ * Traffic capture, the bytes of every connection as they came and went
+ *
+ * With global.capture on, connections opened since the start are recorded to <log dir>/<date>-<time>.lcap:
+ * what was read from the socket, before any protocol saw it, and what was written, each with the time it happened.
+ * lotospp-replay plays the sessions back against a server and compares what it answers.
+ * The file holds logins and passwords in clear text, it is created 0600 and never overwritten, treat copies likewise.
+ *
+ * File layout: FileHeader, then records of
+ *	varint ns since the previous record, varint connection, uint8 RecordType, varint length, length bytes
+ * with OPEN carrying the remote address as text and CLOSE nothing. Varints are LEB128.
+ */
+class Capture
+{
+public:
+	static constexpr char MAGIC[8]={'L', 'P', 'P', 'C', 'A', 'P', 'T', '1'};
+	static const uint32_t VERSION=1;
+
+	enum RecordType : uint8_t {
+		RECORD_OPEN=1,
+		RECORD_IN,
+		RECORD_OUT,
+		RECORD_CLOSE
+		};
+
+	struct FileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t reserved;
+		// ns since the epoch, of the first record
+		uint64_t startTime;
+		};
+
+	static Capture* instance();
+
+	Capture()
+	{};
+
+	/**
+	 * Creates the file, if global.capture is on
+	 */
+	bool start();
+	void stop();
+	bool isEnabled() const
+	{
+		return m_enabled.load(std::memory_order_relaxed);
+	};
+	const std::string& getFileName() const
+	{
+		return m_fileName;
+	};
+
+	/**
+	 * @return id of a new connection in the capture, 0 when not capturing
+	 */
+	uint32_t open(const std::string& address);
+	void record(RecordType type, uint32_t connection, const void* data=nullptr, size_t length=0);
+
+private:
+	static void flushEvent();
+	void putVarint(uint64_t v);
+
+	std::string m_fileName{};
+	FILE* m_file{nullptr};
+	std::atomic<bool> m_enabled{false};
+	boost::mutex m_lock;
+	std::chrono::steady_clock::time_point m_last{};
+	std::atomic<uint32_t> m_connections{0};
+	uint64_t m_bytes{0};
+};
+
+	}
+
+#endif
@@ -1,25 +1,46 @@
 #include "Connection.h"
+#include "Capture.h"
 #include "ConnectionManager.h"
+#include "LatencyTrace.h"
 #include "globals.h"
+#include "Common/FlightRecorder.h"
+#include "Common/Metrics.h"
+#include "Common/Probe.h"
 #include "Protocol.h"
 #include "OutputMessage.h"
 #include "ServicePort.h"
-#include "Log/Logger.h"
+#include "Log/BinaryLog.h"
+#include "Log/LogSite.h"
 #include <boost/asio/placeholders.hpp>
-#include <boost/asio/write.hpp>
 #include <cassert>
+#include <iostream>
 
 
 using namespace LotosPP::Network;
 using namespace std;
 
 
-Connection::Connection(boost::asio::ip::tcp::socket* socket, boost::asio::io_service& io_service, ServicePort_ptr service_port)
-	: m_socket{socket}, m_writeTimer{io_service}, m_io_service{io_service}, m_service_port{service_port}
+namespace {
+
+LotosPP::Common::Metrics* metrics{LotosPP::Common::Metrics::instance()};
+LotosPP::Common::Metrics::Gauge* connectionsOpen{metrics->gauge("lotospp_connections", "Open connections")};
+LotosPP::Common::Metrics::Counter* connectionsTotal{metrics->counter("lotospp_connections_total", "Connections accepted")};
+LotosPP::Common::Metrics::Counter* receivedBytes{metrics->counter("lotospp_network_receive_bytes_total", "Bytes read from connections")};
+LotosPP::Common::Metrics::Counter* sentBytes{metrics->counter("lotospp_network_transmit_bytes_total", "Bytes written to connections")};
+
+	}
+
+Connection::Connection(Transport* transport, boost::asio::io_service& io_service, ServicePort_ptr service_port)
+	: m_transport{transport}, m_writeTimer{io_service}, m_io_service{io_service}, m_service_port{service_port}
 {
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
 	connectionCount++;
 #endif
+	connectionsOpen->add();
+	connectionsTotal->add();
+	if (Capture* capture=Capture::instance(); capture->isEnabled()) {
+		m_captureId=capture->open(getAddress().to_string());
+		}
 }
 
 Connection::~Connection()
@@ -27,19 +48,18 @@ Connection::~Connection()
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
 	connectionCount--;
 #endif
+	connectionsOpen->sub();
 }
 
-boost::asio::ip::tcp::socket& Connection::getHandle()
+Transport& Connection::getTransport()
 {
-	return *m_socket;
+	return *m_transport;
 }
 
 void Connection::closeConnection()
 {
 	//any thread
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "Connection::closeConnection" << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "Connection::closeConnection";
 
 	boost::recursive_mutex::scoped_lock lockClass(m_connectionLock);
 	if (m_connectionState==CONNECTION_STATE_CLOSED || m_connectionState==CONNECTION_STATE_REQUEST_CLOSE) {
@@ -47,16 +67,19 @@ void Connection::closeConnection()
 		}
 
 	m_connectionState=CONNECTION_STATE_REQUEST_CLOSE;
+	LotosPP::Common::FlightRecorder::instance()->record(LotosPP::Common::FlightRecorder::EVENT_CONNECTION_CLOSE, (uintptr_t)this);
+	LOTOSPP_PROBE(connection__close, (uintptr_t)this);
+	if (m_captureId) {
+		Capture::instance()->record(Capture::RECORD_CLOSE, m_captureId);
+		}
 
-	g_dispatcher.addTask(LotosPP::Common::createTask(boost::bind(&Connection::closeConnectionTask, this)));
+	g_dispatcher.addTask(LotosPP::Common::createTask(boost::bind(&Connection::closeConnectionTask, this), LotosPP::Common::Task::CATEGORY_NETWORK));
 }
 
 void Connection::closeConnectionTask()
 {
 	//dispatcher thread
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "Connection::closeConnectionTask" << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "Connection::closeConnectionTask";
 
 	m_connectionLock.lock();
 	if (m_connectionState!=CONNECTION_STATE_REQUEST_CLOSE) {
@@ -87,22 +110,18 @@ void Connection::closeConnectionTask()
 
 void Connection::closeSocket()
 {
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "Connection::closeSocket" << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "Connection::closeSocket";
 
 	m_connectionLock.lock();
 
-	if (m_socket->is_open()) {
-#ifdef __DEBUG_NET_DETAIL__
-		cout << "Closing socket" << endl;
-#endif
+	if (m_transport->isOpen()) {
+		LOGC(LTRACE, "net.detail") << "Closing socket";
 
 		m_pendingRead= m_pendingWrite= 0;
 
 		try {
 			boost::system::error_code error;
-			m_socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
+			m_transport->shutdown(error);
 			if (error) {
 				if (error==boost::asio::error::not_connected) {
 					//Transport endpoint is not connected.
@@ -111,17 +130,14 @@ void Connection::closeSocket()
 					PRINT_ASIO_ERROR("Shutdown");
 					}
 				}
-			m_socket->close(error);
+			m_transport->close(error);
 
 			if (error) {
 				PRINT_ASIO_ERROR("Close");
 				}
 			}
 		catch (boost::system::system_error& e) {
-			if (m_logError) {
-				LOG(LERROR) << e.what();
-				m_logError=false;
-				}
+			LOGC(LERROR, "net") << e.what();
 			}
 		}
 
@@ -146,18 +162,18 @@ void Connection::onStopOperation()
 	m_writeTimer.cancel();
 
 	try {
-		if (m_socket->is_open()) {
+		if (m_transport->isOpen()) {
 			boost::system::error_code error;
-			m_socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
-			m_socket->close();
+			m_transport->shutdown(error);
+			m_transport->close(error);
 			}
 		}
 	catch (boost::system::system_error&) {
 		//
 		}
 
-	delete m_socket;
-	m_socket=nullptr;
+	delete m_transport;
+	m_transport=nullptr;
 
 	m_connectionLock.unlock();
 	ConnectionManager::getInstance()->releaseConnection(shared_from_this());
@@ -171,10 +187,7 @@ void Connection::deleteConnectionTask()
 		m_io_service.dispatch(boost::bind(&Connection::onStopOperation, this));
 		}
 	catch (boost::system::system_error& e) {
-		if (m_logError) {
-			LOG(LERROR) << e.what();
-			m_logError=false;
-			}
+		LOGC(LERROR, "net") << e.what();
 		}
 }
 
@@ -192,17 +205,14 @@ void Connection::acceptConnection()
 		++m_pendingRead;
 
 		// Read size of the first packet
-		getHandle().async_read_some(
+		getTransport().asyncReadSome(
 			boost::asio::buffer(m_msg.getBuffer(), NetworkMessage::max_body_length),
 			boost::bind(&Connection::parsePacket, shared_from_this(), boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred)
 			);
 		}
 	catch (boost::system::system_error& e) {
-		if (m_logError) {
-			LOG(LERROR) << e.what();
-			m_logError=false;
-			closeConnection();
-			}
+		LOGC(LERROR, "net") << e.what();
+		closeConnection();
 		}
 }
 
@@ -223,6 +233,11 @@ void Connection::parsePacket(const boost::system::error_code& error, const std::
 	--m_pendingRead;
 
 	m_msg.setMessageLength(bytes_transferred);
+	receivedBytes->add(bytes_transferred);
+	LOTOSPP_PROBE(packet__received, (uintptr_t)this, bytes_transferred);
+	if (m_captureId) {
+		Capture::instance()->record(Capture::RECORD_IN, m_captureId, m_msg.getBuffer(), bytes_transferred);
+		}
 
 	if (!m_receivedFirst) {
 		m_receivedFirst=true;
@@ -243,7 +258,8 @@ void Connection::parsePacket(const boost::system::error_code& error, const std::
 		m_protocol->onRecvFirstMessage(m_msg);
 		}
 	else {
-		// Send the packet to the current protocol
+		// Send the packet to the current protocol, what it starts belongs to the trace if this one is sampled
+		LatencyTracer::Scope scope(LatencyTracer::instance()->sample((uintptr_t)this));
 		m_protocol->onRecvMessage(m_msg);
 		}
 
@@ -251,17 +267,14 @@ void Connection::parsePacket(const boost::system::error_code& error, const std::
 		++m_pendingRead;
 
 		// Wait to the next packet
-		getHandle().async_read_some(
+		getTransport().asyncReadSome(
 			boost::asio::buffer(m_msg.getBuffer(), NetworkMessage::max_body_length),
 			boost::bind(&Connection::parsePacket, shared_from_this(), boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred)
 			);
 		}
 	catch (boost::system::system_error& e) {
-		if (m_logError) {
-			LOG(LERROR) << e.what();
-			m_logError=false;
-			closeConnection();
-			}
+		LOGC(LERROR, "net") << e.what();
+		closeConnection();
 		}
 
 	m_connectionLock.unlock();
@@ -269,9 +282,7 @@ void Connection::parsePacket(const boost::system::error_code& error, const std::
 
 bool Connection::send(OutputMessage_ptr msg)
 {
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "Connection::send init" << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "Connection::send init";
 
 	m_connectionLock.lock();
 	if (m_connectionState!=CONNECTION_STATE_OPEN || m_writeError) {
@@ -284,16 +295,12 @@ bool Connection::send(OutputMessage_ptr msg)
 
 		TRACK_MESSAGE(msg);
 
-#ifdef __DEBUG_NET_DETAIL__
-		cout << "Connection::send " << msg->getMessageLength() << endl;
-#endif
+		LOGC(LTRACE, "net.detail") << "Connection::send " << msg->getMessageLength();
 
 		internalSend(msg);
 		}
 	else {
-#ifdef __DEBUG_NET__
-		cout << "Connection::send Adding to queue " << msg->getMessageLength() << endl;
-#endif
+		LOGC(LTRACE, "net") << "Connection::send Adding to queue " << msg->getMessageLength();
 
 		TRACK_MESSAGE(msg);
 		OutputMessagePool::getInstance()->addToAutoSend(msg);
@@ -315,48 +322,39 @@ void Connection::internalSend(OutputMessage_ptr msg)
 				boost::weak_ptr<Connection>(shared_from_this()),
 				boost::asio::placeholders::error
 			));
+		if (m_captureId) {
+			Capture::instance()->record(Capture::RECORD_OUT, m_captureId, msg->getOutputBuffer(), msg->getMessageLength());
+			}
 		boost::system::error_code ec;
-		size_t len=boost::asio::write(
-			getHandle(),
+		int64_t writeBegin{msg->getTrace() ? LatencyTrace::now() : 0};
+		size_t len=getTransport().write(
 			boost::asio::buffer(msg->getOutputBuffer(), msg->getMessageLength()),
 			ec
 			);
+		if (const LatencyTrace_ptr& trace=msg->getTrace()) {
+			trace->addSpan("output", msg->getTraceStart(), writeBegin, (uintptr_t)this);
+			trace->addSpan("write", writeBegin, LatencyTrace::now(), (uintptr_t)this);
+			}
+		sentBytes->add(len);
+		LOTOSPP_PROBE(message__send, (uintptr_t)this, len);
 		this->onWriteOperation(msg, ec);
-		if (len!=msg->getMessageLength() && m_logError) {
-			LOG(LERROR) << "Unable to write all the bytes";
-			m_logError=false;
+		if (len!=msg->getMessageLength()) {
+			LOGC(LERROR, "net") << "Unable to write all the bytes";
 			}
 		}
 	catch (boost::system::system_error& e) {
-		if (m_logError) {
-			LOG(LERROR) << e.what();
-			m_logError=false;
-			}
+		LOGC(LERROR, "net") << e.what();
 		}
 }
 
 boost::asio::ip::address Connection::getAddress() const
 {
-	//Ip is expressed in network byte order
-	boost::system::error_code error;
-	const boost::asio::ip::tcp::endpoint endpoint=m_socket->remote_endpoint(error);
-	if (!error) {
-		return endpoint.address();
-		}
-	PRINT_ASIO_ERROR("Getting remote ip");
-	return boost::asio::ip::address();
+	return m_transport->getAddress();
 }
 
 uint16_t Connection::getPort() const
 {
-	//Ip is expressed in network byte order
-	boost::system::error_code error;
-	const boost::asio::ip::tcp::endpoint endpoint=m_socket->remote_endpoint(error);
-	if (!error) {
-		return endpoint.port();
-		}
-	PRINT_ASIO_ERROR("Getting remote port");
-	return 0;
+	return m_transport->getPort();
 }
 
 std::string Connection::getHostname()
@@ -364,12 +362,16 @@ std::string Connection::getHostname()
 	if (hostName.length()) {
 		return hostName;
 		}
-	boost::system::error_code error;
+	if (m_transport->getType()!=Transport::TYPE_TCP) {
+		// a Unix socket or a pipe, the peer is on this host
+		hostName="localhost";
+		return hostName;
+		}
 
 	try {
 		boost::asio::io_service io_service;
 		boost::asio::deadline_timer timer(io_service);
-		const boost::asio::ip::tcp::endpoint endpoint=m_socket->remote_endpoint(error);
+		const boost::asio::ip::tcp::endpoint endpoint(getAddress(), getPort());
 		timer.expires_from_now(boost::posix_time::seconds(Connection::read_timeout));
 		boost::asio::ip::tcp::resolver resolver(io_service);
 
@@ -379,10 +381,10 @@ std::string Connection::getHostname()
 				boost::asio::placeholders::error
 			));
 		hostName=resolver.resolve(endpoint)->host_name();
-		LOG(LINFO) << "User address " << getAddress() << " = " << hostName;
+		LOGF(LINFO, "User address {} = {}", getAddress(), hostName);
 		}
 	catch (boost::system::system_error& error) {
-		LOG(LERROR) << "Address " << getAddress() << " does not resolve";
+		LOGC(LERROR, "net") << "Address " << getAddress() << " does not resolve";
 		}
 
 	return hostName;
@@ -400,9 +402,7 @@ int32_t Connection::unRef()
 
 void Connection::onWriteOperation(OutputMessage_ptr msg, const boost::system::error_code& error)
 {
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "Connection::onWriteOperation" << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "Connection::onWriteOperation";
 
 	m_connectionLock.lock();
 	m_writeTimer.cancel();
@@ -427,9 +427,7 @@ void Connection::onWriteOperation(OutputMessage_ptr msg, const boost::system::er
 
 void Connection::handleReadError(const boost::system::error_code& error)
 {
-#ifdef __DEBUG_NET_DETAIL__
-	PRINT_ASIO_ERROR("Reading - detail");
-#endif
+	LOGC(LTRACE, "net.detail") << "Reading: " << error.message();
 
 	boost::recursive_mutex::scoped_lock lockClass(m_connectionLock);
 
@@ -485,9 +483,7 @@ void Connection::handleReadTimeout(boost::weak_ptr<Connection> weak_conn, const
 			}
 
 		if (boost::shared_ptr<Connection> connection=weak_conn.lock()) {
-#ifdef __DEBUG_NET_DETAIL__
-			cout << "Connection::handleReadTimeout" << endl;
-#endif
+			LOGC(LTRACE, "net.detail") << "Connection::handleReadTimeout";
 			connection->onReadTimeout();
 			}
 		}
@@ -495,9 +491,7 @@ void Connection::handleReadTimeout(boost::weak_ptr<Connection> weak_conn, const
 
 void Connection::handleWriteError(const boost::system::error_code& error)
 {
-#ifdef __DEBUG_NET_DETAIL__
-	PRINT_ASIO_ERROR("Writing - detail");
-#endif
+	LOGC(LTRACE, "net.detail") << "Writing: " << error.message();
 
 	boost::recursive_mutex::scoped_lock lockClass(m_connectionLock);
 
@@ -528,9 +522,7 @@ void Connection::handleWriteTimeout(boost::weak_ptr<Connection> weak_conn, const
 			}
 
 		if (boost::shared_ptr<Connection> connection=weak_conn.lock()) {
-#ifdef __DEBUG_NET_DETAIL__
-			cout << "Connection::handleWriteTimeout" << endl;
-#endif
+			LOGC(LTRACE, "net.detail") << "Connection::handleWriteTimeout";
 			connection->onWriteTimeout();
 			}
 		}
@@ -544,9 +536,7 @@ void Connection::handleResolveTimeout(boost::weak_ptr<Connection> weak_conn, con
 			}
 
 		if (boost::shared_ptr<Connection> connection=weak_conn.lock()) {
-#ifdef __DEBUG_NET_DETAIL__
-			cout << "Connection::handleResolveTimeout" << endl;
-#endif
+			LOGC(LTRACE, "net.detail") << "Connection::handleResolveTimeout";
 			connection->onResolveTimeout();
 			}
 		}
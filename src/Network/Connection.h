@@ -2,15 +2,13 @@
 #define LOTOSPP_NETWORK_CONNECTION_H
 
 #include "NetworkMessage.h"
+#include "Transport.h"
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/core/noncopyable.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/thread/recursive_mutex.hpp>
-#if defined(__DEBUG_NET__) || defined(__DEBUG_NET_DETAIL__)
-#	include <iostream>
-#endif
 
 
 namespace LotosPP::Network {
@@ -21,14 +19,11 @@ namespace LotosPP::Network {
 	class OutputMessage;
 	typedef boost::shared_ptr<OutputMessage> OutputMessage_ptr;
 
-#ifdef __DEBUG_NET__
-#	define PRINT_ASIO_ERROR(desc) \
-	std::cout << "Error: [" << __FUNCTION__ << "] " << desc \
+// trace of the "net" category, needs Log/LogSite.h
+#define PRINT_ASIO_ERROR(desc) \
+	LOGC(LTRACE, "net") << "Error: [" << __FUNCTION__ << "] " << desc \
 		<< " - Error: " << error.value() \
-		<< " Desc: " << error.message() << std::endl;
-#else
-#	define PRINT_ASIO_ERROR(desc)
-#endif
+		<< " Desc: " << error.message()
 
 class Connection
 	: public boost::enable_shared_from_this<Connection>,
@@ -37,7 +32,7 @@ class Connection
 	friend class ConnectionManager;
 
 public:
-	Connection(boost::asio::ip::tcp::socket* socket, boost::asio::io_service& io_service, ServicePort_ptr service_port);
+	Connection(Transport* transport, boost::asio::io_service& io_service, ServicePort_ptr service_port);
 	~Connection();
 
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
@@ -54,7 +49,7 @@ public:
 		CONNECTION_STATE_CLOSED
 		};
 
-	boost::asio::ip::tcp::socket& getHandle();
+	Transport& getTransport();
 
 	void closeConnection();
 	// Used by protocols that require server to send first
@@ -100,7 +95,7 @@ private:
 	void internalSend(OutputMessage_ptr msg);
 
 	NetworkMessage m_msg;
-	boost::asio::ip::tcp::socket* m_socket{nullptr};
+	Transport* m_transport{nullptr};
 	boost::asio::deadline_timer m_writeTimer;
 	boost::asio::io_service& m_io_service;
 	ServicePort_ptr m_service_port{nullptr};
@@ -112,10 +107,11 @@ private:
 	int32_t m_pendingRead{0};
 	ConnectionState_t m_connectionState{CONNECTION_STATE_OPEN};
 	uint32_t m_refCount{0};
-	static inline bool m_logError{true};
 	boost::recursive_mutex m_connectionLock;
 
 	Protocol* m_protocol{nullptr};
+	// in the traffic capture, 0 when not captured
+	uint32_t m_captureId{0};
 
 	std::string hostName{};
 
@@ -1,6 +1,7 @@
 #include "ConnectionManager.h"
 #include "Connection.h"
 #include "Common/Singleton.h"
+#include "Log/LogSite.h"
 #include <iostream>
 
 
@@ -14,23 +15,19 @@ ConnectionManager* ConnectionManager::getInstance()
 	return instance.get();
 }
 
-Connection_ptr ConnectionManager::createConnection(boost::asio::ip::tcp::socket* socket, boost::asio::io_service& io_service, ServicePort_ptr servicer)
+Connection_ptr ConnectionManager::createConnection(Transport* transport, boost::asio::io_service& io_service, ServicePort_ptr servicer)
 {
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "Create new Connection" << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "Create new Connection";
 
 	boost::recursive_mutex::scoped_lock lockClass(m_connectionManagerLock);
-	Connection_ptr connection=boost::shared_ptr<Connection>(new Connection(socket, io_service, servicer));
+	Connection_ptr connection=boost::shared_ptr<Connection>(new Connection(transport, io_service, servicer));
 	m_connections.push_back(connection);
 	return connection;
 }
 
 void ConnectionManager::releaseConnection(Connection_ptr connection)
 {
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "Releasing connection" << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "Releasing connection";
 
 	boost::recursive_mutex::scoped_lock lockClass(m_connectionManagerLock);
 	if (list<Connection_ptr>::iterator it=find(m_connections.begin(), m_connections.end(), connection); it!=m_connections.end()) {
@@ -43,15 +40,13 @@ void ConnectionManager::releaseConnection(Connection_ptr connection)
 
 void ConnectionManager::closeAll()
 {
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "Closing all connections" << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "Closing all connections";
 	boost::recursive_mutex::scoped_lock lockClass(m_connectionManagerLock);
 	for (Connection_ptr con : m_connections) {
 		try {
 			boost::system::error_code error;
-			con->m_socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
-			con->m_socket->close(error);
+			con->m_transport->shutdown(error);
+			con->m_transport->close(error);
 			}
 		catch (boost::system::system_error&) {}
 		}
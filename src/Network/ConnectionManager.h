@@ -2,7 +2,7 @@
 #define LOTOSPP_NETWORK_CONNECTIONMANAGER_H
 
 #include <boost/asio/io_service.hpp>
-#include <boost/asio/ip/tcp.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 #include <list>
 
@@ -12,13 +12,14 @@ namespace LotosPP::Network {
 	typedef boost::shared_ptr<Connection> Connection_ptr;
 	class ServicePort;
 	typedef boost::shared_ptr<ServicePort> ServicePort_ptr;
+	class Transport;
 
 class ConnectionManager
 {
 public:
 	static ConnectionManager* getInstance();
 
-	Connection_ptr createConnection(boost::asio::ip::tcp::socket* socket, boost::asio::io_service& io_service, ServicePort_ptr servicers);
+	Connection_ptr createConnection(Transport* transport, boost::asio::io_service& io_service, ServicePort_ptr servicers);
 	void releaseConnection(Connection_ptr connection);
 	void closeAll();
 
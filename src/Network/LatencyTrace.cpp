@@ -0,0 +1,200 @@
+#include "LatencyTrace.h"
+#include "globals.h"
+#include "Common/Singleton.h"
+#include "Log/Logger.h"
+#include <boost/thread/lock_guard.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <sstream>
+
+
+using namespace LotosPP::Network;
+
+
+namespace {
+
+std::string jsonString(const std::string& text)
+{
+	std::string json{"\""};
+	for (char c : text) {
+		switch (c) {
+			case '"':
+				json+="\\\"";
+				break;
+			case '\\':
+				json+="\\\\";
+				break;
+			default:
+				if ((unsigned char)c<0x20) {
+					char escaped[8];
+					snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+					json+=escaped;
+					}
+				else {
+					json+=c;
+					}
+			}
+		}
+	return json+"\"";
+}
+
+std::string connectionName(const char* prefix, uintptr_t connection)
+{
+	std::ostringstream name;
+	name << prefix << " 0x" << std::hex << connection;
+	return name.str();
+}
+
+	}
+
+
+LatencyTrace::LatencyTrace(uint64_t id, uintptr_t connection)
+	: m_id{id}, m_connection{connection}, m_begin{now()}
+{
+}
+
+LatencyTrace::~LatencyTrace()
+{
+	// the last holder let go, nothing adds spans anymore
+	LatencyTracer::instance()->write(*this);
+}
+
+void LatencyTrace::addSpan(const char* name, int64_t begin, int64_t end, uintptr_t connection/*=0*/, const std::string& detail/*=std::string()*/)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	m_spans.push_back(Span{name, begin, end, connection, detail});
+}
+
+std::vector<LatencyTrace::Span> LatencyTrace::getSpans()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	return m_spans;
+}
+
+
+LatencyTracer* LatencyTracer::instance()
+{
+	static LotosPP::Common::Singleton<LatencyTracer> instance;
+	return instance.get();
+}
+
+bool LatencyTracer::start()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	uint32_t sample{options.get<uint32_t>("global.latencyTraceSample", 0)};
+	if (m_file || !sample) {
+		return false;
+		}
+	time_t now=time(nullptr);
+	struct tm local;
+	char stamp[32];
+	strftime(stamp, sizeof(stamp), "%Y-%m-%d-%H%M%S", localtime_r(&now, &local));
+	m_fileName=options.get("global.log.dir", "")+"/"+stamp+".trace.json";
+	if (m_file=fopen(m_fileName.c_str(), "w"); !m_file) {
+		LOG(LWARNING) << "Can't create the latency trace " << m_fileName << ": " << strerror(errno);
+		return false;
+		}
+	setvbuf(m_file, nullptr, _IOFBF, 1<<16);
+	fputs("[\n", m_file);
+	m_start=LatencyTrace::now();
+	m_written=false;
+	m_sample=sample;
+	g_scheduler.addEvent(Common::createSchedulerTask(1000, &LatencyTracer::flushEvent));
+	LOG(LINFO) << "Tracing the latency of 1 in " << sample << " packets to " << m_fileName;
+	return true;
+}
+
+void LatencyTracer::stop()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	if (!m_file) {
+		return;
+		}
+	m_sample=0;
+	// the traces still held are dropped
+	fputs("\n]\n", m_file);
+	fclose(m_file);
+	m_file=nullptr;
+	LOG(LINFO) << "Latency trace " << m_fileName << ": " << m_traces << " traces";
+}
+
+void LatencyTracer::flushEvent()
+{
+	LatencyTracer* tracer=instance();
+	boost::lock_guard<boost::mutex> lockGuard(tracer->m_lock);
+	if (tracer->m_file) {
+		fflush(tracer->m_file);
+		g_scheduler.addEvent(Common::createSchedulerTask(1000, &LatencyTracer::flushEvent));
+		}
+}
+
+LatencyTrace_ptr LatencyTracer::sample(uintptr_t connection)
+{
+	uint32_t sample{m_sample.load(std::memory_order_relaxed)};
+	if (!sample || m_packets.fetch_add(1, std::memory_order_relaxed)%sample) {
+		return LatencyTrace_ptr();
+		}
+	return LatencyTrace_ptr(new LatencyTrace(m_traces.fetch_add(1, std::memory_order_relaxed)+1, connection));
+}
+
+void LatencyTracer::write(LatencyTrace& trace)
+{
+	std::vector<LatencyTrace::Span> spans{trace.getSpans()};
+	if (spans.empty()) {
+		// the input made nothing happen
+		return;
+		}
+
+	// us since the start of the tracer
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(3);
+	auto ts=[this](int64_t ns) {
+			return (ns-m_start)/1e3;
+		};
+	uint64_t pid{trace.getId()};
+	int64_t end{trace.getBegin()};
+	for (const LatencyTrace::Span& span : spans) {
+		end=std::max(end, span.end);
+		}
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\"trace " << pid << "\"}},\n"
+		<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":0,\"args\":{\"name\":"
+		<< jsonString(connectionName("input", trace.getConnection())) << "}},\n"
+		<< "{\"name\":\"input\",\"cat\":\"lotospp\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":0,\"ts\":" << ts(trace.getBegin())
+		<< ",\"dur\":" << (end-trace.getBegin())/1e3 << "},\n";
+
+	// a row for each recipient
+	std::map<uintptr_t, uint32_t> tids;
+	for (const LatencyTrace::Span& span : spans) {
+		uint32_t tid{0};
+		if (span.connection) {
+			auto [it, added]=tids.emplace(span.connection, tids.size()+1);
+			tid=it->second;
+			if (added) {
+				out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid << ",\"args\":{\"name\":"
+					<< jsonString(connectionName("to", span.connection)) << "}},\n";
+				}
+			}
+		out << "{\"name\":\"" << span.name << "\",\"cat\":\"lotospp\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << tid
+			<< ",\"ts\":" << ts(span.begin) << ",\"dur\":" << (span.end-span.begin)/1e3;
+		if (!span.detail.empty()) {
+			out << ",\"args\":{\"detail\":" << jsonString(span.detail) << "}";
+			}
+		out << "},\n";
+		}
+
+	// events are separated, not terminated, by commas
+	std::string text{out.str()};
+	text.resize(text.length()-2);
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	if (m_file) {
+		if (m_written) {
+			fputs(",\n", m_file);
+			}
+		fwrite(text.data(), 1, text.length(), m_file);
+		m_written=true;
+		}
+}
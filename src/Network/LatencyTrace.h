@@ -0,0 +1,152 @@
+#ifndef LOTOSPP_NETWORK_LATENCYTRACE_H
+#define LOTOSPP_NETWORK_LATENCYTRACE_H
+
+#include <boost/core/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+
+
+namespace LotosPP::Network {
+
+/**
+ * Latency trace of one sampled input, from its bytes to every socket the output it caused went to
+ *
+ * Connection::parsePacket opens it, the dispatcher task of the input and every OutputMessage got meanwhile hold it,
+ * the last of them to let go writes it out. Spans, in ns of the steady clock:
+ *	dispatch	bytes read until the dispatcher took up the input
+ *	command		User::parseLine, the command and its fan-out
+ *	output		an output message got until its write began, for each recipient
+ *	write		the write until the kernel took the bytes
+ */
+class LatencyTrace
+	: boost::noncopyable
+{
+public:
+	struct Span {
+		const char* name;
+		int64_t begin;
+		int64_t end;
+		// the connection written to, 0 for the spans of the input
+		uintptr_t connection;
+		std::string detail;
+		};
+
+	LatencyTrace(uint64_t id, uintptr_t connection);
+	~LatencyTrace();
+
+	static int64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	};
+
+	void addSpan(const char* name, int64_t begin, int64_t end, uintptr_t connection=0, const std::string& detail=std::string());
+
+	uint64_t getId() const
+	{
+		return m_id;
+	};
+	uintptr_t getConnection() const
+	{
+		return m_connection;
+	};
+	int64_t getBegin() const
+	{
+		return m_begin;
+	};
+	std::vector<Span> getSpans();
+
+private:
+	uint64_t m_id;
+	uintptr_t m_connection;
+	int64_t m_begin;
+	boost::mutex m_lock;
+	std::vector<Span> m_spans{};
+};
+
+typedef boost::shared_ptr<LatencyTrace> LatencyTrace_ptr;
+
+
+/**
+ * Samples inputs into LatencyTraces and writes the finished ones in the Chrome trace event format
+ *
+ * With global.latencyTraceSample N, every N th packet read is traced, 0 traces none. Traces go to
+ * <log dir>/<date>-<time>.trace.json, in the JSON array form which may stay unterminated, so the file of a running
+ * server loads as it is in chrome://tracing or Perfetto. Each trace is a process there, its input a thread and
+ * every recipient another.
+ */
+class LatencyTracer
+{
+public:
+	static LatencyTracer* instance();
+
+	LatencyTracer()
+	{};
+
+	/**
+	 * Creates the file, if global.latencyTraceSample isn't 0
+	 */
+	bool start();
+	void stop();
+	bool isEnabled() const
+	{
+		return m_sample.load(std::memory_order_relaxed)!=0;
+	};
+
+	/**
+	 * @return a new trace when this packet is sampled, an empty pointer otherwise
+	 */
+	LatencyTrace_ptr sample(uintptr_t connection);
+	void write(LatencyTrace& trace);
+
+	/**
+	 * @return trace of the input the calling thread handles, the output it gets belongs to it
+	 */
+	static const LatencyTrace_ptr& current()
+	{
+		return s_current;
+	};
+
+	/**
+	 * Makes a trace current for the lifetime of the scope
+	 */
+	class Scope
+		: boost::noncopyable
+	{
+	public:
+		Scope(const LatencyTrace_ptr& trace)
+			: m_previous{s_current}
+		{
+			s_current=trace;
+		};
+		~Scope()
+		{
+			s_current=m_previous;
+		};
+	private:
+		LatencyTrace_ptr m_previous;
+	};
+
+private:
+	static void flushEvent();
+
+	static inline thread_local LatencyTrace_ptr s_current{};
+
+	std::string m_fileName{};
+	FILE* m_file{nullptr};
+	boost::mutex m_lock;
+	std::atomic<uint32_t> m_sample{0};
+	std::atomic<uint64_t> m_packets{0};
+	std::atomic<uint64_t> m_traces{0};
+	int64_t m_start{0};
+	bool m_written{false};
+};
+
+	}
+
+#endif
@@ -2,8 +2,11 @@
 #include "Protocol.h"
 #include "Connection.h"
 #include "globals.h"
+#include "Common/Clock.h"
+#include "Common/Metrics.h"
 #include "Common/Singleton.h"
-#include "System/system.h"
+#include "Log/LogSite.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <iostream>
 
 
@@ -11,6 +14,18 @@ using namespace LotosPP::Network;
 using namespace std;
 
 
+namespace {
+
+LotosPP::Common::Metrics::Gauge* poolMessages{LotosPP::Common::Metrics::instance()->gauge("lotospp_output_messages", "Output messages allocated by the pool")};
+
+// ms on the clock of the tasks, in a simulation messages age with the virtual time
+int64_t frameTime()
+{
+	return (LotosPP::Common::Clock::now()-boost::posix_time::ptime(boost::gregorian::date(1970,1,1))).total_milliseconds();
+}
+
+	}
+
 OutputMessage::OutputMessage()
 {
 	freeMessage();
@@ -40,11 +55,23 @@ uint64_t OutputMessage::getFrame() const
 	return m_frame;
 }
 
+const LatencyTrace_ptr& OutputMessage::getTrace() const
+{
+	return m_trace;
+}
+
+int64_t OutputMessage::getTraceStart() const
+{
+	return m_traceStart;
+}
+
 void OutputMessage::freeMessage()
 {
 	setConnection(Connection_ptr());
 	setProtocol(nullptr);
 	m_frame=0;
+	// the trace is written once no message holds it anymore
+	setTrace(LatencyTrace_ptr());
 	m_outputBufferStart=0;
 
 	//setState have to be the last one
@@ -76,6 +103,12 @@ void OutputMessage::setFrame(uint64_t frame)
 	m_frame=frame;
 }
 
+void OutputMessage::setTrace(const LatencyTrace_ptr& trace)
+{
+	m_trace=trace;
+	m_traceStart=trace ? LatencyTrace::now() : 0;
+}
+
 //*********** OutputMessagePool ****************
 
 OutputMessagePool::OutputMessagePool()
@@ -87,7 +120,16 @@ OutputMessagePool::OutputMessagePool()
 		m_allOutputMessages.push_back(msg);
 #endif
 		}
-	m_frameTime=SYS_TIME();
+	poolMessages->add(OUTPUT_POOL_SIZE);
+	LotosPP::Common::Metrics::instance()->gauge("lotospp_output_messages_available", "Output messages free in the pool", [this] {
+			boost::recursive_mutex::scoped_lock lockClass(m_outputPoolLock);
+			return (int64_t)m_outputMessages.size();
+		});
+	LotosPP::Common::Metrics::instance()->gauge("lotospp_output_messages_autosend", "Output messages waiting to be sent at the end of a dispatcher task", [this] {
+			boost::recursive_mutex::scoped_lock lockClass(m_outputPoolLock);
+			return (int64_t)m_autoSendOutputMessages.size();
+		});
+	m_frameTime=frameTime();
 }
 
 OutputMessagePool::~OutputMessagePool()
@@ -100,7 +142,7 @@ OutputMessagePool::~OutputMessagePool()
 
 void OutputMessagePool::startExecutionFrame()
 {
-	m_frameTime=SYS_TIME();
+	m_frameTime=frameTime();
 	m_isOpen=true;
 }
 
@@ -136,9 +178,7 @@ void OutputMessagePool::send(OutputMessage_ptr msg)
 	m_outputPoolLock.unlock();
 
 	if (state==OutputMessage::STATE_ALLOCATED_NO_AUTOSEND) {
-#ifdef __DEBUG_NET_DETAIL__
-		cout << "Sending message - SINGLE" << endl;
-#endif
+		LOGC(LTRACE, "net.detail") << "Sending message - SINGLE";
 		if (msg->getConnection()) {
 			if (!msg->getConnection()->send(msg)) {
 				// Send only fails when connection is closing (or in error state)
@@ -147,15 +187,11 @@ void OutputMessagePool::send(OutputMessage_ptr msg)
 				}
 			}
 		else {
-#ifdef __DEBUG_NET__
-			cout << "Error: [OutputMessagePool::send] NULL connection." << endl;
-#endif
+			LOGC(LTRACE, "net") << "Error: [OutputMessagePool::send] NULL connection.";
 			}
 		}
 	else {
-#ifdef __DEBUG_NET__
-		cout << "Warning: [OutputMessagePool::send] State!=STATE_ALLOCATED_NO_AUTOSEND" << endl;
-#endif
+		LOGC(LTRACE, "net") << "Warning: [OutputMessagePool::send] State!=STATE_ALLOCATED_NO_AUTOSEND";
 		}
 }
 
@@ -166,7 +202,7 @@ void OutputMessagePool::sendAll()
 
 	for (it=m_toAddQueue.begin(); it!=m_toAddQueue.end(); ) {
 		//drop messages that are older than Connection::read_timeout seconds
-		if (SYS_TIME()-(*it)->getFrame()>Connection::read_timeout*1000) {
+		if (frameTime()-(*it)->getFrame()>Connection::read_timeout*1000) {
 			(*it)->getProtocol()->onSendMessage(*it);
 			it=m_toAddQueue.erase(it);
 			continue;
@@ -181,9 +217,7 @@ void OutputMessagePool::sendAll()
 
 	for (it=m_autoSendOutputMessages.begin(); it!=m_autoSendOutputMessages.end(); ) {
 		OutputMessage_ptr omsg=*it;
-#ifdef __DEBUG_NET_DETAIL__
-		cout << "Sending message - ALL" << endl;
-#endif
+		LOGC(LTRACE, "net.detail") << "Sending message - ALL";
 
 		if (omsg->getConnection()) {
 			if (!omsg->getConnection()->send(omsg)) {
@@ -193,9 +227,7 @@ void OutputMessagePool::sendAll()
 				}
 			}
 		else {
-#ifdef __DEBUG_NET__
-			cout << "Error: [OutputMessagePool::send] NULL connection." << endl;
-#endif
+			LOGC(LTRACE, "net") << "Error: [OutputMessagePool::send] NULL connection.";
 			}
 
 		it=m_autoSendOutputMessages.erase(it);
@@ -209,16 +241,14 @@ void OutputMessagePool::stop()
 
 void OutputMessagePool::releaseMessage(OutputMessage* msg)
 {
-	LotosPP::g_dispatcher.addTask(LotosPP::Common::createTask(boost::bind(&OutputMessagePool::internalReleaseMessage, this, msg)), true);
+	LotosPP::g_dispatcher.addTask(LotosPP::Common::createTask(boost::bind(&OutputMessagePool::internalReleaseMessage, this, msg), LotosPP::Common::Task::CATEGORY_NETWORK), true);
 }
 
 void OutputMessagePool::internalReleaseMessage(OutputMessage* msg)
 {
 	if (msg->getProtocol()) {
 		msg->getProtocol()->unRef();
-#ifdef __DEBUG_NET_DETAIL__
-		cout << "Removing reference to protocol " << msg->getProtocol() << endl;
-#endif
+		LOGC(LTRACE, "net.detail") << "Removing reference to protocol " << msg->getProtocol();
 		}
 	else {
 		cout << "No protocol found." << endl;
@@ -226,9 +256,7 @@ void OutputMessagePool::internalReleaseMessage(OutputMessage* msg)
 
 	if (msg->getConnection()) {
 		msg->getConnection()->unRef();
-#ifdef __DEBUG_NET_DETAIL__
-		cout << "Removing reference to connection " << msg->getConnection() << endl;
-#endif
+		LOGC(LTRACE, "net.detail") << "Removing reference to connection " << msg->getConnection();
 		}
 	else {
 		cout << "No connection found." << endl;
@@ -247,9 +275,7 @@ void OutputMessagePool::internalReleaseMessage(OutputMessage* msg)
 
 OutputMessage_ptr OutputMessagePool::getOutputMessage(Protocol* protocol, bool autosend/*=true*/)
 {
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "request output message - auto = " << autosend << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "request output message - auto = " << autosend;
 
 	if (!m_isOpen) {
 		return OutputMessage_ptr();
@@ -264,6 +290,7 @@ OutputMessage_ptr OutputMessagePool::getOutputMessage(Protocol* protocol, bool a
 	if (m_outputMessages.empty()) {
 		OutputMessage* msg=new OutputMessage();
 		m_outputMessages.push_back(msg);
+		poolMessages->add();
 
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
 		OutputMessagePoolCount++;
@@ -299,15 +326,12 @@ void OutputMessagePool::configureOutputMessage(OutputMessage_ptr msg, Protocol*
 
 	msg->setProtocol(protocol);
 	protocol->addRef();
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "Adding reference to protocol - " << protocol << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "Adding reference to protocol - " << protocol;
 	msg->setConnection(connection);
 	connection->addRef();
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "Adding reference to connection - " << connection << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "Adding reference to connection - " << connection;
 	msg->setFrame(m_frameTime);
+	msg->setTrace(LatencyTracer::current());
 }
 
 void OutputMessagePool::addToAutoSend(OutputMessage_ptr msg)
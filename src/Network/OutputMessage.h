@@ -2,6 +2,7 @@
 #define LOTOSPP_NETWORK_OUTPUTMESSAGE_H
 
 #include "NetworkMessage.h"
+#include "LatencyTrace.h"
 #include <boost/core/noncopyable.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 #include <list>
@@ -38,6 +39,11 @@ public:
 	Protocol* getProtocol();
 	Connection_ptr getConnection();
 	uint64_t getFrame() const;
+	/**
+	 * @return trace of the input this message answers, if that one is sampled
+	 */
+	const LatencyTrace_ptr& getTrace() const;
+	int64_t getTraceStart() const;
 
 #ifdef __TRACK_NETWORK__
 	virtual void Track(const std::string& file, long line, const std::string& func)
@@ -77,12 +83,15 @@ protected:
 	OutputMessageState getState() const;
 
 	void setFrame(uint64_t frame);
+	void setTrace(const LatencyTrace_ptr& trace);
 
 	Protocol* m_protocol{nullptr};
 	Connection_ptr m_connection{nullptr};
 
 	uint32_t m_outputBufferStart{0};
 	uint64_t m_frame{0};
+	LatencyTrace_ptr m_trace{};
+	int64_t m_traceStart{0};
 
 	OutputMessageState m_state;
 };
@@ -0,0 +1,108 @@
+#include "Pipe.h"
+#include <boost/asio/error.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <algorithm>
+#include <cstring>
+
+
+using namespace LotosPP::Network;
+using namespace std;
+
+
+Pipe::Pipe(boost::asio::io_service& io_service)
+	: m_io_service{io_service}
+{
+}
+
+bool Pipe::send(const std::string& data)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	if (m_serverClosed || m_clientClosed) {
+		return false;
+		}
+	m_input+=data;
+	completeRead();
+	return true;
+}
+
+std::string Pipe::receive()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	string output;
+	output.swap(m_output);
+	return output;
+}
+
+void Pipe::close()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	m_clientClosed=true;
+	completeRead();
+}
+
+bool Pipe::isOpen() const
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	return !m_serverClosed;
+}
+
+void Pipe::asyncRead(boost::asio::mutable_buffer buffer, const Transport::ReadHandler& handler)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	m_readBuffer=buffer;
+	m_readHandler=handler;
+	completeRead();
+}
+
+std::size_t Pipe::write(boost::asio::const_buffer buffer, boost::system::error_code& ec)
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	if (m_serverClosed) {
+		ec=boost::asio::error::bad_descriptor;
+		return 0;
+		}
+	if (m_clientClosed) {
+		ec=boost::asio::error::broken_pipe;
+		return 0;
+		}
+	ec.clear();
+	m_output.append((const char*)buffer.data(), buffer.size());
+	return buffer.size();
+}
+
+void Pipe::closeServer()
+{
+	boost::lock_guard<boost::mutex> lockGuard(m_lock);
+	m_serverClosed=true;
+	completeRead();
+}
+
+/**
+ * Hands what there is to the pending read, as the socket would: data first, then the end of the stream.
+ * The handler runs on the io_service, never under the lock
+ */
+void Pipe::completeRead()
+{
+	if (!m_readHandler) {
+		return;
+		}
+	boost::system::error_code ec;
+	size_t length{0};
+	if (m_serverClosed) {
+		ec=boost::asio::error::operation_aborted;
+		}
+	else if (!m_input.empty()) {
+		length=min(m_input.length(), m_readBuffer.size());
+		memcpy(m_readBuffer.data(), m_input.data(), length);
+		m_input.erase(0, length);
+		}
+	else if (m_clientClosed) {
+		ec=boost::asio::error::eof;
+		}
+	else {
+		return;
+		}
+	m_io_service.post(boost::bind(m_readHandler, ec, length));
+	m_readHandler.clear();
+}
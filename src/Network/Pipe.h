@@ -0,0 +1,107 @@
+#ifndef LOTOSPP_NETWORK_PIPE_H
+#define LOTOSPP_NETWORK_PIPE_H
+
+#include "Transport.h"
+#include <boost/asio/io_service.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <string>
+
+
+namespace LotosPP::Network {
+
+/**
+ * In-memory byte stream between a client in the process and a Connection, no kernel in between
+ *
+ * The client end is the public interface, for benchmarks and tests driving a protocol: send() is what the client
+ * types, receive() what the server wrote. The server end is a PipeTransport; its reads complete on the io_service
+ * of the pipe, as those of a socket. Either end may be used from any thread.
+ */
+class Pipe
+	: public boost::enable_shared_from_this<Pipe>,
+		boost::noncopyable
+{
+public:
+	Pipe(boost::asio::io_service& io_service);
+
+	/**
+	 * @return false when the server closed its end
+	 */
+	bool send(const std::string& data);
+	/**
+	 * @return what the server wrote since the last call
+	 */
+	std::string receive();
+	/**
+	 * Hangs up, the server reads the end of the stream once it has read the rest
+	 */
+	void close();
+	/**
+	 * @return whether the server has not closed its end
+	 */
+	bool isOpen() const;
+
+	// server end, for PipeTransport
+	void asyncRead(boost::asio::mutable_buffer buffer, const Transport::ReadHandler& handler);
+	std::size_t write(boost::asio::const_buffer buffer, boost::system::error_code& ec);
+	void closeServer();
+
+private:
+	void completeRead();
+
+	boost::asio::io_service& m_io_service;
+	mutable boost::mutex m_lock;
+	std::string m_input{};
+	std::string m_output{};
+	boost::asio::mutable_buffer m_readBuffer{};
+	Transport::ReadHandler m_readHandler{};
+	bool m_clientClosed{false};
+	bool m_serverClosed{false};
+};
+
+typedef boost::shared_ptr<Pipe> Pipe_ptr;
+
+class PipeTransport
+	: public Transport
+{
+public:
+	PipeTransport(Pipe_ptr pipe)
+		: m_pipe{pipe}
+	{};
+
+	Type getType() const
+	{
+		return TYPE_PIPE;
+	};
+
+	void asyncReadSome(boost::asio::mutable_buffer buffer, const ReadHandler& handler)
+	{
+		m_pipe->asyncRead(buffer, handler);
+	};
+	std::size_t write(boost::asio::const_buffer buffer, boost::system::error_code& ec)
+	{
+		return m_pipe->write(buffer, ec);
+	};
+
+	bool isOpen() const
+	{
+		return m_pipe->isOpen();
+	};
+	void shutdown(boost::system::error_code& ec)
+	{
+		ec.clear();
+	};
+	void close(boost::system::error_code& ec)
+	{
+		ec.clear();
+		m_pipe->closeServer();
+	};
+
+private:
+	Pipe_ptr m_pipe;
+};
+
+	}
+
+#endif
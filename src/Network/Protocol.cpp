@@ -3,9 +3,7 @@
 #include "OutputMessage.h"
 #include "Common/User.h"
 #include "Common/Scheduler.h"
-#ifdef __DEBUG_NET_DETAIL__
-#	include <iostream>
-#endif
+#include "Log/LogSite.h"
 #include <cassert>
 #ifdef OS_WIN
 #	include <winerror.h>
@@ -18,9 +16,7 @@ using namespace std;
 
 void Protocol::onSendMessage(OutputMessage_ptr msg)
 {
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "Protocol::onSendMessage" << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "Protocol::onSendMessage";
 	if (msg==m_outputBuffer) {
 		m_outputBuffer.reset();
 		}
@@ -28,9 +24,7 @@ void Protocol::onSendMessage(OutputMessage_ptr msg)
 
 void Protocol::onRecvMessage(NetworkMessage& msg)
 {
-#ifdef __DEBUG_NET_DETAIL__
-	cout << "Protocol::onRecvMessage" << endl;
-#endif
+	LOGC(LTRACE, "net.detail") << "Protocol::onRecvMessage";
 	parsePacket(msg);
 }
 
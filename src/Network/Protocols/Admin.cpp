@@ -0,0 +1,117 @@
+#include "Admin.h"
+#include "../NetworkMessage.h"
+#include "../OutputMessage.h"
+#include "Common/Metrics.h"
+#include <algorithm>
+#include <sstream>
+
+
+using namespace LotosPP::Network::Protocols;
+using LotosPP::Common::Metrics;
+using namespace std;
+
+
+void Admin::onRecvFirstMessage(NetworkMessage& msg)
+{
+	parsePacket(msg);
+}
+
+void Admin::parsePacket(NetworkMessage& msg)
+{
+	if (m_responded) {
+		return;
+		}
+	m_request+=msg.GetRaw();
+	if (m_request.find("\r\n\r\n")==string::npos && m_request.find("\n\n")==string::npos) {
+		if (m_request.length()>8192) {
+			respond("431 Request Header Fields Too Large", "text/plain", "request too large\n");
+			}
+		return;
+		}
+
+	string::size_type end=m_request.find_first_of("\r\n");
+	istringstream line(m_request.substr(0, end));
+	string method, target;
+	line >> method >> target;
+	if (method!="GET" && method!="HEAD") {
+		respond("405 Method Not Allowed", "text/plain", "only GET\n");
+		}
+	else if (target!="/metrics") {
+		respond("404 Not Found", "text/plain", "try /metrics\n");
+		}
+	else {
+		respond("200 OK", "text/plain; version=0.0.4; charset=utf-8", method=="HEAD" ? string() : exposition());
+		}
+}
+
+void Admin::respond(const std::string& status, const std::string& contentType, const std::string& body)
+{
+	m_responded=true;
+	Connection_ptr connection=getConnection();
+	if (!connection) {
+		return;
+		}
+	string response{"HTTP/1.0 "+status+"\r\nContent-Type: "+contentType+"\r\nContent-Length: "+to_string(body.length())
+		+"\r\nConnection: close\r\n\r\n"+body};
+	// an output message holds 8 KiB at most
+	for (size_t pos=0; pos<response.length(); pos+=8192) {
+		OutputMessage_ptr output=OutputMessagePool::getInstance()->getOutputMessage(this, false);
+		if (!output) {
+			break;
+			}
+		size_t length=min<size_t>(8192, response.length()-pos);
+		output->AddBytes(response.data()+pos, length);
+		connection->send(output);
+		}
+	connection->closeConnection();
+}
+
+std::string Admin::exposition()
+{
+	ostringstream out;
+	out.precision(12);
+	const string* family{nullptr};
+	for (const Metrics::Metric* metric : Metrics::instance()->getAll()) {
+		const string& name=metric->getName();
+		const string& labels=metric->getLabels();
+		// the label sets of a name come one after the other, under one HELP and TYPE
+		bool first{!family || *family!=name};
+		family=&name;
+		if (first) {
+			out << "# HELP " << name << " " << metric->getHelp() << "\n";
+			}
+		string series{labels.empty() ? string() : "{"+labels+"}"};
+		switch (metric->getType()) {
+			case Metrics::Metric::TYPE_COUNTER:
+				if (first) {
+					out << "# TYPE " << name << " counter\n";
+					}
+				out << name << series << " " << static_cast<const Metrics::Counter*>(metric)->get() << "\n";
+				break;
+			case Metrics::Metric::TYPE_GAUGE:
+				if (first) {
+					out << "# TYPE " << name << " gauge\n";
+					}
+				out << name << series << " " << static_cast<const Metrics::Gauge*>(metric)->get() << "\n";
+				break;
+			case Metrics::Metric::TYPE_HISTOGRAM: {
+				// recorded in microseconds, exposed in seconds
+				Metrics::Histogram::Snapshot snapshot{static_cast<const Metrics::Histogram*>(metric)->get()};
+				if (first) {
+					out << "# TYPE " << name << " histogram\n";
+					}
+				string bucket{labels.empty() ? "{le=\"" : "{"+labels+",le=\""};
+				uint64_t cumulative{0};
+				for (uint32_t i=0; i<Metrics::Histogram::UPPER_BOUNDS.size(); ++i) {
+					cumulative+=snapshot.buckets[i];
+					out << name << "_bucket" << bucket << Metrics::Histogram::UPPER_BOUNDS[i]/1e6 << "\"} " << cumulative << "\n";
+					}
+				out << name << "_bucket" << bucket << "+Inf\"} " << snapshot.count << "\n"
+					<< name << "_sum" << series << " " << snapshot.sum/1e6 << "\n"
+					<< name << "_count" << series << " " << snapshot.count << "\n";
+				break;
+				}
+			}
+		}
+	return out.str();
+}
@@ -0,0 +1,54 @@
+#ifndef LOTOSPP_NETWORK_PROTOCOLS_ADMIN_H
+#define LOTOSPP_NETWORK_PROTOCOLS_ADMIN_H
+
+#include "../Protocol.h"
+#include <string>
+
+
+namespace LotosPP::Network {
+	class NetworkMessage;
+
+		namespace Protocols {
+
+/**
+ * HTTP on the admin port, GET /metrics answers the metrics registry in the Prometheus text format
+ *
+ * One request per connection, HTTP/1.0 style. It runs on the network thread, reading the registry takes no locks the
+ * dispatcher holds for long.
+ */
+class Admin
+	: public LotosPP::Network::Protocol
+{
+public:
+	// static protocol information
+	enum {
+		server_sends_first=false
+		};
+
+	Admin(Connection_ptr connection)
+		: Protocol(connection)
+	{};
+	static const char* protocolName()
+	{
+		return "Admin HTTP protocol";
+	};
+
+	/**
+	 * @return the metrics registry in the Prometheus text exposition format 0.0.4
+	 */
+	static std::string exposition();
+
+private:
+	virtual void onRecvFirstMessage(NetworkMessage& msg);
+	virtual void parsePacket(NetworkMessage& msg);
+
+	void respond(const std::string& status, const std::string& contentType, const std::string& body);
+
+	std::string m_request{};
+	bool m_responded{false};
+};
+
+		}
+	}
+
+#endif
@@ -5,7 +5,8 @@
 #include "Common/Enums/TelnetCmd.h"
 #include "Common/Enums/TelnetOpt.h"
 #include "globals.h"
-#include "Log/Logger.h"
+#include "Log/BinaryLog.h"
+#include "Log/LogSite.h"
 
 
 using namespace LotosPP::Network::Protocols;
@@ -17,10 +18,10 @@ template<typename FunctionType>
 void Telnet::addTalkerTaskInternal(bool droppable, uint32_t delay, const FunctionType& func)
 {
 	if (droppable) {
-		g_dispatcher.addTask(createTask(delay, func));
+		g_dispatcher.addTask(createTask(delay, func, LotosPP::Common::Task::CATEGORY_INPUT));
 		}
 	else {
-		g_dispatcher.addTask(createTask(func));
+		g_dispatcher.addTask(createTask(func, LotosPP::Common::Task::CATEGORY_INPUT));
 		}
 }
 
@@ -44,7 +45,7 @@ void Telnet::onConnect()
 {
 	boost::asio::ip::address adr=getAddress();
 
-	LOG(LINFO) << "User connection from " << adr;
+	LOGF(LINFO, "User connection from {}", adr);
 
 	OutputMessage_ptr output=OutputMessagePool::getInstance()->getOutputMessage(this, false);
 	output->AddString("\n")
@@ -85,9 +86,7 @@ void Telnet::deleteProtocolTask()
 {
 	//dispatcher thread
 	if (user) {
-#ifdef __DEBUG_NET_DETAIL__
-		std::cout << "Deleting Telnet - Protocol:" << this << ", User: " << user << std::endl;
-#endif
+		LOGC(LTRACE, "net.detail") << "Deleting Telnet - Protocol:" << this << ", User: " << user;
 		g_talker.FreeThing(user);
 		user=nullptr;
 		}
@@ -130,24 +129,25 @@ bool Telnet::parseFirstPacket([[maybe_unused]]LotosPP::Network::NetworkMessage&
 
 void Telnet::parsePacket(LotosPP::Network::NetworkMessage& msg)
 {
-	if (!user || !m_acceptPackets || msg.getMessageLength()<=0) {
+	//io thread, user belongs to the dispatcher thread and may be going away there
+	if (!m_acceptPackets || msg.getMessageLength()<=0) {
 		return;
 		}
-	try {
-		user->uRead(msg);
+	// user input is handled on the dispatcher thread, keep the protocol alive until then
+	addRef();
+	g_dispatcher.addTask(LotosPP::Common::createTask(boost::bind(&Telnet::parseUserInput, this, msg.GetRaw(), LatencyTracer::current()), LotosPP::Common::Task::CATEGORY_INPUT));
+}
+
+void Telnet::parseUserInput(const std::string& input, const LatencyTrace_ptr& trace)
+{
+	//dispatcher thread
+	unRef();
+	if (trace) {
+		trace->addSpan("dispatch", trace->getBegin(), LatencyTrace::now());
 		}
-	catch (enums::UserStage stg) {
-		switch (stg) {
-			case enums::UserStage_DISCONNECT:
-				user->disconnect();
-				[[fallthrough]];
-			case enums::UserStage_SWAPPED:
-				delete user;
-				user=nullptr;
-				return;
-			default:
-				LOG(LERROR) << "INTERNAL ERROR: Caught unexpected user_stage " << stg << "in parsePacket()";
-			}
+	LatencyTracer::Scope scope(trace);
+	if (user) {
+		user->uRead(input);
 		}
 }
 
@@ -2,6 +2,7 @@
 #define LOTOSPP_NETWORK_PROTOCOLS_TELNET_H
 
 #include "../Protocol.h"
+#include "../LatencyTrace.h"
 #include <boost/bind/bind.hpp>
 
 
@@ -58,6 +59,7 @@ private:
 	virtual void onRecvFirstMessage(NetworkMessage& msg);
 	bool parseFirstPacket(NetworkMessage& msg);
 	virtual void parsePacket(NetworkMessage& msg);
+	void parseUserInput(const std::string& input, const LatencyTrace_ptr& trace);
 
 	friend class LotosPP::Common::User;
 
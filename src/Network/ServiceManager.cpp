@@ -26,7 +26,9 @@ std::list<uint16_t> ServiceManager::getPorts() const
 {
 	list<uint16_t> ports{};
 	for (const auto& [f, s] : m_acceptors) {
-		ports.push_back(f);
+		if (f.type==Transport::TYPE_TCP) {
+			ports.push_back(f.port);
+			}
 		}
 	// Maps are ordered, so the elements are in order
 	//ports.sort();
@@ -51,6 +53,18 @@ void ServiceManager::run()
 		}
 }
 
+std::size_t ServiceManager::poll()
+{
+	try {
+		m_io_service.restart();
+		return m_io_service.poll();
+		}
+	catch (boost::system::system_error& e) {
+		LOG(LERROR) << e.what();
+		}
+	return 0;
+}
+
 void ServiceManager::stop()
 {
 	if (!running) {
@@ -76,16 +90,16 @@ void ServiceManager::stop()
 	death_timer.async_wait(boost::bind(&ServiceManager::die, this));
 }
 
-bool ServiceManager::remove(uint16_t port)
+bool ServiceManager::remove(const ServiceAddress& address)
 {
-	if (!port) {
-		cout << "NOTICE: No port provided for service remove. Service not removed." << endl;
+	if (!address.isValid()) {
+		cout << "NOTICE: No address provided for service remove. Service not removed." << endl;
 		return false;
 		}
 
-	map<uint16_t, ServicePort_ptr>::iterator finder=m_acceptors.find(port);
+	map<ServiceAddress, ServicePort_ptr>::iterator finder=m_acceptors.find(address);
 	if (finder==m_acceptors.end()) {
-		cout << "ERROR: " << "No service found for port " << port;
+		cout << "ERROR: " << "No service found for " << address.toString();
 		return false;
 		}
 	ServicePort_ptr service_port=finder->second;
@@ -94,3 +108,12 @@ bool ServiceManager::remove(uint16_t port)
 	delete service_port.get();
 	return true;
 }
+
+Pipe_ptr ServiceManager::connectPipe(const std::string& name)
+{
+	map<ServiceAddress, ServicePort_ptr>::iterator finder=m_acceptors.find(ServiceAddress(Transport::TYPE_PIPE, name));
+	if (finder==m_acceptors.end()) {
+		return Pipe_ptr();
+		}
+	return finder->second->connectPipe();
+}
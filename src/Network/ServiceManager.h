@@ -24,12 +24,24 @@ public:
 	// Run and start all servers
 	void run();
 	void stop();
-
-	// Adds a new service to be managed
+	/**
+	 * Runs the handlers that are ready and returns, for a simulation driving the io_service from its own loop
+	 *
+	 * @return how many ran
+	 */
+	std::size_t poll();
+
+	// Adds a new service to be managed, on a TCP port, a Unix-domain socket or a pipe
 	template <typename ProtocolType>
-	bool add(uint16_t port);
+	bool add(const ServiceAddress& address);
 	// Remove service
-	bool remove(uint16_t port);
+	bool remove(const ServiceAddress& address);
+	/**
+	 * Connects a client in the process to the pipe service name
+	 *
+	 * @return the client end, nullptr when there is no such service
+	 */
+	Pipe_ptr connectPipe(const std::string& name);
 
 	bool isRunning() const
 	{
@@ -39,7 +51,7 @@ public:
 protected:
 	void die();
 
-	std::map<uint16_t, ServicePort_ptr> m_acceptors{};
+	std::map<ServiceAddress, ServicePort_ptr> m_acceptors{};
 
 	boost::asio::io_service m_io_service;
 	boost::asio::deadline_timer death_timer;
@@ -48,27 +60,27 @@ protected:
 
 
 template <typename ProtocolType>
-bool ServiceManager::add(uint16_t port)
+bool ServiceManager::add(const ServiceAddress& address)
 {
-	if (!port) {
-		std::cout << "NOTICE: No port provided for service " << ProtocolType::protocolName() << ". Service disabled." << std::endl;
+	if (!address.isValid()) {
+		std::cout << "NOTICE: No address provided for service " << ProtocolType::protocolName() << ". Service disabled." << std::endl;
 		return false;
 		}
 
-	std::map<uint16_t, ServicePort_ptr>::iterator finder=m_acceptors.find(port);
+	std::map<ServiceAddress, ServicePort_ptr>::iterator finder=m_acceptors.find(address);
 
 	ServicePort_ptr service_port{nullptr};
 	if (finder==m_acceptors.end()) {
 		service_port.reset(new ServicePort(m_io_service));
-		service_port->open(port);
-		m_acceptors[port]=service_port;
+		service_port->open(address);
+		m_acceptors[address]=service_port;
 		}
 	else {
 		service_port=finder->second;
 		if (service_port->isSingleSocket() || ProtocolType::server_sends_first) {
 			std::cout << "ERROR: " << ProtocolType::protocolName()
 				<< " and " << service_port->getProtocolNames()
-				<< " cannot use the same port " << port << "." << std::endl;
+				<< " cannot use the same " << address.toString() << "." << std::endl;
 			return false;
 			}
 		}
@@ -2,14 +2,18 @@
 #include "ServiceBase.h"
 #include "Connection.h"
 #include "ConnectionManager.h"
-#include "Log/Logger.h"
+#include "Common/FlightRecorder.h"
+#include "Common/Probe.h"
+#include "Log/LogSite.h"
 #include "globals.h"
 #include "System/build_config.h"
 #include <boost/bind/bind.hpp>
 #include <boost/asio/placeholders.hpp>
 #include <boost/asio/ip/v6_only.hpp>
-#if defined(__DEBUG_NET__) || defined(__DEBUG_NET_DETAIL__)
-#	include <iostream>
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+#	include <boost/asio/local/stream_protocol.hpp>
+#	include <sys/stat.h>
+#	include <unistd.h>
 #endif
 #ifdef OS_WIN
 #	include <winerror.h>
@@ -20,11 +24,54 @@ using namespace LotosPP::Network;
 using namespace std;
 
 
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+/**
+ * Removes a socket file left by a previous run
+ *
+ * Anything else at path stays, and so does the socket of a server still accepting on it; binding fails then.
+ */
+static void removeStaleSocket(boost::asio::io_service& io_service, const std::string& path)
+{
+	struct stat st;
+	if (::lstat(path.c_str(), &st)) {
+		return;
+		}
+	if (!S_ISSOCK(st.st_mode)) {
+		LOGC(LERROR, "net") << path << " is not a socket, not removing it";
+		return;
+		}
+	boost::asio::local::stream_protocol::socket probe(io_service);
+	boost::system::error_code error;
+	probe.connect(boost::asio::local::stream_protocol::endpoint(path), error);
+	if (!error) {
+		LOGC(LERROR, "net") << path << " is in use by a running server, not removing it";
+		return;
+		}
+	::unlink(path.c_str());
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// ServiceAddress
+
+std::string ServiceAddress::toString() const
+{
+	switch (type) {
+		case Transport::TYPE_TCP:
+			return "port "+to_string(port);
+		case Transport::TYPE_UNIX:
+			return "unix:"+path;
+		case Transport::TYPE_PIPE:
+			return "pipe:"+path;
+		}
+	return "";
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // ServicePort
 
 ServicePort::ServicePort(boost::asio::io_service& io_service)
-	: m_io_service{io_service}, m_serverPort{0}, m_pendingStart{false}
+	: m_io_service{io_service}, m_address{0}, m_pendingStart{false}
 {
 }
 
@@ -68,20 +115,15 @@ void ServicePort::accept(Acceptor_ptr acceptor)
 			);
 		}
 	catch (boost::system::system_error& e) {
-		if (m_logError) {
-			LOG(LERROR) << e.what();
-			m_logError=false;
-            }
-        }
+		LOGC(LERROR, "net") << e.what();
+		}
 }
 
 void ServicePort::onAccept(Acceptor_ptr acceptor, boost::asio::ip::tcp::socket* socket, const boost::system::error_code& error)
 {
 	if (!error) {
 		if (m_services.empty()) {
-#ifdef __DEBUG_NET__
-			cout << "Error: [ServerPort::accept] No services running!" << endl;
-#endif
+			LOGC(LTRACE, "net") << "Error: [ServerPort::accept] No services running!";
 			return;
 		}
 
@@ -93,15 +135,7 @@ void ServicePort::onAccept(Acceptor_ptr acceptor, boost::asio::ip::tcp::socket*
 			}
 
 		if (!remote_ip.is_unspecified()) {
-			Connection_ptr connection=ConnectionManager::getInstance()->createConnection(socket, m_io_service, shared_from_this());
-
-			if (m_services.front()->isSingleSocket()) {
-				// Only one handler, and it will send first
-				connection->acceptConnection(m_services.front()->makeProtocol(connection));
-				}
-			else {
-				connection->acceptConnection();
-				}
+			acceptTransport(new TcpTransport(socket));
 			}
 		else {
 			//close the socket
@@ -113,35 +147,108 @@ void ServicePort::onAccept(Acceptor_ptr acceptor, boost::asio::ip::tcp::socket*
 				}
 			}
 
-#ifdef __DEBUG_NET_DETAIL__
-		cout << "accept - OK" << endl;
-#endif
+		LOGC(LTRACE, "net.detail") << "accept - OK";
 		accept(acceptor);
 		}
 	else {
 		if (error!=boost::asio::error::operation_aborted) {
-			close();
-
-			if (!m_pendingStart) {
-				m_pendingStart=true;
-				g_scheduler.addEvent(LotosPP::Common::createSchedulerTask(
-						5000,
-						boost::bind(
-							&ServicePort::openAcceptor,
-							boost::weak_ptr<ServicePort>(shared_from_this()),
-							m_serverPort
-							)
-					));
-				}
+			LOGC(LERROR, "net") << "Accept on " << m_address.toString() << " failed: " << error.message();
+			retryOpen();
 			}
 		else {
-#ifdef __DEBUG_NET__
-			cout << "Error: [ServerPort::onAccept] Operation aborted." << endl;
-#endif
+			LOGC(LTRACE, "net") << "Error: [ServerPort::onAccept] Operation aborted.";
 			}
 		}
 }
 
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+void ServicePort::acceptUnix(UnixAcceptor_ptr acceptor)
+{
+	try {
+		boost::asio::local::stream_protocol::socket* socket=new boost::asio::local::stream_protocol::socket(m_io_service);
+
+		acceptor->async_accept(
+			*socket,
+			boost::bind(
+				&ServicePort::onAcceptUnix,
+				this,
+				acceptor,
+				socket,
+				boost::asio::placeholders::error
+				)
+			);
+		}
+	catch (boost::system::system_error& e) {
+		LOGC(LERROR, "net") << e.what();
+		}
+}
+
+void ServicePort::onAcceptUnix(UnixAcceptor_ptr acceptor, boost::asio::local::stream_protocol::socket* socket, const boost::system::error_code& error)
+{
+	if (!error) {
+		if (m_services.empty()) {
+			LOGC(LTRACE, "net") << "Error: [ServerPort::acceptUnix] No services running!";
+			return;
+			}
+		// the peer is on this host, it has no address to check
+		acceptTransport(new UnixTransport(socket));
+		acceptUnix(acceptor);
+		}
+	else {
+		delete socket;
+		if (error!=boost::asio::error::operation_aborted) {
+			LOGC(LERROR, "net") << "Accept on " << m_address.toString() << " failed: " << error.message();
+			retryOpen();
+			}
+		}
+}
+#endif
+
+Pipe_ptr ServicePort::connectPipe()
+{
+	if (m_address.type!=Transport::TYPE_PIPE || m_services.empty()) {
+		return Pipe_ptr();
+		}
+	Pipe_ptr pipe(new Pipe(m_io_service));
+	acceptTransport(new PipeTransport(pipe));
+	return pipe;
+}
+
+void ServicePort::acceptTransport(Transport* transport)
+{
+	Connection_ptr connection=ConnectionManager::getInstance()->createConnection(transport, m_io_service, shared_from_this());
+	boost::asio::ip::address remote_ip=transport->getAddress();
+	uint32_t remote_ipv4{remote_ip.is_v4() ? remote_ip.to_v4().to_uint() : 0};
+	LotosPP::Common::FlightRecorder::instance()->record(LotosPP::Common::FlightRecorder::EVENT_CONNECTION_OPEN, (uintptr_t)connection.get(),
+		remote_ipv4, transport->getPort());
+	LOTOSPP_PROBE(connection__accept, (uintptr_t)connection.get(), remote_ipv4, transport->getPort());
+
+	if (m_services.front()->isSingleSocket()) {
+		// Only one handler, and it will send first
+		connection->acceptConnection(m_services.front()->makeProtocol(connection));
+		}
+	else {
+		connection->acceptConnection();
+		}
+}
+
+void ServicePort::retryOpen()
+{
+	close();
+
+	if (!m_pendingStart) {
+		m_pendingStart=true;
+		g_scheduler.addEvent(LotosPP::Common::createSchedulerTask(
+				5000,
+				boost::bind(
+					&ServicePort::openAcceptor,
+					boost::weak_ptr<ServicePort>(shared_from_this()),
+					m_address
+					)
+			));
+		}
+}
+
 Protocol* ServicePort::makeProtocol(NetworkMessage& msg) const
 {
 	for (Service_ptr service : m_services) {
@@ -157,52 +264,66 @@ void ServicePort::onStopServer()
 	close();
 }
 
-void ServicePort::openAcceptor(boost::weak_ptr<ServicePort> weak_service, uint16_t port)
+void ServicePort::openAcceptor(boost::weak_ptr<ServicePort> weak_service, const ServiceAddress& address)
 {
 	if (weak_service.expired()) {
 		return;
 		}
 
 	if (ServicePort_ptr service=weak_service.lock()) {
-#ifdef __DEBUG_NET_DETAIL__
-		cout << "ServicePort::openAcceptor" << endl;
-#endif
-		service->open(port);
+		LOGC(LTRACE, "net.detail") << "ServicePort::openAcceptor";
+		service->open(address);
 		}
 }
 
-void ServicePort::open(uint16_t port)
+void ServicePort::open(const ServiceAddress& address)
 {
 	namespace ip=boost::asio::ip;
 
-	m_serverPort=port;
+	m_address=address;
 	m_pendingStart=false;
 
 	try {
+		switch (m_address.type) {
+			case Transport::TYPE_TCP: {
 #ifdef ENABLE_IPV6
-		ip::v6_only v6_only;
-		boost::system::error_code ec;
-		Acceptor_ptr aptr(new ip::tcp::acceptor(m_io_service, ip::tcp::endpoint(ip::address_v6(), m_serverPort)));
-		aptr->set_option(v6_only, ec);
-		aptr->set_option(ip::tcp::no_delay(true));
-		aptr->get_option(v6_only);
-		accept(aptr);
-		m_tcp_acceptors.push_back(aptr);
-		if (!aptr->is_open() || v6_only) {
+				ip::v6_only v6_only;
+				boost::system::error_code ec;
+				Acceptor_ptr aptr(new ip::tcp::acceptor(m_io_service, ip::tcp::endpoint(ip::address_v6(), m_address.port)));
+				aptr->set_option(v6_only, ec);
+				aptr->set_option(ip::tcp::no_delay(true));
+				aptr->get_option(v6_only);
+				accept(aptr);
+				m_tcp_acceptors.push_back(aptr);
+				if (!aptr->is_open() || v6_only) {
 #endif
-			Acceptor_ptr aptr(new ip::tcp::acceptor(m_io_service, ip::tcp::endpoint(ip::address(), m_serverPort)));
-			aptr->set_option(ip::tcp::no_delay(true));
-			accept(aptr);
-			m_tcp_acceptors.push_back(aptr);
+					Acceptor_ptr aptr(new ip::tcp::acceptor(m_io_service, ip::tcp::endpoint(ip::address(), m_address.port)));
+					aptr->set_option(ip::tcp::no_delay(true));
+					accept(aptr);
+					m_tcp_acceptors.push_back(aptr);
 #ifdef ENABLE_IPV6
-			}
+					}
 #endif
+				break;
+				}
+			case Transport::TYPE_UNIX:
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+				// a socket file left by a previous run would fail the bind
+				removeStaleSocket(m_io_service, m_address.path);
+				m_unix_acceptor.reset(new boost::asio::local::stream_protocol::acceptor(m_io_service,
+					boost::asio::local::stream_protocol::endpoint(m_address.path)));
+				acceptUnix(m_unix_acceptor);
+#else
+				LOGC(LERROR, "net") << "Unix-domain sockets are not supported, " << m_address.toString() << " disabled";
+#endif
+				break;
+			case Transport::TYPE_PIPE:
+				// nothing to listen on, connectPipe() makes the connections
+				break;
+			}
 		}
 	catch (boost::system::system_error& e) {
-		if (m_logError) {
-			LOG(LERROR) << e.what();
-			m_logError=false;
-			}
+		LOGC(LERROR, "net") << e.what();
 
 		m_pendingStart=true;
 		g_scheduler.addEvent(LotosPP::Common::createSchedulerTask(
@@ -210,7 +331,7 @@ void ServicePort::open(uint16_t port)
 				boost::bind(
 					&ServicePort::openAcceptor,
 					boost::weak_ptr<ServicePort>(shared_from_this()),
-					port
+					address
 					)
 				));
 		}
@@ -228,6 +349,23 @@ void ServicePort::close()
 			}
 		}
 	m_tcp_acceptors.clear();
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+	if (m_unix_acceptor) {
+		if (m_unix_acceptor->is_open()) {
+			boost::system::error_code error;
+			m_unix_acceptor->close(error);
+			if (error) {
+				PRINT_ASIO_ERROR("Closing listen socket");
+				}
+			// ours unless someone replaced it meanwhile
+			struct stat st;
+			if (!::lstat(m_address.path.c_str(), &st) && S_ISSOCK(st.st_mode)) {
+				::unlink(m_address.path.c_str());
+				}
+			}
+		m_unix_acceptor.reset();
+		}
+#endif
 }
 
 bool ServicePort::addService(Service_ptr new_svc)
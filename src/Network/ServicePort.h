@@ -1,10 +1,15 @@
 #ifndef LOTOSPP_NETWORK_SERVICEPORT_H
 #define LOTOSPP_NETWORK_SERVICEPORT_H
 
+#include "Pipe.h"
+#include "Transport.h"
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/core/noncopyable.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/io_service.hpp>
+#include <string>
+#include <tuple>
+#include <vector>
 
 
 namespace LotosPP::Network {
@@ -14,6 +19,35 @@ namespace LotosPP::Network {
 	typedef boost::shared_ptr<ServiceBase> Service_ptr;
 
 typedef boost::shared_ptr<boost::asio::ip::tcp::acceptor> Acceptor_ptr;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+typedef boost::shared_ptr<boost::asio::local::stream_protocol::acceptor> UnixAcceptor_ptr;
+#endif
+
+/**
+ * Where a service port listens: a TCP port, the path of a Unix-domain socket or the name of an in-memory pipe
+ */
+struct ServiceAddress {
+	ServiceAddress(uint16_t p)
+		: type{Transport::TYPE_TCP}, port{p}
+	{};
+	ServiceAddress(Transport::Type t, const std::string& p)
+		: type{t}, path{p}
+	{};
+
+	bool operator<(const ServiceAddress& other) const
+	{
+		return std::tie(type, port, path)<std::tie(other.type, other.port, other.path);
+	};
+	bool isValid() const
+	{
+		return type==Transport::TYPE_TCP ? port!=0 : !path.empty();
+	};
+	std::string toString() const;
+
+	Transport::Type type;
+	uint16_t port{0};
+	std::string path{};
+};
 
 /**
  * A Service Port represents a listener on a port
@@ -29,8 +63,8 @@ public:
 	ServicePort(boost::asio::io_service& io_service);
 	~ServicePort();
 
-	static void openAcceptor(boost::weak_ptr<ServicePort> weak_service, uint16_t port);
-	void open(uint16_t port);
+	static void openAcceptor(boost::weak_ptr<ServicePort> weak_service, const ServiceAddress& address);
+	void open(const ServiceAddress& address);
 	void close();
 	bool isSingleSocket() const;
 	std::string getProtocolNames() const;
@@ -40,17 +74,33 @@ public:
 
 	void onStopServer();
 	void onAccept(Acceptor_ptr acceptor, boost::asio::ip::tcp::socket* socket, const boost::system::error_code& error);
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+	void onAcceptUnix(UnixAcceptor_ptr acceptor, boost::asio::local::stream_protocol::socket* socket, const boost::system::error_code& error);
+#endif
+	/**
+	 * Connects a client in the process through a pipe, as if it had connected to a socket of this port
+	 *
+	 * @return the client end, nullptr unless the port is a pipe one
+	 */
+	Pipe_ptr connectPipe();
 
 protected:
 	void accept(Acceptor_ptr acceptor);
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+	void acceptUnix(UnixAcceptor_ptr acceptor);
+#endif
+	void acceptTransport(Transport* transport);
+	void retryOpen();
 
 	boost::asio::io_service& m_io_service;
 	std::vector<Acceptor_ptr> m_tcp_acceptors{};
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+	UnixAcceptor_ptr m_unix_acceptor{};
+#endif
 	std::vector<Service_ptr> m_services{};
 
-	uint16_t m_serverPort{0};
+	ServiceAddress m_address{0};
 	bool m_pendingStart{false};
-	static inline bool m_logError{true};
 };
 
 typedef boost::shared_ptr<ServicePort> ServicePort_ptr;
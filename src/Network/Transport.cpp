@@ -0,0 +1,26 @@
+#include "Transport.h"
+
+
+using namespace LotosPP::Network;
+
+
+boost::asio::ip::address TcpTransport::getAddress() const
+{
+	//Ip is expressed in network byte order
+	boost::system::error_code error;
+	const boost::asio::ip::tcp::endpoint endpoint=m_socket->remote_endpoint(error);
+	if (!error) {
+		return endpoint.address();
+		}
+	return boost::asio::ip::address();
+}
+
+uint16_t TcpTransport::getPort() const
+{
+	boost::system::error_code error;
+	const boost::asio::ip::tcp::endpoint endpoint=m_socket->remote_endpoint(error);
+	if (!error) {
+		return endpoint.port();
+		}
+	return 0;
+}
@@ -0,0 +1,137 @@
+#ifndef LOTOSPP_NETWORK_TRANSPORT_H
+#define LOTOSPP_NETWORK_TRANSPORT_H
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/core/noncopyable.hpp>
+#include <boost/function.hpp>
+#include <string>
+
+
+namespace LotosPP::Network {
+
+/**
+ * The byte stream under a Connection
+ *
+ * Reads complete on the io_service of the connection, writes block as they did on the socket. Whoever creates
+ * a transport gives it to the Connection, which deletes it when it stops.
+ */
+class Transport
+	: boost::noncopyable
+{
+public:
+	enum Type {
+		TYPE_TCP,
+		TYPE_UNIX,
+		TYPE_PIPE
+		};
+
+	typedef boost::function<void (const boost::system::error_code&, std::size_t)> ReadHandler;
+
+	virtual ~Transport()
+	{};
+
+	virtual Type getType() const =0;
+
+	virtual void asyncReadSome(boost::asio::mutable_buffer buffer, const ReadHandler& handler) =0;
+	virtual std::size_t write(boost::asio::const_buffer buffer, boost::system::error_code& ec) =0;
+
+	virtual bool isOpen() const =0;
+	virtual void shutdown(boost::system::error_code& ec) =0;
+	virtual void close(boost::system::error_code& ec) =0;
+
+	/**
+	 * @return address of the peer, unspecified when the transport has none
+	 */
+	virtual boost::asio::ip::address getAddress() const
+	{
+		return boost::asio::ip::address();
+	};
+	virtual uint16_t getPort() const
+	{
+		return 0;
+	};
+};
+
+/**
+ * A transport over an asio stream socket, which it owns
+ */
+template <typename Socket>
+class SocketTransport
+	: public Transport
+{
+public:
+	SocketTransport(Socket* socket)
+		: m_socket{socket}
+	{};
+	~SocketTransport()
+	{
+		delete m_socket;
+	};
+
+	void asyncReadSome(boost::asio::mutable_buffer buffer, const ReadHandler& handler)
+	{
+		m_socket->async_read_some(buffer, handler);
+	};
+	std::size_t write(boost::asio::const_buffer buffer, boost::system::error_code& ec)
+	{
+		return boost::asio::write(*m_socket, buffer, ec);
+	};
+
+	bool isOpen() const
+	{
+		return m_socket->is_open();
+	};
+	void shutdown(boost::system::error_code& ec)
+	{
+		m_socket->shutdown(Socket::shutdown_both, ec);
+	};
+	void close(boost::system::error_code& ec)
+	{
+		m_socket->close(ec);
+	};
+
+protected:
+	Socket* m_socket;
+};
+
+class TcpTransport
+	: public SocketTransport<boost::asio::ip::tcp::socket>
+{
+public:
+	TcpTransport(boost::asio::ip::tcp::socket* socket)
+		: SocketTransport(socket)
+	{};
+
+	Type getType() const
+	{
+		return TYPE_TCP;
+	};
+	boost::asio::ip::address getAddress() const;
+	uint16_t getPort() const;
+};
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+/**
+ * Unix-domain stream socket, for a proxy on the same host without the loopback TCP stack
+ */
+class UnixTransport
+	: public SocketTransport<boost::asio::local::stream_protocol::socket>
+{
+public:
+	UnixTransport(boost::asio::local::stream_protocol::socket* socket)
+		: SocketTransport(socket)
+	{};
+
+	Type getType() const
+	{
+		return TYPE_UNIX;
+	};
+};
+#endif
+
+	}
+
+#endif
@@ -0,0 +1,30 @@
+#include "DesCrypt.h"
+#include <crypt.h>
+#include <memory>
+
+
+using namespace LotosPP::Security;
+
+bool DesCrypt::isHash(const std::string& hash)
+{
+	if (hash.length()!=13) {
+		return false;
+		}
+	for (char c : hash) {
+		if (!isalnum((unsigned char)c) && c!='.' && c!='/') {
+			return false;
+			}
+		}
+	return true;
+}
+
+bool DesCrypt::verify(const std::string& password, const std::string& hash)
+{
+	if (!isHash(hash)) {
+		return false;
+		}
+	// too large for the stack of a pool thread, crypt() itself isn't reentrant
+	std::unique_ptr<crypt_data> data{new crypt_data()};
+	const char* out=crypt_r(password.c_str(), hash.c_str(), data.get());
+	return out && hash==out;
+}
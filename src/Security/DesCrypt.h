@@ -0,0 +1,29 @@
+#ifndef LOTOSPP_SECURITY_DESCRYPT_H
+#define LOTOSPP_SECURITY_DESCRYPT_H
+
+#include <string>
+
+
+namespace LotosPP::Security {
+
+/**
+ * Traditional DES crypt(3) hashes, as NUTS user files store them
+ *
+ * Only verified, never created, a matching password is rehashed with Blowfish.
+ */
+class DesCrypt
+{
+public:
+	/**
+	 * @return true if hash looks like a DES crypt() result, 2 salt and 11 hash characters of [./0-9A-Za-z]
+	 */
+	static bool isHash(const std::string& hash);
+	/**
+	 * @return true if password matches hash, DES only looks at the first 8 characters of it
+	 */
+	static bool verify(const std::string& password, const std::string& hash);
+};
+
+	}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef LOTOSPP_STRINGS_STRINGFORMAT_H
+#define	LOTOSPP_STRINGS_STRINGFORMAT_H
+
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+
+namespace LotosPP::Strings {
+
+/**
+ * Convert all std::strings to const char* using constexpr if (C++17)
+ */
+template<typename T>
+auto convert(T&& t)
+{
+	if constexpr (std::is_same<std::remove_cv_t<std::remove_reference_t<T>>, std::string>::value) {
+		return std::forward<T>(t).c_str();
+		}
+	return std::forward<T>(t);
+}
+/**
+ * printf like formatting for C++ with std::string
+ * Original source: https://stackoverflow.com/a/26221725/11722
+ */
+template<typename ... Args>
+std::string stringFormat(const std::string& format, Args&& ... args)
+{
+	size_t size=snprintf(nullptr, 0, format.c_str(), std::forward<Args>(args) ...)+1;
+	if (size<=0) {
+		throw std::runtime_error("Error during formatting.");
+		}
+	std::unique_ptr<char[]> buf(new char[size]);
+	snprintf(buf.get(), size, format.c_str(), args ...);
+	return std::string(buf.get(), buf.get()+size-1);
+}
+
+	}
+
+#endif
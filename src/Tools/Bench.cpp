@@ -0,0 +1,312 @@
+/* vi: set ts=4 sw=4 ai: */
+/**
+ * lotospp-bench, microbenchmarks of the hot paths of the server
+ *
+ * Google Benchmark, the usual --benchmark_* options apply. Besides the table on stdout the results are written as
+ * JSON to lotospp-bench-<version>.json, unless --benchmark_out names another file; compare two of them with
+ * compare.py of Google Benchmark to find regressions between releases.
+ */
+#define MAINFILE
+#include "Lotospp/buildinfo.h"
+#include "globals.h"
+#include "Common/AutoID.h"
+#include "Common/User.h"
+#include "Common/Enums/UserLevel.h"
+#include "Network/Connection.h"
+#include "Network/NetworkMessage.h"
+#include "Network/OutputMessage.h"
+#include "Network/Pipe.h"
+#include "Network/Protocol.h"
+#include "Security/Blowfish.h"
+#include "Strings/Splitline.h"
+#include "Strings/misc.h"
+#include "Strings/stringFormat.h"
+#include <benchmark/benchmark.h>
+#include <boost/asio/io_service.hpp>
+#include <boost/thread/thread.hpp>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+using namespace LotosPP;
+using namespace std;
+
+
+namespace {
+
+const string LINE{".say the quick brown fox \"jumps over\" the lazy dog"};
+
+/**
+ * A protocol for the pooled output messages, it never gets a packet
+ */
+class BenchProtocol
+	: public Network::Protocol
+{
+public:
+	BenchProtocol(Network::Connection_ptr connection)
+		: Protocol(connection)
+	{};
+
+	void parsePacket(Network::NetworkMessage& msg)
+	{};
+	void onRecvFirstMessage(Network::NetworkMessage& msg)
+	{};
+};
+
+boost::asio::io_service ioService;
+Network::Connection_ptr connection;
+BenchProtocol* protocol{nullptr};
+
+/**
+ * Waits for the dispatcher to catch up, the tasks and the releases of messages run there
+ */
+template<typename Done>
+void waitFor(Done done)
+{
+	while (!done()) {
+		boost::this_thread::yield();
+		}
+}
+
+	}
+
+
+static void BM_NetworkMessageAdd(benchmark::State& state)
+{
+	Network::NetworkMessage msg;
+	for (auto _ : state) {
+		msg.setMessageLength(0);
+		msg.setReadPos(0);
+		msg.AddByte(0xFF)->AddU16(4000)->AddU32(0xDEADBEEF)->AddU64(1)->AddString(LINE);
+		benchmark::DoNotOptimize(msg.getBuffer());
+		}
+	state.SetBytesProcessed(state.iterations()*(1+2+4+8+LINE.length()));
+}
+BENCHMARK(BM_NetworkMessageAdd);
+
+static void BM_NetworkMessageGet(benchmark::State& state)
+{
+	Network::NetworkMessage msg;
+	msg.AddByte(0xFF)->AddU16(4000)->AddU32(0xDEADBEEF)->AddU64(1)->AddString(LINE);
+	for (auto _ : state) {
+		msg.setReadPos(0);
+		benchmark::DoNotOptimize(msg.GetByte());
+		benchmark::DoNotOptimize(msg.GetU16());
+		benchmark::DoNotOptimize(msg.GetU32());
+		benchmark::DoNotOptimize(msg.GetU64());
+		benchmark::DoNotOptimize(msg.GetString());
+		}
+	state.SetBytesProcessed(state.iterations()*msg.getMessageLength());
+}
+BENCHMARK(BM_NetworkMessageGet);
+
+/**
+ * A batch of messages taken from the pool and given back, until the dispatcher has returned them all
+ */
+static void BM_OutputMessagePool(benchmark::State& state)
+{
+	Network::OutputMessagePool* pool{Network::OutputMessagePool::getInstance()};
+	size_t batch=state.range(0);
+	vector<Network::OutputMessage_ptr> messages;
+	messages.reserve(batch);
+	for (auto _ : state) {
+		size_t available{pool->getAvailableMessageCount()};
+		for (size_t i=0; i<batch; ++i) {
+			messages.push_back(pool->getOutputMessage(protocol, false));
+			messages.back()->AddString(LINE);
+			}
+		messages.clear();
+		waitFor([pool, available] {
+				return pool->getAvailableMessageCount()>=available;
+			});
+		}
+	state.SetItemsProcessed(state.iterations()*batch);
+}
+BENCHMARK(BM_OutputMessagePool)->Arg(1)->Arg(64)->UseRealTime();
+
+static void BM_StringFormat(benchmark::State& state)
+{
+	string name{"Lopo"}, text{LINE.substr(5)};
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(Strings::stringFormat("%s say: %s\n", name.c_str(), text.c_str()));
+		}
+}
+BENCHMARK(BM_StringFormat);
+
+/**
+ * Formatting and escaping of the text for a user, without a connection to write to
+ */
+static void BM_UserPrintf(benchmark::State& state)
+{
+	Common::User user{"Lopo"};
+	string text{LINE.substr(5)};
+	for (auto _ : state) {
+		user.uPrintf("%s say: %s\n", user.getName().c_str(), text.c_str());
+		}
+}
+BENCHMARK(BM_UserPrintf);
+
+static void BM_SplitlineParse(benchmark::State& state)
+{
+	Strings::Splitline com;
+	for (auto _ : state) {
+		com.parse(LINE);
+		benchmark::DoNotOptimize(com.word.size());
+		}
+	state.SetBytesProcessed(state.iterations()*LINE.length());
+}
+BENCHMARK(BM_SplitlineParse);
+
+static void BM_CleanString(benchmark::State& state)
+{
+	const string dirty{"100% of \"the\" quick\tbrown\x07 fox %s jumps\r\n over %% the lazy dog"};
+	for (auto _ : state) {
+		string str{dirty};
+		Strings::cleanString(str);
+		benchmark::DoNotOptimize(str.data());
+		}
+	state.SetBytesProcessed(state.iterations()*dirty.length());
+}
+BENCHMARK(BM_CleanString);
+
+/**
+ * Hash of a password at the cost given, 10 is what new accounts get
+ */
+static void BM_BlowfishCrypt(benchmark::State& state)
+{
+	char setting[32];
+	snprintf(setting, sizeof(setting), "$2y$%02d$abcdefghijklmnopqrstuv", (int)state.range(0));
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(Security::Blowfish::crypt("secret password", setting));
+		}
+}
+BENCHMARK(BM_BlowfishCrypt)->Arg(4)->Arg(10)->Unit(benchmark::kMillisecond);
+
+static void BM_EnumToString(benchmark::State& state)
+{
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(Common::UserLevel::toString(Common::UserLevel_ADMIN));
+		}
+}
+BENCHMARK(BM_EnumToString);
+
+static void BM_EnumFromString(benchmark::State& state)
+{
+	string name{Common::UserLevel::toString(Common::UserLevel_ADMIN)};
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(Common::UserLevel::fromString(name));
+		}
+}
+BENCHMARK(BM_EnumFromString);
+
+/**
+ * An id taken and given back, with as many others in use as the argument
+ */
+static void BM_AutoID(benchmark::State& state)
+{
+	vector<unique_ptr<Common::AutoID>> live;
+	for (int64_t i=0; i<state.range(0); ++i) {
+		live.emplace_back(new Common::AutoID());
+		}
+	for (auto _ : state) {
+		Common::AutoID id;
+		benchmark::DoNotOptimize(id.auto_id);
+		}
+}
+BENCHMARK(BM_AutoID)->Arg(0)->Arg(10000);
+
+/**
+ * A batch of tasks through the dispatcher thread
+ */
+static void BM_Dispatcher(benchmark::State& state)
+{
+	size_t batch=state.range(0);
+	atomic<size_t> done{0};
+	size_t expected{0};
+	for (auto _ : state) {
+		expected+=batch;
+		for (size_t i=0; i<batch; ++i) {
+			g_dispatcher.addTask(Common::createTask([&done] {
+					done.fetch_add(1, memory_order_relaxed);
+				}));
+			}
+		waitFor([&done, expected] {
+				return done.load(memory_order_relaxed)==expected;
+			});
+		}
+	state.SetItemsProcessed(state.iterations()*batch);
+}
+BENCHMARK(BM_Dispatcher)->Arg(1)->Arg(1000)->UseRealTime();
+
+/**
+ * An event added to the scheduler and stopped before it fires
+ */
+static void BM_SchedulerAddStop(benchmark::State& state)
+{
+	for (auto _ : state) {
+		uint32_t id{g_scheduler.addEvent(Common::createSchedulerTask(Common::SchedulerTask::SCHEDULER_MINTICKS, [] {}))};
+		g_scheduler.stopEvent(id);
+		}
+}
+BENCHMARK(BM_SchedulerAddStop);
+
+/**
+ * A batch of events due together, from the scheduler through the dispatcher, SCHEDULER_MINTICKS ms of it waiting
+ */
+static void BM_SchedulerFire(benchmark::State& state)
+{
+	size_t batch=state.range(0);
+	atomic<size_t> done{0};
+	size_t expected{0};
+	for (auto _ : state) {
+		expected+=batch;
+		for (size_t i=0; i<batch; ++i) {
+			g_scheduler.addEvent(Common::createSchedulerTask(Common::SchedulerTask::SCHEDULER_MINTICKS, [&done] {
+					done.fetch_add(1, memory_order_relaxed);
+				}));
+			}
+		waitFor([&done, expected] {
+				return done.load(memory_order_relaxed)==expected;
+			});
+		}
+	state.SetItemsProcessed(state.iterations()*batch);
+}
+BENCHMARK(BM_SchedulerFire)->Arg(1000)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+
+int main(int argc, char** argv)
+{
+	// JSON next to the console output, unless asked otherwise
+	vector<char*> args(argv, argv+argc);
+	string out{string("--benchmark_out=lotospp-bench-")+Lotospp_get_buildinfo()->project_version+".json"};
+	string format{"--benchmark_out_format=json"};
+	bool hasOut{false};
+	for (int i=1; i<argc; ++i) {
+		hasOut|= !strncmp(argv[i], "--benchmark_out=", 16);
+		}
+	if (!hasOut) {
+		args.push_back(out.data());
+		args.push_back(format.data());
+		}
+	int count=args.size();
+	benchmark::Initialize(&count, args.data());
+	if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+		return 1;
+		}
+
+	g_dispatcher.start();
+	g_scheduler.start();
+	Network::OutputMessagePool::getInstance()->startExecutionFrame();
+	connection.reset(new Network::Connection(new Network::PipeTransport(Network::Pipe_ptr(new Network::Pipe(ioService))), ioService, Network::ServicePort_ptr()));
+	protocol=new BenchProtocol(connection);
+
+	benchmark::RunSpecifiedBenchmarks();
+
+	g_scheduler.shutdownAndWait();
+	g_dispatcher.shutdownAndWait();
+	return 0;
+}
@@ -0,0 +1,192 @@
+/* vi: set ts=4 sw=4 ai: */
+/**
+ * lotospp-flightdecode, prints the timeline of a flight recorder file
+ *
+ * Reads flight.rec (or flight.rec.prev after a restart) as the server left it, a crash included, and prints the
+ * recorded events in order. A task begun but never ended on its thread is the one that was running when it stopped.
+ */
+#include "Common/FlightRecorder.h"
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+
+using LotosPP::Common::FlightRecorder;
+using namespace std;
+
+
+struct Event {
+	uint64_t seq;
+	uint64_t time;
+	uint64_t a;
+	uint64_t b;
+	uint32_t thread;
+	uint16_t type;
+	uint16_t aux;
+};
+
+static string timeText(uint64_t ns)
+{
+	time_t seconds=ns/1000000000;
+	struct tm local;
+	char stamp[32], text[48];
+	strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime_r(&seconds, &local));
+	snprintf(text, sizeof(text), "%s.%09llu", stamp, (unsigned long long)(ns%1000000000));
+	return text;
+}
+
+static string addressText(uint64_t v4)
+{
+	if (!v4) {
+		return "IPv6";
+		}
+	char text[16];
+	snprintf(text, sizeof(text), "%u.%u.%u.%u", (uint32_t)(v4>>24)&0xff, (uint32_t)(v4>>16)&0xff, (uint32_t)(v4>>8)&0xff, (uint32_t)v4&0xff);
+	return text;
+}
+
+int main(int argc, char** argv)
+{
+	namespace po=boost::program_options;
+
+	string file;
+	uint64_t last;
+	po::options_description generic("Allowed options");
+	generic.add_options()
+		("help,h", "this help")
+		("last,n", po::value<uint64_t>(&last)->default_value(0), "only the last n events")
+		("file", po::value<string>(&file), "flight recorder file")
+		;
+	po::positional_options_description p;
+	p.add("file", 1);
+
+	po::variables_map vm;
+	try {
+		po::store(po::command_line_parser(argc, argv).options(generic).positional(p).run(), vm);
+		po::notify(vm);
+		}
+	catch (po::error& e) {
+		cerr << e.what() << endl;
+		return 1;
+		}
+	if (vm.count("help") || file.empty()) {
+		cout << "Usage: " << argv[0] << " [options] flight.rec" << endl << generic << endl;
+		return file.empty() ? 1 : 0;
+		}
+
+	ifstream in(file, ios::binary);
+	if (!in) {
+		cerr << file << ": can't open" << endl;
+		return 1;
+		}
+	string data{istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
+	FlightRecorder::Header header;
+	if (data.length()<sizeof(header) || memcmp(data.data(), FlightRecorder::MAGIC, sizeof(FlightRecorder::MAGIC))) {
+		cerr << file << ": not a flight recorder file" << endl;
+		return 1;
+		}
+	memcpy((void*)&header, data.data(), sizeof(header));
+	if (header.version!=FlightRecorder::VERSION || header.eventSize!=sizeof(FlightRecorder::Event)) {
+		cerr << file << ": version " << header.version << ", not " << FlightRecorder::VERSION << endl;
+		return 1;
+		}
+	size_t namesOffset{(sizeof(FlightRecorder::Header)+63)&~(size_t)63};
+	size_t eventsOffset{namesOffset+FlightRecorder::NAME_SLOTS*FlightRecorder::NAME_LENGTH};
+	if (data.length()<eventsOffset+header.capacity*sizeof(FlightRecorder::Event)) {
+		cerr << file << ": truncated" << endl;
+		return 1;
+		}
+
+	uint32_t nameCount{min(header.names.load(), FlightRecorder::NAME_SLOTS)};
+	auto name=[&data, namesOffset, nameCount](uint16_t id) -> string {
+			if (!id || id>=nameCount) {
+				return "?";
+				}
+			const char* slot=data.data()+namesOffset+id*FlightRecorder::NAME_LENGTH;
+			return string(slot, strnlen(slot, FlightRecorder::NAME_LENGTH));
+		};
+
+	vector<Event> events;
+	for (uint64_t i=0; i<header.capacity; ++i) {
+		Event event;
+		memcpy(&event, data.data()+eventsOffset+i*sizeof(FlightRecorder::Event), sizeof(event));
+		// 0 was never written or was being written
+		if (event.seq) {
+			events.push_back(event);
+			}
+		}
+	sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+			return a.seq<b.seq;
+		});
+
+	time_t start=header.startTime;
+	cout << "pid " << header.pid << ", started " << ctime(&start)
+		<< header.next.load() << " events recorded, the last " << events.size() << " kept";
+	if (header.signal) {
+		cout << ", stopped by signal " << header.signal << " (" << strsignal(header.signal) << ")";
+		}
+	cout << "\n\n";
+
+	// the task each thread is in the middle of
+	map<uint32_t, uint64_t> running;
+	for (const Event& event : events) {
+		if (event.type==FlightRecorder::EVENT_TASK_BEGIN) {
+			running[event.thread]=event.seq;
+			}
+		else if (event.type==FlightRecorder::EVENT_TASK_END) {
+			running.erase(event.thread);
+			}
+		}
+
+	size_t first{last && last<events.size() ? events.size()-last : 0};
+	for (size_t i=first; i<events.size(); ++i) {
+		const Event& event=events[i];
+		string thread{"T"+to_string(event.thread)};
+		if (event.thread<FlightRecorder::THREAD_SLOTS && header.threads[event.thread]) {
+			thread+="/"+name(header.threads[event.thread]);
+			}
+		cout << timeText(event.time) << "  " << thread << "  ";
+		switch (event.type) {
+			case FlightRecorder::EVENT_START:
+				cout << "start";
+				break;
+			case FlightRecorder::EVENT_STOP:
+				cout << "stop";
+				break;
+			case FlightRecorder::EVENT_TASK_BEGIN:
+				cout << "task " << name(event.aux);
+				if (auto it=running.find(event.thread); it!=running.end() && it->second==event.seq) {
+					cout << "  <-- never ended";
+					}
+				break;
+			case FlightRecorder::EVENT_TASK_END:
+				cout << "task done in " << event.a/1000 << " us";
+				break;
+			case FlightRecorder::EVENT_SCHEDULER_FIRE:
+				cout << "scheduler event " << event.a << " " << name(event.aux);
+				break;
+			case FlightRecorder::EVENT_CONNECTION_OPEN:
+				cout << "connection 0x" << hex << event.a << dec << " from " << addressText(event.b) << ":" << event.aux;
+				break;
+			case FlightRecorder::EVENT_CONNECTION_CLOSE:
+				cout << "connection 0x" << hex << event.a << dec << " closing";
+				break;
+			case FlightRecorder::EVENT_SIGNAL:
+				cout << "signal " << event.a << " (" << strsignal(event.a) << ") at 0x" << hex << event.b << dec;
+				break;
+			default:
+				cout << "event " << event.type;
+				break;
+			}
+		cout << "\n";
+		}
+	return 0;
+}
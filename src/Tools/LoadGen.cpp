@@ -0,0 +1,629 @@
+/* vi: set ts=4 sw=4 ai: */
+/**
+ * lotospp-loadgen, simulates telnet users against a running server
+ *
+ * Opens --users sessions, --ramp ms apart. Each answers the option negotiation of Telnet::onConnect and logs in,
+ * creating its account on the first run. After that it repeats: wait an exponentially distributed think time, then
+ * say something, stay idle or reconnect, weighted by --mix. Said lines carry the time they were sent, so both the
+ * echo to the sender and the fan-out to every other session are measured.
+ *
+ * Reports the latencies of connecting, logging in, creating accounts, the echo and the fan-out as percentiles, and
+ * the throughput, as JSON on stdout or into --output, for comparing runs. Progress goes to stderr.
+ */
+#include "Common/Histogram.h"
+#include "Common/Enums/TelnetCmd.h"
+#include "Common/Enums/TelnetOpt.h"
+#include "Common/Enums/TelnetSub.h"
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/asio.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+using namespace LotosPP;
+using namespace std;
+namespace asio=boost::asio;
+namespace enums=LotosPP::Common::enums;
+
+
+static uint64_t nowMicros()
+{
+	return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Config {
+	asio::ip::tcp::endpoint endpoint;
+	uint32_t users;
+	uint32_t ramp;
+	uint32_t duration;
+	uint32_t think;
+	string prefix;
+	string password;
+	uint32_t sayWeight;
+	uint32_t idleWeight;
+	uint32_t reconnectWeight;
+};
+
+/**
+ * What all sessions measured, under one lock, a load generator can afford it
+ */
+struct Results {
+	boost::mutex lock;
+	Common::Histogram connect;
+	Common::Histogram login;
+	Common::Histogram create;
+	Common::Histogram echo;
+	Common::Histogram fanout;
+	atomic<uint64_t> says{0};
+	atomic<uint64_t> echoes{0};
+	atomic<uint64_t> fanouts{0};
+	atomic<uint64_t> idles{0};
+	atomic<uint64_t> reconnects{0};
+	atomic<uint64_t> logins{0};
+	atomic<uint64_t> errors{0};
+	atomic<uint64_t> bytesIn{0};
+	atomic<uint64_t> bytesOut{0};
+	atomic<uint32_t> online{0};
+
+	void record(Common::Histogram& histogram, uint64_t micros)
+	{
+		boost::lock_guard<boost::mutex> lockGuard(lock);
+		histogram.record(micros);
+	};
+};
+
+class Session
+	: public boost::enable_shared_from_this<Session>
+{
+public:
+	enum State {
+		STATE_CONNECTING,
+		STATE_BANNER,
+		STATE_NAME,
+		STATE_PASSWORD,
+		STATE_CONFIRM,
+		STATE_ONLINE,
+		STATE_CLOSED
+		};
+
+	Session(asio::io_service& io_service, const Config& config, Results& results, uint32_t index)
+		: m_strand{io_service}, m_socket{io_service}, m_timer{io_service}, m_config{config}, m_results{results}, m_random{index}
+	{
+		// names are letters only
+		m_name=config.prefix;
+		for (uint32_t i=0, n=index; i<4; ++i, n/=26) {
+			m_name+=(char)('a'+n%26);
+			}
+	};
+
+	/**
+	 * From any thread, the session runs in its strand
+	 */
+	void start()
+	{
+		m_strand.post(boost::bind(&Session::connect, shared_from_this()));
+	};
+	void stop()
+	{
+		m_strand.post([self=shared_from_this()]() {
+				self->m_stopping=true;
+				self->close();
+			});
+	};
+
+private:
+	void connect()
+	{
+		// handlers of an earlier connection still come, aborted or not, they are told apart by this
+		++m_generation;
+		m_state=STATE_CONNECTING;
+		m_input.clear();
+		m_started=nowMicros();
+		m_socket.async_connect(m_config.endpoint,
+			m_strand.wrap(boost::bind(&Session::onConnect, shared_from_this(), m_generation, asio::placeholders::error)));
+	};
+
+	void onConnect(uint32_t generation, const boost::system::error_code& error)
+	{
+		if (generation!=m_generation) {
+			return;
+			}
+		if (error) {
+			fail("connect: "+error.message());
+			return;
+			}
+		m_socket.set_option(asio::ip::tcp::no_delay(true));
+		m_state=STATE_BANNER;
+		read();
+	};
+
+	void read()
+	{
+		m_socket.async_read_some(asio::buffer(m_buffer),
+			m_strand.wrap(boost::bind(&Session::onRead, shared_from_this(), m_generation, asio::placeholders::error, asio::placeholders::bytes_transferred)));
+	};
+	void onRead(uint32_t generation, const boost::system::error_code& error, size_t bytes)
+	{
+		if (generation!=m_generation) {
+			return;
+			}
+		if (error) {
+			if (m_state!=STATE_CLOSED) {
+				fail("read: "+error.message());
+				}
+			return;
+			}
+		m_results.bytesIn+=bytes;
+		negotiate(bytes);
+		parse();
+		if (m_state!=STATE_CLOSED) {
+			read();
+			}
+	};
+
+	/**
+	 * Answers the telnet options and keeps the text
+	 */
+	void negotiate(size_t bytes)
+	{
+		m_telnet.append(m_buffer.data(), bytes);
+		string reply;
+		size_t i{0};
+		while (i<m_telnet.length()) {
+			if ((uint8_t)m_telnet[i]!=enums::TELCMD_IAC) {
+				m_input+=m_telnet[i++];
+				continue;
+				}
+			if (i+1>=m_telnet.length()) {
+				break;
+				}
+			uint8_t command=m_telnet[i+1];
+			if (command==enums::TELCMD_SB) {
+				size_t end=m_telnet.find((char)enums::TELCMD_SE, i+2);
+				if (end==string::npos) {
+					break;
+					}
+				if ((uint8_t)m_telnet[i+2]==enums::TELOPT_TERM) {
+					reply+={(char)enums::TELCMD_IAC, (char)enums::TELCMD_SB, (char)enums::TELOPT_TERM, (char)enums::TELSUB_IS};
+					reply+="xterm";
+					reply+={(char)enums::TELCMD_IAC, (char)enums::TELCMD_SE};
+					}
+				i=end+1;
+				continue;
+				}
+			if (command==enums::TELCMD_IAC) {
+				m_input+=m_telnet[i];
+				i+=2;
+				continue;
+				}
+			if (command<enums::TELCMD_WILL) {
+				i+=2;
+				continue;
+				}
+			if (i+2>=m_telnet.length()) {
+				break;
+				}
+			uint8_t option=m_telnet[i+2];
+			if (command==enums::TELCMD_WILL && (option==enums::TELOPT_SGA || option==enums::TELOPT_ECHO)) {
+				reply+={(char)enums::TELCMD_IAC, (char)enums::TELCMD_DO, (char)option};
+				}
+			else if (command==enums::TELCMD_DO && option==enums::TELOPT_TERM) {
+				reply+={(char)enums::TELCMD_IAC, (char)enums::TELCMD_WILL, (char)option};
+				}
+			else if (command==enums::TELCMD_DO && option==enums::TELOPT_NAWS) {
+				reply+={(char)enums::TELCMD_IAC, (char)enums::TELCMD_WILL, (char)option,
+					(char)enums::TELCMD_IAC, (char)enums::TELCMD_SB, (char)option, 0, 80, 0, 24, (char)enums::TELCMD_IAC, (char)enums::TELCMD_SE};
+				}
+			i+=3;
+			}
+		m_telnet.erase(0, i);
+		if (!reply.empty()) {
+			send(reply);
+			}
+	};
+
+	/**
+	 * @return whether marker came, the input is consumed up to its end then
+	 */
+	bool consume(const string& marker)
+	{
+		size_t pos=m_input.find(marker);
+		if (pos==string::npos) {
+			return false;
+			}
+		m_input.erase(0, pos+marker.length());
+		return true;
+	};
+	bool saw(const char* text) const
+	{
+		return m_input.find(text)!=string::npos;
+	};
+
+	void parse()
+	{
+		switch (m_state) {
+			case STATE_BANNER:
+				if (consume("Login: ")) {
+					m_results.record(m_results.connect, nowMicros()-m_started);
+					m_loginStarted=nowMicros();
+					m_state=STATE_NAME;
+					send(m_name+"\r\n");
+					}
+				break;
+			case STATE_NAME:
+				if (saw("database unavailable") || saw("letters only") || saw("too short") || saw("too long")) {
+					fail("login refused");
+					return;
+					}
+				if (consume("Enter password: ")) {
+					m_state=STATE_PASSWORD;
+					send(m_config.password+"\r\n");
+					}
+				break;
+			case STATE_PASSWORD:
+				if (saw("wrong password") || saw("too short")) {
+					fail("wrong password");
+					return;
+					}
+				if (consume("confirm: ")) {
+					m_state=STATE_CONFIRM;
+					send(m_config.password+"\r\n");
+					}
+				else if (consume(m_name+"@")) {
+					online();
+					}
+				break;
+			case STATE_CONFIRM:
+				if (saw("nomatch") || saw("not created")) {
+					fail("account not created");
+					return;
+					}
+				if (consume("press [ENTER] to login")) {
+					// created, the session ends at the login prompt, log in the usual way
+					m_results.record(m_results.create, nowMicros()-m_loginStarted);
+					reconnect();
+					}
+				break;
+			case STATE_ONLINE:
+				lines();
+				break;
+			default:
+				break;
+			}
+	};
+
+	void online()
+	{
+		m_results.record(m_results.login, nowMicros()-m_loginStarted);
+		++m_results.logins;
+		++m_results.online;
+		m_state=STATE_ONLINE;
+		m_input.clear();
+		next();
+	};
+
+	/**
+	 * Said lines, our own echoed or those of others
+	 */
+	void lines()
+	{
+		size_t end;
+		while ((end=m_input.find('\n'))!=string::npos) {
+			string line{m_input.substr(0, end)};
+			m_input.erase(0, end+1);
+			size_t pos=line.find(" say: t");
+			if (pos==string::npos) {
+				continue;
+				}
+			uint64_t sent=strtoull(line.c_str()+pos+7, nullptr, 10);
+			uint64_t now=nowMicros();
+			if (!sent || sent>now) {
+				continue;
+				}
+			if (pos>=3 && line.compare(pos-3, 3, "You")==0) {
+				m_results.record(m_results.echo, now-sent);
+				++m_results.echoes;
+				}
+			else {
+				m_results.record(m_results.fanout, now-sent);
+				++m_results.fanouts;
+				}
+			}
+		// a partial line stays, anything longer is not ours
+		if (m_input.length()>4096) {
+			m_input.clear();
+			}
+	};
+
+	/**
+	 * Waits the think time, then does the next step of the mix
+	 */
+	void next()
+	{
+		exponential_distribution<double> think(1.0/max(1u, m_config.think));
+		m_timer.expires_from_now(boost::posix_time::milliseconds((int64_t)think(m_random)));
+		m_timer.async_wait(m_strand.wrap(boost::bind(&Session::onTimer, shared_from_this(), m_generation, asio::placeholders::error)));
+	};
+	void onTimer(uint32_t generation, const boost::system::error_code& error)
+	{
+		if (error || generation!=m_generation || m_state!=STATE_ONLINE || m_stopping) {
+			return;
+			}
+		uniform_int_distribution<uint32_t> pick(1, max(1u, m_config.sayWeight+m_config.idleWeight+m_config.reconnectWeight));
+		uint32_t roll=pick(m_random);
+		if (roll<=m_config.sayWeight) {
+			++m_results.says;
+			send(".say t"+to_string(nowMicros())+"\r\n");
+			}
+		else if (roll<=m_config.sayWeight+m_config.idleWeight) {
+			++m_results.idles;
+			}
+		else {
+			++m_results.reconnects;
+			reconnect();
+			return;
+			}
+		next();
+	};
+
+	/**
+	 * One write at a time, what comes meanwhile waits in m_pending
+	 */
+	void send(const string& data)
+	{
+		m_results.bytesOut+=data.length();
+		m_pending+=data;
+		if (!m_writing) {
+			write();
+			}
+	};
+	void write()
+	{
+		m_writing=true;
+		m_sending.swap(m_pending);
+		m_pending.clear();
+		asio::async_write(m_socket, asio::buffer(m_sending),
+			m_strand.wrap(boost::bind(&Session::onWrite, shared_from_this(), m_generation, asio::placeholders::error)));
+	};
+	void onWrite(uint32_t generation, const boost::system::error_code& error)
+	{
+		if (generation!=m_generation) {
+			return;
+			}
+		m_writing=false;
+		if (error) {
+			if (m_state!=STATE_CLOSED) {
+				fail("write: "+error.message());
+				}
+			return;
+			}
+		if (!m_pending.empty()) {
+			write();
+			}
+	};
+
+	void close()
+	{
+		if (m_state==STATE_ONLINE) {
+			--m_results.online;
+			}
+		m_state=STATE_CLOSED;
+		boost::system::error_code error;
+		m_timer.cancel(error);
+		m_socket.close(error);
+		m_telnet.clear();
+		m_pending.clear();
+		m_writing=false;
+	};
+	void reconnect()
+	{
+		close();
+		if (!m_stopping) {
+			connect();
+			}
+	};
+	void fail(const string& reason)
+	{
+		if (m_stopping) {
+			return;
+			}
+		if (++m_results.errors<=10) {
+			cerr << m_name << ": " << reason << endl;
+			}
+		close();
+		// try again a little later, a server under load refuses some
+		m_timer.expires_from_now(boost::posix_time::seconds(1));
+		m_timer.async_wait(m_strand.wrap([self=shared_from_this(), generation=m_generation](const boost::system::error_code& error) {
+				if (!error && generation==self->m_generation && !self->m_stopping) {
+					self->connect();
+					}
+			}));
+	};
+
+	asio::io_service::strand m_strand;
+	asio::ip::tcp::socket m_socket;
+	asio::deadline_timer m_timer;
+	const Config& m_config;
+	Results& m_results;
+	mt19937 m_random;
+	string m_name{};
+	State m_state{STATE_CLOSED};
+	bool m_stopping{false};
+	uint32_t m_generation{0};
+	array<char, 4096> m_buffer{};
+	string m_telnet{};
+	string m_input{};
+	string m_pending{};
+	string m_sending{};
+	bool m_writing{false};
+	uint64_t m_started{0};
+	uint64_t m_loginStarted{0};
+};
+
+
+static void writeHistogram(ostream& out, const char* name, const Common::Histogram& histogram, bool last=false)
+{
+	out << "    \"" << name << "\": {\"count\": " << histogram.getCount() << ", \"mean\": " << histogram.getMean()
+		<< ", \"p50\": " << histogram.getPercentile(50) << ", \"p95\": " << histogram.getPercentile(95)
+		<< ", \"p99\": " << histogram.getPercentile(99) << ", \"p999\": " << histogram.getPercentile(99.9)
+		<< ", \"max\": " << histogram.getMax() << "}" << (last ? "" : ",") << "\n";
+}
+
+int main(int argc, char** argv)
+{
+	namespace po=boost::program_options;
+
+	Config config;
+	string host, mix, output;
+	uint16_t port;
+	uint32_t threads, report;
+	po::options_description generic("Allowed options");
+	generic.add_options()
+		("help,h", "this help")
+		("host", po::value<string>(&host)->default_value("127.0.0.1"), "server address")
+		("port,p", po::value<uint16_t>(&port)->default_value(4000), "telnet port of the server")
+		("users,u", po::value<uint32_t>(&config.users)->default_value(100), "concurrent sessions")
+		("ramp,r", po::value<uint32_t>(&config.ramp)->default_value(10), "ms between two session starts")
+		("duration,d", po::value<uint32_t>(&config.duration)->default_value(60), "seconds to run, ramp included")
+		("think,t", po::value<uint32_t>(&config.think)->default_value(2000), "mean ms between two steps of a session")
+		("mix,m", po::value<string>(&mix)->default_value("say=60,idle=35,reconnect=5"), "weights of the steps")
+		("prefix", po::value<string>(&config.prefix)->default_value("lg"), "account names, letters only, 4 letters are appended")
+		("password", po::value<string>(&config.password)->default_value("loadgen1"), "password of all accounts")
+		("threads", po::value<uint32_t>(&threads)->default_value(2), "I/O threads")
+		("report", po::value<uint32_t>(&report)->default_value(5), "seconds between progress lines, 0 for none")
+		("output,o", po::value<string>(&output), "JSON results to this file instead of stdout")
+		;
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, generic), vm);
+		po::notify(vm);
+		}
+	catch (po::error& e) {
+		cerr << e.what() << endl;
+		return 1;
+		}
+	if (vm.count("help")) {
+		cout << "Usage: " << argv[0] << " [options]" << endl << generic << endl;
+		return 0;
+		}
+
+	config.sayWeight= config.idleWeight= config.reconnectWeight= 0;
+	vector<string> weights;
+	boost::split(weights, mix, boost::is_any_of(","));
+	for (const string& weight : weights) {
+		size_t eq=weight.find('=');
+		uint32_t value=eq==string::npos ? 0 : strtoul(weight.c_str()+eq+1, nullptr, 10);
+		string step{weight.substr(0, eq)};
+		if (step=="say") {
+			config.sayWeight=value;
+			}
+		else if (step=="idle") {
+			config.idleWeight=value;
+			}
+		else if (step=="reconnect") {
+			config.reconnectWeight=value;
+			}
+		else {
+			cerr << "unknown step " << step << " in --mix, say, idle or reconnect" << endl;
+			return 1;
+			}
+		}
+
+	asio::io_service io_service;
+	boost::system::error_code error;
+	asio::ip::tcp::resolver resolver(io_service);
+	asio::ip::tcp::resolver::iterator it=resolver.resolve(asio::ip::tcp::resolver::query(host, to_string(port)), error);
+	if (error || it==asio::ip::tcp::resolver::iterator()) {
+		cerr << host << ": " << error.message() << endl;
+		return 1;
+		}
+	config.endpoint=*it;
+
+	Results results;
+	vector<boost::shared_ptr<Session>> sessions;
+	asio::io_service::work work(io_service);
+	boost::thread_group ioThreads;
+	for (uint32_t i=0; i<max(1u, threads); ++i) {
+		ioThreads.create_thread([&io_service]() {
+				io_service.run();
+			});
+		}
+
+	chrono::steady_clock::time_point begin{chrono::steady_clock::now()};
+	chrono::steady_clock::time_point end{begin+chrono::seconds(config.duration)};
+	chrono::steady_clock::time_point nextReport{begin+chrono::seconds(report)};
+	uint64_t lastSays{0}, lastFanouts{0};
+	while (chrono::steady_clock::now()<end) {
+		if (sessions.size()<config.users) {
+			boost::shared_ptr<Session> session=boost::make_shared<Session>(io_service, config, results, sessions.size());
+			sessions.push_back(session);
+			session->start();
+			this_thread::sleep_for(chrono::milliseconds(config.ramp));
+			}
+		else {
+			this_thread::sleep_for(chrono::milliseconds(100));
+			}
+		if (report && chrono::steady_clock::now()>=nextReport) {
+			nextReport+=chrono::seconds(report);
+			cerr << chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now()-begin).count() << " s: "
+				<< results.online << "/" << sessions.size() << " online, " << (results.says-lastSays)/report << " says/s, "
+				<< (results.fanouts-lastFanouts)/report << " lines delivered/s, " << results.errors << " errors" << endl;
+			lastSays=results.says;
+			lastFanouts=results.fanouts;
+			}
+		}
+	double seconds=chrono::duration<double>(chrono::steady_clock::now()-begin).count();
+
+	for (const boost::shared_ptr<Session>& session : sessions) {
+		session->stop();
+		}
+	// let the sessions close before the threads end
+	this_thread::sleep_for(chrono::milliseconds(200));
+	io_service.stop();
+	ioThreads.join_all();
+
+	ostringstream json;
+	boost::lock_guard<boost::mutex> lockGuard(results.lock);
+	json << "{\n"
+		<< "  \"config\": {\"host\": \"" << host << "\", \"port\": " << port << ", \"users\": " << config.users
+		<< ", \"ramp_ms\": " << config.ramp << ", \"duration_s\": " << config.duration << ", \"think_ms\": " << config.think
+		<< ", \"mix\": \"" << mix << "\"},\n"
+		<< "  \"elapsed_s\": " << seconds << ",\n"
+		<< "  \"latency_us\": {\n";
+	writeHistogram(json, "connect", results.connect);
+	writeHistogram(json, "login", results.login);
+	writeHistogram(json, "create", results.create);
+	writeHistogram(json, "echo", results.echo);
+	writeHistogram(json, "fanout", results.fanout, true);
+	json << "  },\n"
+		<< "  \"counts\": {\"logins\": " << results.logins << ", \"says\": " << results.says << ", \"echoes\": " << results.echoes
+		<< ", \"fanouts\": " << results.fanouts << ", \"idles\": " << results.idles << ", \"reconnects\": " << results.reconnects
+		<< ", \"errors\": " << results.errors << ", \"bytes_in\": " << results.bytesIn << ", \"bytes_out\": " << results.bytesOut << "},\n"
+		<< "  \"throughput\": {\"says_per_s\": " << results.says/seconds << ", \"fanouts_per_s\": " << results.fanouts/seconds
+		<< ", \"bytes_in_per_s\": " << results.bytesIn/seconds << "}\n"
+		<< "}\n";
+	if (output.empty()) {
+		cout << json.str();
+		}
+	else {
+		ofstream out(output);
+		out << json.str();
+		if (!out) {
+			cerr << output << ": can't write" << endl;
+			return 1;
+			}
+		}
+	return results.logins ? 0 : 1;
+}
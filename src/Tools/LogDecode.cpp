@@ -0,0 +1,346 @@
+/* vi: set ts=4 sw=4 ai: */
+/**
+ * lotospp-logdecode, renders binary logs as text
+ *
+ * Reads the <date>.blog files written with global.logBinary and prints their records in the layout of the text log.
+ * Records come in per-thread chunks, --sort orders them by time across threads at the cost of holding them all.
+ */
+#include "Log/BinaryFormat.h"
+#include "Log/severity_t.h"
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+
+using namespace LotosPP::Log;
+using namespace std;
+
+
+struct Format {
+	severity_level level;
+	uint32_t line;
+	string file;
+	string format;
+};
+
+struct Line {
+	uint64_t time;
+	string text;
+};
+
+/**
+ * One file, a header starts a new section with its own formats and threads
+ */
+class Decoder
+{
+public:
+	Decoder(severity_level level, bool sort, vector<Line>& sorted)
+		: m_level{level}, m_sort{sort}, m_sorted{sorted}
+	{};
+
+	bool decode(const string& name)
+	{
+		ifstream in(name, ios::binary);
+		if (!in) {
+			cerr << name << ": can't open" << endl;
+			return false;
+			}
+		m_name=name;
+		string payload;
+		for (int c; (c=in.get())!=EOF; ) {
+			if (c==Binary::MAGIC[0]) {
+				if (!header(in)) {
+					return false;
+					}
+				continue;
+				}
+			uint64_t length;
+			if (!readVarint(in, length)) {
+				return truncated();
+				}
+			payload.resize(length);
+			if (!in.read(payload.data(), length)) {
+				return truncated();
+				}
+			const char* p=payload.data();
+			const char* end=p+payload.length();
+			bool ok{true};
+			switch (c) {
+				case Binary::CHUNK_FORMAT:
+					ok=format(p, end);
+					break;
+				case Binary::CHUNK_THREAD:
+					ok=thread(p, end);
+					break;
+				case Binary::CHUNK_RECORDS:
+					ok=records(p, end);
+					break;
+				default:
+					// a newer writer, skip what isn't known
+					break;
+				}
+			if (!ok) {
+				cerr << m_name << ": corrupt chunk at " << (uint64_t)in.tellg() << endl;
+				return false;
+				}
+			}
+		return true;
+	};
+
+	/**
+	 * Only collects the formats, for listFormats()
+	 */
+	void skipRecords()
+	{
+		m_records=false;
+	};
+	void listFormats()
+	{
+		for (const auto& [id, f] : m_formats) {
+			cout << id << "\t" << severity_t::to_string(f.level) << "\t" << f.file << ":" << f.line << "\t" << f.format << "\n";
+			}
+	};
+
+private:
+	bool header(ifstream& in)
+	{
+		char magic[sizeof(Binary::MAGIC)];
+		magic[0]=Binary::MAGIC[0];
+		uint64_t version, start;
+		if (!in.read(magic+1, sizeof(magic)-1) || !equal(magic, magic+sizeof(magic), Binary::MAGIC)) {
+			cerr << m_name << ": not a binary log" << endl;
+			return false;
+			}
+		if (!readVarint(in, version) || !readVarint(in, m_pid) || !readVarint(in, start)) {
+			return truncated();
+			}
+		if (version>Binary::VERSION) {
+			cerr << m_name << ": written by a newer server, version " << version << endl;
+			return false;
+			}
+		m_formats.clear();
+		m_threads.clear();
+		return true;
+	};
+
+	bool format(const char* p, const char* end)
+	{
+		uint64_t id, line;
+		Format f;
+		if (!Binary::getVarint(p, end, id) || p>=end || (uint8_t)*p>LFATAL) {
+			return false;
+			}
+		f.level=(severity_level)*p++;
+		if (!Binary::getVarint(p, end, line) || !Binary::getString(p, end, f.file) || !Binary::getString(p, end, f.format)) {
+			return false;
+			}
+		f.line=line;
+		m_formats[id]=f;
+		return true;
+	};
+
+	bool thread(const char* p, const char* end)
+	{
+		uint64_t index, id;
+		if (!Binary::getVarint(p, end, index) || !Binary::getVarint(p, end, id)) {
+			return false;
+			}
+		m_threads[index]=id;
+		return true;
+	};
+
+	bool records(const char* p, const char* end)
+	{
+		uint64_t index, base;
+		if (!Binary::getVarint(p, end, index) || !Binary::getVarint(p, end, base)) {
+			return false;
+			}
+		vector<string> args;
+		while (p<end) {
+			uint64_t id, delta, count;
+			if (!Binary::getVarint(p, end, id) || !Binary::getVarint(p, end, delta) || !Binary::getVarint(p, end, count)) {
+				return false;
+				}
+			args.clear();
+			for (uint64_t i=0; i<count; ++i) {
+				if (p>=end) {
+					return false;
+					}
+				uint64_t value;
+				switch ((uint8_t)*p++) {
+					case Binary::ARG_BOOL:
+						if (p>=end) {
+							return false;
+							}
+						args.push_back(*p++ ? "true" : "false");
+						break;
+					case Binary::ARG_INT:
+						if (!Binary::getVarint(p, end, value)) {
+							return false;
+							}
+						args.push_back(to_string(Binary::unzigzag(value)));
+						break;
+					case Binary::ARG_UINT:
+						if (!Binary::getVarint(p, end, value)) {
+							return false;
+							}
+						args.push_back(to_string(value));
+						break;
+					case Binary::ARG_DOUBLE:
+						{
+						double d;
+						if (end-p<(ptrdiff_t)sizeof(d)) {
+							return false;
+							}
+						memcpy(&d, p, sizeof(d));
+						p+=sizeof(d);
+						char text[32];
+						snprintf(text, sizeof(text), "%g", d);
+						args.push_back(text);
+						}
+						break;
+					case Binary::ARG_STRING:
+						args.emplace_back();
+						if (!Binary::getString(p, end, args.back())) {
+							return false;
+							}
+						break;
+					default:
+						return false;
+					}
+				}
+			print(base+delta, index, id, args);
+			}
+		return true;
+	};
+
+	void print(uint64_t time, uint64_t thread, uint64_t id, const vector<string>& args)
+	{
+		auto it=m_formats.find(id);
+		severity_level level{it!=m_formats.end() ? it->second.level : LINFO};
+		if (!m_records || level<m_level) {
+			return;
+			}
+		time_t seconds=time/1000000000;
+		struct tm local;
+		char stamp[32], ids[48];
+		strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime_r(&seconds, &local));
+		snprintf(ids, sizeof(ids), "<0x%08llx/0x%016llx>", (unsigned long long)m_pid, (unsigned long long)m_threads[thread]);
+		char micros[8];
+		snprintf(micros, sizeof(micros), ".%06u", (uint32_t)(time/1000%1000000));
+
+		string text{string(stamp)+micros+" "+ids+" : ["+severity_t::to_string(level)+"] "};
+		text+=it!=m_formats.end()
+			? Binary::render(it->second.format, args)
+			: "(unknown format "+to_string(id)+")"+Binary::render("", args);
+		if (m_sort) {
+			m_sorted.push_back(Line{time, move(text)});
+			}
+		else {
+			cout << text << "\n";
+			}
+	};
+
+	bool readVarint(ifstream& in, uint64_t& value)
+	{
+		value=0;
+		for (uint32_t shift=0; shift<64; shift+=7) {
+			int c=in.get();
+			if (c==EOF) {
+				return false;
+				}
+			value|=(uint64_t)(c&0x7f)<<shift;
+			if (!(c&0x80)) {
+				return true;
+				}
+			}
+		return false;
+	};
+
+	bool truncated()
+	{
+		// the server died while writing, what came before is fine
+		cerr << m_name << ": truncated" << endl;
+		return true;
+	};
+
+	severity_level m_level;
+	bool m_sort;
+	bool m_records{true};
+	vector<Line>& m_sorted;
+	string m_name{};
+	uint64_t m_pid{0};
+	map<uint64_t, Format> m_formats{};
+	map<uint64_t, uint64_t> m_threads{};
+};
+
+
+int main(int argc, char** argv)
+{
+	namespace po=boost::program_options;
+
+	vector<string> files;
+	string level;
+	po::options_description generic("Allowed options");
+	generic.add_options()
+		("help,h", "this help")
+		("sort,s", "order the records of all threads by time")
+		("level,l", po::value<string>(&level)->default_value("trace"), "lowest severity shown (trace, debug, info, warning, error, fatal)")
+		("formats,f", "list the call sites instead of the records")
+		("file", po::value<vector<string>>(&files), "binary log files")
+		;
+	po::positional_options_description p;
+	p.add("file", -1);
+
+	po::variables_map vm;
+	try {
+		po::store(po::command_line_parser(argc, argv).options(generic).positional(p).run(), vm);
+		po::notify(vm);
+		}
+	catch (po::error& e) {
+		cerr << e.what() << endl;
+		return 1;
+		}
+	if (vm.count("help") || files.empty()) {
+		cout << "Usage: " << argv[0] << " [options] file.blog..." << endl << generic << endl;
+		return files.empty() ? 1 : 0;
+		}
+
+	severity_level minLevel;
+	try {
+		minLevel=severity_t::to_severity(level);
+		}
+	catch (po::error& e) {
+		cerr << "unknown level " << level << endl;
+		return 1;
+		}
+
+	vector<Line> sorted;
+	bool ok{true};
+	for (const string& file : files) {
+		Decoder decoder(minLevel, vm.count("sort")>0, sorted);
+		if (vm.count("formats")) {
+			decoder.skipRecords();
+			ok=decoder.decode(file) && ok;
+			decoder.listFormats();
+			continue;
+			}
+		ok=decoder.decode(file) && ok;
+		}
+	if (vm.count("sort") && !vm.count("formats")) {
+		stable_sort(sorted.begin(), sorted.end(), [](const Line& a, const Line& b) {
+				return a.time<b.time;
+			});
+		for (const Line& line : sorted) {
+			cout << line.text << "\n";
+			}
+		}
+	return ok ? 0 : 1;
+}
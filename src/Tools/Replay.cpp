@@ -0,0 +1,396 @@
+/* vi: set ts=4 sw=4 ai: */
+/**
+ * lotospp-replay, plays a traffic capture back against a server
+ *
+ * Every connection of the capture (global.capture) becomes a session which connects when the original did and sends
+ * what the original client sent, at the same offsets from the start of the capture divided by --speed; --speed 0
+ * sends everything as fast as the server takes it. A session ends when the server closes it, or --linger ms after
+ * the later of its last input and the time the original connection closed.
+ *
+ * Then what each session got is compared with what the server sent in the capture. Output naming times, addresses
+ * or other users differs between runs, a session being identical is only the strongest result.
+ */
+#include "Network/Capture.h"
+#include <boost/asio.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+
+using LotosPP::Network::Capture;
+using namespace std;
+namespace asio=boost::asio;
+
+
+/**
+ * One connection as it was captured, times in ns since the start of the capture
+ */
+struct Recorded {
+	uint32_t id{0};
+	string address{};
+	uint64_t open{0};
+	uint64_t close{0};
+	bool closed{false};
+	vector<pair<uint64_t, string>> input{};
+	string output{};
+};
+
+struct Settings {
+	asio::ip::tcp::endpoint endpoint;
+	double speed;
+	uint32_t linger;
+	chrono::steady_clock::time_point begin;
+};
+
+static bool readVarint(const string& data, size_t& pos, uint64_t& v)
+{
+	v=0;
+	for (uint32_t shift=0; pos<data.length() && shift<64; shift+=7) {
+		uint8_t byte=data[pos++];
+		v|=(uint64_t)(byte&0x7f)<<shift;
+		if (!(byte&0x80)) {
+			return true;
+			}
+		}
+	return false;
+}
+
+/**
+ * @return the connections of the capture by id, empty with a message on stderr when the file is no capture
+ */
+static map<uint32_t, Recorded> load(const string& file)
+{
+	map<uint32_t, Recorded> connections;
+	ifstream in(file, ios::binary);
+	if (!in) {
+		cerr << file << ": can't open" << endl;
+		return connections;
+		}
+	string data{istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
+	Capture::FileHeader header;
+	if (data.length()<sizeof(header) || memcmp(data.data(), Capture::MAGIC, sizeof(Capture::MAGIC))) {
+		cerr << file << ": not a capture" << endl;
+		return connections;
+		}
+	memcpy(&header, data.data(), sizeof(header));
+	if (header.version!=Capture::VERSION) {
+		cerr << file << ": version " << header.version << ", not " << Capture::VERSION << endl;
+		return connections;
+		}
+
+	uint64_t time{0};
+	size_t pos{sizeof(header)};
+	while (pos<data.length()) {
+		uint64_t delta, id, length;
+		if (!readVarint(data, pos, delta) || !readVarint(data, pos, id) || pos>=data.length()) {
+			break;
+			}
+		uint8_t type=data[pos++];
+		if (!readVarint(data, pos, length) || pos+length>data.length()) {
+			break;
+			}
+		// a capture cut short by a crash ends in a partial record, what came before is good
+		time+=delta;
+		Recorded& connection=connections[id];
+		connection.id=id;
+		switch (type) {
+			case Capture::RECORD_OPEN:
+				connection.address.assign(data, pos, length);
+				connection.open=time;
+				break;
+			case Capture::RECORD_IN:
+				connection.input.emplace_back(time, data.substr(pos, length));
+				break;
+			case Capture::RECORD_OUT:
+				connection.output.append(data, pos, length);
+				break;
+			case Capture::RECORD_CLOSE:
+				connection.close=time;
+				connection.closed=true;
+				break;
+			}
+		if (!connection.closed) {
+			connection.close=time;
+			}
+		pos+=length;
+		}
+	return connections;
+}
+
+class Session
+	: public boost::enable_shared_from_this<Session>
+{
+public:
+	Session(asio::io_service& io_service, const Settings& settings, const Recorded& recorded)
+		: m_socket{io_service}, m_timer{io_service}, m_settings{settings}, m_recorded{recorded}
+	{};
+
+	void start()
+	{
+		m_timer.expires_at(due(m_recorded.open));
+		m_timer.async_wait(boost::bind(&Session::connect, shared_from_this(), asio::placeholders::error));
+	};
+
+	const Recorded& getRecorded() const
+	{
+		return m_recorded;
+	};
+	const string& getReceived() const
+	{
+		return m_received;
+	};
+	const string& getError() const
+	{
+		return m_error;
+	};
+	size_t getSent() const
+	{
+		return m_sent;
+	};
+
+private:
+	/**
+	 * @return when what happened at time of the capture is due now
+	 */
+	asio::steady_timer::time_point due(uint64_t time) const
+	{
+		if (m_settings.speed<=0) {
+			return chrono::steady_clock::now();
+			}
+		return m_settings.begin+chrono::nanoseconds((uint64_t)(time/m_settings.speed));
+	};
+
+	void connect(const boost::system::error_code& error)
+	{
+		if (error) {
+			return;
+			}
+		m_socket.async_connect(m_settings.endpoint, boost::bind(&Session::onConnect, shared_from_this(), asio::placeholders::error));
+	};
+	void onConnect(const boost::system::error_code& error)
+	{
+		if (error) {
+			finish("connect: "+error.message());
+			return;
+			}
+		m_socket.set_option(asio::ip::tcp::no_delay(true));
+		read();
+		next();
+	};
+
+	void read()
+	{
+		m_socket.async_read_some(asio::buffer(m_buffer),
+			boost::bind(&Session::onRead, shared_from_this(), asio::placeholders::error, asio::placeholders::bytes_transferred));
+	};
+	void onRead(const boost::system::error_code& error, size_t bytes)
+	{
+		if (m_closed) {
+			return;
+			}
+		if (error) {
+			// the server closing is the regular end of most sessions
+			finish(error==asio::error::eof ? "" : "read: "+error.message());
+			return;
+			}
+		m_received.append(m_buffer, bytes);
+		read();
+	};
+
+	/**
+	 * Waits for the next input, or for the end after the last
+	 */
+	void next()
+	{
+		if (m_closed) {
+			return;
+			}
+		if (m_next>=m_recorded.input.size()) {
+			m_timer.expires_at(max(due(m_recorded.close), chrono::steady_clock::now())+chrono::milliseconds(m_settings.linger));
+			m_timer.async_wait([self=shared_from_this()](const boost::system::error_code& error) {
+					if (!error) {
+						self->finish("");
+						}
+				});
+			return;
+			}
+		m_timer.expires_at(due(m_recorded.input[m_next].first));
+		m_timer.async_wait(boost::bind(&Session::send, shared_from_this(), asio::placeholders::error));
+	};
+	void send(const boost::system::error_code& error)
+	{
+		if (error || m_closed) {
+			return;
+			}
+		asio::async_write(m_socket, asio::buffer(m_recorded.input[m_next].second),
+			boost::bind(&Session::onWrite, shared_from_this(), asio::placeholders::error));
+	};
+	void onWrite(const boost::system::error_code& error)
+	{
+		if (m_closed) {
+			return;
+			}
+		if (error) {
+			finish("write: "+error.message());
+			return;
+			}
+		m_sent+=m_recorded.input[m_next].second.length();
+		++m_next;
+		next();
+	};
+
+	void finish(const string& error)
+	{
+		if (m_closed) {
+			return;
+			}
+		m_closed=true;
+		m_error=error;
+		boost::system::error_code ignored;
+		m_timer.cancel(ignored);
+		m_socket.shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+		m_socket.close(ignored);
+	};
+
+	asio::ip::tcp::socket m_socket;
+	asio::steady_timer m_timer;
+	const Settings& m_settings;
+	const Recorded& m_recorded;
+	char m_buffer[4096];
+	size_t m_next{0};
+	size_t m_sent{0};
+	string m_received{};
+	string m_error{};
+	bool m_closed{false};
+};
+
+/**
+ * Up to 32 bytes from pos, the unprintable ones escaped
+ */
+static string excerpt(const string& text, size_t pos)
+{
+	string out;
+	for (size_t i=pos; i<text.length() && i<pos+32; ++i) {
+		uint8_t c=text[i];
+		if (c>=32 && c<127 && c!='\\') {
+			out+=c;
+			}
+		else {
+			char hex[8];
+			snprintf(hex, sizeof(hex), "\\x%02x", c);
+			out+=hex;
+			}
+		}
+	return out;
+}
+
+int main(int argc, char** argv)
+{
+	namespace po=boost::program_options;
+
+	string file, host;
+	uint16_t port;
+	Settings settings;
+	po::options_description generic("Allowed options");
+	generic.add_options()
+		("help,h", "this help")
+		("host", po::value<string>(&host)->default_value("127.0.0.1"), "server address")
+		("port,p", po::value<uint16_t>(&port)->default_value(4000), "telnet port of the server")
+		("speed,s", po::value<double>(&settings.speed)->default_value(1), "times the original speed, 0 as fast as possible")
+		("linger,l", po::value<uint32_t>(&settings.linger)->default_value(1000), "ms to wait for output at the end of a session")
+		("list", "only list the connections of the capture")
+		("diff", "show where the output of each differing session departs from the capture")
+		("file", po::value<string>(&file), "capture file")
+		;
+	po::positional_options_description p;
+	p.add("file", 1);
+
+	po::variables_map vm;
+	try {
+		po::store(po::command_line_parser(argc, argv).options(generic).positional(p).run(), vm);
+		po::notify(vm);
+		}
+	catch (po::error& e) {
+		cerr << e.what() << endl;
+		return 1;
+		}
+	if (vm.count("help") || file.empty()) {
+		cout << "Usage: " << argv[0] << " [options] capture.lcap" << endl << generic << endl;
+		return file.empty() ? 1 : 0;
+		}
+
+	map<uint32_t, Recorded> connections{load(file)};
+	if (connections.empty()) {
+		return 1;
+		}
+	if (vm.count("list")) {
+		for (const auto& [id, connection] : connections) {
+			size_t sent{0};
+			for (const auto& [time, bytes] : connection.input) {
+				sent+=bytes.length();
+				}
+			cout << "#" << id << " " << connection.address << " at " << connection.open/1000000 << " ms for "
+				<< (connection.close-connection.open)/1000000 << " ms: " << connection.input.size() << " reads, " << sent
+				<< " bytes in, " << connection.output.length() << " bytes out" << (connection.closed ? "" : ", not closed") << "\n";
+			}
+		return 0;
+		}
+
+	asio::io_service io_service;
+	boost::system::error_code error;
+	asio::ip::tcp::resolver resolver(io_service);
+	asio::ip::tcp::resolver::iterator it=resolver.resolve(asio::ip::tcp::resolver::query(host, to_string(port)), error);
+	if (error || it==asio::ip::tcp::resolver::iterator()) {
+		cerr << host << ": " << error.message() << endl;
+		return 1;
+		}
+	settings.endpoint=*it;
+
+	vector<boost::shared_ptr<Session>> sessions;
+	settings.begin=chrono::steady_clock::now();
+	for (const auto& [id, connection] : connections) {
+		sessions.push_back(boost::make_shared<Session>(io_service, settings, connection));
+		sessions.back()->start();
+		}
+	io_service.run();
+	double seconds=chrono::duration<double>(chrono::steady_clock::now()-settings.begin).count();
+
+	size_t identical{0}, failed{0}, sent{0}, received{0}, expected{0};
+	for (const boost::shared_ptr<Session>& session : sessions) {
+		const Recorded& recorded=session->getRecorded();
+		const string& output=session->getReceived();
+		sent+=session->getSent();
+		received+=output.length();
+		expected+=recorded.output.length();
+		if (!session->getError().empty()) {
+			++failed;
+			cout << "#" << recorded.id << " " << session->getError() << "\n";
+			continue;
+			}
+		if (output==recorded.output) {
+			++identical;
+			continue;
+			}
+		size_t pos=mismatch(output.begin(), output.begin()+min(output.length(), recorded.output.length()), recorded.output.begin()).first-output.begin();
+		cout << "#" << recorded.id << " differs at byte " << pos << ", " << output.length() << " bytes instead of "
+			<< recorded.output.length() << "\n";
+		if (vm.count("diff")) {
+			cout << "\tcaptured: " << excerpt(recorded.output, pos) << "\n"
+				<< "\treplayed: " << excerpt(output, pos) << "\n";
+			}
+		}
+	cout << sessions.size() << " sessions in " << seconds << " s: " << identical << " identical, "
+		<< sessions.size()-identical-failed << " differing, " << failed << " failed; "
+		<< sent << " bytes sent, " << received << " bytes received of " << expected << " captured" << endl;
+	return failed ? 1 : 0;
+}
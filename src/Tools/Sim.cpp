@@ -0,0 +1,429 @@
+/* vi: set ts=4 sw=4 ai: */
+/**
+ * lotospp-sim, the talker with simulated clients on a virtual clock
+ *
+ * Scheduler, dispatcher and io_service run without their threads: the next due scheduler event moves the virtual
+ * clock, then io handlers and dispatcher tasks run until neither has anything left, all on one thread. --users
+ * clients live in the process, each on a Connection over an in-memory pipe to the "sim" service, so input, output
+ * messages and the teardown of a quit take the path of a socket. After a think time drawn from its own generator,
+ * seeded from --seed, each client says something, stays idle or quits and comes back, weighted by --mix. The same
+ * seed gives the same run, down to the digest of all output; the run takes as long as its tasks, not as long as
+ * --duration.
+ *
+ * Clients send their name as the first line and enter on the command line, a login would need the database and
+ * hashes passwords for a long time. Connection write timeouts stay on the system clock, a pipe never blocks a write.
+ * Reports what happened and the wall time spent fanning out says, connecting and tearing down as JSON.
+ */
+#define MAINFILE
+#include "globals.h"
+#include "Common/Clock.h"
+#include "Common/Histogram.h"
+#include "Common/User.h"
+#include "Log/Logger.h"
+#include "Network/Protocol.h"
+#include "Network/NetworkMessage.h"
+#include "Network/ServiceManager.h"
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/date_time/posix_time/conversion.hpp>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+using namespace LotosPP;
+using namespace std;
+namespace enums=LotosPP::Common::enums;
+
+
+struct Config {
+	uint32_t users;
+	uint32_t ramp;
+	uint32_t think;
+	uint64_t seed;
+	uint32_t sayWeight;
+	uint32_t idleWeight;
+	uint32_t quitWeight;
+};
+
+/**
+ * What the clients did, the run has one thread
+ */
+struct Results {
+	Common::Histogram connect;
+	Common::Histogram say;
+	Common::Histogram quit;
+	uint64_t handlers{0};
+	uint64_t tasks{0};
+	uint64_t connects{0};
+	uint64_t says{0};
+	uint64_t idles{0};
+	uint64_t quits{0};
+	uint64_t lines{0};
+	uint64_t bytes{0};
+	uint32_t online{0};
+	// FNV-1a of all output, client by client in the order they read it
+	uint64_t digest{0xcbf29ce484222325ull};
+};
+
+/**
+ * Served on the "sim" pipe, the first line is the name to enter as, the rest goes to the user as Telnet does
+ */
+class SimProtocol
+	: public Network::Protocol
+{
+public:
+	// static protocol information
+	enum {
+		server_sends_first=true
+		};
+
+	SimProtocol(Network::Connection_ptr connection)
+		: Protocol(connection)
+	{};
+	static const char* protocolName()
+	{
+		return "Simulated protocol";
+	};
+
+private:
+	void releaseProtocol()
+	{
+		//dispatcher thread
+		if (user && user->client==this) {
+			user->client=nullptr;
+			}
+		Protocol::releaseProtocol();
+	};
+	void deleteProtocolTask()
+	{
+		//dispatcher thread
+		if (user) {
+			g_talker.FreeThing(user);
+			user=nullptr;
+			}
+		Protocol::deleteProtocolTask();
+	};
+
+	void onRecvFirstMessage(Network::NetworkMessage& msg)
+	{
+		//io thread
+		std::string input{msg.GetRaw()};
+		addRef();
+		g_dispatcher.addTask(Common::createTask(boost::bind(&SimProtocol::enter, this, input.substr(0, input.find_first_of("\r\n"))),
+			Common::Task::CATEGORY_INPUT));
+	};
+	void parsePacket(Network::NetworkMessage& msg)
+	{
+		//io thread
+		if (msg.getMessageLength()<=0) {
+			return;
+			}
+		addRef();
+		g_dispatcher.addTask(Common::createTask(boost::bind(&SimProtocol::read, this, msg.GetRaw()), Common::Task::CATEGORY_INPUT));
+	};
+
+	void enter(const std::string& name)
+	{
+		//dispatcher thread, as Telnet::parseFirstPacket, then past the login
+		unRef();
+		if (!getConnection()) {
+			return;
+			}
+		Common::User* _user=new Common::User("", this);
+		_user->setID();
+		_user->addList();
+		_user->enterAs(name, Common::UserLevel_NOVICE);
+	};
+	void read(const std::string& input)
+	{
+		//dispatcher thread
+		unRef();
+		if (user) {
+			user->uRead(input);
+			}
+	};
+};
+
+/**
+ * Runs io handlers and dispatcher tasks until neither has anything left: input queues tasks, tasks write to and
+ * close connections
+ */
+static void settle(Network::ServiceManager& servicer, Results& results)
+{
+	while (true) {
+		size_t handlers{servicer.poll()},
+			tasks{g_dispatcher.runPending()};
+		results.handlers+=handlers;
+		results.tasks+=tasks;
+		if (!handlers && !tasks) {
+			return;
+			}
+		}
+}
+
+class Client
+{
+public:
+	Client(Network::ServiceManager& servicer, const Config& config, Results& results, uint32_t index)
+		: m_servicer{servicer}, m_config{config}, m_results{results}, m_random{config.seed*1000003+index}
+	{
+		m_name="Sim";
+		for (uint32_t i=0, n=index; i<4; ++i, n/=26) {
+			m_name+=(char)('a'+n%26);
+			}
+	};
+
+	void schedule(uint32_t delay)
+	{
+		g_scheduler.addEvent(Common::createSchedulerTask(max<uint32_t>(delay, Common::SchedulerTask::SCHEDULER_MINTICKS),
+			boost::bind(&Client::step, this)));
+	};
+
+	/**
+	 * Reads what the server wrote since the last time
+	 */
+	void output()
+	{
+		if (!m_pipe) {
+			return;
+			}
+		string str{m_pipe->receive()};
+		m_results.bytes+=str.length();
+		for (char c : str) {
+			m_results.lines+= c=='\n';
+			m_results.digest=(m_results.digest^(uint8_t)c)*0x100000001b3ull;
+			}
+	};
+
+private:
+	void step()
+	{
+		output();
+		if (m_pipe && !m_pipe->isOpen()) {
+			// the server hung up
+			hangUp();
+			}
+		if (!m_pipe) {
+			connect();
+			}
+		else {
+			uint32_t pick=uniform_int_distribution<uint32_t>(0, m_config.sayWeight+m_config.idleWeight+m_config.quitWeight-1)(m_random);
+			if (pick<m_config.sayWeight) {
+				say();
+				}
+			else if (pick<m_config.sayWeight+m_config.idleWeight) {
+				++m_results.idles;
+				}
+			else {
+				quit();
+				}
+			}
+		schedule(exponential_distribution<double>(1.0/m_config.think)(m_random));
+	};
+
+	void connect()
+	{
+		chrono::steady_clock::time_point begin{chrono::steady_clock::now()};
+		m_pipe=m_servicer.connectPipe("sim");
+		m_pipe->send(m_name+"\r\n");
+		settle(m_servicer, m_results);
+		m_results.connect.record(micros(begin));
+		output();
+		++m_results.connects;
+		++m_results.online;
+	};
+	void say()
+	{
+		chrono::steady_clock::time_point begin{chrono::steady_clock::now()};
+		m_pipe->send(".say line "+to_string(++m_said)+" of "+m_name+"\r");
+		settle(m_servicer, m_results);
+		m_results.say.record(micros(begin));
+		output();
+		++m_results.says;
+	};
+	void quit()
+	{
+		chrono::steady_clock::time_point begin{chrono::steady_clock::now()};
+		m_pipe->send(".quit\r");
+		settle(m_servicer, m_results);
+		m_results.quit.record(micros(begin));
+		output();
+		if (!m_pipe->isOpen()) {
+			hangUp();
+			}
+		++m_results.quits;
+	};
+	void hangUp()
+	{
+		m_pipe->close();
+		m_pipe.reset();
+		// the users the closed connections left behind, as Talker::shutdown
+		g_talker.cleanup();
+		--m_results.online;
+	};
+
+	static uint64_t micros(chrono::steady_clock::time_point begin)
+	{
+		return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now()-begin).count();
+	};
+
+	Network::ServiceManager& m_servicer;
+	const Config& m_config;
+	Results& m_results;
+	mt19937_64 m_random;
+	string m_name;
+	Network::Pipe_ptr m_pipe{nullptr};
+	uint64_t m_said{0};
+};
+
+static void writeHistogram(ostream& out, const char* name, const Common::Histogram& histogram, bool last=false)
+{
+	out << "    \"" << name << "\": {\"count\": " << histogram.getCount() << ", \"mean\": " << histogram.getMean()
+		<< ", \"p50\": " << histogram.getPercentile(50) << ", \"p99\": " << histogram.getPercentile(99)
+		<< ", \"max\": " << histogram.getMax() << "}" << (last ? "" : ",") << "\n";
+}
+
+int main(int argc, char** argv)
+{
+	namespace po=boost::program_options;
+
+	Config config;
+	string mix, output, logDir;
+	uint32_t duration, report;
+	po::options_description generic("Allowed options");
+	generic.add_options()
+		("help,h", "this help")
+		("users,u", po::value<uint32_t>(&config.users)->default_value(1000), "simulated clients")
+		("ramp,r", po::value<uint32_t>(&config.ramp)->default_value(1), "virtual ms between two client starts")
+		("duration,d", po::value<uint32_t>(&duration)->default_value(600), "virtual seconds to run")
+		("think,t", po::value<uint32_t>(&config.think)->default_value(5000), "mean virtual ms between two steps of a client")
+		("mix,m", po::value<string>(&mix)->default_value("say=20,idle=75,quit=5"), "weights of the steps")
+		("seed,s", po::value<uint64_t>(&config.seed)->default_value(1), "seed of the clients")
+		("report", po::value<uint32_t>(&report)->default_value(60), "virtual seconds between progress lines, 0 for none")
+		("log-dir", po::value<string>(&logDir)->default_value("log"), "log directory")
+		("output,o", po::value<string>(&output), "JSON results to this file instead of stdout")
+		;
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, generic), vm);
+		po::notify(vm);
+		}
+	catch (po::error& e) {
+		cerr << e.what() << endl;
+		return 1;
+		}
+	if (vm.count("help")) {
+		cout << "Usage: " << argv[0] << " [options]" << endl
+			<< "Runs the talker on a virtual clock with clients connected over in-memory pipes" << endl << generic << endl;
+		return 0;
+		}
+
+	config.sayWeight= config.idleWeight= config.quitWeight= 0;
+	vector<string> weights;
+	boost::split(weights, mix, boost::is_any_of(","));
+	for (const string& weight : weights) {
+		size_t eq=weight.find('=');
+		uint32_t value=eq==string::npos ? 0 : strtoul(weight.c_str()+eq+1, nullptr, 10);
+		string step{weight.substr(0, eq)};
+		if (step=="say") {
+			config.sayWeight=value;
+			}
+		else if (step=="idle") {
+			config.idleWeight=value;
+			}
+		else if (step=="quit") {
+			config.quitWeight=value;
+			}
+		else {
+			cerr << "unknown step " << step << " in --mix, say, idle or quit" << endl;
+			return 1;
+			}
+		}
+	if (!config.sayWeight && !config.idleWeight && !config.quitWeight) {
+		cerr << "--mix weighs nothing" << endl;
+		return 1;
+		}
+
+	options.put("global.serverName", "Sim");
+	options.put("global.log.dir", logDir);
+	options.put("global.log.console.level", "warning");
+	options.put("global.log.file.level", "warning");
+	Log::Logger::getInstance()->init();
+
+	// the same start each run, the prompt or a log line may show it
+	boost::system_time start{boost::posix_time::from_time_t(946684800)};
+	Common::Clock::setVirtual(start);
+	g_dispatcher.startSimulated();
+	g_scheduler.startSimulated();
+	Network::ServiceManager servicer;
+	if (!servicer.add<SimProtocol>(Network::ServiceAddress(Network::Transport::TYPE_PIPE, "sim"))) {
+		cerr << "can't serve the sim pipe" << endl;
+		return 1;
+		}
+
+	Results results;
+	vector<unique_ptr<Client>> clients;
+	for (uint32_t i=0; i<config.users; ++i) {
+		clients.emplace_back(new Client(servicer, config, results, i));
+		clients.back()->schedule(i*config.ramp);
+		}
+
+	chrono::steady_clock::time_point begin{chrono::steady_clock::now()};
+	boost::system_time end{start+boost::posix_time::seconds(duration)};
+	boost::system_time nextReport{start+boost::posix_time::seconds(report)};
+	uint64_t events{0};
+	do {
+		settle(servicer, results);
+		if (report && Common::Clock::now()>=nextReport) {
+			nextReport+=boost::posix_time::seconds(report);
+			cerr << (Common::Clock::now()-start).total_seconds() << " s: " << results.online << "/" << config.users << " online, "
+				<< results.says << " says, " << results.lines << " lines delivered, "
+				<< chrono::duration<double>(chrono::steady_clock::now()-begin).count() << " s wall" << endl;
+			}
+		}
+	while (g_scheduler.runNext(end) && ++events);
+	for (const unique_ptr<Client>& client : clients) {
+		client->output();
+		}
+	double seconds=chrono::duration<double>(chrono::steady_clock::now()-begin).count();
+	double simulated=(Common::Clock::now()-start).total_milliseconds()/1000.0;
+
+	ostringstream json;
+	json << "{\n"
+		<< "  \"config\": {\"users\": " << config.users << ", \"ramp_ms\": " << config.ramp << ", \"duration_s\": " << duration
+		<< ", \"think_ms\": " << config.think << ", \"mix\": \"" << mix << "\", \"seed\": " << config.seed << "},\n"
+		<< "  \"simulated_s\": " << simulated << ",\n"
+		<< "  \"wall_s\": " << seconds << ",\n"
+		<< "  \"speedup\": " << (seconds>0 ? simulated/seconds : 0) << ",\n"
+		<< "  \"wall_us\": {\n";
+	writeHistogram(json, "connect", results.connect);
+	writeHistogram(json, "say", results.say);
+	writeHistogram(json, "quit", results.quit, true);
+	json << "  },\n"
+		<< "  \"counts\": {\"events\": " << events << ", \"handlers\": " << results.handlers << ", \"tasks\": " << results.tasks << ", \"connects\": " << results.connects
+		<< ", \"says\": " << results.says << ", \"idles\": " << results.idles << ", \"quits\": " << results.quits
+		<< ", \"online\": " << results.online << ", \"lines\": " << results.lines << ", \"bytes\": " << results.bytes << "},\n"
+		<< "  \"digest\": \"" << hex << results.digest << dec << "\"\n"
+		<< "}\n";
+	if (output.empty()) {
+		cout << json.str();
+		}
+	else {
+		ofstream out(output);
+		out << json.str();
+		if (!out) {
+			cerr << output << ": can't write" << endl;
+			return 1;
+			}
+		}
+	Log::Logger::getInstance()->shutdown();
+	return 0;
+}
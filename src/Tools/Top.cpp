@@ -0,0 +1,155 @@
+/* vi: set ts=4 sw=4 ai: */
+/**
+ * lotospp-top, live view of a running server from its stats segment
+ *
+ * Maps the shared memory segment the server publishes (global.statsSegment, /lotospp-<userPort> by default) read
+ * only and shows it every --interval ms: connections, users, dispatcher queue and tasks, the output message pool,
+ * the traffic and the CPU use of each named thread. Rates are over the last interval. The server does no work for
+ * it, reading takes no lock and no system call on its side. --batch prints a line per sample instead, for logs.
+ */
+#include "Common/StatsSegment.h"
+#include <boost/program_options.hpp>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+using LotosPP::Common::StatsSegment;
+using namespace std;
+
+
+static string bytesText(double bytes)
+{
+	const char* units[]={"B", "KiB", "MiB", "GiB", "TiB"};
+	uint32_t unit{0};
+	while (bytes>=1024 && unit<4) {
+		bytes/=1024;
+		++unit;
+		}
+	char text[32];
+	snprintf(text, sizeof(text), "%.1f %s", bytes, units[unit]);
+	return text;
+}
+
+/**
+ * @return change per second of a counter between two samples
+ */
+static double rate(uint64_t now, uint64_t before, double seconds)
+{
+	return seconds>0 && now>=before ? (now-before)/seconds : 0;
+}
+
+int main(int argc, char** argv)
+{
+	namespace po=boost::program_options;
+
+	string name;
+	uint32_t port, interval, count;
+	po::options_description generic("Allowed options");
+	generic.add_options()
+		("help,h", "this help")
+		("port,p", po::value<uint32_t>(&port)->default_value(1234), "user port of the server, names the segment")
+		("segment,s", po::value<string>(&name), "segment name, instead of /lotospp-<port>")
+		("interval,i", po::value<uint32_t>(&interval)->default_value(1000), "ms between samples")
+		("count,n", po::value<uint32_t>(&count)->default_value(0), "samples to show, 0 until interrupted")
+		("batch,b", "a line per sample, no screen")
+		;
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, generic), vm);
+		po::notify(vm);
+		}
+	catch (po::error& e) {
+		cerr << e.what() << endl;
+		return 1;
+		}
+	if (vm.count("help")) {
+		cout << "Usage: " << argv[0] << " [options]" << endl << generic << endl;
+		return 0;
+		}
+	if (name.empty()) {
+		name="/lotospp-"+to_string(port);
+		}
+	bool batch=vm.count("batch");
+
+	int fd=shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd<0) {
+		cerr << name << ": " << strerror(errno) << ", is the server running?" << endl;
+		return 1;
+		}
+	void* map=mmap(nullptr, sizeof(StatsSegment::Segment), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map==MAP_FAILED) {
+		cerr << name << ": can't map, " << strerror(errno) << endl;
+		return 1;
+		}
+	const StatsSegment::Segment* segment=(const StatsSegment::Segment*)map;
+	if (memcmp(segment->magic, StatsSegment::MAGIC, sizeof(StatsSegment::MAGIC)) || segment->version!=StatsSegment::VERSION
+			|| segment->size!=sizeof(StatsSegment::Segment)) {
+		cerr << name << ": not a stats segment of this version" << endl;
+		return 1;
+		}
+
+	StatsSegment::Snapshot previous{}, current{};
+	if (!StatsSegment::read(segment, previous)) {
+		cerr << name << ": the server keeps writing, can't read" << endl;
+		return 1;
+		}
+	for (uint32_t sample=0; !count || sample<count; ++sample) {
+		this_thread::sleep_for(chrono::milliseconds(interval));
+		if (!StatsSegment::read(segment, current)) {
+			continue;
+			}
+		double seconds=(current.time-previous.time)/1000.0;
+		uint64_t poolUsed{current.poolMessages>current.poolAvailable ? current.poolMessages-current.poolAvailable : 0};
+
+		if (batch) {
+			printf("%llu conn=%llu users=%llu queue=%llu tasks/s=%.0f pool=%llu/%llu in/s=%.0f out/s=%.0f",
+				(unsigned long long)current.time/1000, (unsigned long long)current.connections, (unsigned long long)current.users,
+				(unsigned long long)current.dispatcherQueue, rate(current.tasks, previous.tasks, seconds),
+				(unsigned long long)poolUsed, (unsigned long long)current.poolMessages,
+				rate(current.receivedBytes, previous.receivedBytes, seconds), rate(current.sentBytes, previous.sentBytes, seconds));
+			for (size_t i=0; i<current.threads.size(); ++i) {
+				uint64_t before{i<previous.threads.size() ? previous.threads[i].cpuNanos : 0};
+				printf(" %s=%.1f%%", current.threads[i].name.c_str(), rate(current.threads[i].cpuNanos, before, seconds)/1e7);
+				}
+			printf("\n");
+			fflush(stdout);
+			}
+		else {
+			time_t started=current.startTime, updated=current.time/1000;
+			char startText[32], updateText[32];
+			struct tm local;
+			strftime(startText, sizeof(startText), "%Y-%m-%d %H:%M:%S", localtime_r(&started, &local));
+			strftime(updateText, sizeof(updateText), "%H:%M:%S", localtime_r(&updated, &local));
+			// home and clear
+			printf("\033[H\033[2J");
+			printf("lotospp pid %llu, started %s, updated %s\n\n", (unsigned long long)current.pid, startText, updateText);
+			printf("connections  %10llu open  %10llu accepted  %8.1f/s\n", (unsigned long long)current.connections,
+				(unsigned long long)current.connectionsTotal, rate(current.connectionsTotal, previous.connectionsTotal, seconds));
+			printf("users        %10llu\n", (unsigned long long)current.users);
+			printf("dispatcher   %10llu queued %10.0f tasks/s\n", (unsigned long long)current.dispatcherQueue,
+				rate(current.tasks, previous.tasks, seconds));
+			printf("output pool  %10llu used  %10llu allocated\n", (unsigned long long)poolUsed, (unsigned long long)current.poolMessages);
+			printf("traffic      %10s/s in %10s/s out\n", bytesText(rate(current.receivedBytes, previous.receivedBytes, seconds)).c_str(),
+				bytesText(rate(current.sentBytes, previous.sentBytes, seconds)).c_str());
+			printf("\n%-16s %8s %12s\n", "thread", "cpu", "cpu time");
+			for (size_t i=0; i<current.threads.size(); ++i) {
+				uint64_t before{i<previous.threads.size() ? previous.threads[i].cpuNanos : 0};
+				printf("%-16s %7.1f%% %11.1fs\n", current.threads[i].name.c_str(), rate(current.threads[i].cpuNanos, before, seconds)/1e7,
+					current.threads[i].cpuNanos/1e9);
+				}
+			fflush(stdout);
+			}
+		previous=current;
+		}
+	return 0;
+}
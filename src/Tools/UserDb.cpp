@@ -0,0 +1,463 @@
+/* vi: set ts=4 sw=4 ai: */
+/**
+ * lotospp-userdb, bulk import and export of accounts
+ *
+ * Imports CSV (login,password,level) or a directory of legacy NUTS/Lotos user files (<name>.D, password on the first
+ * line) into `users`, with multi-row INSERTs inside large transactions. Plaintext legacy passwords are hashed with
+ * bcrypt on several threads meanwhile, `users` never gets one. The crypt() hashes of NUTS files are kept, the server
+ * verifies them and replaces them with bcrypt on the next login. Exports stream `users` back out as CSV.
+ */
+#include "Database/Driver.h"
+#include "Database/Insert.h"
+#include "Database/Migrator.h"
+#include "Database/Result.h"
+#include "Database/Transaction.h"
+#include "Security/Blowfish.h"
+#include "Security/DesCrypt.h"
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ini_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace LotosPP {
+	boost::property_tree::ptree options;
+	struct std::tm serverTimeTms;
+	}
+
+using namespace LotosPP;
+using namespace std;
+namespace fs=std::filesystem;
+
+
+struct Account {
+	string login;
+	string password;
+	int32_t level;
+	// password is a hash already, kept as it is
+	bool hashed;
+};
+typedef vector<Account> Chunk;
+
+/**
+ * Bounded queue of chunks between the reader, the hashers and the writer
+ */
+class ChunkQueue
+{
+public:
+	ChunkQueue(size_t capacity, uint32_t producers)
+		: m_capacity{capacity}, m_producers{producers}
+	{};
+
+	void push(Chunk&& chunk)
+	{
+		boost::unique_lock<boost::mutex> lockUnique(m_lock);
+		while (m_chunks.size()>=m_capacity) {
+			m_signal.wait(lockUnique);
+			}
+		m_chunks.push_back(std::move(chunk));
+		m_signal.notify_all();
+	};
+	/**
+	 * @return false once all producers are done and the queue is empty
+	 */
+	bool pop(Chunk& chunk)
+	{
+		boost::unique_lock<boost::mutex> lockUnique(m_lock);
+		while (m_chunks.empty() && m_producers) {
+			m_signal.wait(lockUnique);
+			}
+		if (m_chunks.empty()) {
+			return false;
+			}
+		chunk=std::move(m_chunks.front());
+		m_chunks.pop_front();
+		m_signal.notify_all();
+		return true;
+	};
+	void producerDone()
+	{
+		boost::lock_guard<boost::mutex> lockGuard(m_lock);
+		--m_producers;
+		m_signal.notify_all();
+	};
+
+private:
+	boost::mutex m_lock;
+	boost::condition_variable m_signal;
+	deque<Chunk> m_chunks;
+	size_t m_capacity;
+	uint32_t m_producers;
+};
+
+static const size_t CHUNK_SIZE=1000;
+static atomic<uint64_t> g_skipped{0};
+static atomic<uint64_t> g_hashed{0};
+static atomic<uint64_t> g_legacy{0};
+static atomic<bool> g_readFailed{false};
+// without hasher threads only hashed passwords can be imported
+static bool g_rehash{true};
+
+/**
+ * Splits a CSV line, fields may be "quoted" with "" inside
+ */
+static vector<string> splitCSV(const string& line)
+{
+	vector<string> fields(1);
+	bool quoted{false};
+	for (size_t i=0; i<line.length(); ++i) {
+		char c=line[i];
+		if (quoted) {
+			if (c=='"' && i+1<line.length() && line[i+1]=='"') {
+				fields.back()+='"';
+				++i;
+				}
+			else if (c=='"') {
+				quoted=false;
+				}
+			else {
+				fields.back()+=c;
+				}
+			}
+		else if (c=='"') {
+			quoted=true;
+			}
+		else if (c==',') {
+			fields.emplace_back();
+			}
+		else if (c!='\r') {
+			fields.back()+=c;
+			}
+		}
+	return fields;
+}
+
+static string quoteCSV(const string& field)
+{
+	if (field.find_first_of(",\"\r\n")==string::npos) {
+		return field;
+		}
+	string r{"\""};
+	for (char c : field) {
+		if (c=='"') {
+			r+='"';
+			}
+		r+=c;
+		}
+	return r+'"';
+}
+
+/**
+ * Login as the talker stores it, lowercase with a capital first letter
+ *
+ * @return false when it can't be a login
+ */
+static bool normalizeLogin(string& login)
+{
+	boost::algorithm::trim(login);
+	if (login.length()<MIN_USERNAME_LEN || login.length()>MAX_USERNAME_LEN) {
+		return false;
+		}
+	for (char c : login) {
+		if (!isalpha((unsigned char)c)) {
+			return false;
+			}
+		}
+	boost::algorithm::to_lower(login);
+	login[0]=toupper(login[0]);
+	return true;
+}
+
+static bool addAccount(Chunk& chunk, string login, string password, int32_t level, bool hashed, const string& origin)
+{
+	if (!normalizeLogin(login) || password.empty() || level<0) {
+		cerr << "skipping " << origin << ": invalid login, password or level" << endl;
+		++g_skipped;
+		return false;
+		}
+	if (!hashed && !g_rehash) {
+		cerr << "skipping " << origin << ": plaintext password and no hasher threads" << endl;
+		++g_skipped;
+		return false;
+		}
+	chunk.push_back(Account{login, password, level, hashed});
+	return true;
+}
+
+static void readCSV(istream& in, ChunkQueue& out, int32_t defaultLevel)
+{
+	Chunk chunk;
+	chunk.reserve(CHUNK_SIZE);
+	string line;
+	for (uint64_t lineNo=1; getline(in, line); ++lineNo) {
+		if (line.empty() || line[0]=='#') {
+			continue;
+			}
+		vector<string> fields=splitCSV(line);
+		if (lineNo==1 && boost::iequals(fields[0], "login")) {
+			// header
+			continue;
+			}
+		int32_t level{defaultLevel};
+		if (fields.size()>2 && from_chars(fields[2].data(), fields[2].data()+fields[2].length(), level).ec!=errc()) {
+			level=-1;
+			}
+		string password{fields.size()>1 ? fields[1] : ""};
+		// bcrypt hashes are kept, anything else is a plaintext password
+		addAccount(chunk, fields[0], password, level, boost::starts_with(password, "$2"), "line "+to_string(lineNo));
+		if (chunk.size()>=CHUNK_SIZE) {
+			out.push(std::move(chunk));
+			chunk=Chunk();
+			chunk.reserve(CHUNK_SIZE);
+			}
+		}
+	if (!chunk.empty()) {
+		out.push(std::move(chunk));
+		}
+}
+
+static void readUserFiles(const fs::path& dir, ChunkQueue& out, int32_t defaultLevel)
+{
+	Chunk chunk;
+	chunk.reserve(CHUNK_SIZE);
+	for (const fs::directory_entry& entry : fs::directory_iterator(dir)) {
+		if (!entry.is_regular_file() || entry.path().extension()!=".D") {
+			continue;
+			}
+		ifstream file(entry.path());
+		string password;
+		getline(file, password);
+		boost::algorithm::trim(password);
+		// NUTS stores crypt() output, only Lotos files may hold plaintext
+		bool legacy{Security::DesCrypt::isHash(password)};
+		if (addAccount(chunk, entry.path().stem().string(), password, defaultLevel, legacy || boost::starts_with(password, "$2"),
+				entry.path().string()) && legacy) {
+			++g_legacy;
+			}
+		if (chunk.size()>=CHUNK_SIZE) {
+			out.push(std::move(chunk));
+			chunk=Chunk();
+			chunk.reserve(CHUNK_SIZE);
+			}
+		}
+	if (!chunk.empty()) {
+		out.push(std::move(chunk));
+		}
+}
+
+static void readerThread(const string& source, const string& format, int32_t defaultLevel, ChunkQueue* out)
+{
+	try {
+		if (format=="nuts") {
+			readUserFiles(source, *out, defaultLevel);
+			}
+		else if (source=="-") {
+			readCSV(cin, *out, defaultLevel);
+			}
+		else {
+			ifstream in(source);
+			if (!in) {
+				cerr << "can't open " << source << endl;
+				g_readFailed=true;
+				}
+			else {
+				readCSV(in, *out, defaultLevel);
+				}
+			}
+		}
+	catch (const exception& e) {
+		cerr << "reading " << source << " failed: " << e.what() << endl;
+		g_readFailed=true;
+		}
+	out->producerDone();
+}
+
+static void hasherThread(ChunkQueue* in, ChunkQueue* out)
+{
+	Chunk chunk;
+	while (in->pop(chunk)) {
+		for (Account& account : chunk) {
+			if (!account.hashed) {
+				account.password=Security::Blowfish::crypt(account.password);
+				++g_hashed;
+				}
+			}
+		out->push(std::move(chunk));
+		}
+	out->producerDone();
+}
+
+static int importAccounts(Database::Driver* db, ChunkQueue& in, uint32_t transactionRows, bool replace)
+{
+	string suffix;
+	if (replace && (suffix=db->getUpsertClause("login_key", {"login", "password", "level"})).empty()) {
+		cerr << "this database can't replace accounts" << endl;
+		return 1;
+		}
+
+	auto started=chrono::steady_clock::now();
+	uint64_t imported{0}, pending{0};
+	Chunk chunk;
+	while (in.pop(chunk)) {
+		Database::Transaction transaction(db);
+		if (!transaction.begin()) {
+			return 1;
+			}
+		Database::Insert insert(db);
+		insert.setQuery("INSERT INTO users (login, login_key, password, level) VALUES ", suffix);
+		do {
+			for (const Account& account : chunk) {
+				string row{db->escapeString(account.login)+", "+db->escapeString(boost::algorithm::to_lower_copy(account.login))+", "
+					+db->escapeString(account.password)+", "+to_string(account.level)};
+				if (!insert.addRow(row)) {
+					cerr << "import failed after " << imported << " accounts, the current transaction is rolled back" << endl;
+					return 1;
+					}
+				}
+			pending+=chunk.size();
+			}
+		while (pending<transactionRows && in.pop(chunk));
+		if (!insert.execute()) {
+			cerr << "import failed after " << imported << " accounts, the current transaction is rolled back" << endl;
+			return 1;
+			}
+		if (insert.getRowsWritten()!=pending) {
+			// every row added has to be in a statement the database took, or it would be lost without a word
+			cerr << "import wrote " << insert.getRowsWritten() << " of " << pending << " accounts after " << imported
+				<< ", the current transaction is rolled back" << endl;
+			return 1;
+			}
+		if (!transaction.commit()) {
+			cerr << "import failed after " << imported << " accounts, the current transaction is rolled back" << endl;
+			return 1;
+			}
+		imported+=pending;
+		pending=0;
+
+		double seconds=chrono::duration<double>(chrono::steady_clock::now()-started).count();
+		cerr << "\rimported " << imported << " accounts, " << (uint64_t)(imported/max(seconds, 0.001)) << "/s" << flush;
+		}
+	cerr << endl << "done: " << imported << " imported, " << g_hashed << " passwords hashed, " << g_legacy << " crypt() hashes kept, "
+		<< g_skipped << " skipped" << endl;
+	return 0;
+}
+
+static int exportAccounts(Database::Driver* db, const string& target)
+{
+	ofstream file;
+	if (target!="-") {
+		file.open(target, ios::out|ios::trunc);
+		if (!file) {
+			cerr << "can't open " << target << endl;
+			return 1;
+			}
+		}
+	ostream& out{target=="-" ? cout : file};
+
+	out << "login,password,level\n";
+	uint64_t exported{0};
+	// streamed, the whole table is never in memory
+	for (Database::Result_ptr result=db->streamQuery("SELECT login, password, level FROM users ORDER BY id"); result; result=result->advance()) {
+		out << quoteCSV(result->get<string>(0)) << ',' << quoteCSV(result->get<string>(1)) << ',' << result->getView(2) << '\n';
+		++exported;
+		}
+	out.flush();
+	cerr << "exported " << exported << " accounts" << endl;
+	return out ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	string cf, importSource, exportTarget, format;
+	uint32_t threads, transactionRows;
+	int32_t defaultLevel;
+
+	namespace po=boost::program_options;
+	po::options_description generic("Allowed options");
+	generic.add_options()
+		("configFile,c", po::value<string>(&cf)->default_value("etc/config.ini"), "config file, for the [database] section")
+		("help,h", "this help")
+		("import,i", po::value<string>(&importSource), "import accounts from a CSV file, '-' for stdin, or a directory of user files")
+		("export,e", po::value<string>(&exportTarget), "export accounts as CSV to a file, '-' for stdout")
+		("format,f", po::value<string>(&format)->default_value("csv"), "import format: csv (login,password,level) or nuts (<name>.D user files)")
+		("level,l", po::value<int32_t>(&defaultLevel)->default_value(1), "level of imported accounts that come without one")
+		("threads,t", po::value<uint32_t>(&threads)->default_value(boost::thread::hardware_concurrency()),
+			"threads hashing plaintext passwords with bcrypt, 0 imports hashed passwords only; bcrypt hashes and the crypt() "
+			"hashes of user files are kept as they are")
+		("transaction,n", po::value<uint32_t>(&transactionRows)->default_value(50000), "accounts per transaction")
+		("replace", "update accounts that exist already instead of failing")
+		;
+
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, generic), vm);
+		po::notify(vm);
+		}
+	catch (const po::error& e) {
+		cerr << e.what() << endl;
+		return 1;
+		}
+	if (vm.count("help") || vm.count("import")==vm.count("export")) {
+		cout << "Usage: " << argv[0] << " [options] --import <source> | --export <target>" << endl << generic << endl;
+		return vm.count("help") ? 0 : 1;
+		}
+	if (format!="csv" && format!="nuts") {
+		cerr << "unknown format " << format << endl;
+		return 1;
+		}
+	if (vm.count("import") && fs::is_directory(importSource)) {
+		format="nuts";
+		}
+
+	try {
+		boost::property_tree::ini_parser::read_ini(cf, options);
+		}
+	catch (const boost::property_tree::ini_parser_error& e) {
+		cerr << e.what() << endl;
+		return 1;
+		}
+	Database::Driver* db=Database::Driver::create();
+	if (!db || !db->isConnected()) {
+		cerr << "can't connect to the database" << endl;
+		return 1;
+		}
+	if (!Database::Migrator(db, Database::Migrator::getDefaultDir()).run()) {
+		cerr << "database schema is not up to date" << endl;
+		return 1;
+		}
+
+	if (vm.count("export")) {
+		return exportAccounts(db, exportTarget);
+		}
+
+	// reader -> hashers -> this thread, writing, the reader feeds this thread directly without hashers
+	g_rehash=threads>0;
+	ChunkQueue parsed(64, 1), hashed(64, max(1u, threads));
+	boost::thread_group workers;
+	workers.create_thread(boost::bind(readerThread, importSource, format, defaultLevel, threads ? &parsed : &hashed));
+	for (uint32_t i=0; i<threads; ++i) {
+		workers.create_thread(boost::bind(hasherThread, &parsed, &hashed));
+		}
+	int rc=importAccounts(db, hashed, max(1u, transactionRows), vm.count("replace"));
+	if (rc) {
+		// don't wait for the rest of the input
+		std::_Exit(rc);
+		}
+	workers.join_all();
+	return g_readFailed ? 1 : rc;
+}
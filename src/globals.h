@@ -4,6 +4,7 @@
 #include "Common/Scheduler.h"
 #include "Common/Dispatcher.h"
 #include "Common/Talker.h"
+#include "Common/WorkerPool.h"
 #include <boost/property_tree/ptree.hpp>
 #include <ctime>
 
@@ -22,6 +23,7 @@ EXTERN struct std::tm serverTimeTms;
 EXTERN Common::Scheduler g_scheduler;
 EXTERN Common::Dispatcher g_dispatcher;
 EXTERN Common::Talker g_talker;
+EXTERN Common::WorkerPool g_workers;
 
 	}
 
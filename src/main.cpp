@@ -3,14 +3,29 @@
 
 #include "Lotospp/buildinfo.h"
 #include "Log/Logger.h"
+#include "Log/LogSite.h"
+#include "Common/FlightRecorder.h"
+#include "Common/StatsSegment.h"
 #include "Strings/misc.h"
+#include "Network/Capture.h"
+#include "Network/LatencyTrace.h"
 #include "Network/ServiceManager.h"
+#include "Network/Protocols/Admin.h"
 #include "Network/Protocols/Telnet.h"
 #ifdef __EXCEPTION_TRACER__
 #	include "Common/ExceptionHandler.h"
 #endif
 #include "globals.h"
 #include "System/build_config.h"
+#ifdef WITH_DATABASE
+#	include "Database/Executor.h"
+#	include "Common/UserCache.h"
+#	include "Database/Driver.h"
+#	include "Database/GroupCommit.h"
+#	include "Database/Migrator.h"
+#	include <boost/make_shared.hpp>
+#	include <future>
+#endif
 #include <boost/program_options.hpp>
 #include <boost/program_options/detail/utf8_codecvt_facet.hpp>
 #include <boost/property_tree/ini_parser.hpp>
@@ -167,6 +182,12 @@ void init(void)
 		LOG(LINFO) << "Working dir: " << filesystem::canonical(options.get("global.workingDir", ""));
 		LOG(LINFO) << "Log dir: " << options.get("global.log.dir", "");
 		LOG(LINFO) << "User port: " << options.get("global.userPort", 0);
+		if (string userSocket{options.get("global.userSocket", "")}; !userSocket.empty()) {
+			LOG(LINFO) << "User socket: " << userSocket;
+			}
+		if (uint16_t adminPort{options.get<uint16_t>("global.adminPort", 0)}; adminPort) {
+			LOG(LINFO) << "Admin port: " << adminPort;
+			}
 		LOG(LINFO) << "Done.";
 		}
 
@@ -195,6 +216,60 @@ void ErrorMessage(const std::string& message)
 #endif
 }
 
+#ifdef WITH_DATABASE
+bool migrateDatabase()
+{
+	// settles the promise once, with false if the job is dropped without running
+	struct Migration {
+		std::promise<bool> migrated;
+		bool settled{false};
+
+		void settle(bool result)
+		{
+			settled=true;
+			migrated.set_value(result);
+		};
+		~Migration()
+		{
+			if (!settled) {
+				LOG(LERROR) << "Database: the migration job was dropped";
+				migrated.set_value(false);
+				}
+		};
+	};
+
+	// on the writer connection, nothing else uses the database yet
+	boost::shared_ptr<Migration> migration=boost::make_shared<Migration>();
+	std::future<bool> migrated{migration->migrated.get_future()};
+	bool queued=Database::Executor::instance()->addWriteJob([migration]() {
+			try {
+				migration->settle(Database::Migrator(Database::Driver::instance(), Database::Migrator::getDefaultDir()).run());
+				}
+			catch (const std::exception& e) {
+				LOG(LERROR) << "Database: migration failed: " << e.what();
+				migration->settle(false);
+				}
+			catch (...) {
+				LOG(LERROR) << "Database: migration failed";
+				migration->settle(false);
+				}
+		});
+	if (!queued) {
+		return false;
+		}
+	// the job holds the last reference now, it settles when run or dropped
+	migration.reset();
+	return migrated.get();
+}
+#endif
+
+void logReportEvent()
+{
+	// the suppressed records of LOGC() sites that went quiet
+	Log::LogSite::report();
+	g_scheduler.addEvent(Common::createSchedulerTask(1000, &logReportEvent));
+}
+
 boost::mutex g_loaderLock;
 boost::condition_variable g_loaderSignal;
 boost::unique_lock<boost::mutex> g_loaderUniqueLock(g_loaderLock);
@@ -203,6 +278,12 @@ void mainLoader(Network::ServiceManager* service_manager)
 {
 	// Tie ports and register services
 	service_manager->add<Network::Protocols::Telnet>(options.get<uint16_t>("global.userPort"));
+	if (string userSocket{options.get("global.userSocket", "")}; !userSocket.empty()) {
+		service_manager->add<Network::Protocols::Telnet>(Network::ServiceAddress(Network::Transport::TYPE_UNIX, userSocket));
+		}
+	if (uint16_t adminPort{options.get<uint16_t>("global.adminPort", 0)}; adminPort) {
+		service_manager->add<Network::Protocols::Admin>(adminPort);
+		}
 
 	g_talker.start(service_manager);
 	g_loaderSignal.notify_all();
@@ -249,11 +330,35 @@ int main(int argc, char **argv)
 #endif
 
 	init();
+	Common::FlightRecorder::instance()->start();
 	Network::ServiceManager servicer;
 
-	// Start scheduler and dispatcher threads
+	// Start scheduler, dispatcher and worker threads
 	g_dispatcher.start();
 	g_scheduler.start();
+	g_workers.start(options.get<uint32_t>("global.workerThreads", 0));
+	g_scheduler.addEvent(Common::createSchedulerTask(1000, &logReportEvent));
+	Network::Capture::instance()->start();
+	Network::LatencyTracer::instance()->start();
+	Common::StatsSegment::instance()->start();
+#ifdef WITH_DATABASE
+	// Open the database connections before accepting users
+	bool databaseUp{Database::Executor::instance()->start()>0};
+	if (!databaseUp) {
+		LOG(LERROR) << "Database: no connection, can't bring the schema up to date";
+		}
+	if (!databaseUp || !migrateDatabase()) {
+		ErrorMessage("Database schema migration failed.");
+		g_scheduler.shutdownAndWait();
+		g_dispatcher.shutdownAndWait();
+		g_workers.shutdownAndWait();
+		Database::Executor::instance()->shutdownAndWait();
+		LotosPP::Log::Logger::getInstance()->shutdown();
+		return 1;
+		}
+	Database::GroupCommit::instance()->start();
+	Common::UserCache::instance()->start();
+#endif
 	// Add load task
 	g_dispatcher.addTask(LotosPP::Common::createTask(boost::bind(mainLoader, &servicer)));
 
@@ -261,6 +366,7 @@ int main(int argc, char **argv)
 	g_loaderSignal.wait(g_loaderUniqueLock);
 
 	if (servicer.isRunning()) {
+		Common::StatsSegment::instance()->registerThread("network");
 		servicer.run();
 		}
 	else {
@@ -272,6 +378,19 @@ int main(int argc, char **argv)
 #endif
 	g_scheduler.shutdownAndWait();
 	g_dispatcher.shutdownAndWait();
+	g_workers.shutdownAndWait();
+#ifdef WITH_DATABASE
+	// nothing changes the cache anymore, write what is left while the writer still runs
+	Common::UserCache::instance()->flushAndWait();
+	Database::GroupCommit::instance()->shutdownAndWait();
+	Database::Executor::instance()->shutdownAndWait();
+#endif
+	Network::Capture::instance()->stop();
+	Network::LatencyTracer::instance()->stop();
+	Common::StatsSegment::instance()->stop();
+	Common::FlightRecorder::instance()->stop();
+	// the last records still sit in the log queues
+	LotosPP::Log::Logger::getInstance()->shutdown();
 	// Don't run destructors, may hang!
 
 	return 0;